@@ -16,14 +16,54 @@
 
 #pragma once
 
-#include <android/log.h>
+// same values as the android_LogPriority levels
+#define LOG_LEVEL_VERBOSE 2
+#define LOG_LEVEL_DEBUG 3
+#define LOG_LEVEL_INFO 4
+#define LOG_LEVEL_WARN 5
+#define LOG_LEVEL_ERROR 6
 
-#define ALOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__);
-#define ALOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__);
-#define ALOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__);
-#define ALOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__);
+// messages below this level are compiled out
+#ifndef LOG_MIN_LEVEL
 #ifdef NDEBUG
-#define ALOGV(...)
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_VERBOSE
+#endif
+#endif
+
+// LOG_DIRECT formats on the calling thread and writes straight to logcat, which is
+// handy when chasing a crash that would otherwise lose the last deferred messages
+#ifdef LOG_DIRECT
+#include <android/log.h>
+#define LOG_WRITE(level, ...) __android_log_print(level, LOG_TAG, __VA_ARGS__)
+#else
+#include "binary_log.hpp"
+#define LOG_WRITE(level, ...) BinaryLog::Write(level, LOG_TAG, __VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define ALOGE(...) LOG_WRITE(LOG_LEVEL_ERROR, __VA_ARGS__);
 #else
-#define ALOGV(...) __android_log_print(ANDROID_LOG_VERBOSE, LOG_TAG, __VA_ARGS__);
+#define ALOGE(...)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define ALOGW(...) LOG_WRITE(LOG_LEVEL_WARN, __VA_ARGS__);
+#else
+#define ALOGW(...)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define ALOGD(...) LOG_WRITE(LOG_LEVEL_DEBUG, __VA_ARGS__);
+#else
+#define ALOGD(...)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define ALOGI(...) LOG_WRITE(LOG_LEVEL_INFO, __VA_ARGS__);
+#else
+#define ALOGI(...)
+#endif
+#if LOG_MIN_LEVEL <= LOG_LEVEL_VERBOSE
+#define ALOGV(...) LOG_WRITE(LOG_LEVEL_VERBOSE, __VA_ARGS__);
+#else
+#define ALOGV(...)
 #endif
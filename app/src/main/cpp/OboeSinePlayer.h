@@ -1,36 +1,55 @@
 #include <oboe/Oboe.h>
-#include <math.h>
+#include <cstring>
+#include "audio_mixer.hpp"
+#include "latency_tuner.hpp"
+#include "platform.hpp"
+#include "sound_streamer.hpp"
+#include "trace.hpp"
 using namespace oboe;
 
-class OboeSinePlayer: public oboe::AudioStreamDataCallback {
+class OboeSinePlayer: public oboe::AudioStreamDataCallback, public oboe::AudioStreamErrorCallback {
 public:
 
+    OboeSinePlayer() : mStreamer(kSampleRate), mMixer(kSampleRate) {
+        mMixer.Play(OSCILLATOR_SINE, kFrequency, kAmplitude, 0.0f);
+    }
+
     virtual ~OboeSinePlayer() = default;
 
-    // Call this from Activity onResume()
+    // Opens the stream without starting it, so that starting it later is quick
+    int32_t openAudio() {
+        std::lock_guard<std::mutex> lock(mLock);
+        Result result = openStream();
+        if (result == Result::OK && mState == kClosed) mState = kPaused;
+        return (int32_t) result;
+    }
+
+    // Call this from Activity onResume(); opens the stream if it isn't open
     int32_t startAudio() {
         std::lock_guard<std::mutex> lock(mLock);
-        oboe::AudioStreamBuilder builder;
-        // The builder set methods can be chained for convenience.
-        Result result = builder.setSharingMode(oboe::SharingMode::Exclusive)
-                ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
-                ->setChannelCount(kChannelCount)
-                ->setSampleRate(kSampleRate)
-                ->setSampleRateConversionQuality(oboe::SampleRateConversionQuality::Medium)
-                ->setFormat(oboe::AudioFormat::Float)
-                ->setDataCallback(this)
-                ->openStream(mStream);
+        Result result = openStream();
         if (result != Result::OK) return (int32_t) result;
 
         // Typically, start the stream after querying some stream information, as well as some input from the user
         result = mStream->requestStart();
+        mState = result == Result::OK ? kPlaying : kPaused;
         return (int32_t) result;
     }
 
-    // Call this from Activity onPause()
+    // Call this from Activity onPause(). The stream stays open, so resuming is quick.
+    void pauseAudio() {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mStream) {
+            mStream->requestPause();
+            mState = kPaused;
+        }
+    }
+
+    // Call this from Activity onStop(). Closes the stream so the device can sleep.
     void stopAudio() {
         // Stop, close and delete in case not already closed.
         std::lock_guard<std::mutex> lock(mLock);
+        mState = kClosed;
         if (mStream) {
             mStream->stop();
             mStream->close();
@@ -38,32 +57,111 @@ public:
         }
     }
 
+    // Plays sounds; only call it from the thread that created the player
+    AudioMixer *getMixer() {
+        return &mMixer;
+    }
+
+    // Streams sounds for the mixer; the same thread as getMixer()
+    SoundStreamer *getStreamer() {
+        return &mStreamer;
+    }
+
+    void getStats(AudioStats *stats) {
+        std::lock_guard<std::mutex> lock(mLock);
+        memset(stats, 0, sizeof(*stats));
+        stats->open = mStream != nullptr;
+        stats->playing = mState == kPlaying;
+        stats->latencyMs = -1.0;
+        stats->reopens = mReopens;
+        if (mStream) {
+            stats->framesPerBurst = mStream->getFramesPerBurst();
+            stats->bufferSize = mStream->getBufferSizeInFrames();
+            stats->bufferCapacity = mStream->getBufferCapacityInFrames();
+            stats->sampleRate = mStream->getSampleRate();
+            ResultWithValue<double> latency = mStream->calculateLatencyMillis();
+            if (latency) stats->latencyMs = latency.value();
+        }
+        LatencyTuner::Stats tunerStats;
+        mTuner.GetStats(&tunerStats);
+        stats->underruns = tunerStats.underruns;
+        stats->bufferIncreases = tunerStats.increases;
+        stats->bufferDecreases = tunerStats.decreases;
+    }
+
     oboe::DataCallbackResult onAudioReady(oboe::AudioStream *oboeStream, void *audioData, int32_t numFrames) override {
-        float *floatData = (float *) audioData;
-        for (int i = 0; i < numFrames; ++i) {
-            float sampleValue = kAmplitude * sinf(mPhase);
-            for (int j = 0; j < kChannelCount; j++) {
-                floatData[i * kChannelCount + j] = sampleValue;
-            }
-            mPhase += mPhaseIncrement;
-            if (mPhase >= kTwoPi) mPhase -= kTwoPi;
+        // tracing here must not lock or allocate
+        Trace::SetThreadRealtime("AudioCallback");
+        TRACE_SCOPE("AudioCallback");
+        // Grow the buffer on underruns and shrink it back when they stop; AAudio only
+        ResultWithValue<int32_t> xRunCount = oboeStream->getXRunCount();
+        if (xRunCount && mTuner.Update(xRunCount.value(), numFrames)) {
+            oboeStream->setBufferSizeInFrames(mTuner.GetBufferSize());
         }
+        mMixer.Render((float *) audioData, numFrames, kChannelCount);
         return oboe::DataCallbackResult::Continue;
     }
 
+    // The stream was lost, e.g. the headset it played to went away: open a new
+    // one on whatever the device plays to now
+    void onErrorAfterClose(oboe::AudioStream *oboeStream, oboe::Result) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        // a stream closed or replaced since; the one open now is fine
+        if (oboeStream != mStream.get()) return;
+        mStream.reset();
+        if (mState == kClosed) return;
+        ++mReopens;
+        if (openStream() != Result::OK) {
+            mState = kClosed;
+            return;
+        }
+        if (mState == kPlaying && mStream->requestStart() != Result::OK) mState = kPaused;
+    }
+
 private:
+    // opens the stream unless it is open already, called with mLock held
+    Result openStream() {
+        if (mStream) return Result::OK;
+        oboe::AudioStreamBuilder builder;
+        // The builder set methods can be chained for convenience.
+        Result result = builder.setSharingMode(oboe::SharingMode::Exclusive)
+                ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
+                ->setChannelCount(kChannelCount)
+                ->setSampleRate(kSampleRate)
+                ->setSampleRateConversionQuality(oboe::SampleRateConversionQuality::Medium)
+                ->setFormat(oboe::AudioFormat::Float)
+                ->setDataCallback(this)
+                ->setErrorCallback(this)
+                ->openStream(mStream);
+        if (result != Result::OK) return result;
+
+        // The callback isn't running yet, so the tuner can start over
+        mTuner.Reset(mStream->getFramesPerBurst(), mStream->getBufferCapacityInFrames(),
+                     mStream->getSampleRate());
+        mStream->setBufferSizeInFrames(mTuner.GetBufferSize());
+        return Result::OK;
+    }
+
     std::mutex         mLock;
     std::shared_ptr<oboe::AudioStream> mStream;
 
+    // Lifecycle: closed, open but paused, or playing
+    static int constexpr kClosed = 0;
+    static int constexpr kPaused = 1;
+    static int constexpr kPlaying = 2;
+    int mState = kClosed;
+    int32_t mReopens = 0;
+
     // Stream params
     static int constexpr kChannelCount = 2;
     static int constexpr kSampleRate = 48000;
     // Wave params, these could be instance variables in order to modify at runtime
     static float constexpr kAmplitude = 0.5f;
     static float constexpr kFrequency = 440;
-    static float constexpr kPI = M_PI;
-    static float constexpr kTwoPi = kPI * 2;
-    static double constexpr mPhaseIncrement = kFrequency * kTwoPi / (double) kSampleRate;
-    // Keeps track of where the wave is
-    float mPhase = 0.0;
-};
\ No newline at end of file
+    // Decodes streamed sounds ahead; outlives the mixer, whose voices hold its streams
+    SoundStreamer mStreamer;
+    // Everything that plays, the tone included
+    AudioMixer mMixer;
+    // Finds the smallest buffer that doesn't underrun
+    LatencyTuner mTuner;
+};
@@ -1,3 +1,4 @@
+#include "android_platform.hpp"
 #include "native_engine.hpp"
 
 extern "C" {
@@ -10,7 +11,9 @@ extern "C" {
 */
 
 void android_main(struct android_app *app) {
-    NativeEngine *engine = new NativeEngine(app);
+    AndroidPlatform *platform = new AndroidPlatform(app);
+    NativeEngine *engine = new NativeEngine(platform);
     engine->GameLoop();
     delete engine;
+    delete platform;
 }
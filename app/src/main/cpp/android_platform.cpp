@@ -0,0 +1,480 @@
+#include "android_platform.hpp"
+#include "game-activity/native_app_glue/android_native_app_glue.h"
+#include <android/asset_manager.h>
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "Log.h"
+#include "input_cooker.hpp"
+#include "snapshot.hpp"
+#include "startup_graph.hpp"
+#include "swappy/swappyGL.h"
+#include "trace.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+#define VLOGD ALOGD
+
+// Debug builds replay this file from the app's files directory when it exists,
+// otherwise they record live input when the enable marker exists
+#define INPUT_REPLAY_FILENAME "input_replay.bin"
+#define INPUT_RECORD_FILENAME "input_record.bin"
+#define INPUT_RECORD_ENABLE_FILENAME "input_record.enable"
+
+// Debug builds trace while this marker exists and write the last
+// TRACE_EXPORT_FRAMES frames to TRACE_FILENAME whenever the app stops
+#define TRACE_ENABLE_FILENAME "trace.enable"
+#define TRACE_FILENAME "trace.json"
+#define TRACE_EXPORT_FRAMES 300
+
+// where saved program binaries go, under the app's files directory
+#define PIPELINE_CACHE_DIRECTORY "pipelines"
+
+// Built from the assets directory at build time and stored uncompressed in the
+// APK (see app/build.gradle), so it can be mapped in place
+#define ASSET_PACK_FILENAME "assets.pak"
+
+// threads decoding compressed assets
+#define ASSET_LOADER_WORKERS 1
+
+// threads running startup tasks besides the main thread
+#define STARTUP_WORKERS 3
+
+static_assert(PLATFORM_CMD_INIT_WINDOW == APP_CMD_INIT_WINDOW &&
+              PLATFORM_CMD_TERM_WINDOW == APP_CMD_TERM_WINDOW &&
+              PLATFORM_CMD_WINDOW_RESIZED == APP_CMD_WINDOW_RESIZED &&
+              PLATFORM_CMD_WINDOW_REDRAW_NEEDED == APP_CMD_WINDOW_REDRAW_NEEDED &&
+              PLATFORM_CMD_CONTENT_RECT_CHANGED == APP_CMD_CONTENT_RECT_CHANGED &&
+              PLATFORM_CMD_GAINED_FOCUS == APP_CMD_GAINED_FOCUS &&
+              PLATFORM_CMD_LOST_FOCUS == APP_CMD_LOST_FOCUS &&
+              PLATFORM_CMD_CONFIG_CHANGED == APP_CMD_CONFIG_CHANGED &&
+              PLATFORM_CMD_LOW_MEMORY == APP_CMD_LOW_MEMORY &&
+              PLATFORM_CMD_START == APP_CMD_START &&
+              PLATFORM_CMD_RESUME == APP_CMD_RESUME &&
+              PLATFORM_CMD_SAVE_STATE == APP_CMD_SAVE_STATE &&
+              PLATFORM_CMD_PAUSE == APP_CMD_PAUSE &&
+              PLATFORM_CMD_STOP == APP_CMD_STOP &&
+              PLATFORM_CMD_DESTROY == APP_CMD_DESTROY &&
+              PLATFORM_CMD_WINDOW_INSETS_CHANGED == APP_CMD_WINDOW_INSETS_CHANGED,
+              "PLATFORM_CMD_* must match the native app glue APP_CMD_* values");
+
+AndroidPlatform::AndroidPlatform(struct android_app *app)
+        : mEglLayer(app, &mShaderCompiler), mRenderContext(&mEglLayer, &mGpuResources) {
+    mApp = app;
+    mApp->userData = this;
+    mApp->onAppCmd = HandleAppCommand;
+
+    mCommandCallback = NULL;
+    mCommandUserData = NULL;
+
+    mViewportWidth = mViewportHeight = 0;
+    mSurfaceWidth = mSurfaceHeight = 0;
+
+    mTextInputState.text_UTF8 = "";
+    mTextInputState.text_length = 0;
+    mTextInputState.selection.start = 0;
+    mTextInputState.selection.end = 0;
+    mTextInputState.composingRegion.start = -1;
+    mTextInputState.composingRegion.end = -1;
+    mReplayedTextInput = false;
+
+    mInputFrame = 0;
+    mInputFrameOpen = false;
+    mJniEnv = NULL;
+
+    mTuningManager = NULL;
+    mPipelineCache = NULL;
+    mAssetLoader = NULL;
+
+    // Independent startup work overlaps on worker threads. Swappy and the
+    // choreographer stay on this thread, which has the JNI env and the looper.
+    StartupGraph startup;
+    const int swappy = startup.AddTask("swappy", [](void *data) {
+        AndroidPlatform *platform = (AndroidPlatform *) data;
+        ALOGI("Calling SwappyGL_init");
+        SwappyGL_init(platform->GetJniEnv(), platform->mApp->activity->javaGameActivity);
+        SwappyGL_setSwapIntervalNS(SWAPPY_SWAP_60FPS);
+    }, this, STARTUP_CALLING_THREAD);
+    // records frame times through Swappy's tracer, so it needs Swappy up
+    const int tuningFork = startup.AddTask("tuning fork", [](void *data) {
+        AndroidPlatform *platform = (AndroidPlatform *) data;
+        JavaVM *vm = platform->mApp->activity->vm;
+        JNIEnv *env = NULL;
+        if (vm->AttachCurrentThread(&env, NULL) != 0) {
+            ALOGE("*** FATAL ERROR: Failed to attach startup thread to JNI.");
+        }
+        // a launch with a snapshot to resume from is a warm start
+        SnapshotReader snapshot;
+        const bool warmStart = snapshot.Open(platform->mApp->savedState,
+                                             platform->mApp->savedStateSize);
+        platform->mTuningManager = new TuningManager(env,
+                                                     platform->mApp->activity->javaGameActivity,
+                                                     warmStart);
+        vm->DetachCurrentThread();
+    }, this);
+    startup.AddDependency(tuningFork, swappy);
+    const int choreographer = startup.AddTask("choreographer", [](void *data) {
+        AndroidPlatform *platform = (AndroidPlatform *) data;
+        platform->mTuningManager->InitializeChoreographerCallback(platform->mApp->config);
+    }, this, STARTUP_CALLING_THREAD);
+    startup.AddDependency(choreographer, tuningFork);
+    startup.AddTask("pipeline cache", [](void *data) {
+        AndroidPlatform *platform = (AndroidPlatform *) data;
+        const char *dataPath = platform->mApp->activity->internalDataPath;
+        const std::string directory = std::string(dataPath != NULL ? dataPath : ".") +
+                                      "/" PIPELINE_CACHE_DIRECTORY;
+        platform->mPipelineCache = new PipelineCache(&platform->mShaderCompiler, directory);
+    }, this);
+    startup.AddTask("asset pack", [](void *data) {
+        AndroidPlatform *platform = (AndroidPlatform *) data;
+        if (platform->OpenAssetPack()) {
+            platform->mAssetLoader = new AssetLoader(&platform->mAssetPack, ASSET_LOADER_WORKERS);
+        }
+    }, this);
+    // the stream is started with the first window, opening it is the slow part
+    startup.AddTask("audio", [](void *data) {
+        ((AndroidPlatform *) data)->mSinePlayer.openAudio();
+    }, this);
+    startup.Run(STARTUP_WORKERS);
+    startup.Log();
+    mTuningManager->ReportStartup(startup);
+
+    RegisterGpuResources();
+
+#ifndef NDEBUG
+    if (mApp->activity->internalDataPath != NULL) {
+        std::string dataPath(mApp->activity->internalDataPath);
+        if (access((dataPath + "/" INPUT_REPLAY_FILENAME).c_str(), R_OK) == 0) {
+            StartInputReplay((dataPath + "/" INPUT_REPLAY_FILENAME).c_str());
+        } else if (access((dataPath + "/" INPUT_RECORD_ENABLE_FILENAME).c_str(), F_OK) == 0) {
+            StartInputRecording((dataPath + "/" INPUT_RECORD_FILENAME).c_str());
+        }
+        if (access((dataPath + "/" TRACE_ENABLE_FILENAME).c_str(), F_OK) == 0) {
+            mTracePath = dataPath + "/" TRACE_FILENAME;
+            Trace::Start();
+        }
+    }
+#endif
+}
+
+AndroidPlatform::~AndroidPlatform() {
+    if (mInputFrameOpen) {
+        mInputRecorder.EndFrame(mInputFrame, mClock.NowNs());
+    }
+    mSinePlayer.stopAudio();
+    delete mTuningManager;
+    SwappyGL_destroy();
+    mRenderContext.KillContext();
+    delete mPipelineCache;
+    delete mAssetLoader;
+}
+
+void AndroidPlatform::RegisterGpuResources() {
+    // the new context has its default state, whatever the backend last set
+    GpuResourceRecipe renderState = {"render state", GPU_RESOURCE_PRIORITY_DRAW,
+                                     [](void *data) {
+                                         AndroidPlatform *platform = (AndroidPlatform *) data;
+                                         platform->mRenderBackend.Invalidate();
+                                         platform->mViewportWidth = 0;
+                                         platform->mViewportHeight = 0;
+                                         return true;
+                                     }, NULL, this};
+    // programs are built on first use and in the background, their binaries stay on disk
+    GpuResourceRecipe pipelines = {"pipelines", GPU_RESOURCE_PRIORITY_DRAW, NULL,
+                                   [](void *data, bool deleteObjects) {
+                                       ((PipelineCache *) data)->ForgetPrograms();
+                                   }, mPipelineCache};
+    // allocated by the first frame rendered below the surface size
+    GpuResourceRecipe scaledTarget = {"scaled target", GPU_RESOURCE_PRIORITY_DRAW, NULL,
+                                      [](void *data, bool deleteObjects) {
+                                          ((GlScaledTarget *) data)->Release(deleteObjects);
+                                      }, &mScaledTarget};
+    // frames are judged on CPU time until the timer is back
+    GpuResourceRecipe gpuTimer = {"gpu timer", GPU_RESOURCE_PRIORITY_LATER,
+                                  [](void *data) {
+                                      // no timer queries is fine too
+                                      ((GlGpuTimer *) data)->Init();
+                                      return true;
+                                  },
+                                  [](void *data, bool deleteObjects) {
+                                      ((GlGpuTimer *) data)->Release(deleteObjects);
+                                  }, &mGpuTimer};
+    mGpuResources.Register(renderState);
+    mGpuResources.Register(pipelines);
+    mGpuResources.Register(scaledTarget);
+    mGpuResources.Register(gpuTimer);
+}
+
+bool AndroidPlatform::OpenAssetPack() {
+    AAsset *asset = AAssetManager_open(mApp->activity->assetManager, ASSET_PACK_FILENAME,
+                                       AASSET_MODE_STREAMING);
+    if (asset == NULL) {
+        ALOGW("AndroidPlatform: no %s, assets load through the asset manager only",
+              ASSET_PACK_FILENAME);
+        return false;
+    }
+    off64_t offset, length;
+    const int fd = AAsset_openFileDescriptor64(asset, &offset, &length);
+    AAsset_close(asset);
+    if (fd < 0) {
+        ALOGE("AndroidPlatform: %s is compressed in the APK and can't be mapped",
+              ASSET_PACK_FILENAME);
+        return false;
+    }
+    const bool opened = mAssetPack.OpenFd(fd, offset, length);
+    close(fd);
+    return opened;
+}
+
+JNIEnv *AndroidPlatform::GetJniEnv() {
+    if (!mJniEnv) {
+        ALOGI("Attaching current thread to JNI.");
+        if (0 != mApp->activity->vm->AttachCurrentThread(&mJniEnv, NULL)) {
+            ALOGE("*** FATAL ERROR: Failed to attach thread to JNI.");
+        }
+        ALOGI("Attached current thread to JNI, %p", mJniEnv);
+    }
+    return mJniEnv;
+}
+
+void AndroidPlatform::HandleAppCommand(struct android_app *app, int32_t cmd) {
+    AndroidPlatform *platform = (AndroidPlatform *) app->userData;
+    if (platform->mCommandCallback != NULL) {
+        platform->mCommandCallback(platform->mCommandUserData, cmd);
+    }
+    if (cmd == APP_CMD_STOP && !platform->mTracePath.empty()) {
+        const uint64_t frame = Trace::GetFrame();
+        Trace::WriteJsonFile(platform->mTracePath.c_str(),
+                             frame > TRACE_EXPORT_FRAMES ? frame - TRACE_EXPORT_FRAMES : 0, frame);
+    }
+}
+
+void AndroidPlatform::SetCommandCallback(PlatformCommandCallback callback, void *userData) {
+    mCommandCallback = callback;
+    mCommandUserData = userData;
+}
+
+bool AndroidPlatform::PollEvent(int timeoutMs) {
+    int events;
+    struct android_poll_source* source;
+
+    if (ALooper_pollAll(timeoutMs, NULL, &events, (void **) &source) < 0) {
+        return false;
+    }
+    if (source != NULL) {
+        source->process(mApp, source);
+    }
+    return true;
+}
+
+bool AndroidPlatform::IsDestroyRequested() {
+    return mApp->destroyRequested != 0;
+}
+
+void AndroidPlatform::PollInput(TouchBatch *batch) {
+    // everything the previous frame's input produced has been seen, close that frame
+    if (mInputFrameOpen) {
+        mInputRecorder.EndFrame(mInputFrame++, mClock.NowNs());
+    }
+    mInputFrameOpen = true;
+
+    // Swap input buffers so we don't miss any events while processing inputBuffer.
+    android_input_buffer* inputBuffer = android_app_swap_input_buffers(mApp);
+
+    if (inputBuffer != nullptr && inputBuffer->motionEventsCount != 0) {
+        // live touches are ignored while a recording is being replayed
+        if (!mInputReplayer.IsOpen()) {
+            mInputRecorder.RecordMotionEvents(inputBuffer);
+            // Cook every pointer and historical sample of this frame in one pass
+            CookInputBuffer(inputBuffer, batch);
+        }
+        android_app_clear_motion_events(inputBuffer);
+    }
+
+    if (mInputReplayer.IsOpen()) {
+        ReplayInputFrame(batch);
+    }
+}
+
+void AndroidPlatform::ReplayInputFrame(TouchBatch *batch) {
+    InputRecordFrame frame;
+    InputReplayText text;
+    const android_input_buffer *inputBuffer = mInputReplayer.ReadFrame(&frame, &text);
+    if (inputBuffer == nullptr) {
+        ALOGI("AndroidPlatform: input replay finished after %llu frames",
+              (unsigned long long) mInputFrame);
+        mInputReplayer.Close();
+        return;
+    }
+
+    // replayed input goes through exactly the same cooking path as live input
+    CookInputBuffer(inputBuffer, batch);
+
+    if (text.present) {
+        mTextInput.assign(text.text, text.textLength);
+        mTextInputState.text_UTF8 = mTextInput.c_str();
+        mTextInputState.text_length = text.textLength;
+        mTextInputState.selection.start = text.selectionStart;
+        mTextInputState.selection.end = text.selectionEnd;
+        mTextInputState.composingRegion.start = text.composingStart;
+        mTextInputState.composingRegion.end = text.composingEnd;
+        mReplayedTextInput = true;
+    }
+}
+
+bool AndroidPlatform::StartInputRecording(const char *path) {
+    mInputReplayer.Close();
+    return mInputRecorder.Open(path);
+}
+
+bool AndroidPlatform::StartInputReplay(const char *path) {
+    mInputRecorder.Close();
+    return mInputReplayer.Open(path);
+}
+
+bool AndroidPlatform::PollTextInputChanged() {
+    bool changed = false;
+    if (mApp->textInputState) {
+        // live text input is ignored while a recording is being replayed
+        changed = !mInputReplayer.IsOpen();
+        mApp->textInputState = 0;
+    }
+    if (mReplayedTextInput) {
+        changed = true;
+        mReplayedTextInput = false;
+    }
+    return changed;
+}
+
+void AndroidPlatform::GetTextInput(std::string *text) {
+    if (!mInputReplayer.IsOpen()) {
+        auto activity = mApp->activity;
+        GameActivity_getTextInputState(activity, [](void *context, const GameTextInputState *state) {
+            VLOGD("InputString: %s", state->text_UTF8);
+            AndroidPlatform *platform = (AndroidPlatform *) context;
+            // the state only lives as long as this callback, keep our own copy of the text
+            platform->mTextInput.assign(state->text_UTF8, state->text_length);
+            platform->mTextInputState = *state;
+            platform->mTextInputState.text_UTF8 = platform->mTextInput.c_str();
+            platform->mInputRecorder.RecordTextInput(state);
+        }, this);
+        ARect insets;
+        GameTextInput_getImeInsets(GameActivity_getTextInput(activity), &insets);
+//        VLOGD("NativeEngine", "IME insets: left=%d right=%d top=%d bottom=%d",
+//                            insets.left, insets.right, insets.top, insets.bottom);
+    }
+    *text = mTextInput;
+}
+
+void AndroidPlatform::SetTextInputVisible(bool visible) {
+    if (visible) {
+        GameActivity_setTextInputState(mApp->activity, &mTextInputState);
+        GameActivity_showSoftInput(mApp->activity, 0);
+    } else {
+        GameActivity_hideSoftInput(mApp->activity, 0);
+    }
+}
+
+bool AndroidPlatform::AttachWindow() {
+    if (mApp->window == NULL) {
+        return false;
+    }
+    SwappyGL_setWindow(mApp->window);
+    return true;
+}
+
+void AndroidPlatform::GetSurfaceSize(int *width, int *height) {
+    eglQuerySurface(mEglLayer.GetDisplay(), mEglLayer.GetSurface(), EGL_WIDTH, width);
+    eglQuerySurface(mEglLayer.GetDisplay(), mEglLayer.GetSurface(), EGL_HEIGHT, height);
+    mSurfaceWidth = *width;
+    mSurfaceHeight = *height;
+}
+
+void AndroidPlatform::BeginFrame(int width, int height) {
+    mGpuTimer.BeginFrame();
+    if (!mScaledTarget.Bind(width, height, mSurfaceWidth, mSurfaceHeight)) {
+        // render at full size instead
+        width = mSurfaceWidth;
+        height = mSurfaceHeight;
+    }
+    if (width != mViewportWidth || height != mViewportHeight) {
+        mViewportWidth = width;
+        mViewportHeight = height;
+        glViewport(0, 0, width, height);
+    }
+}
+
+bool AndroidPlatform::Present() {
+    mScaledTarget.Resolve();
+    mGpuTimer.EndFrame();
+
+    // a lost context or surface is recreated by the next PrepareToRender()
+    return mRenderContext.Present();
+}
+
+int64_t AndroidPlatform::GetPresentPeriodNs() {
+    return (int64_t) SwappyGL_getSwapIntervalNS();
+}
+
+void AndroidPlatform::UpdateWindowInsets() {
+    ARect insets;
+    // Log all the insets types
+    for (int type = 0; type < GAMECOMMON_INSETS_TYPE_COUNT; ++type) {
+        GameActivity_getWindowInsets(mApp->activity, (GameCommonInsetsType)type, &insets);
+//        VLOGD("%s insets: left=%d right=%d top=%d bottom=%d",
+//              sInsetsTypeName[type], insets.left, insets.right, insets.top, insets.bottom);
+    }
+}
+
+bool AndroidPlatform::GetSavedState(const void **data, size_t *size) {
+    // the glue frees it once the activity resumes
+    if (mApp->savedState == NULL || mApp->savedStateSize == 0) {
+        return false;
+    }
+    *data = mApp->savedState;
+    *size = mApp->savedStateSize;
+    return true;
+}
+
+void AndroidPlatform::SaveState(const void *data, size_t size) {
+    // the glue hands the state to the activity once this command returns, then frees it
+    free(mApp->savedState);
+    mApp->savedState = malloc(size);
+    if (mApp->savedState == NULL) {
+        ALOGE("AndroidPlatform: no memory to save %zu bytes of state", size);
+        mApp->savedStateSize = 0;
+        return;
+    }
+    memcpy(mApp->savedState, data, size);
+    mApp->savedStateSize = size;
+}
+
+void AndroidPlatform::OpenAudio() {
+    mSinePlayer.openAudio();
+}
+
+void AndroidPlatform::StartAudio() {
+    mSinePlayer.startAudio();
+}
+
+void AndroidPlatform::PauseAudio() {
+    mSinePlayer.pauseAudio();
+}
+
+void AndroidPlatform::StopAudio() {
+    mSinePlayer.stopAudio();
+}
+
+bool AndroidPlatform::GetAudioStats(AudioStats *stats) {
+    mSinePlayer.getStats(stats);
+    return true;
+}
+
+void AndroidPlatform::KillSurface() {
+    mRenderContext.KillSurface();
+}
+
+bool AndroidPlatform::PrepareToRender() {
+    return mRenderContext.Prepare();
+}
@@ -0,0 +1,163 @@
+#ifndef agdktunnel_android_platform_hpp
+#define agdktunnel_android_platform_hpp
+
+#include <EGL/egl.h>
+#include <game-text-input/gametextinput.h>
+#include <string>
+#include "OboeSinePlayer.h"
+#include "asset_loader.hpp"
+#include "asset_pack.hpp"
+#include "egl_context_layer.hpp"
+#include "gl_gpu_timer.hpp"
+#include "gl_render_backend.hpp"
+#include "gl_scaled_target.hpp"
+#include "gl_shader_compiler.hpp"
+#include "gpu_resource_registry.hpp"
+#include "input_recorder.hpp"
+#include "pipeline_cache.hpp"
+#include "platform.hpp"
+#include "render_context.hpp"
+#include "tuning_manager.hpp"
+
+struct android_app;
+
+// Platform implementation on top of GameActivity's native app glue, EGL and SwappyGL.
+class AndroidPlatform : public Platform {
+public:
+    AndroidPlatform(struct android_app *app);
+
+    ~AndroidPlatform() override;
+
+    // returns the JNI environment
+    JNIEnv *GetJniEnv();
+
+    // record live input to a file, or replay a recording instead of live input
+    bool StartInputRecording(const char *path);
+    bool StartInputReplay(const char *path);
+
+    void SetCommandCallback(PlatformCommandCallback callback, void *userData) override;
+    bool PollEvent(int timeoutMs) override;
+    bool IsDestroyRequested() override;
+
+    void PollInput(TouchBatch *batch) override;
+    bool PollTextInputChanged() override;
+    void GetTextInput(std::string *text) override;
+    void SetTextInputVisible(bool visible) override;
+
+    bool AttachWindow() override;
+    bool PrepareToRender() override;
+    void GetSurfaceSize(int *width, int *height) override;
+    void BeginFrame(int width, int height) override;
+
+    RenderBackend *GetRenderBackend() override {
+        return &mRenderBackend;
+    }
+
+    PipelineCache *GetPipelineCache() override {
+        return mPipelineCache;
+    }
+
+    AssetLoader *GetAssetLoader() override {
+        return mAssetLoader;
+    }
+
+    RenderContext *GetRenderContext() override {
+        return &mRenderContext;
+    }
+
+    bool Present() override;
+    int64_t GetPresentPeriodNs() override;
+
+    int64_t GetGpuFrameNs() override {
+        return mGpuTimer.GetLastFrameNs();
+    }
+    void KillSurface() override;
+    void UpdateWindowInsets() override;
+    bool GetSavedState(const void **data, size_t *size) override;
+    void SaveState(const void *data, size_t size) override;
+
+    FrameClock *GetClock() override {
+        return &mClock;
+    }
+
+    PerformanceReporter *GetPerformanceReporter() override {
+        return mTuningManager;
+    }
+
+    AudioMixer *GetAudioMixer() override {
+        return mSinePlayer.getMixer();
+    }
+
+    SoundStreamer *GetSoundStreamer() override {
+        return mSinePlayer.getStreamer();
+    }
+
+    void OpenAudio() override;
+    void StartAudio() override;
+    void PauseAudio() override;
+    void StopAudio() override;
+    bool GetAudioStats(AudioStats *stats) override;
+
+private:
+    static void HandleAppCommand(struct android_app *app, int32_t cmd);
+
+    void ReplayInputFrame(TouchBatch *batch);
+
+    // the GL objects made again on every new context
+    void RegisterGpuResources();
+
+    bool OpenAssetPack();
+
+    // android_app structure
+    struct android_app *mApp;
+
+    PlatformCommandCallback mCommandCallback;
+    void *mCommandUserData;
+
+    int mViewportWidth, mViewportHeight;
+    GlRenderBackend mRenderBackend;
+
+    // frames rendered below the surface size go here first
+    int mSurfaceWidth, mSurfaceHeight;
+    GlScaledTarget mScaledTarget;
+    GlGpuTimer mGpuTimer;
+
+    // program binaries persist in the app's files directory
+    GlShaderCompiler mShaderCompiler;
+    PipelineCache *mPipelineCache;
+
+    // display, surface and context, recreated after whichever of them is lost
+    EglContextLayer mEglLayer;
+    GpuResourceRegistry mGpuResources;
+    RenderContext mRenderContext;
+
+    // the asset pack, mapped straight out of the APK; NULL loader if there is none
+    AssetPack mAssetPack;
+    AssetLoader *mAssetLoader;
+
+    SteadyFrameClock mClock;
+
+    // soft keyboard state; mTextInputState.text_UTF8 points into mTextInput
+    GameTextInputState mTextInputState;
+    std::string mTextInput;
+    bool mReplayedTextInput;
+
+    // input record/replay for deterministic performance runs
+    InputRecorder mInputRecorder;
+    InputReplayer mInputReplayer;
+    uint64_t mInputFrame;
+    bool mInputFrameOpen;
+
+    // where the trace goes when the app stops, empty when not tracing
+    std::string mTracePath;
+
+    // JNI environment
+    JNIEnv *mJniEnv;
+
+    // Tuning manager instance
+    TuningManager *mTuningManager;
+
+    OboeSinePlayer mSinePlayer;
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include "asset_loader.hpp"
+#include <cstdio>
+#include <cstring>
+#include "Log.h"
+#include "trace.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+AssetLoader::AssetLoader(const AssetPack *pack, int workerCount) {
+    mPack = pack;
+    mNextSequence = 0;
+    mQuit = false;
+    memset(&mStats, 0, sizeof(mStats));
+
+    if (workerCount < 1) {
+        workerCount = 1;
+    }
+    for (int i = 0; i < workerCount; ++i) {
+        mThreads.push_back(std::thread(&AssetLoader::WorkerMain, this, i));
+    }
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mQuit = true;
+    }
+    mQueued.notify_all();
+    for (size_t i = 0; i < mThreads.size(); ++i) {
+        mThreads[i].join();
+    }
+
+    // whatever is left was never decoded
+    while (!mQueue.empty()) {
+        AssetRequest *request = mQueue.top();
+        mQueue.pop();
+        if (request->released) {
+            Free(request);
+        } else {
+            request->state.store(ASSET_LOAD_FAILED, std::memory_order_release);
+        }
+    }
+}
+
+AssetRequest *AssetLoader::Load(const char *name, int priority) {
+    const int index = mPack->Find(name);
+    if (index < 0) {
+        ALOGW("AssetLoader: no asset %s", name);
+        return NULL;
+    }
+
+    AssetRequest *request = new AssetRequest;
+    request->index = index;
+    request->priority = priority;
+    request->buffer = NULL;
+    request->view.data = NULL;
+    request->view.size = 0;
+    request->requestNs = Trace::NowNs();
+    request->released = false;
+
+    std::unique_lock<std::mutex> lock(mLock);
+    ++mStats.requests;
+    if (mPack->GetView(index, &request->view)) {
+        ++mStats.views;
+        lock.unlock();
+        mPack->Prefetch(index);
+        request->sequence = 0;
+        request->state.store(ASSET_LOAD_READY, std::memory_order_release);
+        return request;
+    }
+
+    request->sequence = mNextSequence++;
+    request->state.store(ASSET_LOAD_PENDING, std::memory_order_relaxed);
+    mQueue.push(request);
+    lock.unlock();
+    mQueued.notify_one();
+    return request;
+}
+
+bool AssetLoader::GetData(const AssetRequest *request, AssetView *view) {
+    if (GetState(request) != ASSET_LOAD_READY) {
+        return false;
+    }
+    *view = request->view;
+    return true;
+}
+
+int AssetLoader::Wait(AssetRequest *request) {
+    int state = GetState(request);
+    if (state != ASSET_LOAD_PENDING) {
+        return state;
+    }
+    TRACE_SCOPE("AssetLoader::Wait");
+    std::unique_lock<std::mutex> lock(mLock);
+    mFinished.wait(lock, [request]() {
+        return GetState(request) != ASSET_LOAD_PENDING;
+    });
+    return GetState(request);
+}
+
+void AssetLoader::Release(AssetRequest *request) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (GetState(request) == ASSET_LOAD_PENDING) {
+            // queued or being decoded, whoever finishes it frees it
+            request->released = true;
+            return;
+        }
+    }
+    Free(request);
+}
+
+void AssetLoader::Free(AssetRequest *request) {
+    delete[] request->buffer;
+    delete request;
+}
+
+void AssetLoader::WorkerMain(int index) {
+    char name[32];
+    snprintf(name, sizeof(name), "AssetLoader %d", index);
+    Trace::SetThreadName(name);
+
+    std::unique_lock<std::mutex> lock(mLock);
+    while (1) {
+        mQueued.wait(lock, [this]() {
+            return mQuit || !mQueue.empty();
+        });
+        if (mQuit) {
+            return;
+        }
+        AssetRequest *request = mQueue.top();
+        mQueue.pop();
+        if (request->released) {
+            ++mStats.cancelled;
+            Free(request);
+            continue;
+        }
+        lock.unlock();
+
+        const int64_t startNs = Trace::NowNs();
+        bool decoded;
+        {
+            TRACE_SCOPE("AssetLoader::Decode");
+            const AssetPackEntry &entry = mPack->GetEntry(request->index);
+            request->buffer = new uint8_t[entry.size > 0 ? entry.size : 1];
+            decoded = mPack->Read(request->index, request->buffer);
+            if (decoded) {
+                request->view.data = request->buffer;
+                request->view.size = entry.size;
+            }
+        }
+        const int64_t decodeNs = Trace::NowNs() - startNs;
+
+        lock.lock();
+        Finish(request, decoded, decodeNs);
+    }
+}
+
+// called with the lock held
+void AssetLoader::Finish(AssetRequest *request, bool decoded, int64_t decodeNs) {
+    mStats.decodeNs += decodeNs;
+    if (decoded) {
+        const int64_t latencyNs = Trace::NowNs() - request->requestNs;
+        ++mStats.decodes;
+        mStats.decodedBytes += request->view.size;
+        mStats.totalLatencyNs += latencyNs;
+        if (latencyNs > mStats.maxLatencyNs) {
+            mStats.maxLatencyNs = latencyNs;
+        }
+    } else {
+        ++mStats.failures;
+    }
+
+    if (request->released) {
+        ++mStats.cancelled;
+        Free(request);
+        return;
+    }
+    request->state.store(decoded ? ASSET_LOAD_READY : ASSET_LOAD_FAILED,
+                         std::memory_order_release);
+    mFinished.notify_all();
+}
+
+AssetLoader::Stats AssetLoader::GetStats() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
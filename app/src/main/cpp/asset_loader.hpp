@@ -0,0 +1,119 @@
+#ifndef agdktunnel_asset_loader_hpp
+#define agdktunnel_asset_loader_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "asset_pack.hpp"
+
+// states of an AssetRequest
+#define ASSET_LOAD_PENDING 0
+#define ASSET_LOAD_READY 1
+#define ASSET_LOAD_FAILED 2
+
+struct AssetRequest {
+    int index;
+    int priority;
+    // orders requests of the same priority
+    uint64_t sequence;
+    std::atomic<int> state;
+    // the asset's bytes once ready
+    AssetView view;
+    // owns the decoded bytes, NULL for views into the pack
+    uint8_t *buffer;
+    int64_t requestNs;
+    // the owner let go while the request was queued or decoding, guarded by the loader's lock
+    bool released;
+};
+
+/*
+ * Loads assets out of a mapped pack. Uncompressed assets are ready at once as
+ * views into the mapping, and the kernel is asked to read their pages ahead.
+ * Compressed ones are queued and decoded by worker threads, highest priority
+ * first and in request order within a priority.
+ *
+ * Requests may be polled from any thread; every request must be released once.
+ */
+class AssetLoader {
+public:
+    struct Stats {
+        uint64_t requests;
+        // ready at once as views into the pack
+        uint64_t views;
+        uint64_t decodes;
+        uint64_t failures;
+        // released before they were decoded
+        uint64_t cancelled;
+        uint64_t decodedBytes;
+        // time the workers spent decoding
+        int64_t decodeNs;
+        // from request to ready, over the decoded requests
+        int64_t totalLatencyNs;
+        int64_t maxLatencyNs;
+    };
+
+    // the pack must stay open while the loader exists
+    AssetLoader(const AssetPack *pack, int workerCount);
+
+    // cancels whatever is still queued
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader &) = delete;
+    AssetLoader &operator=(const AssetLoader &) = delete;
+
+    const AssetPack *GetPack() const {
+        return mPack;
+    }
+
+    // starts loading the asset, NULL if the pack has no such asset
+    AssetRequest *Load(const char *name, int priority);
+
+    static int GetState(const AssetRequest *request) {
+        return request->state.load(std::memory_order_acquire);
+    }
+
+    // the asset's bytes, false unless the request is ready
+    static bool GetData(const AssetRequest *request, AssetView *view);
+
+    // blocks until the request is no longer pending and returns its state
+    int Wait(AssetRequest *request);
+
+    // frees the request and its bytes, or cancels it if it is still pending
+    void Release(AssetRequest *request);
+
+    Stats GetStats();
+
+private:
+    struct RequestOrder {
+        bool operator()(const AssetRequest *a, const AssetRequest *b) const {
+            if (a->priority != b->priority) {
+                return a->priority < b->priority;
+            }
+            return a->sequence > b->sequence;
+        }
+    };
+
+    void WorkerMain(int index);
+    void Finish(AssetRequest *request, bool decoded, int64_t decodeNs);
+    static void Free(AssetRequest *request);
+
+    const AssetPack *mPack;
+
+    std::mutex mLock;
+    // signals new requests to the workers
+    std::condition_variable mQueued;
+    // signals finished requests to waiters
+    std::condition_variable mFinished;
+    std::priority_queue<AssetRequest *, std::vector<AssetRequest *>, RequestOrder> mQueue;
+    uint64_t mNextSequence;
+    bool mQuit;
+    Stats mStats;
+
+    std::vector<std::thread> mThreads;
+};
+
+#endif
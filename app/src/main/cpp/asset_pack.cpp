@@ -0,0 +1,284 @@
+#include "asset_pack.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include "Log.h"
+#include "lz4_block.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+namespace {
+    const uint64_t kFnvOffset = 14695981039346656037ULL;
+    const uint64_t kFnvPrime = 1099511628211ULL;
+
+    const uint64_t kContentPrime1 = 0x9e3779b185ebca87ULL;
+    const uint64_t kContentPrime2 = 0xc2b2ae3d27d4eb4fULL;
+
+    inline uint64_t read64(const uint8_t *p) {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t rotate_left(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline uint64_t mix_lane(uint64_t lane, uint64_t word) {
+        return rotate_left(lane + word * kContentPrime2, 31) * kContentPrime1;
+    }
+
+    inline uint64_t finalize(uint64_t hash) {
+        hash ^= hash >> 33;
+        hash *= kContentPrime2;
+        hash ^= hash >> 29;
+        hash *= kContentPrime1;
+        return hash ^ (hash >> 32);
+    }
+
+    bool is_aligned(uint64_t offset) {
+        return (offset & (ASSET_PACK_ALIGNMENT - 1)) == 0;
+    }
+
+    // orders the table of contents, the writer sorts with the same rule
+    int compare_entry(uint64_t nameHash, const char *name, size_t nameLength,
+                      const AssetPackEntry &entry, const char *entryName) {
+        if (nameHash != entry.nameHash) {
+            return nameHash < entry.nameHash ? -1 : 1;
+        }
+        const size_t common = nameLength < entry.nameLength ? nameLength : entry.nameLength;
+        const int order = memcmp(name, entryName, common);
+        if (order != 0) {
+            return order;
+        }
+        return nameLength == entry.nameLength ? 0 : nameLength < entry.nameLength ? -1 : 1;
+    }
+}
+
+AssetPack::AssetPack() {
+    mMapping = NULL;
+    mMappingSize = 0;
+    mBase = NULL;
+    mSize = 0;
+    mHeader = NULL;
+    mEntries = NULL;
+    mNames = NULL;
+}
+
+AssetPack::~AssetPack() {
+    Close();
+}
+
+uint64_t AssetPack::HashName(const char *name, size_t length) {
+    uint64_t hash = kFnvOffset;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ (uint8_t) name[i]) * kFnvPrime;
+    }
+    return hash;
+}
+
+uint64_t AssetPack::HashContent(const uint8_t *data, size_t size) {
+    // four independent lanes over 32 byte blocks keep the multipliers busy
+    uint64_t lanes[4] = {kContentPrime1 + kContentPrime2, kContentPrime2, 0, 0 - kContentPrime1};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        lanes[0] = mix_lane(lanes[0], read64(data + i));
+        lanes[1] = mix_lane(lanes[1], read64(data + i + 8));
+        lanes[2] = mix_lane(lanes[2], read64(data + i + 16));
+        lanes[3] = mix_lane(lanes[3], read64(data + i + 24));
+    }
+    uint64_t hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) +
+                    rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18);
+    hash += (uint64_t) size;
+    for (; i + 8 <= size; i += 8) {
+        hash = rotate_left(hash ^ mix_lane(0, read64(data + i)), 27) * kContentPrime1;
+    }
+    for (; i < size; ++i) {
+        hash = rotate_left(hash ^ (data[i] * kContentPrime2), 11) * kContentPrime1;
+    }
+    return finalize(hash);
+}
+
+bool AssetPack::Open(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGE("AssetPack: can't open %s", path);
+        return false;
+    }
+    struct stat info;
+    bool opened = false;
+    if (fstat(fd, &info) == 0) {
+        opened = OpenFd(fd, 0, (int64_t) info.st_size);
+    } else {
+        ALOGE("AssetPack: can't stat %s", path);
+    }
+    close(fd);
+    return opened;
+}
+
+bool AssetPack::OpenFd(int fd, int64_t offset, int64_t length) {
+    Close();
+    if (!Map(fd, offset, length)) {
+        return false;
+    }
+    if (!Validate()) {
+        Close();
+        return false;
+    }
+    ALOGI("AssetPack: %u entries, %zu bytes", mHeader->entryCount, mSize);
+    return true;
+}
+
+bool AssetPack::Map(int fd, int64_t offset, int64_t length) {
+    if (offset < 0 || length < (int64_t) sizeof(AssetPackHeader)) {
+        ALOGE("AssetPack: %lld bytes is too small for a pack", (long long) length);
+        return false;
+    }
+    // mappings start at page boundaries, the pack inside an APK need not
+    const int64_t pageSize = sysconf(_SC_PAGESIZE);
+    const int64_t mapOffset = offset - offset % pageSize;
+    const size_t lead = (size_t) (offset - mapOffset);
+
+    void *mapping = mmap(NULL, lead + (size_t) length, PROT_READ, MAP_SHARED, fd, mapOffset);
+    if (mapping == MAP_FAILED) {
+        ALOGE("AssetPack: can't map %lld bytes", (long long) length);
+        return false;
+    }
+    mMapping = mapping;
+    mMappingSize = lead + (size_t) length;
+    mBase = (const uint8_t *) mapping + lead;
+    mSize = (size_t) length;
+    return true;
+}
+
+bool AssetPack::Validate() {
+    const AssetPackHeader *header = (const AssetPackHeader *) mBase;
+    if (header->magic != ASSET_PACK_MAGIC || header->version != ASSET_PACK_VERSION) {
+        ALOGE("AssetPack: not a version %d pack", ASSET_PACK_VERSION);
+        return false;
+    }
+    if (header->packSize != mSize) {
+        ALOGE("AssetPack: pack claims %llu bytes but has %zu",
+              (unsigned long long) header->packSize, mSize);
+        return false;
+    }
+    const uint64_t tocSize = (uint64_t) header->entryCount * sizeof(AssetPackEntry);
+    if (!is_aligned(header->tocOffset) || header->tocOffset > mSize ||
+        tocSize > mSize - header->tocOffset || header->namesOffset > mSize ||
+        header->namesSize > mSize - header->namesOffset ||
+        (header->namesSize > 0 && mBase[header->namesOffset + header->namesSize - 1] != '\0')) {
+        ALOGE("AssetPack: table of contents out of bounds");
+        return false;
+    }
+
+    const AssetPackEntry *entries = (const AssetPackEntry *) (mBase + header->tocOffset);
+    const char *names = (const char *) mBase + header->namesOffset;
+    for (uint32_t i = 0; i < header->entryCount; ++i) {
+        const AssetPackEntry &entry = entries[i];
+        const bool dataValid = is_aligned(entry.offset) && entry.offset <= mSize &&
+                               entry.storedSize <= mSize - entry.offset;
+        const bool nameValid = (uint64_t) entry.nameOffset + entry.nameLength < header->namesSize &&
+                               names[entry.nameOffset + entry.nameLength] == '\0';
+        const bool sizeValid = entry.compression == ASSET_COMPRESSION_LZ4 ||
+                               (entry.compression == ASSET_COMPRESSION_NONE &&
+                                entry.storedSize == entry.size);
+        if (!dataValid || !nameValid || !sizeValid) {
+            ALOGE("AssetPack: entry %u is corrupt", i);
+            return false;
+        }
+        if (i > 0 && compare_entry(entries[i - 1].nameHash, names + entries[i - 1].nameOffset,
+                                   entries[i - 1].nameLength, entry,
+                                   names + entry.nameOffset) >= 0) {
+            ALOGE("AssetPack: entry %u is out of order", i);
+            return false;
+        }
+    }
+
+    mHeader = header;
+    mEntries = entries;
+    mNames = names;
+    return true;
+}
+
+void AssetPack::Close() {
+    if (mMapping != NULL) {
+        munmap(mMapping, mMappingSize);
+    }
+    mMapping = NULL;
+    mMappingSize = 0;
+    mBase = NULL;
+    mSize = 0;
+    mHeader = NULL;
+    mEntries = NULL;
+    mNames = NULL;
+}
+
+int AssetPack::Find(const char *name) const {
+    if (mHeader == NULL) {
+        return -1;
+    }
+    const size_t length = strlen(name);
+    const uint64_t hash = HashName(name, length);
+    int low = 0, high = (int) mHeader->entryCount - 1;
+    while (low <= high) {
+        const int middle = low + (high - low) / 2;
+        const int order = compare_entry(hash, name, length, mEntries[middle], GetName(middle));
+        if (order == 0) {
+            return middle;
+        }
+        if (order < 0) {
+            high = middle - 1;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return -1;
+}
+
+bool AssetPack::GetView(int index, AssetView *view) const {
+    const AssetPackEntry &entry = mEntries[index];
+    if (entry.compression != ASSET_COMPRESSION_NONE) {
+        return false;
+    }
+    view->data = mBase + entry.offset;
+    view->size = entry.size;
+    return true;
+}
+
+bool AssetPack::Read(int index, uint8_t *out) const {
+    const AssetPackEntry &entry = mEntries[index];
+    const uint8_t *stored = mBase + entry.offset;
+    if (entry.compression == ASSET_COMPRESSION_LZ4) {
+        if (Lz4Decompress(stored, entry.storedSize, out, entry.size) != (int64_t) entry.size) {
+            ALOGE("AssetPack: %s doesn't decompress", GetName(index));
+            return false;
+        }
+    } else {
+        memcpy(out, stored, entry.size);
+    }
+    if (HashContent(out, entry.size) != entry.contentHash) {
+        ALOGE("AssetPack: %s fails its content hash", GetName(index));
+        return false;
+    }
+    return true;
+}
+
+bool AssetPack::Verify(int index) const {
+    const AssetPackEntry &entry = mEntries[index];
+    if (entry.compression != ASSET_COMPRESSION_NONE) {
+        return false;
+    }
+    return HashContent(mBase + entry.offset, entry.size) == entry.contentHash;
+}
+
+void AssetPack::Prefetch(int index) const {
+    const AssetPackEntry &entry = mEntries[index];
+    const uintptr_t pageSize = (uintptr_t) sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = (uintptr_t) (mBase + entry.offset) & ~(pageSize - 1);
+    const uintptr_t end = (uintptr_t) (mBase + entry.offset + entry.storedSize);
+    if (end > begin) {
+        madvise((void *) begin, end - begin, MADV_WILLNEED);
+    }
+}
@@ -0,0 +1,138 @@
+#ifndef agdktunnel_asset_pack_hpp
+#define agdktunnel_asset_pack_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Asset pack layout, all integers little endian:
+ *
+ *   AssetPackHeader
+ *   AssetPackEntry[entryCount]   at tocOffset, sorted by name hash then name
+ *   names                        at namesOffset, each NUL terminated
+ *   entry data                   each entry at an ASSET_PACK_ALIGNMENT boundary
+ *
+ * Every section starts at an ASSET_PACK_ALIGNMENT boundary too, so a mapped
+ * pack hands out aligned views straight into the mapping. An entry is stored as
+ * is or LZ4 compressed, and carries a hash of its uncompressed content.
+ */
+
+// 'APAK'
+#define ASSET_PACK_MAGIC 0x4b415041u
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGNMENT 64
+
+#define ASSET_COMPRESSION_NONE 0
+#define ASSET_COMPRESSION_LZ4 1
+
+struct AssetPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t tocOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    // size of the whole pack
+    uint64_t packSize;
+};
+
+struct AssetPackEntry {
+    uint64_t nameHash;
+    // of the stored bytes, from the start of the pack
+    uint64_t offset;
+    // AssetPack::HashContent() of the uncompressed bytes
+    uint64_t contentHash;
+    uint32_t storedSize;
+    uint32_t size;
+    // into the names, the length excludes the terminator
+    uint32_t nameOffset;
+    uint16_t nameLength;
+    // ASSET_COMPRESSION_*
+    uint16_t compression;
+};
+
+static_assert(sizeof(AssetPackHeader) == 48, "AssetPackHeader layout");
+static_assert(sizeof(AssetPackEntry) == 40, "AssetPackEntry layout");
+
+// bytes of an asset, valid while the pack (or the request holding them) is
+struct AssetView {
+    const uint8_t *data;
+    size_t size;
+};
+
+/*
+ * A read-only pack mapped into memory. The pack is checked once when opened:
+ * after that every entry, name and offset is known to lie inside the mapping.
+ * Content hashes are only checked when an entry is decoded or verified, so
+ * handing out a view touches none of its pages.
+ */
+class AssetPack {
+public:
+    AssetPack();
+
+    ~AssetPack();
+
+    AssetPack(const AssetPack &) = delete;
+    AssetPack &operator=(const AssetPack &) = delete;
+
+    bool Open(const char *path);
+
+    // Maps length bytes of fd from offset, e.g. an uncompressed file inside an
+    // APK. The descriptor isn't needed afterwards.
+    bool OpenFd(int fd, int64_t offset, int64_t length);
+
+    void Close();
+
+    bool IsOpen() const {
+        return mHeader != NULL;
+    }
+
+    int GetEntryCount() const {
+        return mHeader != NULL ? (int) mHeader->entryCount : 0;
+    }
+
+    const AssetPackEntry &GetEntry(int index) const {
+        return mEntries[index];
+    }
+
+    const char *GetName(int index) const {
+        return mNames + mEntries[index].nameOffset;
+    }
+
+    // index of the entry, -1 if there is none
+    int Find(const char *name) const;
+
+    // the stored bytes of an uncompressed entry, false for compressed ones
+    bool GetView(int index, AssetView *view) const;
+
+    // Decompresses (or copies) the entry into out, which holds its size bytes,
+    // and checks the content hash.
+    bool Read(int index, uint8_t *out) const;
+
+    // checks an uncompressed entry's content hash
+    bool Verify(int index) const;
+
+    // Asks the kernel to read the entry's stored bytes ahead of their use.
+    void Prefetch(int index) const;
+
+    static uint64_t HashName(const char *name, size_t length);
+
+    static uint64_t HashContent(const uint8_t *data, size_t size);
+
+private:
+    bool Map(int fd, int64_t offset, int64_t length);
+    bool Validate();
+
+    void *mMapping;
+    size_t mMappingSize;
+    // the pack inside the mapping, which starts at a page boundary
+    const uint8_t *mBase;
+    size_t mSize;
+
+    const AssetPackHeader *mHeader;
+    const AssetPackEntry *mEntries;
+    const char *mNames;
+};
+
+#endif
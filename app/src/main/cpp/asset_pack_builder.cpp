@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <cstring>
+#include "asset_pack_writer.hpp"
+#include "binary_log.hpp"
+
+/*
+    Host tool that packs an asset directory:
+
+        asset_pack_builder [--store] assets_dir pack_file
+
+    Every file below assets_dir becomes an entry named by its relative path.
+    Entries are LZ4 compressed where that saves enough, unless --store is given.
+*/
+
+static void _usage(const char *name) {
+    fprintf(stderr, "usage: %s [--store] assets_dir pack_file\n", name);
+}
+
+int main(int argc, char **argv) {
+    bool compress = true;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "--store") == 0) {
+        compress = false;
+        first = 2;
+    }
+    if (argc - first != 2) {
+        _usage(argv[0]);
+        return 1;
+    }
+    const char *directory = argv[first];
+    const char *packPath = argv[first + 1];
+
+    BinaryLog::SetSink(&BinaryLog::StdoutSink);
+    AssetPackWriter writer;
+    const bool ok = writer.AddDirectory(directory, compress) && writer.Write(packPath);
+    BinaryLog::Flush();
+    if (!ok) {
+        fprintf(stderr, "asset_pack_builder: failed to pack %s\n", directory);
+        return 1;
+    }
+
+    const AssetPackWriter::Stats stats = writer.GetStats();
+    printf("%s: %d entries (%d compressed), %llu bytes stored as %llu, pack %llu bytes\n",
+           packPath, stats.entries, stats.compressedEntries,
+           (unsigned long long) stats.inputBytes, (unsigned long long) stats.storedBytes,
+           (unsigned long long) stats.packBytes);
+    return 0;
+}
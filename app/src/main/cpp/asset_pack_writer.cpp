@@ -0,0 +1,211 @@
+#include "asset_pack_writer.hpp"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "Log.h"
+#include "lz4_block.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+namespace {
+    uint64_t align_offset(uint64_t offset) {
+        return (offset + ASSET_PACK_ALIGNMENT - 1) & ~(uint64_t) (ASSET_PACK_ALIGNMENT - 1);
+    }
+
+    bool read_file(const std::string &path, std::vector<uint8_t> *data) {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (file == NULL) {
+            return false;
+        }
+        data->clear();
+        uint8_t buffer[64 * 1024];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data->insert(data->end(), buffer, buffer + read);
+        }
+        const bool ok = ferror(file) == 0;
+        fclose(file);
+        return ok;
+    }
+
+    bool write_padding(FILE *file, uint64_t *position, uint64_t target) {
+        static const uint8_t kZeros[ASSET_PACK_ALIGNMENT] = {};
+        while (*position < target) {
+            const size_t count = (size_t) std::min<uint64_t>(target - *position, sizeof(kZeros));
+            if (fwrite(kZeros, 1, count, file) != count) {
+                return false;
+            }
+            *position += count;
+        }
+        return true;
+    }
+}
+
+AssetPackWriter::AssetPackWriter() {
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+bool AssetPackWriter::Add(const std::string &name, const uint8_t *data, size_t size,
+                          bool compress) {
+    if (size > LZ4_MAX_INPUT_SIZE || name.empty() || name.size() > UINT16_MAX) {
+        ALOGE("AssetPackWriter: can't store %s", name.c_str());
+        return false;
+    }
+    for (size_t i = 0; i < mEntries.size(); ++i) {
+        if (mEntries[i].name == name) {
+            ALOGE("AssetPackWriter: %s added twice", name.c_str());
+            return false;
+        }
+    }
+
+    Entry entry;
+    entry.name = name;
+    entry.nameHash = AssetPack::HashName(name.c_str(), name.size());
+    entry.contentHash = AssetPack::HashContent(data, size);
+    entry.size = (uint32_t) size;
+    entry.compression = ASSET_COMPRESSION_NONE;
+
+    if (compress && size >= ASSET_PACK_MIN_COMPRESS_SIZE) {
+        entry.stored.resize(Lz4CompressBound(size));
+        const size_t compressedSize = Lz4Compress(data, size, entry.stored.data(),
+                                                  entry.stored.size());
+        if (compressedSize > 0 &&
+            (float) compressedSize <= (1.0f - ASSET_PACK_MIN_SAVING) * (float) size) {
+            entry.stored.resize(compressedSize);
+            entry.compression = ASSET_COMPRESSION_LZ4;
+            ++mStats.compressedEntries;
+        }
+    }
+    if (entry.compression == ASSET_COMPRESSION_NONE) {
+        entry.stored.assign(data, data + size);
+    }
+
+    ++mStats.entries;
+    mStats.inputBytes += size;
+    mStats.storedBytes += entry.stored.size();
+    mEntries.push_back(std::move(entry));
+    return true;
+}
+
+bool AssetPackWriter::AddDirectory(const std::string &directory, bool compress) {
+    return AddDirectoryRecursive(directory, "", compress);
+}
+
+bool AssetPackWriter::AddDirectoryRecursive(const std::string &directory,
+                                            const std::string &prefix, bool compress) {
+    DIR *dir = opendir(directory.c_str());
+    if (dir == NULL) {
+        ALOGE("AssetPackWriter: can't open %s", directory.c_str());
+        return false;
+    }
+    // sorted, so the same tree always gives the same pack
+    std::vector<std::string> names;
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir(dir)) != NULL) {
+        if (dirEntry->d_name[0] != '.') {
+            names.push_back(dirEntry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    bool ok = true;
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < names.size() && ok; ++i) {
+        const std::string path = directory + "/" + names[i];
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            ALOGE("AssetPackWriter: can't stat %s", path.c_str());
+            ok = false;
+        } else if (S_ISDIR(info.st_mode)) {
+            ok = AddDirectoryRecursive(path, prefix + names[i] + "/", compress);
+        } else if (S_ISREG(info.st_mode)) {
+            if (!read_file(path, &data)) {
+                ALOGE("AssetPackWriter: can't read %s", path.c_str());
+                ok = false;
+            } else {
+                ok = Add(prefix + names[i], data.data(), data.size(), compress);
+            }
+        }
+    }
+    return ok;
+}
+
+bool AssetPackWriter::Write(const std::string &path) {
+    std::vector<Entry *> order(mEntries.size());
+    for (size_t i = 0; i < mEntries.size(); ++i) {
+        order[i] = &mEntries[i];
+    }
+    std::sort(order.begin(), order.end(), [](const Entry *a, const Entry *b) {
+        if (a->nameHash != b->nameHash) {
+            return a->nameHash < b->nameHash;
+        }
+        return a->name < b->name;
+    });
+
+    // lay the pack out
+    std::vector<AssetPackEntry> toc(order.size());
+    std::string names;
+    AssetPackHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.entryCount = (uint32_t) order.size();
+    header.tocOffset = align_offset(sizeof(header));
+    header.namesOffset = header.tocOffset + toc.size() * sizeof(AssetPackEntry);
+    for (size_t i = 0; i < order.size(); ++i) {
+        toc[i].nameOffset = (uint32_t) names.size();
+        names += order[i]->name;
+        names += '\0';
+    }
+    header.namesSize = names.size();
+
+    uint64_t offset = align_offset(header.namesOffset + header.namesSize);
+    for (size_t i = 0; i < order.size(); ++i) {
+        const Entry &entry = *order[i];
+        AssetPackEntry &tocEntry = toc[i];
+        tocEntry.nameHash = entry.nameHash;
+        tocEntry.offset = offset;
+        tocEntry.contentHash = entry.contentHash;
+        tocEntry.storedSize = (uint32_t) entry.stored.size();
+        tocEntry.size = entry.size;
+        tocEntry.nameLength = (uint16_t) entry.name.size();
+        tocEntry.compression = entry.compression;
+        offset = align_offset(offset + entry.stored.size());
+    }
+    header.packSize = offset;
+
+    // write aside and rename, so a failed build never leaves half a pack behind
+    const std::string tempPath = path + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == NULL) {
+        ALOGE("AssetPackWriter: can't create %s", tempPath.c_str());
+        return false;
+    }
+    uint64_t position = 0;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    position += sizeof(header);
+    ok = ok && write_padding(file, &position, header.tocOffset);
+    ok = ok && (toc.empty() || fwrite(toc.data(), sizeof(AssetPackEntry), toc.size(), file) ==
+                               toc.size());
+    position += toc.size() * sizeof(AssetPackEntry);
+    ok = ok && fwrite(names.data(), 1, names.size(), file) == names.size();
+    position += names.size();
+    for (size_t i = 0; i < order.size() && ok; ++i) {
+        const std::vector<uint8_t> &stored = order[i]->stored;
+        ok = write_padding(file, &position, toc[i].offset) &&
+             fwrite(stored.data(), 1, stored.size(), file) == stored.size();
+        position += stored.size();
+    }
+    ok = ok && write_padding(file, &position, header.packSize);
+
+    if (fclose(file) != 0 || !ok || rename(tempPath.c_str(), path.c_str()) != 0) {
+        ALOGE("AssetPackWriter: can't write %s", path.c_str());
+        remove(tempPath.c_str());
+        return false;
+    }
+    mStats.packBytes = header.packSize;
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef agdktunnel_asset_pack_writer_hpp
+#define agdktunnel_asset_pack_writer_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "asset_pack.hpp"
+
+// an entry is stored compressed only if that saves at least this fraction of it
+#define ASSET_PACK_MIN_SAVING 0.1f
+
+// entries smaller than this are never compressed
+#define ASSET_PACK_MIN_COMPRESS_SIZE 256
+
+/*
+ * Builds asset packs, on the host: entries are collected in memory, compressed
+ * where it pays off, and written out as one pack.
+ */
+class AssetPackWriter {
+public:
+    struct Stats {
+        int entries;
+        int compressedEntries;
+        uint64_t inputBytes;
+        uint64_t storedBytes;
+        uint64_t packBytes;
+    };
+
+    AssetPackWriter();
+
+    // false if the name is taken or the data is too large
+    bool Add(const std::string &name, const uint8_t *data, size_t size, bool compress);
+
+    // Adds every regular file below directory, named by its path relative to it
+    // with '/' separators. Hidden files and directories are skipped.
+    bool AddDirectory(const std::string &directory, bool compress);
+
+    // writes the pack aside and renames it into place
+    bool Write(const std::string &path);
+
+    Stats GetStats() const {
+        return mStats;
+    }
+
+private:
+    struct Entry {
+        std::string name;
+        uint64_t nameHash;
+        uint64_t contentHash;
+        uint32_t size;
+        uint16_t compression;
+        std::vector<uint8_t> stored;
+    };
+
+    bool AddDirectoryRecursive(const std::string &directory, const std::string &prefix,
+                               bool compress);
+
+    std::vector<Entry> mEntries;
+    Stats mStats;
+};
+
+#endif
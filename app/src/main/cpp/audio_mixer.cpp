@@ -0,0 +1,288 @@
+#include "audio_mixer.hpp"
+#include <cmath>
+#include <cstring>
+#include "simd.hpp"
+
+// commands
+#define MIXER_PLAY 0
+#define MIXER_STOP 1
+#define MIXER_STOP_ALL 2
+#define MIXER_SET_GAIN 3
+#define MIXER_SET_PAN 4
+#define MIXER_SET_FREQUENCY 5
+
+// voice states
+#define MIXER_VOICE_IDLE 0
+#define MIXER_VOICE_PLAYING 1
+// ramping down to silence, idle after
+#define MIXER_VOICE_STOPPING 2
+
+// commands applied at once
+#define MIXER_COMMAND_BATCH 32
+
+AudioMixer::AudioMixer(int sampleRate) : mOscillators(sampleRate), mPlayingCount(0) {
+    memset(mVoiceInUse, 0, sizeof(mVoiceInUse));
+    mNextVoice = 0;
+    memset(&mStats, 0, sizeof(mStats));
+    memset(mVoices, 0, sizeof(mVoices));
+    for (int i = 0; i < MIXER_MAX_VOICES; ++i) {
+        mOscillators.Add(OSCILLATOR_SINE, 0.0, 1.0f);
+    }
+}
+
+bool AudioMixer::Send(const Command &command) {
+    if (!mCommands.Push(command)) {
+        ++mStats.commandsDropped;
+        return false;
+    }
+    ++mStats.commandsSent;
+    return true;
+}
+
+int AudioMixer::Start(Command command) {
+    // round robin, so a voice that was just stopped gets time to fade out
+    for (int i = 0; i < MIXER_MAX_VOICES; ++i) {
+        const int voice = (mNextVoice + i) % MIXER_MAX_VOICES;
+        if (mVoiceInUse[voice]) {
+            continue;
+        }
+        command.voice = voice;
+        if (!Send(command)) {
+            return -1;
+        }
+        mVoiceInUse[voice] = true;
+        mNextVoice = (voice + 1) % MIXER_MAX_VOICES;
+        return voice;
+    }
+    ++mStats.voicesRefused;
+    return -1;
+}
+
+int AudioMixer::Play(int wave, double frequency, float gain, float pan) {
+    const Command command = {MIXER_PLAY, 0, wave, gain, pan, frequency, NULL};
+    return Start(command);
+}
+
+int AudioMixer::PlayStream(SoundStream *stream, float gain, float pan) {
+    // held before the audio thread can see it
+    stream->Acquire();
+    const Command command = {MIXER_PLAY, 0, OSCILLATOR_SINE, gain, pan, 0.0, stream};
+    const int voice = Start(command);
+    if (voice < 0) {
+        stream->Release();
+    }
+    return voice;
+}
+
+bool AudioMixer::Stop(int voice) {
+    if (voice < 0 || voice >= MIXER_MAX_VOICES || !mVoiceInUse[voice]) {
+        return true;
+    }
+    const Command command = {MIXER_STOP, voice, 0, 0.0f, 0.0f, 0.0, NULL};
+    if (!Send(command)) {
+        return false;
+    }
+    mVoiceInUse[voice] = false;
+    return true;
+}
+
+void AudioMixer::StopAll() {
+    const Command command = {MIXER_STOP_ALL, 0, 0, 0.0f, 0.0f, 0.0, NULL};
+    if (Send(command)) {
+        memset(mVoiceInUse, 0, sizeof(mVoiceInUse));
+    }
+}
+
+void AudioMixer::SetGain(int voice, float gain) {
+    if (voice >= 0 && voice < MIXER_MAX_VOICES && mVoiceInUse[voice]) {
+        const Command command = {MIXER_SET_GAIN, voice, 0, gain, 0.0f, 0.0, NULL};
+        Send(command);
+    }
+}
+
+void AudioMixer::SetPan(int voice, float pan) {
+    if (voice >= 0 && voice < MIXER_MAX_VOICES && mVoiceInUse[voice]) {
+        const Command command = {MIXER_SET_PAN, voice, 0, 0.0f, pan, 0.0, NULL};
+        Send(command);
+    }
+}
+
+void AudioMixer::SetFrequency(int voice, double frequency) {
+    if (voice >= 0 && voice < MIXER_MAX_VOICES && mVoiceInUse[voice]) {
+        const Command command = {MIXER_SET_FREQUENCY, voice, 0, 0.0f, 0.0f, frequency, NULL};
+        Send(command);
+    }
+}
+
+void AudioMixer::RampTo(Voice *voice, float gain, float pan) {
+    pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+    voice->gain = gain;
+    voice->pan = pan;
+    const float angle = (pan + 1.0f) * (float) (M_PI / 4.0);
+    voice->leftStep = (gain * cosf(angle) - voice->left) / MIXER_RAMP_FRAMES;
+    voice->rightStep = (gain * sinf(angle) - voice->right) / MIXER_RAMP_FRAMES;
+    voice->rampFrames = MIXER_RAMP_FRAMES;
+}
+
+void AudioMixer::ReleaseStream(Voice *voice) {
+    if (voice->stream != NULL) {
+        voice->stream->Release();
+        voice->stream = NULL;
+    }
+}
+
+void AudioMixer::Apply(const Command &command) {
+    Voice &voice = mVoices[command.voice];
+    switch (command.type) {
+        case MIXER_PLAY:
+            if (voice.state == MIXER_VOICE_IDLE) {
+                mPlayingCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            // from silence, whatever the voice was doing before
+            mOscillators.Restart(command.voice, command.wave, command.frequency);
+            ReleaseStream(&voice);
+            voice.stream = command.stream;
+            voice.state = MIXER_VOICE_PLAYING;
+            voice.left = voice.right = 0.0f;
+            RampTo(&voice, command.gain, command.pan);
+            break;
+        case MIXER_STOP:
+            if (voice.state == MIXER_VOICE_PLAYING) {
+                voice.state = MIXER_VOICE_STOPPING;
+                RampTo(&voice, 0.0f, voice.pan);
+            }
+            break;
+        case MIXER_STOP_ALL:
+            for (Voice &each : mVoices) {
+                if (each.state == MIXER_VOICE_PLAYING) {
+                    each.state = MIXER_VOICE_STOPPING;
+                    RampTo(&each, 0.0f, each.pan);
+                }
+            }
+            break;
+        case MIXER_SET_GAIN:
+            if (voice.state == MIXER_VOICE_PLAYING) {
+                RampTo(&voice, command.gain, voice.pan);
+            }
+            break;
+        case MIXER_SET_PAN:
+            if (voice.state == MIXER_VOICE_PLAYING) {
+                RampTo(&voice, voice.gain, command.pan);
+            }
+            break;
+        case MIXER_SET_FREQUENCY:
+            // the phase carries on, so the change doesn't click
+            mOscillators.SetFrequency(command.voice, command.frequency);
+            break;
+        default:
+            break;
+    }
+}
+
+void AudioMixer::MixBlock(int frameCount) {
+    const int sampleCount = (frameCount + 3) & ~3;
+    memset(mLeft, 0, sampleCount * sizeof(float));
+    memset(mRight, 0, sampleCount * sizeof(float));
+    static const float kLanes[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    const Float4 lanes = Float4Load(kLanes);
+
+    for (int id = 0; id < MIXER_MAX_VOICES; ++id) {
+        Voice &voice = mVoices[id];
+        if (voice.state == MIXER_VOICE_IDLE) {
+            continue;
+        }
+        const float *leftBlock = mVoiceBlock;
+        const float *rightBlock = mVoiceBlock;
+        if (voice.stream != NULL) {
+            voice.stream->Read(mVoiceBlock, mVoiceBlockRight, frameCount);
+            for (int i = frameCount; i < sampleCount; ++i) {
+                mVoiceBlock[i] = mVoiceBlockRight[i] = 0.0f;
+            }
+            rightBlock = mVoiceBlockRight;
+        } else {
+            memset(mVoiceBlock, 0, sampleCount * sizeof(float));
+            mOscillators.Accumulate(id, mVoiceBlock, frameCount);
+        }
+
+        // ramping, four frames at a time with the gain of each
+        int i = 0;
+        for (; i < sampleCount && voice.rampFrames > 0; i += 4) {
+            const Float4 left = Float4MulAdd(Float4Set1(voice.leftStep), lanes,
+                                             Float4Set1(voice.left));
+            const Float4 right = Float4MulAdd(Float4Set1(voice.rightStep), lanes,
+                                              Float4Set1(voice.right));
+            Float4Store(mLeft + i, Float4MulAdd(Float4Load(leftBlock + i), left,
+                                                Float4Load(mLeft + i)));
+            Float4Store(mRight + i, Float4MulAdd(Float4Load(rightBlock + i), right,
+                                                 Float4Load(mRight + i)));
+            voice.left += 4 * voice.leftStep;
+            voice.right += 4 * voice.rightStep;
+            voice.rampFrames -= 4;
+            if (voice.rampFrames <= 0) {
+                // exactly there, whatever rounding did on the way
+                const float angle = (voice.pan + 1.0f) * (float) (M_PI / 4.0);
+                voice.left = voice.gain * cosf(angle);
+                voice.right = voice.gain * sinf(angle);
+                if (voice.state == MIXER_VOICE_STOPPING) {
+                    voice.state = MIXER_VOICE_IDLE;
+                    ReleaseStream(&voice);
+                    mPlayingCount.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+        }
+        if (voice.state == MIXER_VOICE_IDLE) {
+            continue;
+        }
+
+        // steady
+        const Float4 left = Float4Set1(voice.left);
+        const Float4 right = Float4Set1(voice.right);
+        for (; i < sampleCount; i += 4) {
+            Float4Store(mLeft + i, Float4MulAdd(Float4Load(leftBlock + i), left,
+                                                Float4Load(mLeft + i)));
+            Float4Store(mRight + i, Float4MulAdd(Float4Load(rightBlock + i), right,
+                                                 Float4Load(mRight + i)));
+        }
+    }
+}
+
+void AudioMixer::Render(float *out, int frameCount, int channelCount) {
+    Command commands[MIXER_COMMAND_BATCH];
+    size_t count;
+    while ((count = mCommands.PopMany(commands, MIXER_COMMAND_BATCH)) > 0) {
+        for (size_t i = 0; i < count; ++i) {
+            Apply(commands[i]);
+        }
+    }
+
+    while (frameCount > 0) {
+        const int blockFrames = frameCount < OSCILLATOR_BLOCK_FRAMES ? frameCount
+                                                                     : OSCILLATOR_BLOCK_FRAMES;
+        MixBlock(blockFrames);
+
+        int i = 0;
+        if (channelCount == 2) {
+            for (; i + 4 <= blockFrames; i += 4) {
+                const Float4 left = Float4Load(mLeft + i);
+                const Float4 right = Float4Load(mRight + i);
+                Float4Store(out + 2 * i, Float4ZipLow(left, right));
+                Float4Store(out + 2 * i + 4, Float4ZipHigh(left, right));
+            }
+        }
+        for (; i < blockFrames; ++i) {
+            float *frame = out + i * channelCount;
+            if (channelCount == 1) {
+                frame[0] = 0.5f * (mLeft[i] + mRight[i]);
+                continue;
+            }
+            frame[0] = mLeft[i];
+            frame[1] = mRight[i];
+            for (int channel = 2; channel < channelCount; ++channel) {
+                frame[channel] = 0.0f;
+            }
+        }
+
+        out += blockFrames * channelCount;
+        frameCount -= blockFrames;
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef agdktunnel_audio_mixer_hpp
+#define agdktunnel_audio_mixer_hpp
+
+#include <atomic>
+#include <cstdint>
+#include "oscillator_bank.hpp"
+#include "sound_streamer.hpp"
+#include "spsc_ring.hpp"
+
+// voices that can play at once, one oscillator or stream each
+#define MIXER_MAX_VOICES OSCILLATOR_MAX_COUNT
+// commands the game thread can send ahead of the audio thread
+#define MIXER_QUEUE_SIZE 256
+// frames a voice's gain and pan take to reach a new value, 5 ms at 48kHz; a multiple of 4
+#define MIXER_RAMP_FRAMES 240
+
+/*
+ * Voices mixed to stereo inside the audio callback. The game thread plays,
+ * stops and changes voices through the methods above Render(); they only
+ * queue a command in a lock-free ring, which Render() applies at the start of
+ * the next callback. Render() never locks or allocates.
+ *
+ * Gain and pan changes, starts and stops ramp over MIXER_RAMP_FRAMES so they
+ * don't click. Pan is equal power, from -1 (left) to 1 (right); for a stream it
+ * balances the stream's own left and right.
+ */
+class AudioMixer {
+public:
+    // game thread side; the audio thread's side is GetPlayingCount()
+    struct Stats {
+        uint64_t commandsSent;
+        // the queue was full
+        uint64_t commandsDropped;
+        // Play() found every voice in use
+        uint64_t voicesRefused;
+    };
+
+    explicit AudioMixer(int sampleRate);
+
+    // Game thread. Starts a voice and returns its id, -1 if every voice is
+    // playing or the queue is full. The id is valid until Stop().
+    int Play(int wave, double frequency, float gain, float pan);
+
+    // Like Play(), for a stream. The voice holds the stream until it has
+    // faded out after Stop(); the stream's end plays as silence.
+    int PlayStream(SoundStream *stream, float gain, float pan);
+
+    // Fades the voice out. False if the queue is full and it plays on, still
+    // holding any stream.
+    bool Stop(int voice);
+
+    void StopAll();
+
+    void SetGain(int voice, float gain);
+
+    void SetPan(int voice, float pan);
+
+    void SetFrequency(int voice, double frequency);
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+    // voices the audio thread is playing or fading out, from any thread
+    int GetPlayingCount() const {
+        return mPlayingCount.load(std::memory_order_relaxed);
+    }
+
+    // Audio thread. Applies the queued commands, then writes frameCount frames
+    // of the voices' mix: left and right, their average on one channel, silence
+    // on any channels past the second.
+    void Render(float *out, int frameCount, int channelCount);
+
+private:
+    struct Command {
+        int type;
+        int voice;
+        int wave;
+        float gain;
+        float pan;
+        double frequency;
+        SoundStream *stream;
+    };
+
+    struct Voice {
+        int state;
+        float gain;
+        float pan;
+        // per channel: the gain now, its change per frame while ramping, and
+        // the frames the ramp has left
+        float left;
+        float right;
+        float leftStep;
+        float rightStep;
+        int rampFrames;
+        // what the voice plays instead of its oscillator, held until the voice is idle
+        SoundStream *stream;
+    };
+
+    bool Send(const Command &command);
+    // sends the play command on a free voice, returns it or -1
+    int Start(Command command);
+    void Apply(const Command &command);
+    // the voice has gone idle or plays something else: lets go of its stream
+    void ReleaseStream(Voice *voice);
+    // ramps the voice from its gains now to gain and pan
+    void RampTo(Voice *voice, float gain, float pan);
+    // mixes frameCount (up to OSCILLATOR_BLOCK_FRAMES) frames into mLeft and mRight
+    void MixBlock(int frameCount);
+
+    // game thread
+    SpscRing<Command, MIXER_QUEUE_SIZE> mCommands;
+    bool mVoiceInUse[MIXER_MAX_VOICES];
+    int mNextVoice;
+    Stats mStats;
+
+    // audio thread
+    OscillatorBank mOscillators;
+    Voice mVoices[MIXER_MAX_VOICES];
+    std::atomic<int> mPlayingCount;
+    // the voice's own samples, both channels of a stream
+    alignas(16) float mVoiceBlock[OSCILLATOR_BLOCK_FRAMES];
+    alignas(16) float mVoiceBlockRight[OSCILLATOR_BLOCK_FRAMES];
+    alignas(16) float mLeft[OSCILLATOR_BLOCK_FRAMES];
+    alignas(16) float mRight[OSCILLATOR_BLOCK_FRAMES];
+};
+
+#endif
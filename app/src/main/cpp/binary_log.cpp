@@ -0,0 +1,348 @@
+#include "binary_log.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "Log.h"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+// per-thread ring size, must be a power of two
+#define BINARY_LOG_RING_SIZE (128 * 1024)
+
+// maximum number of threads that can log at once; a thread's ring goes to the
+// next thread that logs once it exits
+#define BINARY_LOG_MAX_THREADS 32
+
+// Once woken, the formatting thread waits this long for the rest of a burst
+// before formatting it. While records keep coming it formats this often.
+#define BINARY_LOG_FLUSH_INTERVAL_MS 5
+
+// the longest the formatting thread sleeps while nothing is logged
+#define BINARY_LOG_IDLE_FLUSH_MS 1000
+
+// a ring filling past this wakes the formatting thread even mid-burst
+#define BINARY_LOG_WAKE_FILL (BINARY_LOG_RING_SIZE / 2)
+
+namespace {
+    struct RecordHeader {
+        // total bytes of header and arguments, rounded up to kRecordAlignment;
+        // kPaddingFlag marks padding up to the end of the ring, where only this
+        // field is valid
+        uint32_t size;
+        int32_t level;
+        const char *tag;
+        const char *fmt;
+        BinaryLog::DecodeFn decode;
+        int64_t timeNs;
+    };
+
+    constexpr size_t kRecordAlignment = alignof(RecordHeader);
+    constexpr uint32_t kPaddingFlag = 0x80000000u;
+
+    size_t align_record(size_t size) {
+        return (size + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+    }
+
+    // single-producer (the owning thread) single-consumer (the formatter) byte ring
+    struct ThreadRing {
+        alignas(64) std::atomic<size_t> head;
+        size_t pendingHead;
+        RecordHeader *pendingRecord;
+        // the pending record fills an empty ring, or this one past BINARY_LOG_WAKE_FILL
+        bool pendingFirst;
+        bool pendingFilling;
+        uint64_t dropped;
+        // a live thread writes to the ring, guarded by sRegisterLock
+        bool owned;
+
+        alignas(64) std::atomic<size_t> tail;
+
+        alignas(kRecordAlignment) uint8_t data[BINARY_LOG_RING_SIZE];
+    };
+
+    ThreadRing *sRings[BINARY_LOG_MAX_THREADS];
+    std::atomic<int> sRingCount(0);
+    std::mutex sRegisterLock;
+
+    // the consumer side of every ring, held by whoever is formatting
+    std::mutex sFlushLock;
+
+    std::atomic<BinaryLog::Sink> sSink(&BinaryLog::PlatformSink);
+    std::atomic<uint64_t> sDroppedUnregistered(0);
+    std::once_flag sStartFlag;
+
+    // The formatting thread sleeps on sWakes, a futex word bumped to wake it.
+    // sFormatterIdle is set while it sleeps with every ring empty; the first
+    // record into a ring then wakes it.
+    std::atomic<int> sWakes(0);
+    std::atomic<bool> sFormatterIdle(false);
+    std::atomic<uint64_t> sFormatterWakeups(0);
+
+    static_assert(sizeof(std::atomic<int>) == sizeof(int), "sWakes must be a futex word");
+
+    thread_local ThreadRing *tRing = NULL;
+    thread_local bool tRegistrationFailed = false;
+
+    // Gives the thread's ring up when the thread exits. Records still in it are
+    // formatted as usual; the next owner carries on after them. Only touched
+    // when a thread registers, so logging doesn't pay for its guard.
+    struct RingOwner {
+        ThreadRing *ring = NULL;
+
+        ~RingOwner() {
+            if (ring != NULL) {
+                std::lock_guard<std::mutex> lock(sRegisterLock);
+                ring->owned = false;
+            }
+            // anything logged later on this thread is dropped
+            tRing = NULL;
+            tRegistrationFailed = true;
+        }
+    };
+
+    thread_local RingOwner tRingOwner;
+
+    // sleeps until sWakes moves on from wakes, or for timeoutMs
+    void wait_for_wake(int wakes, int timeoutMs) {
+        struct timespec timeout;
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = (long) (timeoutMs % 1000) * 1000000L;
+        syscall(SYS_futex, (int *) &sWakes, FUTEX_WAIT_PRIVATE, wakes, &timeout, NULL, 0);
+    }
+
+    void wake_formatter(bool filling) {
+        // pairs with the fence in formatter_thread(): either the formatter sees
+        // the new record or this sees it idle
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sFormatterIdle.exchange(false, std::memory_order_relaxed) || filling) {
+            sWakes.fetch_add(1, std::memory_order_relaxed);
+            syscall(SYS_futex, (int *) &sWakes, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+        }
+    }
+
+    bool rings_empty() {
+        const int ringCount = sRingCount.load(std::memory_order_acquire);
+        for (int i = 0; i < ringCount; ++i) {
+            if (sRings[i]->head.load(std::memory_order_relaxed) !=
+                sRings[i]->tail.load(std::memory_order_relaxed)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void formatter_thread() {
+        while (1) {
+            int wakes = sWakes.load(std::memory_order_relaxed);
+            sFormatterIdle.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (rings_empty()) {
+                wait_for_wake(wakes, BINARY_LOG_IDLE_FLUSH_MS);
+            }
+            sFormatterIdle.store(false, std::memory_order_relaxed);
+            sFormatterWakeups.fetch_add(1, std::memory_order_relaxed);
+
+            // let the rest of a burst come in, unless a ring is filling up
+            wakes = sWakes.load(std::memory_order_relaxed);
+            wait_for_wake(wakes, BINARY_LOG_FLUSH_INTERVAL_MS);
+            BinaryLog::Flush();
+        }
+    }
+
+    ThreadRing *get_thread_ring() {
+        if (tRing != NULL || tRegistrationFailed) {
+            return tRing;
+        }
+
+        std::call_once(sStartFlag, []() {
+            std::thread(formatter_thread).detach();
+        });
+
+        std::lock_guard<std::mutex> lock(sRegisterLock);
+        const int ringCount = sRingCount.load(std::memory_order_relaxed);
+        ThreadRing *ring = NULL;
+        for (int i = 0; i < ringCount && ring == NULL; ++i) {
+            if (!sRings[i]->owned) {
+                // the lock orders this thread's writes after the previous owner's
+                ring = sRings[i];
+            }
+        }
+        if (ring == NULL) {
+            if (ringCount >= BINARY_LOG_MAX_THREADS) {
+                tRegistrationFailed = true;
+                return NULL;
+            }
+            ring = new ThreadRing;
+            ring->head.store(0, std::memory_order_relaxed);
+            ring->pendingHead = 0;
+            ring->pendingRecord = NULL;
+            ring->pendingFirst = ring->pendingFilling = false;
+            ring->dropped = 0;
+            ring->tail.store(0, std::memory_order_relaxed);
+            sRings[ringCount] = ring;
+            sRingCount.store(ringCount + 1, std::memory_order_release);
+        }
+        ring->owned = true;
+        tRingOwner.ring = ring;
+        tRing = ring;
+        return ring;
+    }
+
+    const RecordHeader *peek_record(ThreadRing *ring, size_t tail, size_t head) {
+        while (tail != head) {
+            const RecordHeader *record =
+                    (const RecordHeader *) &ring->data[tail & (BINARY_LOG_RING_SIZE - 1)];
+            if ((record->size & kPaddingFlag) == 0) {
+                return record;
+            }
+            // skip the padding at the end of the ring
+            tail += record->size & ~kPaddingFlag;
+            ring->tail.store(tail, std::memory_order_release);
+        }
+        return NULL;
+    }
+
+    char level_char(int level) {
+        switch (level) {
+            case LOG_LEVEL_VERBOSE:
+                return 'V';
+            case LOG_LEVEL_DEBUG:
+                return 'D';
+            case LOG_LEVEL_INFO:
+                return 'I';
+            case LOG_LEVEL_WARN:
+                return 'W';
+            case LOG_LEVEL_ERROR:
+                return 'E';
+            default:
+                return '?';
+        }
+    }
+}
+
+namespace BinaryLog {
+
+    void PlatformSink(int level, const char *tag, int64_t timeNs, const char *message) {
+#ifdef __ANDROID__
+        __android_log_write(level, tag, message);
+#else
+        StdoutSink(level, tag, timeNs, message);
+#endif
+    }
+
+    void StdoutSink(int level, const char *tag, int64_t timeNs, const char *message) {
+        printf("%lld.%06lld %c/%s: %s\n", (long long) (timeNs / 1000000000LL),
+               (long long) ((timeNs % 1000000000LL) / 1000), level_char(level), tag, message);
+    }
+
+    void SetSink(Sink sink) {
+        sSink.store(sink, std::memory_order_release);
+    }
+
+    uint8_t *BeginRecord(size_t argsSize) {
+        ThreadRing *ring = get_thread_ring();
+        if (ring == NULL) {
+            sDroppedUnregistered.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        }
+
+        const size_t size = align_record(sizeof(RecordHeader) + argsSize);
+        const size_t head = ring->head.load(std::memory_order_relaxed);
+        const size_t offset = head & (BINARY_LOG_RING_SIZE - 1);
+        const size_t contiguous = BINARY_LOG_RING_SIZE - offset;
+        const size_t needed = size + (contiguous < size ? contiguous : 0);
+        const size_t used = head - ring->tail.load(std::memory_order_acquire);
+        if (size > BINARY_LOG_RING_SIZE / 4 || needed > BINARY_LOG_RING_SIZE - used) {
+            ++ring->dropped;
+            return NULL;
+        }
+
+        size_t start = head;
+        if (contiguous < size) {
+            // records never wrap, pad out the end of the ring instead
+            uint32_t padding = (uint32_t) contiguous | kPaddingFlag;
+            memcpy(&ring->data[offset], &padding, sizeof(padding));
+            start += contiguous;
+        }
+
+        RecordHeader *record = (RecordHeader *) &ring->data[start & (BINARY_LOG_RING_SIZE - 1)];
+        record->size = (uint32_t) size;
+        ring->pendingRecord = record;
+        ring->pendingHead = start + size;
+        ring->pendingFirst = used == 0;
+        ring->pendingFilling =
+                used < BINARY_LOG_WAKE_FILL && used + needed >= BINARY_LOG_WAKE_FILL;
+        return (uint8_t *) (record + 1);
+    }
+
+    void CommitRecord(int level, const char *tag, const char *fmt, DecodeFn decode,
+                      int64_t timeNs) {
+        ThreadRing *ring = tRing;
+        RecordHeader *record = ring->pendingRecord;
+        record->level = level;
+        record->tag = tag;
+        record->fmt = fmt;
+        record->decode = decode;
+        record->timeNs = timeNs;
+        ring->head.store(ring->pendingHead, std::memory_order_release);
+        if (ring->pendingFirst || ring->pendingFilling) {
+            wake_formatter(ring->pendingFilling);
+        }
+    }
+
+    void Flush() {
+        std::lock_guard<std::mutex> lock(sFlushLock);
+
+        size_t heads[BINARY_LOG_MAX_THREADS];
+        const int ringCount = sRingCount.load(std::memory_order_acquire);
+        for (int i = 0; i < ringCount; ++i) {
+            heads[i] = sRings[i]->head.load(std::memory_order_acquire);
+        }
+
+        // merge the rings by timestamp so messages come out in the order they were logged
+        char message[kMaxMessageLength];
+        Sink sink = sSink.load(std::memory_order_acquire);
+        while (1) {
+            int next = -1;
+            const RecordHeader *nextRecord = NULL;
+            for (int i = 0; i < ringCount; ++i) {
+                const RecordHeader *record = peek_record(
+                        sRings[i], sRings[i]->tail.load(std::memory_order_relaxed), heads[i]);
+                if (record != NULL && (nextRecord == NULL || record->timeNs < nextRecord->timeNs)) {
+                    next = i;
+                    nextRecord = record;
+                }
+            }
+            if (next < 0) {
+                break;
+            }
+
+            nextRecord->decode(nextRecord->fmt, (const uint8_t *) (nextRecord + 1), message,
+                               sizeof(message));
+            sink(nextRecord->level, nextRecord->tag, nextRecord->timeNs, message);
+
+            ThreadRing *ring = sRings[next];
+            ring->tail.store(ring->tail.load(std::memory_order_relaxed) + nextRecord->size,
+                             std::memory_order_release);
+        }
+    }
+
+    uint64_t GetFormatterWakeups() {
+        return sFormatterWakeups.load(std::memory_order_relaxed);
+    }
+
+    uint64_t GetDroppedCount() {
+        // approximate, the per-ring counters belong to their threads
+        uint64_t dropped = sDroppedUnregistered.load(std::memory_order_relaxed);
+        const int ringCount = sRingCount.load(std::memory_order_acquire);
+        for (int i = 0; i < ringCount; ++i) {
+            dropped += sRings[i]->dropped;
+        }
+        return dropped;
+    }
+}
@@ -0,0 +1,238 @@
+#ifndef agdktunnel_binary_log_hpp
+#define agdktunnel_binary_log_hpp
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Deferred-format logging. The calling thread only copies the format string
+ * pointer, a decoder for the argument types and the raw argument values into
+ * its own lock-free ring; a background thread formats the records and hands
+ * them to the sink. String arguments are copied (and truncated) at the call
+ * site, every other argument is stored by value.
+ */
+namespace BinaryLog {
+
+    // maximum number of bytes of each string argument that is kept
+    constexpr size_t kMaxStringArgLength = 127;
+
+    // formatted message size handed to the sink
+    constexpr size_t kMaxMessageLength = 1024;
+
+    typedef void (*DecodeFn)(const char *fmt, const uint8_t *args, char *out, size_t outSize);
+
+    typedef void (*Sink)(int level, const char *tag, int64_t timeNs, const char *message);
+
+    // writes to the platform log (logcat on Android)
+    void PlatformSink(int level, const char *tag, int64_t timeNs, const char *message);
+
+    // writes to stdout, for host runs
+    void StdoutSink(int level, const char *tag, int64_t timeNs, const char *message);
+
+    void SetSink(Sink sink);
+
+    // formats and emits everything logged so far, from any thread
+    void Flush();
+
+    // number of records dropped because a thread's ring was full
+    uint64_t GetDroppedCount();
+
+    // times the formatting thread woke up; it sleeps while nothing is logged
+    uint64_t GetFormatterWakeups();
+
+    // reserves space for a record in the calling thread's ring, NULL if it is full
+    uint8_t *BeginRecord(size_t argsSize);
+
+    void CommitRecord(int level, const char *tag, const char *fmt, DecodeFn decode,
+                      int64_t timeNs);
+
+    inline int64_t NowNs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+    // How an argument of type T is stored: strings by content, other pointers by
+    // value, arithmetic values and enums after the default argument promotions.
+    template<typename T, typename Enable = void>
+    struct Arg {
+        typedef decltype(+std::declval<T>()) Stored;
+
+        static size_t Size(T) {
+            return sizeof(Stored);
+        }
+
+        static uint8_t *Write(uint8_t *out, T value) {
+            Stored stored = value;
+            memcpy(out, &stored, sizeof(stored));
+            return out + sizeof(stored);
+        }
+
+        static Stored Read(const uint8_t *&in) {
+            Stored stored;
+            memcpy(&stored, in, sizeof(stored));
+            in += sizeof(stored);
+            return stored;
+        }
+    };
+
+    template<>
+    struct Arg<float> {
+        typedef double Stored;
+
+        static size_t Size(float) {
+            return sizeof(double);
+        }
+
+        static uint8_t *Write(uint8_t *out, float value) {
+            double stored = value;
+            memcpy(out, &stored, sizeof(stored));
+            return out + sizeof(stored);
+        }
+
+        static double Read(const uint8_t *&in) {
+            double stored;
+            memcpy(&stored, in, sizeof(stored));
+            in += sizeof(stored);
+            return stored;
+        }
+    };
+
+    template<typename T>
+    struct Arg<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+        typedef Arg<typename std::underlying_type<T>::type> Underlying;
+        typedef typename Underlying::Stored Stored;
+
+        static size_t Size(T) {
+            return sizeof(Stored);
+        }
+
+        static uint8_t *Write(uint8_t *out, T value) {
+            return Underlying::Write(out, (typename std::underlying_type<T>::type) value);
+        }
+
+        static Stored Read(const uint8_t *&in) {
+            return Underlying::Read(in);
+        }
+    };
+
+    // strnlen without the object size checks, which misfire on short literals
+    inline size_t StringArgLength(const char *value) {
+        size_t length = 0;
+        while (length < kMaxStringArgLength && value[length] != '\0') {
+            ++length;
+        }
+        return length;
+    }
+
+    template<>
+    struct Arg<const char *> {
+        typedef const char *Stored;
+
+        static size_t Size(const char *value) {
+            return 1 + (value == NULL ? 6 : StringArgLength(value)) + 1;
+        }
+
+        static uint8_t *Write(uint8_t *out, const char *value) {
+            if (value == NULL) {
+                value = "(null)";
+            }
+            size_t length = StringArgLength(value);
+            *out++ = (uint8_t) length;
+            memcpy(out, value, length);
+            out[length] = '\0';
+            return out + length + 1;
+        }
+
+        static const char *Read(const uint8_t *&in) {
+            size_t length = *in++;
+            const char *value = (const char *) in;
+            in += length + 1;
+            return value;
+        }
+    };
+
+    template<>
+    struct Arg<char *> : Arg<const char *> {};
+
+    template<typename T>
+    struct Arg<T *, typename std::enable_if<!std::is_same<typename std::remove_cv<T>::type,
+            char>::value>::type> {
+        typedef const void *Stored;
+
+        static size_t Size(T *) {
+            return sizeof(const void *);
+        }
+
+        static uint8_t *Write(uint8_t *out, T *value) {
+            const void *stored = value;
+            memcpy(out, &stored, sizeof(stored));
+            return out + sizeof(stored);
+        }
+
+        static const void *Read(const uint8_t *&in) {
+            const void *stored;
+            memcpy(&stored, in, sizeof(stored));
+            in += sizeof(stored);
+            return stored;
+        }
+    };
+
+    template<typename T>
+    using ArgOf = Arg<typename std::decay<T>::type>;
+
+    inline size_t ArgsSize() {
+        return 0;
+    }
+
+    template<typename T, typename... Rest>
+    inline size_t ArgsSize(const T &first, const Rest &... rest) {
+        return ArgOf<T>::Size(first) + ArgsSize(rest...);
+    }
+
+    inline uint8_t *WriteArgs(uint8_t *out) {
+        return out;
+    }
+
+    template<typename T, typename... Rest>
+    inline uint8_t *WriteArgs(uint8_t *out, const T &first, const Rest &... rest) {
+        return WriteArgs(ArgOf<T>::Write(out, first), rest...);
+    }
+
+    inline void FormatMessage(char *out, size_t outSize, const char *fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(out, outSize, fmt, args);
+        va_end(args);
+    }
+
+    // runs on the formatting thread only
+    template<typename... Args>
+    void Decode(const char *fmt, const uint8_t *args, char *out, size_t outSize) {
+        // braced initialisation reads the arguments left to right
+        std::tuple<typename ArgOf<Args>::Stored...> values{ArgOf<Args>::Read(args)...};
+        (void) args;
+        std::apply([&](auto... v) {
+            FormatMessage(out, outSize, fmt, v...);
+        }, values);
+    }
+
+    template<typename... Args>
+    inline void Write(int level, const char *tag, const char *fmt, const Args &... args) {
+        int64_t timeNs = NowNs();
+        uint8_t *out = BeginRecord(ArgsSize(args...));
+        if (out != NULL) {
+            WriteArgs(out, args...);
+            CommitRecord(level, tag, fmt, &Decode<Args...>, timeNs);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,129 @@
+#include "egl_context_layer.hpp"
+#include "game-activity/native_app_glue/android_native_app_glue.h"
+#include "Log.h"
+#include "gl_shader_compiler.hpp"
+#include "swappy/swappyGL.h"
+
+#define LOG_TAG "GameActivityTutorial"
+
+EglContextLayer::EglContextLayer(struct android_app *app, GlShaderCompiler *shaderCompiler) {
+    mApp = app;
+    mShaderCompiler = shaderCompiler;
+    mDisplay = EGL_NO_DISPLAY;
+    mSurface = EGL_NO_SURFACE;
+    mContext = EGL_NO_CONTEXT;
+    mConfig = 0;
+}
+
+int EglContextLayer::GetContextError(EGLint error) {
+    switch (error) {
+        case EGL_SUCCESS:
+            return CONTEXT_OK;
+        case EGL_CONTEXT_LOST:
+        case EGL_BAD_CONTEXT:
+            return CONTEXT_ERROR_CONTEXT;
+        case EGL_BAD_SURFACE:
+        case EGL_BAD_NATIVE_WINDOW:
+            return CONTEXT_ERROR_SURFACE;
+        case EGL_BAD_DISPLAY:
+        case EGL_NOT_INITIALIZED:
+            return CONTEXT_ERROR_DISPLAY;
+        default:
+            ALOGW("EglContextLayer: unexpected EGL error 0x%x", error);
+            return CONTEXT_ERROR_UNKNOWN;
+    }
+}
+
+bool EglContextLayer::InitDisplay() {
+    mDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (EGL_FALSE == eglInitialize(mDisplay, 0, 0)) {
+        ALOGE("EglContextLayer: failed to init display, error %d", eglGetError());
+        mDisplay = EGL_NO_DISPLAY;
+        return false;
+    }
+
+    EGLint numConfigs = 0;
+    const EGLint attribs[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, // request OpenGL ES 3.0
+            // pbuffers for the pipeline cache's background context
+            EGL_SURFACE_TYPE, EGL_WINDOW_BIT | EGL_PBUFFER_BIT,
+            EGL_BLUE_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_RED_SIZE, 8,
+            EGL_DEPTH_SIZE, 16,
+            EGL_NONE
+    };
+
+    // Pick the first EGLConfig that matches.
+    if (!eglChooseConfig(mDisplay, attribs, &mConfig, 1, &numConfigs) || numConfigs < 1) {
+        ALOGE("EglContextLayer: no matching config, error %d", eglGetError());
+        eglTerminate(mDisplay);
+        mDisplay = EGL_NO_DISPLAY;
+        return false;
+    }
+    return true;
+}
+
+void EglContextLayer::TerminateDisplay() {
+    eglTerminate(mDisplay);
+    mDisplay = EGL_NO_DISPLAY;
+}
+
+bool EglContextLayer::CreateSurface() {
+    if (mApp->window == NULL) {
+        return false;
+    }
+    mSurface = eglCreateWindowSurface(mDisplay, mConfig, mApp->window, NULL);
+    if (mSurface == EGL_NO_SURFACE) {
+        ALOGE("Failed to create EGL surface, EGL error %d", eglGetError());
+        return false;
+    }
+    return true;
+}
+
+void EglContextLayer::DestroySurface() {
+    eglDestroySurface(mDisplay, mSurface);
+    mSurface = EGL_NO_SURFACE;
+}
+
+bool EglContextLayer::CreateContext() {
+    // OpenGL ES 3.0, for program binaries
+    EGLint attribList[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+    mContext = eglCreateContext(mDisplay, mConfig, NULL, attribList);
+    if (mContext == EGL_NO_CONTEXT) {
+        ALOGE("Failed to create EGL context, EGL error %d", eglGetError());
+        return false;
+    }
+    mShaderCompiler->SetShareContext(mDisplay, mConfig, mContext);
+    return true;
+}
+
+void EglContextLayer::DestroyContext() {
+    mShaderCompiler->SetShareContext(mDisplay, mConfig, EGL_NO_CONTEXT);
+    eglDestroyContext(mDisplay, mContext);
+    mContext = EGL_NO_CONTEXT;
+}
+
+int EglContextLayer::MakeCurrent() {
+    if (EGL_FALSE == eglMakeCurrent(mDisplay, mSurface, mSurface, mContext)) {
+        const EGLint error = eglGetError();
+        ALOGE("EglContextLayer: eglMakeCurrent failed, EGL error %d", error);
+        // a failure that doesn't say why is treated as the worst case
+        return error != EGL_SUCCESS ? GetContextError(error) : CONTEXT_ERROR_UNKNOWN;
+    }
+    return CONTEXT_OK;
+}
+
+void EglContextLayer::ReleaseCurrent() {
+    eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+int EglContextLayer::Swap() {
+    if (!SwappyGL_swap(mDisplay, mSurface)) {
+        // Swappy fails without an EGL error too, e.g. when it can't pace; that's not fatal
+        const EGLint error = eglGetError();
+        ALOGW("EglContextLayer: SwappyGL_swap failed, EGL error %d", error);
+        return GetContextError(error);
+    }
+    return CONTEXT_OK;
+}
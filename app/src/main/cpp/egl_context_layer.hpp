@@ -0,0 +1,47 @@
+#ifndef agdktunnel_egl_context_layer_hpp
+#define agdktunnel_egl_context_layer_hpp
+
+#include <EGL/egl.h>
+#include "render_context.hpp"
+
+struct android_app;
+class GlShaderCompiler;
+
+// The context layer on EGL, for the app's window. Presents through SwappyGL.
+class EglContextLayer : public ContextLayer {
+public:
+    // the shader compiler's background context is kept sharing with the current one
+    EglContextLayer(struct android_app *app, GlShaderCompiler *shaderCompiler);
+
+    EGLDisplay GetDisplay() const {
+        return mDisplay;
+    }
+
+    EGLSurface GetSurface() const {
+        return mSurface;
+    }
+
+    bool InitDisplay() override;
+    void TerminateDisplay() override;
+    bool CreateSurface() override;
+    void DestroySurface() override;
+    bool CreateContext() override;
+    void DestroyContext() override;
+    int MakeCurrent() override;
+    void ReleaseCurrent() override;
+    int Swap() override;
+
+    // CONTEXT_ERROR_* for an EGL error
+    static int GetContextError(EGLint error);
+
+private:
+    struct android_app *mApp;
+    GlShaderCompiler *mShaderCompiler;
+
+    EGLDisplay mDisplay;
+    EGLSurface mSurface;
+    EGLContext mContext;
+    EGLConfig mConfig;
+};
+
+#endif
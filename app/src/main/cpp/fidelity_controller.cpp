@@ -0,0 +1,133 @@
+#include "fidelity_controller.hpp"
+#include <algorithm>
+#include <cstring>
+#include "Log.h"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// frames between two evaluations
+#define FIDELITY_EVALUATE_FRAMES 30
+
+// which frame cost percentile is held against the budget
+#define FIDELITY_PERCENTILE 90
+
+// go down a level over this percentage of the budget...
+#define FIDELITY_DOWNGRADE_PERCENT 90
+// ...for this many evaluations in a row
+#define FIDELITY_DOWNGRADE_EVALUATIONS 2
+
+// go up a level under this percentage of the budget...
+#define FIDELITY_UPGRADE_PERCENT 55
+// ...for this many evaluations in a row, doubled each time an upgrade is undone
+#define FIDELITY_UPGRADE_EVALUATIONS 6
+#define FIDELITY_MAX_UPGRADE_EVALUATIONS 96
+
+// budget until SetBudget() is called, 60Hz
+#define FIDELITY_DEFAULT_BUDGET_NS 16666667LL
+
+FidelityController::FidelityController(const FidelityParams *levels, int levelCount, int level) {
+    mLevels = levels;
+    mLevelCount = levelCount > 0 ? levelCount : 1;
+    mLevel = 0;
+    mBudgetNs = FIDELITY_DEFAULT_BUDGET_NS;
+    mUpgradeHold = FIDELITY_UPGRADE_EVALUATIONS;
+    mFramesSinceUpgrade = -1;
+    memset(&mStats, 0, sizeof(mStats));
+    SetLevel(level);
+}
+
+void FidelityController::SetBudget(int64_t budgetNs) {
+    mBudgetNs = budgetNs > 0 ? budgetNs : FIDELITY_DEFAULT_BUDGET_NS;
+}
+
+void FidelityController::SetLevel(int level) {
+    mLevel = level < 0 ? 0 : level >= mLevelCount ? mLevelCount - 1 : level;
+    mWindowNext = mWindowCount = 0;
+    mFramesToEvaluation = FIDELITY_EVALUATE_FRAMES;
+    mOverBudget = mUnderBudget = 0;
+}
+
+int FidelityController::FindLevel(const FidelityParams &params) const {
+    int best = 0;
+    for (int i = 1; i < mLevelCount; ++i) {
+        const int distance = abs(mLevels[i].tunnelSectionCount - params.tunnelSectionCount);
+        if (distance < abs(mLevels[best].tunnelSectionCount - params.tunnelSectionCount)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+int64_t FidelityController::GetPercentileNs(int percentile) const {
+    if (mWindowCount == 0) {
+        return 0;
+    }
+    int64_t sorted[FIDELITY_WINDOW_FRAMES];
+    memcpy(sorted, mWindow, sizeof(int64_t) * mWindowCount);
+    int rank = mWindowCount * percentile / 100;
+    if (rank >= mWindowCount) {
+        rank = mWindowCount - 1;
+    }
+    std::nth_element(sorted, sorted + rank, sorted + mWindowCount);
+    return sorted[rank];
+}
+
+void FidelityController::ChangeLevel(int level) {
+    if (level > mLevel) {
+        ++mStats.upgrades;
+        mFramesSinceUpgrade = 0;
+    } else {
+        ++mStats.downgrades;
+        if (mFramesSinceUpgrade >= 0 && mFramesSinceUpgrade <= FIDELITY_WINDOW_FRAMES * 2) {
+            // the richer level couldn't hold, be slower to try it again
+            ++mStats.revertedUpgrades;
+            mUpgradeHold = std::min(mUpgradeHold * 2, FIDELITY_MAX_UPGRADE_EVALUATIONS);
+        }
+        mFramesSinceUpgrade = -1;
+    }
+    ALOGI("FidelityController: level %d -> %d, p%d %.2f ms of %.2f ms", mLevel, level,
+          FIDELITY_PERCENTILE, (double) mStats.lastPercentileNs / 1e6, (double) mBudgetNs / 1e6);
+    SetLevel(level);
+}
+
+bool FidelityController::AddFrame(int64_t costNs) {
+    mWindow[mWindowNext] = costNs;
+    mWindowNext = (mWindowNext + 1) % FIDELITY_WINDOW_FRAMES;
+    if (mWindowCount < FIDELITY_WINDOW_FRAMES) {
+        ++mWindowCount;
+    }
+    if (mFramesSinceUpgrade >= 0) {
+        ++mFramesSinceUpgrade;
+    }
+
+    if (--mFramesToEvaluation > 0) {
+        return false;
+    }
+    mFramesToEvaluation = FIDELITY_EVALUATE_FRAMES;
+    if (mWindowCount < FIDELITY_WINDOW_FRAMES) {
+        // judge a level only on frames rendered at that level
+        return false;
+    }
+
+    const int64_t percentileNs = GetPercentileNs(FIDELITY_PERCENTILE);
+    mStats.lastPercentileNs = percentileNs;
+    if (percentileNs * 100 > mBudgetNs * FIDELITY_DOWNGRADE_PERCENT) {
+        ++mOverBudget;
+        mUnderBudget = 0;
+    } else if (percentileNs * 100 < mBudgetNs * FIDELITY_UPGRADE_PERCENT) {
+        ++mUnderBudget;
+        mOverBudget = 0;
+    } else {
+        mOverBudget = mUnderBudget = 0;
+    }
+
+    if (mOverBudget >= FIDELITY_DOWNGRADE_EVALUATIONS && mLevel > 0) {
+        ChangeLevel(mLevel - 1);
+        return true;
+    }
+    if (mUnderBudget >= mUpgradeHold && mLevel < mLevelCount - 1) {
+        ChangeLevel(mLevel + 1);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,90 @@
+#ifndef agdktunnel_fidelity_controller_hpp
+#define agdktunnel_fidelity_controller_hpp
+
+#include <cstdint>
+#include "performance_reporter.hpp"
+
+// frames of history the percentiles are taken over
+#define FIDELITY_WINDOW_FRAMES 120
+
+/*
+ * Picks a fidelity level from measured frame costs. Levels are ordered from
+ * cheapest to richest. Every FIDELITY_EVALUATE_FRAMES frames, once a full
+ * window of frames has been seen at the current level, a high percentile of
+ * the window is compared against the frame budget:
+ * - a level goes down after a couple of evaluations over the downgrade line;
+ * - it goes up only after a longer run of evaluations under the much lower
+ *   upgrade line.
+ * The gap between the lines keeps a device from flip-flopping between two
+ * levels. An upgrade that has to be undone soon after makes the next upgrade
+ * wait twice as long.
+ */
+class FidelityController {
+public:
+    struct Stats {
+        uint64_t upgrades;
+        uint64_t downgrades;
+        // upgrades undone by a downgrade within one window
+        uint64_t revertedUpgrades;
+        // percentile of the last evaluation
+        int64_t lastPercentileNs;
+    };
+
+    // levels must outlive the controller
+    FidelityController(const FidelityParams *levels, int levelCount, int level);
+
+    // time a frame may take
+    void SetBudget(int64_t budgetNs);
+
+    // Records a frame's cost. Returns true if this moved the controller to
+    // another level.
+    bool AddFrame(int64_t costNs);
+
+    // jumps to a level, e.g. when parameters come from elsewhere, and starts over
+    void SetLevel(int level);
+
+    // index of the level closest to params
+    int FindLevel(const FidelityParams &params) const;
+
+    int GetLevel() const {
+        return mLevel;
+    }
+
+    const FidelityParams &GetParams() const {
+        return mLevels[mLevel];
+    }
+
+    // percentile (0 to 100) of the frames in the window, 0 without frames
+    int64_t GetPercentileNs(int percentile) const;
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+private:
+    void ChangeLevel(int level);
+
+    const FidelityParams *mLevels;
+    int mLevelCount;
+    int mLevel;
+    int64_t mBudgetNs;
+
+    // ring of the latest frame costs
+    int64_t mWindow[FIDELITY_WINDOW_FRAMES];
+    int mWindowNext;
+    int mWindowCount;
+    int mFramesToEvaluation;
+
+    // consecutive evaluations over the downgrade and under the upgrade line
+    int mOverBudget;
+    int mUnderBudget;
+
+    // evaluations needed under the upgrade line, grows when upgrades get undone
+    int mUpgradeHold;
+    // frames since the last upgrade, to spot one that didn't stick
+    int64_t mFramesSinceUpgrade;
+
+    Stats mStats;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include "fixed_timestep.hpp"
+#include <cstring>
+
+FixedTimestep::FixedTimestep(FrameClock *clock, int64_t stepNs, int maxStepsPerFrame) {
+    mClock = clock;
+    mStepNs = stepNs;
+    mMaxStepsPerFrame = maxStepsPerFrame;
+    memset(&mStats, 0, sizeof(mStats));
+    Reset();
+}
+
+void FixedTimestep::Reset() {
+    mHasLastTime = false;
+    mLastTimeNs = 0;
+    mAccumulatorNs = 0;
+}
+
+int FixedTimestep::BeginFrame() {
+    const int64_t now = mClock->NowNs();
+    if (!mHasLastTime) {
+        // the first frame after a reset runs exactly one step
+        mHasLastTime = true;
+        mLastTimeNs = now;
+        mAccumulatorNs = mStepNs;
+    } else {
+        int64_t elapsed = now - mLastTimeNs;
+        mLastTimeNs = now;
+        if (elapsed > 0) {
+            mAccumulatorNs += elapsed;
+        }
+    }
+
+    int steps = (int) (mAccumulatorNs / mStepNs);
+    mAccumulatorNs -= (int64_t) steps * mStepNs;
+
+    if (steps > mMaxStepsPerFrame) {
+        mStats.droppedSteps += steps - mMaxStepsPerFrame;
+        steps = mMaxStepsPerFrame;
+    }
+
+    ++mStats.frames;
+    mStats.steps += steps;
+    if (steps == 0) {
+        ++mStats.idleFrames;
+    } else {
+        mStats.extraSteps += steps - 1;
+    }
+    return steps;
+}
@@ -0,0 +1,64 @@
+#ifndef agdktunnel_fixed_timestep_hpp
+#define agdktunnel_fixed_timestep_hpp
+
+#include <cstdint>
+#include "frame_clock.hpp"
+
+/*
+ * Accumulator for a fixed-step simulation. Each rendered frame calls BeginFrame()
+ * to learn how many simulation steps to run, then renders with GetAlpha() to
+ * interpolate between the last two simulation states. Frame time beyond
+ * maxStepsPerFrame steps is dropped rather than caught up, so a long stall does not
+ * turn into a spiral of ever longer frames.
+ */
+class FixedTimestep {
+public:
+    struct Stats {
+        uint64_t frames;
+        uint64_t steps;
+        // frames that ran no step (render rate above the simulation rate)
+        uint64_t idleFrames;
+        // steps run beyond the first in a frame (render rate below the simulation rate)
+        uint64_t extraSteps;
+        // steps discarded by the catch-up limit
+        uint64_t droppedSteps;
+    };
+
+    FixedTimestep(FrameClock *clock, int64_t stepNs, int maxStepsPerFrame);
+
+    // forget accumulated time, e.g. after the loop was paused
+    void Reset();
+
+    // returns the number of simulation steps to run this frame
+    int BeginFrame();
+
+    // fraction of a step between the previous and the current simulation state
+    float GetAlpha() const {
+        return (float) ((double) mAccumulatorNs / (double) mStepNs);
+    }
+
+    int64_t GetStepNs() const {
+        return mStepNs;
+    }
+
+    float GetStepSeconds() const {
+        return (float) mStepNs * 1e-9f;
+    }
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+private:
+    FrameClock *mClock;
+    int64_t mStepNs;
+    int mMaxStepsPerFrame;
+
+    bool mHasLastTime;
+    int64_t mLastTimeNs;
+    int64_t mAccumulatorNs;
+
+    Stats mStats;
+};
+
+#endif
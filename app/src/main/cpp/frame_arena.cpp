@@ -0,0 +1,63 @@
+#include "frame_arena.hpp"
+#include <cstdlib>
+#include <cstring>
+#include "Log.h"
+
+#define LOG_TAG "GameActivityTutorial"
+
+FrameArena::FrameArena(size_t bufferSize) {
+    mBufferSize = (bufferSize + kBufferAlignment - 1) & ~(size_t) (kBufferAlignment - 1);
+    for (int i = 0; i < 2; ++i) {
+        mBuffers[i].data = (uint8_t *) aligned_alloc(kBufferAlignment, mBufferSize);
+        if (mBuffers[i].data == NULL) {
+            ALOGE("FrameArena: failed to allocate %zu bytes, every allocation will overflow",
+                  mBufferSize);
+        }
+        mBuffers[i].offset = mBuffers[i].data != NULL ? 0 : mBufferSize;
+    }
+    mCurrent = 0;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+FrameArena::~FrameArena() {
+    for (int i = 0; i < 2; ++i) {
+        ResetBuffer(mBuffers[i]);
+        free(mBuffers[i].data);
+    }
+}
+
+void *FrameArena::AllocateOverflow(Buffer &buffer, size_t size, size_t alignment) {
+    if (alignment < sizeof(void *)) {
+        alignment = sizeof(void *);
+    }
+    // aligned_alloc wants a multiple of the alignment
+    void *memory = aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+    if (memory == NULL) {
+        return NULL;
+    }
+
+    buffer.overflow.push_back(memory);
+    ++mStats.overflowAllocations;
+    mStats.overflowBytes += size;
+    return memory;
+}
+
+void FrameArena::ResetBuffer(Buffer &buffer) {
+    for (size_t i = 0; i < buffer.overflow.size(); ++i) {
+        free(buffer.overflow[i]);
+    }
+    buffer.overflow.clear();
+    buffer.offset = buffer.data != NULL ? 0 : mBufferSize;
+}
+
+void FrameArena::EndFrame() {
+    const size_t used = mBuffers[mCurrent].offset;
+    if (mBuffers[mCurrent].data != NULL && used > mStats.highWater) {
+        mStats.highWater = used;
+    }
+    ++mStats.frames;
+
+    // the buffer we switch to was last used two frames ago
+    mCurrent ^= 1;
+    ResetBuffer(mBuffers[mCurrent]);
+}
@@ -0,0 +1,130 @@
+#ifndef agdktunnel_frame_arena_hpp
+#define agdktunnel_frame_arena_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Double-buffered bump allocator for transient frame data. Allocating bumps the
+ * current buffer's offset and nothing is freed individually. Only the thread that
+ * owns the arena (the game thread for the engine's) may use it; jobs get their
+ * scratch memory allocated up front by the thread submitting them. EndFrame() switches to the other buffer and
+ * resets it, so memory allocated during a frame stays valid until the end of the
+ * following frame. When a buffer is full, allocations fall back to malloc and are
+ * freed when that buffer is reset; the counters show how often that happens.
+ */
+class FrameArena {
+public:
+    struct Stats {
+        uint64_t frames;
+        // allocations that did not fit and went to the heap
+        uint64_t overflowAllocations;
+        uint64_t overflowBytes;
+        // most bytes used from one buffer in a frame
+        size_t highWater;
+    };
+
+    FrameArena(size_t bufferSize);
+
+    ~FrameArena();
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    // alignment must be a power of two; never returns NULL unless the heap is exhausted
+    void *Allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        Buffer &buffer = mBuffers[mCurrent];
+        // buffers are aligned to kBufferAlignment, so aligning the offset is enough
+        // for alignments up to that; bigger ones take the heap
+        if (alignment <= kBufferAlignment) {
+            const size_t start = (buffer.offset + alignment - 1) & ~(alignment - 1);
+            if (start <= mBufferSize && size <= mBufferSize - start) {
+                buffer.offset = start + size;
+                return buffer.data + start;
+            }
+        }
+        return AllocateOverflow(buffer, size, alignment);
+    }
+
+    template<typename T>
+    T *AllocateArray(size_t count) {
+        return (T *) Allocate(count * sizeof(T), alignof(T));
+    }
+
+    // switches buffers and resets the one that becomes current
+    void EndFrame();
+
+    size_t GetBufferSize() const {
+        return mBufferSize;
+    }
+
+    // bytes used from the current buffer
+    size_t GetUsed() const {
+        return mBuffers[mCurrent].offset;
+    }
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+private:
+    static constexpr size_t kBufferAlignment = 64;
+
+    struct Buffer {
+        uint8_t *data;
+        size_t offset;
+        std::vector<void *> overflow;
+    };
+
+    void *AllocateOverflow(Buffer &buffer, size_t size, size_t alignment);
+    void ResetBuffer(Buffer &buffer);
+
+    size_t mBufferSize;
+    Buffer mBuffers[2];
+    int mCurrent;
+
+    Stats mStats;
+};
+
+// STL allocator on a FrameArena, e.g. std::vector<int, FrameAllocator<int>>.
+// Deallocation is a no-op; the containers must not outlive the arena's frame.
+template<typename T>
+class FrameAllocator {
+public:
+    typedef T value_type;
+
+    FrameAllocator(FrameArena *arena) : mArena(arena) {}
+
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U> &other) : mArena(other.GetArena()) {}
+
+    T *allocate(size_t count) {
+        return mArena->AllocateArray<T>(count);
+    }
+
+    void deallocate(T *, size_t) {
+    }
+
+    FrameArena *GetArena() const {
+        return mArena;
+    }
+
+    template<typename U>
+    bool operator==(const FrameAllocator<U> &other) const {
+        return mArena == other.GetArena();
+    }
+
+    template<typename U>
+    bool operator!=(const FrameAllocator<U> &other) const {
+        return mArena != other.GetArena();
+    }
+
+private:
+    FrameArena *mArena;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef agdktunnel_frame_clock_hpp
+#define agdktunnel_frame_clock_hpp
+
+#include <chrono>
+#include <cstdint>
+
+// Monotonic time source for frame timing, so the timing logic can be driven by a
+// fake clock on a host.
+class FrameClock {
+public:
+    virtual ~FrameClock() = default;
+
+    virtual int64_t NowNs() = 0;
+};
+
+class SteadyFrameClock : public FrameClock {
+public:
+    int64_t NowNs() override {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+// only moves when told to
+class FakeFrameClock : public FrameClock {
+public:
+    FakeFrameClock() : mNowNs(0) {}
+
+    int64_t NowNs() override {
+        return mNowNs;
+    }
+
+    void Advance(int64_t ns) {
+        mNowNs += ns;
+    }
+
+    void Set(int64_t ns) {
+        mNowNs = ns;
+    }
+
+private:
+    int64_t mNowNs;
+};
+
+#endif
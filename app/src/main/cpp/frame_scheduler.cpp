@@ -0,0 +1,74 @@
+#include "frame_scheduler.hpp"
+#include <cstring>
+
+// margin kept before the predicted deadline on top of the predicted frame cost
+#define FRAME_SCHEDULER_MIN_MARGIN_NS 1000000LL
+// ...plus this fraction (1/n) of the predicted cost, for frames costing more than usual
+#define FRAME_SCHEDULER_MARGIN_COST_DIVISOR 4
+// a cheaper frame moves the cost estimate down by 1/n of the difference
+#define FRAME_SCHEDULER_COST_DECAY 16
+
+FrameScheduler::FrameScheduler(FrameClock *clock) {
+    mClock = clock;
+    mPeriodNs = 0;
+    mPredictedCostNs = 0;
+    memset(&mStats, 0, sizeof(mStats));
+    Reset();
+}
+
+void FrameScheduler::Reset() {
+    mHasLastPresent = false;
+    mLastPresentNs = 0;
+    mFrameStartNs = mPresentStartNs = mClock->NowNs();
+}
+
+void FrameScheduler::SetPresentPeriod(int64_t periodNs) {
+    mPeriodNs = periodNs > 0 ? periodNs : 0;
+}
+
+int64_t FrameScheduler::GetSafetyMarginNs() const {
+    return FRAME_SCHEDULER_MIN_MARGIN_NS + mPredictedCostNs / FRAME_SCHEDULER_MARGIN_COST_DIVISOR;
+}
+
+int64_t FrameScheduler::GetWaitNs() {
+    if (mPeriodNs == 0 || !mHasLastPresent) {
+        return 0;
+    }
+    const int64_t deadlineNs = mLastPresentNs + mPeriodNs;
+    const int64_t startNs = deadlineNs - mPredictedCostNs - GetSafetyMarginNs();
+    const int64_t waitNs = startNs - mClock->NowNs();
+    return waitNs > 0 ? waitNs : 0;
+}
+
+void FrameScheduler::BeginFrame() {
+    const int64_t nowNs = mClock->NowNs();
+    // idle since the previous frame's work ended, including its present
+    mStats.lastIdleNs = mHasLastPresent ? nowNs - mPresentStartNs : 0;
+    mStats.idleNs += mStats.lastIdleNs;
+    mFrameStartNs = nowNs;
+}
+
+void FrameScheduler::BeginPresent() {
+    mPresentStartNs = mClock->NowNs();
+}
+
+void FrameScheduler::EndFrame() {
+    const int64_t nowNs = mClock->NowNs();
+    const int64_t costNs = mPresentStartNs - mFrameStartNs;
+
+    if (costNs >= mPredictedCostNs) {
+        mPredictedCostNs = costNs;
+    } else {
+        mPredictedCostNs -= (mPredictedCostNs - costNs) / FRAME_SCHEDULER_COST_DECAY;
+    }
+
+    if (mHasLastPresent && mPeriodNs > 0 && nowNs - mLastPresentNs > mPeriodNs + mPeriodNs / 2) {
+        ++mStats.missedDeadlines;
+    }
+    mHasLastPresent = true;
+    mLastPresentNs = nowNs;
+
+    ++mStats.frames;
+    mStats.lastBusyNs = costNs;
+    mStats.busyNs += costNs;
+}
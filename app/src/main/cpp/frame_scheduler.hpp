@@ -0,0 +1,78 @@
+#ifndef agdktunnel_frame_scheduler_hpp
+#define agdktunnel_frame_scheduler_hpp
+
+#include <cstdint>
+#include "frame_clock.hpp"
+
+/*
+ * Decides how long the game loop may sleep before starting the next frame.
+ * Presenting returns once a frame is queued for its vsync, so the next present
+ * deadline is predicted one present period after the last one returned. The frame
+ * starts the predicted frame cost plus a safety margin before that deadline; the
+ * cost is the work up to presenting (not the blocking in present), and its estimate
+ * follows increases immediately and decays slowly. With no present
+ * period (unpaced presenting) the scheduler never waits.
+ */
+class FrameScheduler {
+public:
+    struct Stats {
+        uint64_t frames;
+        // frames presented later than a period and a half after the previous one
+        uint64_t missedDeadlines;
+        // time not spent working on a frame: waiting, handling events, blocking in present
+        int64_t idleNs;
+        // time between starting a frame and handing it to the presenter
+        int64_t busyNs;
+        int64_t lastIdleNs;
+        int64_t lastBusyNs;
+    };
+
+    FrameScheduler(FrameClock *clock);
+
+    // forget the last present, e.g. after the loop was paused
+    void Reset();
+
+    // time between presents, 0 when presenting is not paced
+    void SetPresentPeriod(int64_t periodNs);
+
+    // how long to wait before starting the next frame, 0 when it is due
+    int64_t GetWaitNs();
+
+    // GetWaitNs() rounded down to whole milliseconds, for millisecond timeouts
+    int GetWaitMs() {
+        return (int) (GetWaitNs() / 1000000);
+    }
+
+    // the frame's work starts now
+    void BeginFrame();
+
+    // the frame's work is done and it is about to be presented
+    void BeginPresent();
+
+    // presenting returned just now
+    void EndFrame();
+
+    int64_t GetPredictedCostNs() const {
+        return mPredictedCostNs;
+    }
+
+    int64_t GetSafetyMarginNs() const;
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+private:
+    FrameClock *mClock;
+    int64_t mPeriodNs;
+
+    bool mHasLastPresent;
+    int64_t mLastPresentNs;
+    int64_t mFrameStartNs;
+    int64_t mPresentStartNs;
+    int64_t mPredictedCostNs;
+
+    Stats mStats;
+};
+
+#endif
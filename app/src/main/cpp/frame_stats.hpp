@@ -0,0 +1,48 @@
+#ifndef agdktunnel_frame_stats_hpp
+#define agdktunnel_frame_stats_hpp
+
+#include <cstdint>
+#include <cstring>
+
+// phases of one iteration of the game loop
+#define FRAME_PHASE_EVENTS 0
+#define FRAME_PHASE_INPUT 1
+#define FRAME_PHASE_PREPARE 2
+#define FRAME_PHASE_SIMULATION 3
+#define FRAME_PHASE_RENDER 4
+#define FRAME_PHASE_PRESENT 5
+#define FRAME_PHASE_COUNT 6
+
+struct FramePhaseStats {
+    uint64_t count;
+    int64_t totalNs;
+    int64_t maxNs;
+};
+
+// time spent in each phase of the game loop since the engine started
+struct FrameStats {
+    uint64_t frames;
+    FramePhaseStats phases[FRAME_PHASE_COUNT];
+
+    void Clear() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    void Add(int phase, int64_t ns) {
+        FramePhaseStats &stats = phases[phase];
+        ++stats.count;
+        stats.totalNs += ns;
+        if (ns > stats.maxNs) {
+            stats.maxNs = ns;
+        }
+    }
+
+    static const char *GetPhaseName(int phase) {
+        static const char *names[FRAME_PHASE_COUNT] = {
+                "events", "input", "prepare", "simulation", "render", "present"
+        };
+        return phase >= 0 && phase < FRAME_PHASE_COUNT ? names[phase] : "unknown";
+    }
+};
+
+#endif
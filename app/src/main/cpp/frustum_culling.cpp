@@ -0,0 +1,117 @@
+#include "frustum_culling.hpp"
+#include <cmath>
+#include "simd.hpp"
+
+namespace {
+    void set_plane(Frustum *frustum, int plane, float nx, float ny, float nz,
+                   const float eye[3], float offset) {
+        const float length = sqrtf(nx * nx + ny * ny + nz * nz);
+        nx /= length;
+        ny /= length;
+        nz /= length;
+        frustum->nx[plane] = nx;
+        frustum->ny[plane] = ny;
+        frustum->nz[plane] = nz;
+        frustum->d[plane] = -(nx * eye[0] + ny * eye[1] + nz * eye[2]) + offset;
+    }
+
+    // Both paths test distance + radius > 0, summed in the same order so they agree
+    // on spheres that just touch a plane.
+    inline bool sphere_visible(const Frustum &frustum, float x, float y, float z, float radius) {
+        for (int plane = 0; plane < FRUSTUM_PLANE_COUNT; ++plane) {
+            const float reach = frustum.nx[plane] * x + (frustum.ny[plane] * y +
+                                (frustum.nz[plane] * z + (frustum.d[plane] + radius)));
+            if (!(reach > 0.0f)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline Float4 plane_reach(Float4 nx, Float4 ny, Float4 nz, Float4 d, Float4 x, Float4 y,
+                              Float4 z, Float4 radius) {
+        return Float4MulAdd(nx, x, Float4MulAdd(ny, y, Float4MulAdd(nz, z, Float4Add(d, radius))));
+    }
+}
+
+void MakeFrustum(Frustum *frustum, const float eye[3], const float forward[3], const float up[3],
+                 float fovY, float aspect, float nearZ, float farZ) {
+    // right = forward x up, then an up that is exactly perpendicular
+    float right[3] = {forward[1] * up[2] - forward[2] * up[1],
+                      forward[2] * up[0] - forward[0] * up[2],
+                      forward[0] * up[1] - forward[1] * up[0]};
+    const float rightLength = sqrtf(right[0] * right[0] + right[1] * right[1] +
+                                    right[2] * right[2]);
+    for (int i = 0; i < 3; ++i) {
+        right[i] /= rightLength;
+    }
+    const float trueUp[3] = {right[1] * forward[2] - right[2] * forward[1],
+                             right[2] * forward[0] - right[0] * forward[2],
+                             right[0] * forward[1] - right[1] * forward[0]};
+
+    const float halfHeight = tanf(fovY * 0.5f);
+    const float halfWidth = halfHeight * aspect;
+    const float *f = forward;
+
+    set_plane(frustum, 0, f[0], f[1], f[2], eye, -nearZ);
+    set_plane(frustum, 1, -f[0], -f[1], -f[2], eye, farZ);
+    // the side planes pass through the eye, their normals point inwards
+    set_plane(frustum, 2, right[0] + halfWidth * f[0], right[1] + halfWidth * f[1],
+              right[2] + halfWidth * f[2], eye, 0.0f);
+    set_plane(frustum, 3, -right[0] + halfWidth * f[0], -right[1] + halfWidth * f[1],
+              -right[2] + halfWidth * f[2], eye, 0.0f);
+    set_plane(frustum, 4, trueUp[0] + halfHeight * f[0], trueUp[1] + halfHeight * f[1],
+              trueUp[2] + halfHeight * f[2], eye, 0.0f);
+    set_plane(frustum, 5, -trueUp[0] + halfHeight * f[0], -trueUp[1] + halfHeight * f[1],
+              -trueUp[2] + halfHeight * f[2], eye, 0.0f);
+}
+
+int CullSpheres(const Frustum &frustum, const float *x, const float *y, const float *z,
+                const float *radius, int count, uint32_t *visible) {
+    Float4 nx[FRUSTUM_PLANE_COUNT], ny[FRUSTUM_PLANE_COUNT], nz[FRUSTUM_PLANE_COUNT];
+    Float4 d[FRUSTUM_PLANE_COUNT];
+    for (int plane = 0; plane < FRUSTUM_PLANE_COUNT; ++plane) {
+        nx[plane] = Float4Set1(frustum.nx[plane]);
+        ny[plane] = Float4Set1(frustum.ny[plane]);
+        nz[plane] = Float4Set1(frustum.nz[plane]);
+        d[plane] = Float4Set1(frustum.d[plane]);
+    }
+    const Float4 zero = Float4Set1(0.0f);
+
+    int visibleCount = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const Float4 sx = Float4Load(x + i);
+        const Float4 sy = Float4Load(y + i);
+        const Float4 sz = Float4Load(z + i);
+        const Float4 sr = Float4Load(radius + i);
+        Mask4 inside = Float4Greater(plane_reach(nx[0], ny[0], nz[0], d[0], sx, sy, sz, sr), zero);
+        for (int plane = 1; plane < FRUSTUM_PLANE_COUNT; ++plane) {
+            inside = Mask4And(inside, Float4Greater(
+                    plane_reach(nx[plane], ny[plane], nz[plane], d[plane], sx, sy, sz, sr), zero));
+        }
+
+        int bits = Mask4Bits(inside);
+        while (bits != 0) {
+            visible[visibleCount++] = (uint32_t) (i + __builtin_ctz(bits));
+            bits &= bits - 1;
+        }
+    }
+    for (; i < count; ++i) {
+        if (sphere_visible(frustum, x[i], y[i], z[i], radius[i])) {
+            visible[visibleCount++] = (uint32_t) i;
+        }
+    }
+    return visibleCount;
+}
+
+int CullSpheresScalar(const Frustum &frustum, const float *x, const float *y, const float *z,
+                      const float *radius, int count, uint32_t *visible) {
+    int visibleCount = 0;
+    for (int i = 0; i < count; ++i) {
+        if (sphere_visible(frustum, x[i], y[i], z[i], radius[i])) {
+            visible[visibleCount++] = (uint32_t) i;
+        }
+    }
+    return visibleCount;
+}
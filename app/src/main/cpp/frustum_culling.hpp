@@ -0,0 +1,37 @@
+#ifndef agdktunnel_frustum_culling_hpp
+#define agdktunnel_frustum_culling_hpp
+
+#include <cstdint>
+
+#define FRUSTUM_PLANE_COUNT 6
+
+// Planes as separate streams. Plane i keeps the points with
+// nx[i] * x + ny[i] * y + nz[i] * z + d[i] >= 0; normals are unit length.
+struct Frustum {
+    float nx[FRUSTUM_PLANE_COUNT];
+    float ny[FRUSTUM_PLANE_COUNT];
+    float nz[FRUSTUM_PLANE_COUNT];
+    float d[FRUSTUM_PLANE_COUNT];
+};
+
+// Perspective frustum of a camera at eye looking along forward (unit length), with
+// up roughly perpendicular to it. fovY is in radians, aspect is width / height.
+void MakeFrustum(Frustum *frustum, const float eye[3], const float forward[3], const float up[3],
+                 float fovY, float aspect, float nearZ, float farZ);
+
+/*
+ * Tests bounding spheres, given as separate x, y, z and radius streams, against
+ * a frustum and writes the indices of those at least partly inside to visible,
+ * in increasing order. visible needs room for count indices. Returns how many
+ * were written. Spheres are tested four at a time (NEON, SSE2 or scalar, see
+ * simd.hpp); a sphere may be reported visible when it only touches the frustum's
+ * corner regions, never the other way round.
+ */
+int CullSpheres(const Frustum &frustum, const float *x, const float *y, const float *z,
+                const float *radius, int count, uint32_t *visible);
+
+// CullSpheres() one sphere at a time, for reference
+int CullSpheresScalar(const Frustum &frustum, const float *x, const float *y, const float *z,
+                      const float *radius, int count, uint32_t *visible);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef agdktunnel_game_consts_hpp
+#define agdktunnel_game_consts_hpp
+
+// length of each tunnel section
+#define TUNNEL_SECTION_LENGTH 150.0f
+
+// number of tunnel sections to render ahead
+#define RENDER_TUNNEL_SECTION_COUNT 4
+
+// the dense fidelity level: more, shorter sections
+#define HIGH_TUNNEL_SECTION_COUNT 8
+#define HIGH_TUNNEL_SECTION_LENGTH 75.0f
+
+// most sections any fidelity level renders ahead; sizes the tunnel's vertex pools
+#define MAX_TUNNEL_SECTION_COUNT 8
+
+// camera's vertical field of view in radians, and its near plane
+#define CAMERA_FOV_Y 1.1f
+#define CAMERA_NEAR 0.5f
+
+// the camera looks at the tunnel's centre this far ahead
+#define CAMERA_LOOK_AHEAD 40.0f
+
+// radius of the tunnel
+#define TUNNEL_RADIUS 20.0f
+
+// vertices around the tunnel, must be a multiple of 4
+#define TUNNEL_RING_SEGMENTS 32
+
+// rings of vertices along each section (plus one closing ring)
+#define TUNNEL_RINGS_PER_SECTION 24
+
+// new sections built per frame at most, so a fidelity change doesn't stall a frame
+#define TUNNEL_MAX_SECTION_BUILDS_PER_FRAME 2
+
+#endif
@@ -0,0 +1,99 @@
+#include "gl_gpu_timer.hpp"
+#include <EGL/egl.h>
+#include <cstring>
+#include "Log.h"
+
+#define LOG_TAG "GameActivityTutorial"
+
+GlGpuTimer::GlGpuTimer() {
+    mSupported = false;
+    mGetQueryObjectui64v = NULL;
+    memset(mQueries, 0, sizeof(mQueries));
+    memset(mPending, 0, sizeof(mPending));
+    mNext = 0;
+    mTiming = false;
+    mLastFrameNs = -1;
+}
+
+bool GlGpuTimer::Init() {
+    Release(true);
+    const char *extensions = (const char *) glGetString(GL_EXTENSIONS);
+    if (extensions == NULL || strstr(extensions, "GL_EXT_disjoint_timer_query") == NULL) {
+        ALOGI("GlGpuTimer: no GPU timer queries, frames are judged on CPU time");
+        return false;
+    }
+    mGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VEXTPROC)
+            eglGetProcAddress("glGetQueryObjectui64vEXT");
+    if (mGetQueryObjectui64v == NULL) {
+        return false;
+    }
+    glGenQueries(GL_GPU_TIMER_QUERIES, mQueries);
+    // clear a disjoint event left from before
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    mSupported = true;
+    return true;
+}
+
+void GlGpuTimer::Release(bool deleteObjects) {
+    if (mSupported && deleteObjects) {
+        glDeleteQueries(GL_GPU_TIMER_QUERIES, mQueries);
+    }
+    mSupported = false;
+    memset(mQueries, 0, sizeof(mQueries));
+    memset(mPending, 0, sizeof(mPending));
+    mNext = 0;
+    mTiming = false;
+    mLastFrameNs = -1;
+}
+
+void GlGpuTimer::CollectResults() {
+    // queries finish in the order they were issued, the oldest is at mNext
+    const int64_t previousNs = mLastFrameNs;
+    bool collected = false;
+    for (int i = 0; i < GL_GPU_TIMER_QUERIES; ++i) {
+        const int index = (mNext + i) % GL_GPU_TIMER_QUERIES;
+        if (!mPending[index]) {
+            continue;
+        }
+        GLuint available = 0;
+        glGetQueryObjectuiv(mQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        GLuint64 elapsedNs = 0;
+        mGetQueryObjectui64v(mQueries[index], GL_QUERY_RESULT, &elapsedNs);
+        mPending[index] = false;
+        mLastFrameNs = (int64_t) elapsedNs;
+        collected = true;
+    }
+
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if (disjoint && collected) {
+        // the timer jumped while these frames ran, their times mean nothing
+        mLastFrameNs = previousNs;
+    }
+}
+
+void GlGpuTimer::BeginFrame() {
+    if (!mSupported) {
+        return;
+    }
+    CollectResults();
+    // a query that is still in flight can't be reused, skip timing this frame
+    mTiming = !mPending[mNext];
+    if (mTiming) {
+        glBeginQuery(GL_TIME_ELAPSED_EXT, mQueries[mNext]);
+    }
+}
+
+void GlGpuTimer::EndFrame() {
+    if (!mTiming) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED_EXT);
+    mPending[mNext] = true;
+    mNext = (mNext + 1) % GL_GPU_TIMER_QUERIES;
+    mTiming = false;
+}
@@ -0,0 +1,48 @@
+#ifndef agdktunnel_gl_gpu_timer_hpp
+#define agdktunnel_gl_gpu_timer_hpp
+
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#include <cstdint>
+
+// queries in flight, results arrive this many frames late at most
+#define GL_GPU_TIMER_QUERIES 4
+
+/*
+ * Measures the GPU time of frames with EXT_disjoint_timer_query. Results are
+ * read back a few frames later, without ever waiting for them; frames during
+ * which the GPU timer was disjoint (e.g. a frequency change) are dropped.
+ */
+class GlGpuTimer {
+public:
+    GlGpuTimer();
+
+    // looks for the extension on the current context, false without it
+    bool Init();
+
+    // forgets the queries, deleting them if their context is current
+    void Release(bool deleteObjects);
+
+    void BeginFrame();
+
+    void EndFrame();
+
+    // GPU time of the latest measured frame, -1 if there is none
+    int64_t GetLastFrameNs() const {
+        return mLastFrameNs;
+    }
+
+private:
+    void CollectResults();
+
+    bool mSupported;
+    PFNGLGETQUERYOBJECTUI64VEXTPROC mGetQueryObjectui64v;
+    GLuint mQueries[GL_GPU_TIMER_QUERIES];
+    bool mPending[GL_GPU_TIMER_QUERIES];
+    int mNext;
+    // a query was started this frame
+    bool mTiming;
+    int64_t mLastFrameNs;
+};
+
+#endif
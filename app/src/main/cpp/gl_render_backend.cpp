@@ -0,0 +1,50 @@
+#include "gl_render_backend.hpp"
+#include <GLES3/gl3.h>
+
+void GlRenderBackend::Clear(const RenderCommand &command) {
+    GLbitfield mask = 0;
+    if (command.clear.mask & RENDER_CLEAR_COLOR) {
+        const uint32_t rgba = command.clear.rgba;
+        glClearColor((float) ((rgba >> 24) & 0xff) / 255.0f, (float) ((rgba >> 16) & 0xff) / 255.0f,
+                     (float) ((rgba >> 8) & 0xff) / 255.0f, (float) (rgba & 0xff) / 255.0f);
+        mask |= GL_COLOR_BUFFER_BIT;
+    }
+    if (command.clear.mask & RENDER_CLEAR_DEPTH) {
+        mask |= GL_DEPTH_BUFFER_BIT;
+    }
+    glClear(mask);
+}
+
+void GlRenderBackend::BindProgram(uint32_t program) {
+    glUseProgram(program);
+}
+
+void GlRenderBackend::BindTexture(uint32_t texture) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GlRenderBackend::BindVertexBuffer(uint32_t vertexBuffer) {
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+}
+
+void GlRenderBackend::SetFlags(uint32_t flags, uint32_t changed) {
+    if (changed & RENDER_FLAG_DEPTH_TEST) {
+        if (flags & RENDER_FLAG_DEPTH_TEST) {
+            glEnable(GL_DEPTH_TEST);
+        } else {
+            glDisable(GL_DEPTH_TEST);
+        }
+    }
+    if (changed & RENDER_FLAG_BLEND) {
+        if (flags & RENDER_FLAG_BLEND) {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        } else {
+            glDisable(GL_BLEND);
+        }
+    }
+}
+
+void GlRenderBackend::Draw(const RenderCommand &command) {
+    glDrawArrays(command.draw.primitive, command.draw.first, command.draw.count);
+}
@@ -0,0 +1,17 @@
+#ifndef agdktunnel_gl_render_backend_hpp
+#define agdktunnel_gl_render_backend_hpp
+
+#include "render_backend.hpp"
+
+// Replays render commands with OpenGL ES calls on the current context.
+class GlRenderBackend : public RenderBackend {
+protected:
+    void Clear(const RenderCommand &command) override;
+    void BindProgram(uint32_t program) override;
+    void BindTexture(uint32_t texture) override;
+    void BindVertexBuffer(uint32_t vertexBuffer) override;
+    void SetFlags(uint32_t flags, uint32_t changed) override;
+    void Draw(const RenderCommand &command) override;
+};
+
+#endif
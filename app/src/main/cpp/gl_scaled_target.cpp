@@ -0,0 +1,93 @@
+#include "gl_scaled_target.hpp"
+#include "Log.h"
+#include "trace.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+GlScaledTarget::GlScaledTarget() {
+    mFramebuffer = mColor = mDepth = 0;
+    mWidth = mHeight = 0;
+    mActive = false;
+    mSurfaceWidth = mSurfaceHeight = 0;
+}
+
+bool GlScaledTarget::Allocate(int width, int height) {
+    // sizes only change on resolution steps, a fresh target each time is fine
+    Release(true);
+    glGenFramebuffers(1, &mFramebuffer);
+    glGenRenderbuffers(1, &mColor);
+    glGenRenderbuffers(1, &mDepth);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, mColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, mDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mColor);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepth);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        ALOGE("GlScaledTarget: %dx%d target incomplete, status 0x%x", width, height, status);
+        Release(true);
+        return false;
+    }
+    mWidth = width;
+    mHeight = height;
+    ALOGI("GlScaledTarget: rendering at %dx%d", width, height);
+    return true;
+}
+
+bool GlScaledTarget::Bind(int width, int height, int surfaceWidth, int surfaceHeight) {
+    mSurfaceWidth = surfaceWidth;
+    mSurfaceHeight = surfaceHeight;
+    if (width >= surfaceWidth && height >= surfaceHeight) {
+        mActive = false;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return true;
+    }
+    if ((width != mWidth || height != mHeight) && !Allocate(width, height)) {
+        mActive = false;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return false;
+    }
+    mActive = true;
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    return true;
+}
+
+void GlScaledTarget::Resolve() {
+    if (!mActive) {
+        return;
+    }
+    TRACE_SCOPE("ResolveScaledTarget");
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, mWidth, mHeight, 0, 0, mSurfaceWidth, mSurfaceHeight,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    // nothing offscreen is needed again, tilers can skip writing it back to memory
+    const GLenum attachments[] = {GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT};
+    glInvalidateFramebuffer(GL_READ_FRAMEBUFFER, 2, attachments);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    mActive = false;
+}
+
+void GlScaledTarget::Release(bool deleteObjects) {
+    if (deleteObjects) {
+        if (mFramebuffer != 0) {
+            glDeleteFramebuffers(1, &mFramebuffer);
+        }
+        if (mColor != 0) {
+            glDeleteRenderbuffers(1, &mColor);
+        }
+        if (mDepth != 0) {
+            glDeleteRenderbuffers(1, &mDepth);
+        }
+    }
+    mFramebuffer = mColor = mDepth = 0;
+    mWidth = mHeight = 0;
+    mActive = false;
+}
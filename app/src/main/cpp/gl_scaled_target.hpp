@@ -0,0 +1,38 @@
+#ifndef agdktunnel_gl_scaled_target_hpp
+#define agdktunnel_gl_scaled_target_hpp
+
+#include <GLES3/gl3.h>
+
+/*
+ * Where a frame rendered below the window's size goes: an offscreen color and
+ * depth target that is scaled up onto the window framebuffer before the frame
+ * is presented. Frames at the window's size render to the window directly.
+ */
+class GlScaledTarget {
+public:
+    GlScaledTarget();
+
+    // binds the framebuffer a frame of width x height renders to, false if it can't be made
+    bool Bind(int width, int height, int surfaceWidth, int surfaceHeight);
+
+    // scales a frame rendered offscreen up onto the window framebuffer
+    void Resolve();
+
+    // forgets the GL objects, deleting them if their context is current
+    void Release(bool deleteObjects);
+
+private:
+    bool Allocate(int width, int height);
+
+    GLuint mFramebuffer;
+    GLuint mColor;
+    GLuint mDepth;
+    // size of the allocated target
+    int mWidth, mHeight;
+
+    // the frame being rendered goes offscreen
+    bool mActive;
+    int mSurfaceWidth, mSurfaceHeight;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "gl_shader_compiler.hpp"
+#include <GLES3/gl3.h>
+#include "Log.h"
+
+#define LOG_TAG "GameActivityTutorial"
+
+namespace {
+    // the background thread's context and surface, when it has one
+    thread_local EGLContext tContext = EGL_NO_CONTEXT;
+    thread_local EGLSurface tSurface = EGL_NO_SURFACE;
+
+    GLuint compile_shader(GLenum type, const char *source, const char *name) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (compiled != GL_TRUE) {
+            char log[512];
+            glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+            ALOGE("GlShaderCompiler: %s %s shader failed to compile: %s", name,
+                  type == GL_VERTEX_SHADER ? "vertex" : "fragment", log);
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+    // A program built on one context may only be used on another once it is
+    // complete; finishing makes sure it is before another thread gets to see it.
+    void finish_if_background() {
+        if (tContext != EGL_NO_CONTEXT) {
+            glFinish();
+        }
+    }
+}
+
+GlShaderCompiler::GlShaderCompiler() {
+    mDisplay = EGL_NO_DISPLAY;
+    mConfig = 0;
+    mShareContext = EGL_NO_CONTEXT;
+}
+
+void GlShaderCompiler::SetShareContext(EGLDisplay display, EGLConfig config, EGLContext context) {
+    mDisplay = display;
+    mConfig = config;
+    mShareContext = context;
+}
+
+std::string GlShaderCompiler::GetDriverId() {
+    // a driver update changes at least one of these, and invalidates old binaries
+    std::string id;
+    const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (GLenum name : names) {
+        const char *value = (const char *) glGetString(name);
+        id += value != NULL ? value : "?";
+        id += '\n';
+    }
+    return id;
+}
+
+uint32_t GlShaderCompiler::CompileProgram(const PipelineDesc &desc) {
+    GLuint vertexShader = compile_shader(GL_VERTEX_SHADER, desc.vertexSource, desc.name);
+    GLuint fragmentShader = compile_shader(GL_FRAGMENT_SHADER, desc.fragmentSource, desc.name);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    // the cache will ask for the binary
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        char log[512];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        ALOGE("GlShaderCompiler: %s failed to link: %s", desc.name, log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    finish_if_background();
+    return program;
+}
+
+bool GlShaderCompiler::GetProgramBinary(uint32_t program, std::vector<uint8_t> *binary,
+                                        uint32_t *format) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return false;
+    }
+    binary->resize(length);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, length, &length, &binaryFormat, binary->data());
+    if (glGetError() != GL_NO_ERROR) {
+        return false;
+    }
+    binary->resize(length);
+    *format = binaryFormat;
+    return true;
+}
+
+uint32_t GlShaderCompiler::LoadProgramBinary(const uint8_t *binary, size_t size,
+                                             uint32_t format) {
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, format, binary, (GLsizei) size);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        // e.g. the driver changed its binary format without changing its version string
+        glDeleteProgram(program);
+        return 0;
+    }
+    finish_if_background();
+    return program;
+}
+
+void GlShaderCompiler::DeleteProgram(uint32_t program) {
+    glDeleteProgram(program);
+}
+
+bool GlShaderCompiler::AttachThread() {
+    if (mShareContext == EGL_NO_CONTEXT) {
+        return false;
+    }
+    const EGLint surfaceAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    tSurface = eglCreatePbufferSurface(mDisplay, mConfig, surfaceAttribs);
+    const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+    tContext = eglCreateContext(mDisplay, mConfig, mShareContext, contextAttribs);
+    if (tSurface == EGL_NO_SURFACE || tContext == EGL_NO_CONTEXT ||
+        eglMakeCurrent(mDisplay, tSurface, tSurface, tContext) == EGL_FALSE) {
+        ALOGW("GlShaderCompiler: no background context, EGL error %d", eglGetError());
+        DetachThread();
+        return false;
+    }
+    return true;
+}
+
+void GlShaderCompiler::DetachThread() {
+    eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (tContext != EGL_NO_CONTEXT) {
+        eglDestroyContext(mDisplay, tContext);
+        tContext = EGL_NO_CONTEXT;
+    }
+    if (tSurface != EGL_NO_SURFACE) {
+        eglDestroySurface(mDisplay, tSurface);
+        tSurface = EGL_NO_SURFACE;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef agdktunnel_gl_shader_compiler_hpp
+#define agdktunnel_gl_shader_compiler_hpp
+
+#include <EGL/egl.h>
+#include "pipeline_cache.hpp"
+
+/*
+ * Builds OpenGL ES 3 programs. Compiling happens on whatever context is current;
+ * a background thread gets its own context sharing objects with the render
+ * context given to SetShareContext(), and a 1x1 pbuffer to make it current on.
+ */
+class GlShaderCompiler : public ShaderCompiler {
+public:
+    GlShaderCompiler();
+
+    // the render context background threads share with, EGL_NO_CONTEXT when there is none
+    void SetShareContext(EGLDisplay display, EGLConfig config, EGLContext context);
+
+    std::string GetDriverId() override;
+    uint32_t CompileProgram(const PipelineDesc &desc) override;
+    bool GetProgramBinary(uint32_t program, std::vector<uint8_t> *binary,
+                          uint32_t *format) override;
+    uint32_t LoadProgramBinary(const uint8_t *binary, size_t size, uint32_t format) override;
+    void DeleteProgram(uint32_t program) override;
+    bool AttachThread() override;
+    void DetachThread() override;
+
+private:
+    EGLDisplay mDisplay;
+    EGLConfig mConfig;
+    EGLContext mShareContext;
+};
+
+#endif
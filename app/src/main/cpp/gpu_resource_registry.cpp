@@ -0,0 +1,92 @@
+#include "gpu_resource_registry.hpp"
+#include <cstring>
+#include "Log.h"
+#include "trace.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+GpuResourceRegistry::GpuResourceRegistry() {
+    mEntryCount = 0;
+    mComplete = true;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+bool GpuResourceRegistry::Register(const GpuResourceRecipe &recipe) {
+    if (mEntryCount >= GPU_RESOURCE_MAX_RECIPES) {
+        ALOGE("GpuResourceRegistry: no room for %s", recipe.name);
+        return false;
+    }
+    int index = mEntryCount;
+    while (index > 0 && mEntries[index - 1].recipe.priority > recipe.priority) {
+        mEntries[index] = mEntries[index - 1];
+        --index;
+    }
+    mEntries[index].recipe = recipe;
+    mEntries[index].state = ENTRY_MISSING;
+    ++mEntryCount;
+    mComplete = false;
+    return true;
+}
+
+bool GpuResourceRegistry::Build(int64_t budgetNs) {
+    if (mComplete) {
+        return true;
+    }
+    TRACE_SCOPE("BuildGpuResources");
+    const int64_t startNs = Trace::NowNs();
+    bool drawable = true;
+    bool complete = true;
+    int laterBuilds = 0;
+    for (int i = 0; i < mEntryCount; ++i) {
+        Entry &entry = mEntries[i];
+        if (entry.state != ENTRY_MISSING) {
+            continue;
+        }
+        const bool draw = entry.recipe.priority == GPU_RESOURCE_PRIORITY_DRAW;
+        if (!draw && laterBuilds > 0 && Trace::NowNs() - startNs >= budgetNs) {
+            // the rest waits for the next frame
+            complete = false;
+            break;
+        }
+        if (entry.recipe.create == NULL) {
+            entry.state = ENTRY_BUILT;
+            continue;
+        }
+
+        const int64_t buildStartNs = Trace::NowNs();
+        const bool built = entry.recipe.create(entry.recipe.data);
+        mStats.buildNs += Trace::NowNs() - buildStartNs;
+        if (built) {
+            entry.state = ENTRY_BUILT;
+            ++mStats.builds;
+        } else {
+            ++mStats.failures;
+            if (draw) {
+                ALOGE("GpuResourceRegistry: building %s failed, can't draw yet",
+                      entry.recipe.name);
+                drawable = false;
+                complete = false;
+            } else {
+                ALOGW("GpuResourceRegistry: building %s failed", entry.recipe.name);
+                entry.state = ENTRY_FAILED;
+            }
+        }
+        if (!draw) {
+            ++laterBuilds;
+        }
+    }
+    mComplete = complete;
+    return drawable;
+}
+
+void GpuResourceRegistry::ReleaseAll(bool deleteObjects) {
+    for (int i = 0; i < mEntryCount; ++i) {
+        Entry &entry = mEntries[i];
+        if (entry.recipe.release != NULL) {
+            entry.recipe.release(entry.recipe.data, deleteObjects);
+        }
+        entry.state = ENTRY_MISSING;
+    }
+    mComplete = mEntryCount == 0;
+    ++mStats.releases;
+}
@@ -0,0 +1,92 @@
+#ifndef agdktunnel_gpu_resource_registry_hpp
+#define agdktunnel_gpu_resource_registry_hpp
+
+#include <cstdint>
+
+// most resources a registry holds
+#define GPU_RESOURCE_MAX_RECIPES 32
+
+// resources no frame can be drawn without, built before the first frame on a context
+#define GPU_RESOURCE_PRIORITY_DRAW 0
+// everything else, built a few at a time over the frames that follow
+#define GPU_RESOURCE_PRIORITY_LATER 1
+
+typedef bool (*GpuResourceCreate)(void *data);
+typedef void (*GpuResourceRelease)(void *data, bool deleteObjects);
+
+// How to make a resource's GPU objects again from what the CPU side keeps.
+struct GpuResourceRecipe {
+    // for logs only
+    const char *name;
+    // GPU_RESOURCE_PRIORITY_*
+    int priority;
+    // Builds the objects on the current context, false if that failed. NULL when
+    // the owner builds them itself on first use.
+    GpuResourceCreate create;
+    // Forgets the objects, deleting them if deleteObjects (their context is still
+    // current). Called whether or not they were built, NULL if there is nothing to forget.
+    GpuResourceRelease release;
+    void *data;
+};
+
+/*
+ * Every GPU object the app owns, as recipes. When a context goes away all of
+ * them are released at once; on the next context they are built again by
+ * priority, the ones needed to draw right away and the rest spread over the
+ * following frames so the first frame after a context loss isn't held up.
+ *
+ * Used from the render thread only.
+ */
+class GpuResourceRegistry {
+public:
+    struct Stats {
+        uint64_t builds;
+        uint64_t failures;
+        // times everything was released
+        uint64_t releases;
+        int64_t buildNs;
+    };
+
+    GpuResourceRegistry();
+
+    // the resource is built on the next Build(); false if the registry is full
+    bool Register(const GpuResourceRecipe &recipe);
+
+    // Builds what the current context is missing: every draw resource, then the
+    // others until budgetNs has passed, at least one per call. Returns false if a
+    // draw resource failed; it is tried again on the next call.
+    bool Build(int64_t budgetNs);
+
+    // whether every resource has been built (or failed to build) on this context
+    bool IsComplete() const {
+        return mComplete;
+    }
+
+    // the context is going away, or already gone; everything is built again on the next
+    void ReleaseAll(bool deleteObjects);
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+private:
+    enum EntryState {
+        ENTRY_MISSING,
+        ENTRY_BUILT,
+        // not tried again before the next context
+        ENTRY_FAILED
+    };
+
+    struct Entry {
+        GpuResourceRecipe recipe;
+        EntryState state;
+    };
+
+    // sorted by priority, in the order registered within one
+    Entry mEntries[GPU_RESOURCE_MAX_RECIPES];
+    int mEntryCount;
+    bool mComplete;
+    Stats mStats;
+};
+
+#endif
@@ -0,0 +1,3860 @@
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Log.h"
+#include "asset_loader.hpp"
+#include "asset_pack.hpp"
+#include "asset_pack_writer.hpp"
+#include "audio_mixer.hpp"
+#include "binary_log.hpp"
+#include "fidelity_controller.hpp"
+#include "fixed_timestep.hpp"
+#include "frame_arena.hpp"
+#include "frame_scheduler.hpp"
+#include "frustum_culling.hpp"
+#include "gpu_resource_registry.hpp"
+#include "headless_platform.hpp"
+#include "input_cooker.hpp"
+#include "input_recorder.hpp"
+#include "input_types.hpp"
+#include "job_system.hpp"
+#include "latency_tuner.hpp"
+#include "native_engine.hpp"
+#include "oscillator_bank.hpp"
+#include "pipeline_cache.hpp"
+#include "realtime_check.hpp"
+#include "render_backend.hpp"
+#include "render_commands.hpp"
+#include "render_context.hpp"
+#include "resolution_controller.hpp"
+#include "resource_manager.hpp"
+#include "ima_adpcm.hpp"
+#include "shaders.hpp"
+#include "sim_state.hpp"
+#include "snapshot.hpp"
+#include "sound_streamer.hpp"
+#include "spsc_ring.hpp"
+#include "startup_graph.hpp"
+#include "trace.hpp"
+#include "tunnel_geometry.hpp"
+
+/*
+    Host entry point. Runs the engine's whole frame loop against the headless
+    platform as a soak benchmark:
+
+        headless_soak [--frames n] [--touches n] [--trace file.json] [--trace-frames n]
+                      [--pipeline-dir dir] [--asset-pack file]
+
+    The engine gets a window and focus at frame 0 and loses them again after the
+    given number of frames, then the frame rate and per-phase timings are printed.
+    With a trace file the run is traced and its last frames are exported there.
+
+        headless_soak --render-bench n
+
+    instead sorts and replays n random draw commands per frame on the null render
+    backend and prints the cost of each.
+
+        headless_soak --tunnel-bench n
+
+    builds n tunnel sections, then streams the tunnel past a moving camera at
+    both fidelity levels, and prints the build throughput.
+
+        headless_soak --fidelity-feed n
+
+    feeds n synthetic frame costs per simulated device to the fidelity
+    controller and checks the level it settles on.
+
+        headless_soak --resolution-feed n
+
+    feeds n synthetic frame timings per simulated GPU to the resolution
+    controller, with the GPU cost following the chosen scale, and checks the
+    scale it settles on.
+
+        headless_soak --cull-bench n
+
+    culls n random bounding spheres against a camera frustum, four at a time
+    and one at a time, and prints the cost of each.
+
+        headless_soak --pipeline-test dir
+
+    runs the pipeline cache with the fake compiler through a cold start, a warm
+    start, a lost context, a driver update and a corrupt binary, saving to dir
+    (its .bin files are deleted first), and checks what got compiled or loaded.
+
+        headless_soak --asset-bench n
+
+    packs n synthetic assets, some compressible and some not, then reads them
+    back synchronously and through the asset loader with one, two and four
+    workers, and prints packing, decode and load throughput and load latency.
+
+        headless_soak --context-loss n
+
+    makes the fake context layer fail in every way it can and checks which
+    calls recover from each failure, and that GPU resources are rebuilt by
+    priority; then runs the engine for n frames with a lost context, a bad
+    surface and a bad display along the way, and prints the time from each
+    error to the next presented frame.
+
+        headless_soak --resource-bench n
+
+    loads n synthetic resources on demand through the resource manager, with a
+    skewed access pattern over more memory than its budgets allow, and prints
+    the hit rate and the cost of acquiring, evicting, trimming for low memory
+    and a lost window, and reloading; then does the same with assets from a
+    pack.
+
+        headless_soak --snapshot-test n
+
+    round-trips snapshots through the writer and reader and checks damaged ones
+    are rejected, then runs the engine for n frames, saves its state, relaunches
+    it from the snapshot and checks it resumes where it was, and prints how long
+    saving and restoring take. Also checks a restored fidelity level isn't
+    replaced by the training parameters handed over at startup.
+
+        headless_soak --startup-test n
+
+    runs stand-ins for the Android startup tasks through the startup graph and
+    checks they overlap where they are independent and what the critical path
+    is, then does the same for n random tasks with random dependencies, and
+    prints each timeline against running the tasks one after another.
+
+        headless_soak --oscillator-bench seconds
+
+    renders that many seconds of each waveform through the oscillator bank,
+    checks its sine against sin() and that the saw, square and noise stay in
+    range, and prints what a sample costs next to the old sinf() loop.
+
+        headless_soak --mixer-test callbacks
+
+    checks that the mixer's gain, pan, starts and stops don't click, then runs
+    that many callbacks of a fake audio stream on its own thread while the
+    main thread plays, changes and stops voices, and fails if a callback
+    allocated, freed or locked a mutex. Prints what a frame costs for more and
+    more voices.
+
+        headless_soak --latency-test seconds
+
+    runs the audio latency tuner against a simulated stream whose callbacks
+    wake up late now and then, through quiet, busy and hostile spells of
+    about that many seconds each, at least 10, and checks that the buffer
+    settles on the smallest size that doesn't underrun in each.
+
+        headless_soak --stream-test seconds
+
+    encodes a test track of that many seconds as IMA ADPCM, packs it and
+    streams it out of the mapped pack: prints decode throughput and checks the
+    codec's noise, then plays it through a sound stream as the audio thread
+    would, in real time and as fast as it can, and checks every frame arrives
+    in order, that only the second run underruns, and that reading never
+    allocates or locks. Last, plays a looping stream through the mixer, checks
+    a stop refused by a full queue leaves it open, and checks it is freed once
+    its voice has faded out.
+
+        headless_soak --input-test frames
+
+    cooks that many frames of random multi-touch input buffers, with historical
+    samples and pointers going down, up and being cancelled, and checks every
+    sample comes out in order with the right phase; then checks a full batch
+    drops what doesn't fit, and prints what cooking a sample costs. Last,
+    records the frames with some text input, replays the recording and checks
+    it cooks to the same samples and text, and prints what recording and
+    replaying a frame cost.
+
+        headless_soak --spsc-test items
+
+    checks a full SPSC ring refuses pushes and hands items back in order, then
+    passes that many items from a producer thread to a consumer thread through
+    a small and a large ring, one at a time and in batches, checks none is
+    lost, repeated, reordered or torn, and prints what an item costs.
+
+        headless_soak --log-test messages
+
+    logs arguments of every kind through the binary log and checks they come
+    out formatted as snprintf() would, with strings copied when logged and cut
+    at their limit; checks threads that come and go keep getting rings, and
+    that the formatter sleeps while nothing is logged but wakes for a message;
+    then logs that many messages and prints what a call costs on the logging thread
+    and what formatting it costs the formatter.
+
+        headless_soak --timestep-test frames
+
+    drives the fixed timestep with a fake clock at display rates from 30Hz to
+    144Hz, with jittery frame times, for that many frames each, and checks no
+    time is lost, that the interpolated state keeps pace with the clock, that a
+    stall is dropped rather than caught up and that a pause is forgotten.
+
+        headless_soak --job-test items
+
+    floods the job system with three queues' worth of jobs, some waiting on
+    another group, and checks each runs once and none before its dependency,
+    checks which cores of made-up CPUs count as big and little, then splits
+    that many items of busy work over one, two, four and one per core workers,
+    and prints how the time scales.
+
+        headless_soak --scheduler-test frames
+
+    runs the frame scheduler against a simulated vsync at 60, 90 and 120 Hz
+    with light and heavy frames, and checks that no vsync is missed and frames
+    reach the screen no later, and light ones sooner, than when they start as
+    soon as present returns; then that cost spikes miss at most their own
+    vsync, and that unpaced presenting never waits.
+
+        headless_soak --arena-bench frames
+
+    allocates 2000 blocks of 8 to 256 bytes a frame from a frame arena, from
+    an atomic bump allocator and with malloc, freeing them at the end of the
+    frame, checks the arena's blocks are aligned and don't overlap, and
+    prints what an allocation costs each way.
+
+        headless_soak --trace-test threads
+
+    starts that many threads one after another, each recording a scope,
+    while tracing, and checks every scope is exported although only 32 rings
+    may exist; then that a realtime thread records into a ring set aside
+    rather than adding one, and prints what a scope costs.
+*/
+
+#define HEADLESS_DEFAULT_FRAMES 10000
+#define HEADLESS_SURFACE_WIDTH 1920
+#define HEADLESS_SURFACE_HEIGHT 1080
+#define HEADLESS_DEFAULT_TRACE_FRAMES 120
+#define HEADLESS_DEFAULT_PIPELINE_DIR "headless_pipelines"
+
+// frames the render benchmark runs
+#define RENDER_BENCH_FRAMES 1000
+
+// frames the tunnel benchmark streams, and how far the camera moves in each
+#define TUNNEL_BENCH_FRAMES 100000
+#define TUNNEL_BENCH_CAMERA_STEP 1.5f
+
+// times the cull benchmark culls the whole set
+#define CULL_BENCH_ITERATIONS 200
+
+// what the fake compiler takes per program in the pipeline test
+#define PIPELINE_TEST_COMPILE_NS 20000000LL
+
+// sizes and priorities of the asset benchmark's assets, and where it puts its pack
+#define ASSET_BENCH_MIN_SIZE (16 * 1024)
+#define ASSET_BENCH_MAX_SIZE (512 * 1024)
+#define ASSET_BENCH_PRIORITIES 4
+#define ASSET_BENCH_MAX_WORKERS 4
+#define ASSET_BENCH_PACK "headless_assets.pak"
+
+// what creating a context and compiling a program take in the context loss test
+#define CONTEXT_LOSS_CREATE_NS 30000000LL
+#define CONTEXT_LOSS_COMPILE_NS 20000000LL
+// what each of its later resources takes to build, and where the engine run saves programs
+#define CONTEXT_LOSS_RESOURCE_NS 1500000LL
+#define CONTEXT_LOSS_LATER_RESOURCES 3
+#define CONTEXT_LOSS_PIPELINE_DIR "headless_context_pipelines"
+
+// sizes of the resource benchmark's resources; every other one also has GPU memory
+#define RESOURCE_BENCH_MIN_SIZE (64 * 1024)
+#define RESOURCE_BENCH_MAX_SIZE (1024 * 1024)
+// frames it runs, resources each frame acquires, and its budgets as a share of the total
+#define RESOURCE_BENCH_FRAMES 2000
+#define RESOURCE_BENCH_ACQUIRES_PER_FRAME 64
+#define RESOURCE_BENCH_BUDGET_SHARE 0.25
+// what the low memory trim keeps of the budgets
+#define RESOURCE_BENCH_LOW_MEMORY_SHARE 0.25
+#define RESOURCE_BENCH_PACK "headless_resources.pak"
+#define RESOURCE_BENCH_MAX_ASSETS 128
+
+// times the snapshot test saves and restores the engine, and the most either may take
+#define SNAPSHOT_TEST_ITERATIONS 1000
+#define SNAPSHOT_TEST_MAX_NS 2000000LL
+
+// threads besides the calling one the startup test runs on, at most
+#define STARTUP_TEST_MAX_WORKERS 4
+// slack allowed between the startup graph's time and its critical path
+#define STARTUP_TEST_SLACK_NS 3000000LL
+
+// sample rate and callback size of the oscillator benchmark, like a low latency stream
+#define OSCILLATOR_BENCH_SAMPLE_RATE 48000
+#define OSCILLATOR_BENCH_CALLBACK_FRAMES 192
+// the most the bank's sine may differ from sin()
+#define OSCILLATOR_TEST_MAX_ERROR 1e-6
+
+// sample rate and callback size of the mixer test's fake stream
+#define MIXER_TEST_SAMPLE_RATE 48000
+#define MIXER_TEST_CALLBACK_FRAMES 192
+// the click test's tone, and the most a sample may move from the one before: the
+// tone's own slope plus a full gain change spread over the ramp, with some room
+#define MIXER_TEST_TONE_HZ 50.0
+#define MIXER_TEST_MAX_STEP 0.012f
+
+// the latency test's simulated stream: 2ms bursts at 48kHz, room for 16 of them
+#define LATENCY_TEST_SAMPLE_RATE 48000
+#define LATENCY_TEST_BURST_FRAMES 96
+#define LATENCY_TEST_CAPACITY_BURSTS 16
+// shorter spells end before the tuner, which waits a quiet spell before each try
+// of a smaller buffer and twice that after a failure, can settle
+#define LATENCY_TEST_MIN_SECONDS (2 * LATENCY_TUNER_QUIET_MS / 1000)
+
+// the stream test's track, at the audio stream's rate in ffmpeg's blocks for stereo,
+// the callbacks reading it, and the most noise the codec may add to it
+#define STREAM_TEST_SAMPLE_RATE 48000
+#define STREAM_TEST_BLOCK_SIZE 2048
+#define STREAM_TEST_CALLBACK_FRAMES 192
+#define STREAM_TEST_MIN_SNR_DB 30.0
+#define STREAM_TEST_PACK "headless_stream.pak"
+#define STREAM_TEST_ASSET "music/test.wav"
+
+// the input test's frames: up to 4 motion events, each with up to 4 historical
+// samples per pointer, 60Hz apart; and how often each is cooked for timing
+#define INPUT_TEST_MAX_EVENTS 4
+#define INPUT_TEST_MAX_HISTORY 4
+#define INPUT_TEST_FRAME_NS 16666667LL
+#define INPUT_TEST_COOK_REPEATS 50
+// the input test's recording, with new text input every so many frames
+#define INPUT_TEST_RECORDING "headless_input.bin"
+#define INPUT_TEST_TEXT_FRAMES 30
+
+// the SPSC test's rings: one that wraps all the time, and the input ring's size;
+// the most items pushed or popped at once
+#define SPSC_TEST_SMALL_CAPACITY 16
+#define SPSC_TEST_LARGE_CAPACITY 1024
+#define SPSC_TEST_MAX_BATCH 32
+
+// threads the log test starts one after another, more than can hold a ring at once,
+// and the messages it logs between flushes, fewer than a ring holds
+#define LOG_TEST_THREADS 100
+#define LOG_TEST_BATCH 1000
+
+// how long the log test leaves the formatter idle, the most times it may wake up
+// meanwhile, and how soon a message logged then must come out without a flush
+#define LOG_TEST_IDLE_MS 500
+#define LOG_TEST_IDLE_MAX_WAKEUPS 1
+#define LOG_TEST_IDLE_LATENCY_MS 100
+
+// the timestep test's simulation, as the engine runs it: 60Hz, catching up at
+// most 5 steps a frame; frame times vary by up to 10%, and the rendered
+// simulation time may run this much faster or slower than the clock
+#define TIMESTEP_TEST_STEP_NS 16666667LL
+#define TIMESTEP_TEST_MAX_STEPS 5
+#define TIMESTEP_TEST_JITTER 0.1
+#define TIMESTEP_TEST_MAX_PACE_ERROR 1e-4
+
+// the job test's flood, three times what a queue holds, waiting on a group of jobs;
+// and the busy work per item of its scaling run and the items per batch
+#define JOB_TEST_FLOOD_JOBS (3 * JOB_SYSTEM_MAX_JOBS_PER_THREAD)
+#define JOB_TEST_GROUP_JOBS 64
+#define JOB_TEST_ITEM_ROUNDS 2000
+#define JOB_TEST_BATCH 64
+
+// the scheduler test's frame cost jitter, as a fraction of the cost, and how often
+// its spiky run doubles a frame's cost
+#define SCHEDULER_TEST_JITTER 0.1
+#define SCHEDULER_TEST_SPIKE_FRAMES 60
+
+// the arena bench's allocations per frame and their sizes, and an arena big enough
+// for a frame of them
+#define ARENA_BENCH_ALLOCATIONS 2000
+#define ARENA_BENCH_MIN_SIZE 8
+#define ARENA_BENCH_MAX_SIZE 256
+#define ARENA_BENCH_BUFFER_SIZE (1024 * 1024)
+
+// scopes the trace test times, on a thread that already has its ring
+#define TRACE_TEST_SCOPES 1000000
+
+// frame budget of the synthetic fidelity feed, 60Hz
+#define FIDELITY_FEED_BUDGET_NS 16666667LL
+
+static void _usage(const char *name) {
+    fprintf(stderr, "usage: %s [--frames n] [--touches n] [--trace file.json] "
+                    "[--trace-frames n] [--pipeline-dir dir] [--asset-pack file]\n"
+                    "       %s --render-bench commands\n"
+                    "       %s --tunnel-bench sections\n"
+                    "       %s --fidelity-feed frames\n"
+                    "       %s --resolution-feed frames\n"
+                    "       %s --cull-bench objects\n"
+                    "       %s --pipeline-test dir\n"
+                    "       %s --asset-bench assets\n"
+                    "       %s --context-loss frames\n"
+                    "       %s --resource-bench resources\n"
+                    "       %s --snapshot-test frames\n"
+                    "       %s --startup-test tasks\n"
+                    "       %s --oscillator-bench seconds\n"
+                    "       %s --mixer-test callbacks\n"
+                    "       %s --latency-test seconds\n"
+                    "       %s --stream-test seconds\n"
+                    "       %s --input-test frames\n"
+                    "       %s --spsc-test items\n"
+                    "       %s --log-test messages\n"
+                    "       %s --timestep-test frames\n"
+                    "       %s --job-test items\n"
+                    "       %s --scheduler-test frames\n"
+                    "       %s --arena-bench frames\n"
+                    "       %s --trace-test threads\n", name, name, name, name, name, name, name,
+            name, name, name, name, name, name, name, name, name, name, name, name, name, name,
+            name, name, name);
+}
+
+static int _render_bench(int commandCount) {
+    // a scene's worth of draws: few layers and programs, more textures, random depth
+    std::vector<RenderCommand> scene(commandCount);
+    uint32_t seed = 12345;
+    for (int i = 0; i < commandCount; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const uint32_t layer = (seed >> 8) % 3;
+        const uint32_t program = 1 + (seed >> 12) % 16;
+        const uint32_t texture = 1 + (seed >> 16) % 128;
+        const uint32_t depth = (seed * 2654435761u) & RENDER_KEY_DEPTH_MASK;
+        memset(&scene[i], 0, sizeof(scene[i]));
+        scene[i].key = MakeRenderSortKey(layer, program, texture, depth);
+        scene[i].program = program;
+        scene[i].texture = texture;
+        scene[i].vertexBuffer = 1 + (seed >> 20) % 32;
+        scene[i].flags = layer == RENDER_LAYER_TRANSLUCENT ? RENDER_FLAG_BLEND :
+                         RENDER_FLAG_DEPTH_TEST;
+    }
+
+    RenderCommandBuffer buffer;
+    NullRenderBackend backend;
+    int64_t fillNs = 0, sortNs = 0, executeNs = 0;
+    for (int frame = 0; frame < RENDER_BENCH_FRAMES; ++frame) {
+        int64_t startNs = Trace::NowNs();
+        buffer.Clear();
+        for (int i = 0; i < commandCount; ++i) {
+            const RenderCommand &command = scene[i];
+            buffer.AddDraw(command.key, command.flags, command.program, command.texture,
+                           command.vertexBuffer, 0, 0, 3);
+        }
+        int64_t nowNs = Trace::NowNs();
+        fillNs += nowNs - startNs;
+        startNs = nowNs;
+
+        buffer.Sort();
+        nowNs = Trace::NowNs();
+        sortNs += nowNs - startNs;
+        startNs = nowNs;
+
+        backend.Execute(buffer);
+        executeNs += Trace::NowNs() - startNs;
+    }
+
+    // the replayed order must be sorted
+    backend.SetRecording(true);
+    backend.Execute(buffer);
+    const std::vector<uint64_t> &keys = backend.GetRecordedKeys();
+    for (size_t i = 1; i < keys.size(); ++i) {
+        if (keys[i - 1] > keys[i]) {
+            fprintf(stderr, "render bench: commands replayed out of order at %zu\n", i);
+            return 1;
+        }
+    }
+
+    const RenderBackend::Stats &stats = backend.GetStats();
+    const double perFrame = 1.0 / RENDER_BENCH_FRAMES;
+    printf("%d commands x %d frames\n", commandCount, RENDER_BENCH_FRAMES);
+    printf("  fill     %8.2f us/frame\n", (double) fillNs / 1e3 * perFrame);
+    printf("  sort     %8.2f us/frame\n", (double) sortNs / 1e3 * perFrame);
+    printf("  execute  %8.2f us/frame\n", (double) executeNs / 1e3 * perFrame);
+    printf("  per frame: %.0f program binds, %.0f texture binds, %.0f vertex buffer binds, "
+           "%.0f state changes, %.0f elided\n",
+           (double) stats.programBinds * perFrame, (double) stats.textureBinds * perFrame,
+           (double) stats.vertexBufferBinds * perFrame, (double) stats.stateChanges * perFrame,
+           (double) stats.elided * perFrame);
+    return 0;
+}
+
+static int _tunnel_bench(int sectionCount) {
+    // one pool's worth of streams to build into
+    std::vector<float> data(5 * TUNNEL_SECTION_VERTEX_SLOTS);
+    TunnelGeometry::Section section;
+    memset(&section, 0, sizeof(section));
+    section.x = &data[0];
+    section.y = section.x + TUNNEL_SECTION_VERTEX_SLOTS;
+    section.z = section.y + TUNNEL_SECTION_VERTEX_SLOTS;
+    section.u = section.z + TUNNEL_SECTION_VERTEX_SLOTS;
+    section.v = section.u + TUNNEL_SECTION_VERTEX_SLOTS;
+
+    int64_t startNs = Trace::NowNs();
+    for (int i = 0; i < sectionCount; ++i) {
+        TunnelGeometry::BuildSection(&section, i, TUNNEL_SECTION_LENGTH);
+    }
+    const int64_t buildNs = Trace::NowNs() - startNs;
+
+    // the last section against a plain evaluation of the same surface
+    float maxError = 0.0f;
+    for (int ring = 0; ring <= TUNNEL_RINGS_PER_SECTION; ++ring) {
+        const float z = section.startZ + TUNNEL_SECTION_LENGTH * ring / TUNNEL_RINGS_PER_SECTION;
+        float centerX, centerY;
+        TunnelGeometry::GetCenter(z, &centerX, &centerY);
+        for (int segment = 0; segment <= TUNNEL_RING_SEGMENTS; ++segment) {
+            const float angle = 2.0f * (float) M_PI * segment / TUNNEL_RING_SEGMENTS;
+            const int i = ring * TUNNEL_RING_STRIDE + segment;
+            maxError = fmaxf(maxError, fabsf(section.x[i] - (centerX + TUNNEL_RADIUS * cosf(angle))));
+            maxError = fmaxf(maxError, fabsf(section.y[i] - (centerY + TUNNEL_RADIUS * sinf(angle))));
+            maxError = fmaxf(maxError, fabsf(section.z[i] - z));
+        }
+    }
+    if (maxError > 1e-3f) {
+        fprintf(stderr, "tunnel bench: vertices off by %f\n", (double) maxError);
+        return 1;
+    }
+
+    // stream past the camera, switching fidelity level halfway
+    TunnelGeometry tunnel;
+    float cameraZ = 0.0f;
+    int maxBuildsPerFrame = 0;
+    startNs = Trace::NowNs();
+    for (int frame = 0; frame < TUNNEL_BENCH_FRAMES; ++frame) {
+        const bool high = frame >= TUNNEL_BENCH_FRAMES / 2;
+        const int built = tunnel.Update(cameraZ, high ? 8 : RENDER_TUNNEL_SECTION_COUNT,
+                                        high ? 75.0f : TUNNEL_SECTION_LENGTH,
+                                        TUNNEL_MAX_SECTION_BUILDS_PER_FRAME);
+        if (built > maxBuildsPerFrame) {
+            maxBuildsPerFrame = built;
+        }
+        cameraZ += TUNNEL_BENCH_CAMERA_STEP;
+    }
+    const int64_t streamNs = Trace::NowNs() - startNs;
+
+    const TunnelGeometry::Section *visible[MAX_TUNNEL_SECTION_COUNT];
+    const int visibleCount = tunnel.GetWindowSections(visible, MAX_TUNNEL_SECTION_COUNT);
+    if (visibleCount != 8 || visible[0]->startZ > cameraZ - TUNNEL_BENCH_CAMERA_STEP) {
+        fprintf(stderr, "tunnel bench: %d sections visible at the end\n", visibleCount);
+        return 1;
+    }
+
+    const int vertices = (TUNNEL_RINGS_PER_SECTION + 1) * (TUNNEL_RING_SEGMENTS + 1);
+    const TunnelGeometry::Stats &stats = tunnel.GetStats();
+    printf("%d sections of %d vertices, max error %g\n", sectionCount, vertices,
+           (double) maxError);
+    printf("  build    %8.2f us/section, %.1f M vertices/s\n",
+           (double) buildNs / 1e3 / sectionCount,
+           (double) sectionCount * vertices / ((double) buildNs / 1e9) / 1e6);
+    printf("  stream   %8.3f us/frame over %d frames, %llu sections built, %llu resets, "
+           "at most %d per frame\n",
+           (double) streamNs / 1e3 / TUNNEL_BENCH_FRAMES, TUNNEL_BENCH_FRAMES,
+           (unsigned long long) stats.sectionsBuilt, (unsigned long long) stats.resets,
+           maxBuildsPerFrame);
+    return 0;
+}
+
+static int _cull_bench(int objectCount) {
+    // objects scattered through a tunnel-sized box around the camera's path
+    std::vector<float> x(objectCount), y(objectCount), z(objectCount), radius(objectCount);
+    uint32_t seed = 12345;
+    for (int i = 0; i < objectCount; ++i) {
+        float *values[4] = {&x[i], &y[i], &z[i], &radius[i]};
+        for (int j = 0; j < 4; ++j) {
+            seed = seed * 1664525u + 1013904223u;
+            *values[j] = (float) (seed >> 8) / (float) (1 << 24);
+        }
+        x[i] = x[i] * 200.0f - 100.0f;
+        y[i] = y[i] * 200.0f - 100.0f;
+        z[i] = z[i] * 1200.0f - 200.0f;
+        radius[i] = 0.5f + radius[i] * 4.0f;
+    }
+
+    const float eye[3] = {0.0f, 0.0f, 0.0f};
+    const float forward[3] = {0.0f, 0.0f, 1.0f};
+    const float up[3] = {0.0f, 1.0f, 0.0f};
+    Frustum frustum;
+    MakeFrustum(&frustum, eye, forward, up, CAMERA_FOV_Y, 16.0f / 9.0f, CAMERA_NEAR,
+                RENDER_TUNNEL_SECTION_COUNT * TUNNEL_SECTION_LENGTH);
+
+    std::vector<uint32_t> visible(objectCount), reference(objectCount);
+    int visibleCount = 0, referenceCount = 0;
+    int64_t simdNs = 0, scalarNs = 0;
+    for (int iteration = 0; iteration < CULL_BENCH_ITERATIONS; ++iteration) {
+        int64_t startNs = Trace::NowNs();
+        visibleCount = CullSpheres(frustum, x.data(), y.data(), z.data(), radius.data(),
+                                   objectCount, visible.data());
+        int64_t nowNs = Trace::NowNs();
+        simdNs += nowNs - startNs;
+        startNs = nowNs;
+        referenceCount = CullSpheresScalar(frustum, x.data(), y.data(), z.data(), radius.data(),
+                                           objectCount, reference.data());
+        scalarNs += Trace::NowNs() - startNs;
+    }
+
+    if (visibleCount != referenceCount ||
+        memcmp(visible.data(), reference.data(), sizeof(uint32_t) * visibleCount) != 0) {
+        fprintf(stderr, "cull bench: %d visible, the reference says %d\n", visibleCount,
+                referenceCount);
+        return 1;
+    }
+
+    const double perCull = 1.0 / CULL_BENCH_ITERATIONS;
+    printf("%d spheres, %d visible (%.1f%%)\n", objectCount, visibleCount,
+           100.0 * visibleCount / objectCount);
+    printf("  4-wide   %8.2f us/cull, %.2f ns/sphere\n", (double) simdNs / 1e3 * perCull,
+           (double) simdNs * perCull / objectCount);
+    printf("  scalar   %8.2f us/cull, %.2f ns/sphere\n", (double) scalarNs / 1e3 * perCull,
+           (double) scalarNs * perCull / objectCount);
+    return 0;
+}
+
+// a device as the fidelity controller sees it: what a frame costs at each level
+struct SyntheticDevice {
+    const char *name;
+    float lowCostMs, highCostMs;
+    // every spikeInterval-th frame costs spikeMs instead, 0 for none
+    int spikeInterval;
+    float spikeMs;
+    // costs are multiplied by this from halfway through, like a throttling SoC
+    float throttle;
+    // level expected at the end, -1 for any
+    int expectedLevel;
+    // most level changes allowed over the run
+    int maxChanges;
+};
+
+static int _fidelity_feed(int frames) {
+    static const FidelityParams levels[] = {
+            {RENDER_TUNNEL_SECTION_COUNT, TUNNEL_SECTION_LENGTH},
+            {HIGH_TUNNEL_SECTION_COUNT, HIGH_TUNNEL_SECTION_LENGTH},
+    };
+    static const SyntheticDevice devices[] = {
+            {"fast",       7.0f,  11.0f, 0,  0.0f,  1.0f, 1, 1},
+            {"slow",       12.0f, 19.0f, 0,  0.0f,  1.0f, 0, 0},
+            {"spiky",      7.0f,  11.0f, 25, 40.0f, 1.0f, 1, 1},
+            {"borderline", 8.5f,  15.5f, 0,  0.0f,  1.0f, -1, 8},
+            {"throttling", 7.0f,  11.0f, 0,  0.0f,  1.6f, 0, 2},
+    };
+
+    int failures = 0;
+    for (const SyntheticDevice &device : devices) {
+        FidelityController controller(levels, 2, 0);
+        controller.SetBudget(FIDELITY_FEED_BUDGET_NS);
+
+        uint32_t seed = 12345;
+        int changes = 0;
+        int64_t feedNs = 0;
+        for (int frame = 0; frame < frames; ++frame) {
+            float costMs = controller.GetLevel() == 0 ? device.lowCostMs : device.highCostMs;
+            if (device.spikeInterval > 0 && frame % device.spikeInterval == 0) {
+                costMs = device.spikeMs;
+            }
+            if (frame >= frames / 2) {
+                costMs *= device.throttle;
+            }
+            // +-10% jitter
+            seed = seed * 1664525u + 1013904223u;
+            costMs *= 0.9f + 0.2f * (float) (seed >> 8) / (float) (1 << 24);
+
+            const int64_t startNs = Trace::NowNs();
+            if (controller.AddFrame((int64_t) (costMs * 1e6f))) {
+                ++changes;
+            }
+            feedNs += Trace::NowNs() - startNs;
+        }
+
+        const FidelityController::Stats &stats = controller.GetStats();
+        const bool ok = (device.expectedLevel < 0 || controller.GetLevel() == device.expectedLevel)
+                        && changes <= device.maxChanges;
+        printf("%-11s level %d, %llu up (%llu reverted), %llu down, p90 %.2f ms, "
+               "%.1f ns/frame%s\n",
+               device.name, controller.GetLevel(), (unsigned long long) stats.upgrades,
+               (unsigned long long) stats.revertedUpgrades,
+               (unsigned long long) stats.downgrades, (double) stats.lastPercentileNs / 1e6,
+               (double) feedNs / frames, ok ? "" : "  UNEXPECTED");
+        if (!ok) {
+            ++failures;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+// a device as the resolution controller sees it: a frame's GPU cost is a fixed
+// part plus a part that grows with the pixels rendered
+struct SyntheticGpu {
+    const char *name;
+    float cpuMs;
+    float fixedMs, fullPixelsMs;
+    // false for a GPU without timer queries, the controller then only sees cpuMs
+    bool timed;
+    // every spikeInterval-th frame costs spikeMs on the GPU instead, 0 for none
+    int spikeInterval;
+    float spikeMs;
+    // the pixel part is multiplied by this from halfway through
+    float secondHalf;
+    // step expected at the end
+    int expectedStep;
+    // most step changes allowed over the run, not counting downscales that were
+    // undone as ineffective (the controller backs off from those on its own)
+    int maxChanges;
+};
+
+static int _resolution_feed(int frames) {
+    static const SyntheticGpu devices[] = {
+            {"fast",       6.0f,  1.0f, 8.0f,  true,  0,  0.0f,  1.0f, 0, 0},
+            {"fill-bound", 6.0f,  1.0f, 22.0f, true,  0,  0.0f,  1.0f, 3, 1},
+            {"cpu-bound",  22.0f, 1.0f, 6.0f,  true,  0,  0.0f,  1.0f, 0, 0},
+            {"spiky",      6.0f,  1.0f, 9.0f,  true,  20, 40.0f, 1.0f, 0, 0},
+            {"throttling", 6.0f,  1.0f, 11.0f, true,  0,  0.0f,  1.6f, 2, 1},
+            {"recovering", 6.0f,  1.0f, 22.0f, true,  0,  0.0f,  0.4f, 0, 4},
+            {"untimed",    20.0f, 1.0f, 6.0f,  false, 0,  0.0f,  1.0f, 0, 0},
+    };
+
+    int failures = 0;
+    for (const SyntheticGpu &device : devices) {
+        ResolutionController controller;
+        controller.SetBudget(FIDELITY_FEED_BUDGET_NS);
+
+        uint32_t seed = 12345;
+        int changes = 0;
+        int64_t feedNs = 0;
+        for (int frame = 0; frame < frames; ++frame) {
+            const float scale = controller.GetScale();
+            float gpuMs = device.fixedMs + device.fullPixelsMs * scale * scale *
+                                           (frame >= frames / 2 ? device.secondHalf : 1.0f);
+            if (device.spikeInterval > 0 && frame % device.spikeInterval == 0) {
+                gpuMs = device.spikeMs;
+            }
+            // +-10% jitter
+            seed = seed * 1664525u + 1013904223u;
+            const float jitter = 0.9f + 0.2f * (float) (seed >> 8) / (float) (1 << 24);
+
+            const int64_t startNs = Trace::NowNs();
+            if (controller.AddFrame((int64_t) (device.cpuMs * jitter * 1e6f),
+                                    device.timed ? (int64_t) (gpuMs * jitter * 1e6f) : -1)) {
+                ++changes;
+            }
+            feedNs += Trace::NowNs() - startNs;
+        }
+
+        const ResolutionController::Stats &stats = controller.GetStats();
+        const int keptChanges = changes - 2 * (int) stats.ineffectiveDownscales;
+        const bool ok = controller.GetStep() == device.expectedStep &&
+                        keptChanges <= device.maxChanges;
+        printf("%-11s scale %.2f, %llu down (%llu undone), %llu up, cost %.2f ms, "
+               "%.1f ns/frame%s\n",
+               device.name, (double) controller.GetScale(),
+               (unsigned long long) stats.downscales,
+               (unsigned long long) stats.ineffectiveDownscales,
+               (unsigned long long) stats.upscales, (double) stats.smoothedCostNs / 1e6,
+               (double) feedNs / frames, ok ? "" : "  UNEXPECTED");
+        if (!ok) {
+            ++failures;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+// one step of the pipeline test: builds every pipeline and checks the counts
+static bool _pipeline_step(const char *name, PipelineCache *cache, uint64_t compiles,
+                           uint64_t diskLoads, uint64_t rejected) {
+    const PipelineCache::Stats before = cache->GetStats();
+    const int64_t startNs = Trace::NowNs();
+    bool built = true;
+    for (int i = 0; i < ENGINE_PIPELINE_COUNT; ++i) {
+        built = cache->GetProgram(ENGINE_PIPELINES[i]) != 0 && built;
+    }
+    const int64_t elapsedNs = Trace::NowNs() - startNs;
+    const PipelineCache::Stats after = cache->GetStats();
+
+    const bool ok = built && after.compiles - before.compiles == compiles &&
+                    after.diskLoads - before.diskLoads == diskLoads &&
+                    after.rejectedBinaries - before.rejectedBinaries == rejected;
+    printf("%-14s %8.2f ms, %llu compiled, %llu loaded, %llu rejected, %llu waits%s\n", name,
+           (double) elapsedNs / 1e6, (unsigned long long) (after.compiles - before.compiles),
+           (unsigned long long) (after.diskLoads - before.diskLoads),
+           (unsigned long long) (after.rejectedBinaries - before.rejectedBinaries),
+           (unsigned long long) (after.backgroundWaits - before.backgroundWaits),
+           ok ? "" : "  UNEXPECTED");
+    return ok;
+}
+
+// a synthetic asset: text-like, mesh-like or noise, by index
+static void _make_asset(int index, uint32_t seed, std::vector<uint8_t> *data) {
+    static const char *const kWords[] = {"tunnel", "section", "ring", "vertex", "shader",
+                                         "uniform", "camera", "obstacle", "bonus", "level"};
+    const size_t size = ASSET_BENCH_MIN_SIZE + (seed % (ASSET_BENCH_MAX_SIZE -
+                                                        ASSET_BENCH_MIN_SIZE));
+    data->resize(size);
+    for (size_t i = 0; i < size;) {
+        seed = seed * 1664525u + 1013904223u;
+        if (index % 4 < 2) {
+            const char *word = kWords[(seed >> 16) % 10];
+            for (size_t j = 0; word[j] != '\0' && i < size; ++j) {
+                (*data)[i++] = (uint8_t) word[j];
+            }
+            if (i < size) {
+                (*data)[i++] = (seed >> 8) % 7 == 0 ? '\n' : ' ';
+            }
+        } else if (index % 4 == 2) {
+            // quantized positions on a smooth surface
+            const float value = 20.0f * sinf((float) i * 0.001f) + (float) ((seed >> 24) & 3);
+            for (size_t j = 0; j < sizeof(value) && i < size; ++j) {
+                (*data)[i++] = ((const uint8_t *) &value)[j];
+            }
+        } else {
+            (*data)[i++] = (uint8_t) (seed >> 24);
+        }
+    }
+}
+
+// spreads the priorities evenly over every kind of asset
+static int _asset_priority(int index) {
+    return (index / 4) % ASSET_BENCH_PRIORITIES;
+}
+
+static int _asset_bench(int assetCount) {
+    std::vector<std::vector<uint8_t>> assets(assetCount);
+    std::vector<std::string> names(assetCount);
+    uint32_t seed = 12345;
+    for (int i = 0; i < assetCount; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        _make_asset(i, seed, &assets[i]);
+        char name[32];
+        snprintf(name, sizeof(name), "bench/asset%04d.bin", i);
+        names[i] = name;
+    }
+
+    AssetPackWriter writer;
+    int64_t startNs = Trace::NowNs();
+    for (int i = 0; i < assetCount; ++i) {
+        writer.Add(names[i], assets[i].data(), assets[i].size(), true);
+    }
+    const int64_t packNs = Trace::NowNs() - startNs;
+    if (!writer.Write(ASSET_BENCH_PACK)) {
+        BinaryLog::Flush();
+        fprintf(stderr, "asset bench: can't write %s\n", ASSET_BENCH_PACK);
+        return 1;
+    }
+    const AssetPackWriter::Stats writerStats = writer.GetStats();
+    printf("%d assets, %.1f MB, %d compressed, stored as %.1f MB (%.1f%%), "
+           "packed at %.0f MB/s\n", assetCount, (double) writerStats.inputBytes / 1e6,
+           writerStats.compressedEntries, (double) writerStats.storedBytes / 1e6,
+           100.0 * (double) writerStats.storedBytes / (double) writerStats.inputBytes,
+           (double) writerStats.inputBytes * 1e3 / (double) packNs);
+
+    AssetPack pack;
+    startNs = Trace::NowNs();
+    if (!pack.Open(ASSET_BENCH_PACK)) {
+        BinaryLog::Flush();
+        fprintf(stderr, "asset bench: can't open %s\n", ASSET_BENCH_PACK);
+        return 1;
+    }
+    const int64_t openNs = Trace::NowNs() - startNs;
+
+    // synchronous: look every asset up and decode or verify it in place
+    uint64_t decodedBytes = 0, viewBytes = 0;
+    int64_t decodeNs = 0, viewNs = 0;
+    bool ok = true;
+    std::vector<uint8_t> buffer;
+    for (int i = 0; i < assetCount; ++i) {
+        startNs = Trace::NowNs();
+        const int index = pack.Find(names[i].c_str());
+        AssetView view;
+        if (index >= 0 && pack.GetView(index, &view)) {
+            ok = pack.Verify(index) && ok;
+            viewNs += Trace::NowNs() - startNs;
+            viewBytes += view.size;
+        } else if (index >= 0) {
+            buffer.resize(pack.GetEntry(index).size);
+            ok = pack.Read(index, buffer.data()) && ok;
+            decodeNs += Trace::NowNs() - startNs;
+            decodedBytes += buffer.size();
+            view.data = buffer.data();
+            view.size = buffer.size();
+        } else {
+            ok = false;
+            continue;
+        }
+        ok = view.size == assets[i].size() &&
+             memcmp(view.data, assets[i].data(), view.size) == 0 && ok;
+    }
+    printf("  open     %8.3f ms\n", (double) openNs / 1e6);
+    printf("  decode   %8.0f MB/s over %.1f MB, hash checked\n",
+           decodeNs > 0 ? (double) decodedBytes * 1e3 / (double) decodeNs : 0.0,
+           (double) decodedBytes / 1e6);
+    printf("  view     %8.0f MB/s over %.1f MB, hash checked\n",
+           viewNs > 0 ? (double) viewBytes * 1e3 / (double) viewNs : 0.0,
+           (double) viewBytes / 1e6);
+
+    // asynchronous: request everything at mixed priorities, note when each is ready
+    for (int workers = 1; workers <= ASSET_BENCH_MAX_WORKERS && ok; workers *= 2) {
+        AssetLoader loader(&pack, workers);
+        std::vector<AssetRequest *> requests(assetCount);
+        std::vector<int64_t> readyNs(assetCount, 0);
+        startNs = Trace::NowNs();
+        for (int i = 0; i < assetCount; ++i) {
+            requests[i] = loader.Load(names[i].c_str(), _asset_priority(i));
+        }
+        const int64_t issueNs = Trace::NowNs() - startNs;
+        for (int pending = assetCount; pending > 0;) {
+            pending = 0;
+            for (int i = 0; i < assetCount; ++i) {
+                if (readyNs[i] == 0) {
+                    if (AssetLoader::GetState(requests[i]) != ASSET_LOAD_PENDING) {
+                        readyNs[i] = Trace::NowNs() - startNs;
+                    } else {
+                        ++pending;
+                    }
+                }
+            }
+            if (pending > 0) {
+                std::this_thread::yield();
+            }
+        }
+        const int64_t totalNs = Trace::NowNs() - startNs;
+
+        // mean latency by priority, counting decoded assets only
+        double latencyMs[ASSET_BENCH_PRIORITIES] = {};
+        int counts[ASSET_BENCH_PRIORITIES] = {};
+        for (int i = 0; i < assetCount; ++i) {
+            AssetView view;
+            ok = AssetLoader::GetData(requests[i], &view) && view.size == assets[i].size() &&
+                 memcmp(view.data, assets[i].data(), view.size) == 0 && ok;
+            if (requests[i]->buffer != NULL) {
+                latencyMs[_asset_priority(i)] += (double) readyNs[i] / 1e6;
+                ++counts[_asset_priority(i)];
+            }
+            loader.Release(requests[i]);
+        }
+        const AssetLoader::Stats stats = loader.GetStats();
+        printf("  %d worker%s %6.2f ms for all (issued in %.3f ms), %.0f MB/s, "
+               "max latency %.2f ms\n", workers, workers > 1 ? "s" : " ",
+               (double) totalNs / 1e6, (double) issueNs / 1e6,
+               (double) (stats.decodedBytes + viewBytes) * 1e3 / (double) totalNs,
+               (double) stats.maxLatencyNs / 1e6);
+        printf("           mean latency by priority, high to low:");
+        for (int priority = ASSET_BENCH_PRIORITIES - 1; priority >= 0; --priority) {
+            printf(" %.2f", counts[priority] > 0 ? latencyMs[priority] / counts[priority] : 0.0);
+        }
+        printf(" ms\n");
+    }
+
+    BinaryLog::Flush();
+    if (!ok) {
+        fprintf(stderr, "asset bench: an asset came back wrong\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int _pipeline_test(const char *directory) {
+    mkdir(directory, 0700);
+    DIR *dir = opendir(directory);
+    if (dir == NULL) {
+        fprintf(stderr, "pipeline test: can't open %s\n", directory);
+        return 1;
+    }
+    while (struct dirent *entry = readdir(dir)) {
+        const size_t length = strlen(entry->d_name);
+        if (length > 4 && strcmp(entry->d_name + length - 4, ".bin") == 0) {
+            unlink((std::string(directory) + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(dir);
+
+    FakeShaderCompiler compiler;
+    compiler.SetCompileCostNs(PIPELINE_TEST_COMPILE_NS);
+    bool ok = true;
+    {
+        // cold start: the background thread compiles, the first lookup waits for it
+        PipelineCache cache(&compiler, directory);
+        cache.StartPrecompile(ENGINE_PIPELINES, ENGINE_PIPELINE_COUNT);
+        ok = _pipeline_step("cold", &cache, ENGINE_PIPELINE_COUNT, 0, 0) && ok;
+        ok = _pipeline_step("in memory", &cache, 0, 0, 0) && ok;
+        cache.ForgetPrograms();
+        ok = _pipeline_step("lost context", &cache, 0, ENGINE_PIPELINE_COUNT, 0) && ok;
+    }
+    {
+        PipelineCache cache(&compiler, directory);
+        ok = _pipeline_step("warm", &cache, 0, ENGINE_PIPELINE_COUNT, 0) && ok;
+    }
+    compiler.SetDriverId("fake 2");
+    {
+        PipelineCache cache(&compiler, directory);
+        ok = _pipeline_step("driver update", &cache, ENGINE_PIPELINE_COUNT, 0,
+                            ENGINE_PIPELINE_COUNT) && ok;
+    }
+
+    // flip the last byte of one binary
+    const uint64_t key = PipelineCache::Hash(ENGINE_PIPELINES[0]);
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long) key);
+    FILE *file = fopen((std::string(directory) + name).c_str(), "r+b");
+    if (file == NULL || fseek(file, -1, SEEK_END) != 0) {
+        fprintf(stderr, "pipeline test: no binary saved for %s\n", ENGINE_PIPELINES[0].name);
+        return 1;
+    }
+    const int last = fgetc(file);
+    fseek(file, -1, SEEK_END);
+    fputc(last ^ 0xff, file);
+    fclose(file);
+    {
+        PipelineCache cache(&compiler, directory);
+        ok = _pipeline_step("corrupt", &cache, 1, ENGINE_PIPELINE_COUNT - 1, 1) && ok;
+    }
+    return ok ? 0 : 1;
+}
+
+// a GPU resource that counts what the registry does with it
+struct CountedResource {
+    int builds;
+    int releases;
+    int deletes;
+    int64_t costNs;
+};
+
+static bool _build_counted(void *data) {
+    CountedResource *resource = (CountedResource *) data;
+    std::this_thread::sleep_for(std::chrono::nanoseconds(resource->costNs));
+    ++resource->builds;
+    return true;
+}
+
+static void _release_counted(void *data, bool deleteObjects) {
+    CountedResource *resource = (CountedResource *) data;
+    ++resource->releases;
+    if (deleteObjects) {
+        ++resource->deletes;
+    }
+}
+
+// one failure of the context loss test, and the calls that must follow it up to
+// and including the next successful present
+struct ContextLossCase {
+    const char *name;
+    // presenting fails with this
+    int swapError;
+    // then this call fails failCount times with failError
+    int failCall;
+    int failCount;
+    int failError;
+    // whether the GPU resources must be rebuilt
+    bool losesResources;
+    // FAKE_CONTEXT_*, ended by -1
+    int calls[24];
+};
+
+static bool _context_loss_case(const ContextLossCase &test) {
+    FakeContextLayer layer;
+    GpuResourceRegistry resources;
+    CountedResource draw = {0, 0, 0, 0};
+    CountedResource later[CONTEXT_LOSS_LATER_RESOURCES];
+    GpuResourceRecipe recipe = {"draw", GPU_RESOURCE_PRIORITY_DRAW, _build_counted,
+                                _release_counted, &draw};
+    for (int i = 0; i < CONTEXT_LOSS_LATER_RESOURCES; ++i) {
+        later[i] = {0, 0, 0, CONTEXT_LOSS_RESOURCE_NS};
+        GpuResourceRecipe laterRecipe = {"later", GPU_RESOURCE_PRIORITY_LATER, _build_counted,
+                                         _release_counted, &later[i]};
+        resources.Register(laterRecipe);
+    }
+    // registered last, built first
+    resources.Register(recipe);
+
+    RenderContext context(&layer, &resources);
+    for (int frame = 0; frame < 4; ++frame) {
+        if (!context.Prepare() || !context.Present()) {
+            fprintf(stderr, "%s: first frames failed\n", test.name);
+            return false;
+        }
+    }
+
+    layer.ClearCalls();
+    layer.FailCall(FAKE_CONTEXT_SWAP, test.swapError);
+    if (test.failCount > 0) {
+        layer.FailCall(test.failCall, test.failError, test.failCount);
+    }
+    bool presented = context.Present();
+    int frames = 0;
+    bool drawnFirst = true;
+    while (!presented && frames < 10) {
+        ++frames;
+        if (context.Prepare()) {
+            // the first frame back must not wait for every resource
+            drawnFirst = draw.builds == (test.losesResources ? 2 : 1);
+            presented = context.Present();
+        }
+    }
+    bool ok = presented;
+
+    std::string expected, got;
+    for (int i = 0; test.calls[i] >= 0; ++i) {
+        expected += std::string(i > 0 ? " " : "") + FakeContextLayer::GetCallName(test.calls[i]);
+    }
+    const std::vector<int> &calls = layer.GetCalls();
+    for (size_t i = 0; i < calls.size(); ++i) {
+        got += std::string(i > 0 ? " " : "") + FakeContextLayer::GetCallName(calls[i]);
+    }
+    if (got != expected) {
+        fprintf(stderr, "%s: expected calls\n    %s\n  got\n    %s\n", test.name,
+                expected.c_str(), got.c_str());
+        ok = false;
+    }
+
+    // a few more frames finish the later resources
+    for (int frame = 0; frame < CONTEXT_LOSS_LATER_RESOURCES && !resources.IsComplete(); ++frame) {
+        context.Prepare();
+        context.Present();
+    }
+    const int generations = test.losesResources ? 2 : 1;
+    bool resourcesOk = drawnFirst && draw.builds == generations && draw.deletes == 0 &&
+                       draw.releases == generations - 1;
+    for (int i = 0; i < CONTEXT_LOSS_LATER_RESOURCES; ++i) {
+        resourcesOk = resourcesOk && later[i].builds == generations;
+    }
+    if (!resourcesOk) {
+        fprintf(stderr, "%s: draw resource built %d times (%s the first frame), released %d, "
+                        "deleted %d\n", test.name, draw.builds, drawnFirst ? "by" : "not by",
+                draw.releases, draw.deletes);
+        ok = false;
+    }
+
+    BinaryLog::Flush();
+    const RenderContext::Stats &stats = context.GetStats();
+    printf("%-26s %d frames, %llu errors, %llu recovered in %.2f ms%s\n", test.name, frames,
+           (unsigned long long) stats.errors, (unsigned long long) stats.recoveries,
+           (double) stats.lastRecoveryNs / 1e6, ok ? "" : "  UNEXPECTED");
+    return ok && stats.recoveries == 1;
+}
+
+static int _context_loss_test(int frames) {
+    const int S = FAKE_CONTEXT_SWAP, RC = FAKE_CONTEXT_RELEASE_CURRENT;
+    const int MC = FAKE_CONTEXT_MAKE_CURRENT;
+    const int CC = FAKE_CONTEXT_CREATE_CONTEXT, DC = FAKE_CONTEXT_DESTROY_CONTEXT;
+    const int CS = FAKE_CONTEXT_CREATE_SURFACE, DS = FAKE_CONTEXT_DESTROY_SURFACE;
+    const int ID = FAKE_CONTEXT_INIT_DISPLAY, TD = FAKE_CONTEXT_TERMINATE_DISPLAY;
+    static const ContextLossCase cases[] = {
+            {"context lost", CONTEXT_ERROR_CONTEXT, 0, 0, 0, true,
+                    {S, RC, DC, CC, MC, S, -1}},
+            {"bad surface", CONTEXT_ERROR_SURFACE, 0, 0, 0, false,
+                    {S, RC, DS, CS, MC, S, -1}},
+            {"bad display", CONTEXT_ERROR_DISPLAY, 0, 0, 0, true,
+                    {S, RC, DC, DS, TD, ID, CS, CC, MC, S, -1}},
+            {"unknown error", CONTEXT_ERROR_UNKNOWN, 0, 0, 0, true,
+                    {S, RC, DC, DS, TD, ID, CS, CC, MC, S, -1}},
+            {"display lost while binding", CONTEXT_ERROR_CONTEXT, MC, 1, CONTEXT_ERROR_DISPLAY, true,
+                    {S, RC, DC, CC, MC, DC, DS, TD, ID, CS, CC, MC, S, -1}},
+            {"display slow to return", CONTEXT_ERROR_DISPLAY, ID, 2, 0, true,
+                    {S, RC, DC, DS, TD, ID, ID, ID, CS, CC, MC, S, -1}},
+            {"surface slow to return", CONTEXT_ERROR_SURFACE, CS, 2, 0, false,
+                    {S, RC, DS, CS, CS, CS, MC, S, -1}},
+    };
+    bool ok = true;
+    for (const ContextLossCase &test : cases) {
+        ok = _context_loss_case(test) && ok;
+    }
+
+    // the whole engine, losing its context, surface and display on the way
+    HeadlessPlatform platform(HEADLESS_SURFACE_WIDTH, HEADLESS_SURFACE_HEIGHT,
+                              CONTEXT_LOSS_PIPELINE_DIR);
+    platform.GetShaderCompiler()->SetCompileCostNs(CONTEXT_LOSS_COMPILE_NS);
+    platform.GetContextLayer()->SetCreateContextCostNs(CONTEXT_LOSS_CREATE_NS);
+    platform.AddCommand(0, PLATFORM_CMD_INIT_WINDOW);
+    platform.AddCommand(0, PLATFORM_CMD_START);
+    platform.AddCommand(0, PLATFORM_CMD_RESUME);
+    platform.AddCommand(0, PLATFORM_CMD_GAINED_FOCUS);
+    platform.AddCommand(frames, PLATFORM_CMD_LOST_FOCUS);
+    platform.AddCommand(frames, PLATFORM_CMD_STOP);
+    platform.AddCommand(frames, PLATFORM_CMD_TERM_WINDOW);
+    platform.AddCommand(frames, PLATFORM_CMD_DESTROY);
+    platform.AddContextError(frames / 4, CONTEXT_ERROR_CONTEXT);
+    platform.AddContextError(frames / 2, CONTEXT_ERROR_SURFACE);
+    platform.AddContextError(frames * 3 / 4, CONTEXT_ERROR_DISPLAY);
+
+    NativeEngine *engine = new NativeEngine(&platform);
+    engine->GameLoop();
+    delete engine;
+    BinaryLog::Flush();
+
+    const RenderContext::Stats &stats = platform.GetRenderContext()->GetStats();
+    const bool engineOk = stats.errors == 3 && stats.recoveries == 3 &&
+                          platform.GetPresentedFrames() >= (uint64_t) frames;
+    printf("engine: %llu frames, %llu contexts, %llu errors, %llu recoveries, "
+           "last %.2f ms, max %.2f ms%s\n",
+           (unsigned long long) platform.GetPresentedFrames(),
+           (unsigned long long) stats.contextsCreated, (unsigned long long) stats.errors,
+           (unsigned long long) stats.recoveries, (double) stats.lastRecoveryNs / 1e6,
+           (double) stats.maxRecoveryNs / 1e6, engineOk ? "" : "  UNEXPECTED");
+    return ok && engineOk ? 0 : 1;
+}
+
+// a resource of the resource benchmark, its CPU memory really allocated and written
+struct BenchResource {
+    size_t cpuBytes;
+    size_t gpuBytes;
+    uint8_t *memory;
+};
+
+static int _load_bench_resource(void *data, ResourceSize *size) {
+    BenchResource *resource = (BenchResource *) data;
+    resource->memory = (uint8_t *) malloc(resource->cpuBytes);
+    if (resource->memory == NULL) {
+        return RESOURCE_FAILED;
+    }
+    memset(resource->memory, 0x5a, resource->cpuBytes);
+    size->cpuBytes = resource->cpuBytes;
+    size->gpuBytes = resource->gpuBytes;
+    return RESOURCE_READY;
+}
+
+static void _unload_bench_resource(void *data, bool) {
+    BenchResource *resource = (BenchResource *) data;
+    free(resource->memory);
+    resource->memory = NULL;
+}
+
+// ids skewed towards the low ones, roughly like the assets a level keeps using
+static int _skewed_id(uint32_t *seed, int count) {
+    *seed = *seed * 1664525u + 1013904223u;
+    const double u = (double) (*seed >> 8) / (double) (1u << 24);
+    return (int) ((double) count * u * u * u);
+}
+
+static int _resource_bench(int resourceCount) {
+    std::vector<BenchResource> resources(resourceCount);
+    std::vector<std::string> names(resourceCount);
+    size_t totalCpuBytes = 0, totalGpuBytes = 0;
+    uint32_t seed = 12345;
+    for (int i = 0; i < resourceCount; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        resources[i].cpuBytes = RESOURCE_BENCH_MIN_SIZE +
+                                (seed >> 8) % (RESOURCE_BENCH_MAX_SIZE - RESOURCE_BENCH_MIN_SIZE);
+        resources[i].gpuBytes = i % 2 == 0 ? 2 * resources[i].cpuBytes : 0;
+        resources[i].memory = NULL;
+        totalCpuBytes += resources[i].cpuBytes;
+        totalGpuBytes += resources[i].gpuBytes;
+        char name[32];
+        snprintf(name, sizeof(name), "bench/resource%04d", i);
+        names[i] = name;
+    }
+    const size_t cpuBudget = (size_t) ((double) totalCpuBytes * RESOURCE_BENCH_BUDGET_SHARE);
+    const size_t gpuBudget = (size_t) ((double) totalGpuBytes * RESOURCE_BENCH_BUDGET_SHARE);
+    printf("%d resources, %.1f MB CPU, %.1f MB GPU, budgets %.1f MB and %.1f MB\n",
+           resourceCount, (double) totalCpuBytes / 1e6, (double) totalGpuBytes / 1e6,
+           (double) cpuBudget / 1e6, (double) gpuBudget / 1e6);
+
+    bool ok = true;
+    {
+        ResourceManager manager(cpuBudget, gpuBudget);
+        for (int i = 0; i < resourceCount; ++i) {
+            ResourceDesc desc = {names[i].c_str(), _load_bench_resource, _unload_bench_resource,
+                                 &resources[i]};
+            manager.Add(desc);
+        }
+
+        // steady state: every frame uses a skewed handful of everything
+        int64_t startNs = Trace::NowNs();
+        int overBudget = 0;
+        for (int frame = 0; frame < RESOURCE_BENCH_FRAMES; ++frame) {
+            for (int i = 0; i < RESOURCE_BENCH_ACQUIRES_PER_FRAME; ++i) {
+                ok = manager.Acquire(_skewed_id(&seed, resourceCount)) && ok;
+            }
+            manager.EndFrame();
+            const ResourceManager::Stats &stats = manager.GetStats();
+            if (stats.cpuBytes > cpuBudget || stats.gpuBytes > gpuBudget) {
+                ++overBudget;
+            }
+        }
+        const int64_t steadyNs = Trace::NowNs() - startNs;
+        ResourceManager::Stats stats = manager.GetStats();
+        const uint64_t acquires = stats.hits + stats.misses;
+        printf("  steady   %.1f%% hits over %llu acquires, %.3f us per acquire "
+               "(loads %.1f us, evictions %.1f us each)\n",
+               100.0 * (double) stats.hits / (double) acquires, (unsigned long long) acquires,
+               (double) steadyNs / 1e3 / (double) acquires,
+               stats.loads > 0 ? (double) stats.loadNs / 1e3 / (double) stats.loads : 0.0,
+               stats.evictions > 0 ? (double) stats.evictNs / 1e3 / (double) stats.evictions
+                                   : 0.0);
+        printf("           %llu loads, %llu evictions, peak %.1f MB CPU, %.1f MB GPU, "
+               "%d frames over budget\n", (unsigned long long) stats.loads,
+               (unsigned long long) stats.evictions, (double) stats.peakCpuBytes / 1e6,
+               (double) stats.peakGpuBytes / 1e6, overBudget);
+        ok = overBudget == 0 && ok;
+
+        // low memory: shed down to a share of the budgets, used or not
+        const size_t cpuTarget = (size_t) ((double) cpuBudget * RESOURCE_BENCH_LOW_MEMORY_SHARE);
+        const size_t gpuTarget = (size_t) ((double) gpuBudget * RESOURCE_BENCH_LOW_MEMORY_SHARE);
+        size_t cpuBytes = stats.cpuBytes, gpuBytes = stats.gpuBytes;
+        uint64_t evictions = stats.evictions;
+        startNs = Trace::NowNs();
+        manager.Trim(cpuTarget, gpuTarget);
+        int64_t trimNs = Trace::NowNs() - startNs;
+        stats = manager.GetStats();
+        printf("  low mem  %.1f MB CPU, %.1f MB GPU freed in %.3f ms (%llu evictions)\n",
+               (double) (cpuBytes - stats.cpuBytes) / 1e6,
+               (double) (gpuBytes - stats.gpuBytes) / 1e6, (double) trimNs / 1e6,
+               (unsigned long long) (stats.evictions - evictions));
+        ok = stats.cpuBytes <= cpuTarget && stats.gpuBytes <= gpuTarget && ok;
+
+        // window lost: every GPU resource goes, CPU only ones stay
+        std::vector<bool> cpuOnlyResident(resourceCount);
+        for (int i = 0; i < resourceCount; ++i) {
+            cpuOnlyResident[i] = resources[i].gpuBytes == 0 && resources[i].memory != NULL;
+        }
+        gpuBytes = stats.gpuBytes;
+        evictions = stats.evictions;
+        startNs = Trace::NowNs();
+        manager.Trim(cpuBudget, 0);
+        trimNs = Trace::NowNs() - startNs;
+        stats = manager.GetStats();
+        printf("  no window %.1f MB GPU freed in %.3f ms (%llu evictions), %.1f MB CPU kept\n",
+               (double) (gpuBytes - stats.gpuBytes) / 1e6, (double) trimNs / 1e6,
+               (unsigned long long) (stats.evictions - evictions), (double) stats.cpuBytes / 1e6);
+        ok = stats.gpuBytes == 0 && ok;
+        for (int i = 0; i < resourceCount; ++i) {
+            ok = (!cpuOnlyResident[i] || resources[i].memory != NULL) && ok;
+        }
+
+        // back in the game: the hot set reloads on demand
+        const uint64_t loads = stats.loads;
+        const int64_t loadNs = stats.loadNs;
+        startNs = Trace::NowNs();
+        for (int frame = 0; frame < 10; ++frame) {
+            for (int i = 0; i < RESOURCE_BENCH_ACQUIRES_PER_FRAME; ++i) {
+                ok = manager.Acquire(_skewed_id(&seed, resourceCount)) && ok;
+            }
+            manager.EndFrame();
+        }
+        const int64_t reloadNs = Trace::NowNs() - startNs;
+        stats = manager.GetStats();
+        printf("  reload   %llu resources in the next 10 frames, %.3f ms, %.1f us per load\n",
+               (unsigned long long) (stats.loads - loads), (double) reloadNs / 1e6,
+               stats.loads > loads ? (double) (stats.loadNs - loadNs) / 1e3 /
+                                     (double) (stats.loads - loads) : 0.0);
+    }
+    for (int i = 0; i < resourceCount; ++i) {
+        ok = resources[i].memory == NULL && ok;
+    }
+
+    // the same over a pack's assets, loaded by the asset loader's workers
+    const int assetCount = resourceCount < RESOURCE_BENCH_MAX_ASSETS ? resourceCount
+                                                                     : RESOURCE_BENCH_MAX_ASSETS;
+    std::vector<std::vector<uint8_t>> assets(assetCount);
+    AssetPackWriter writer;
+    size_t assetBytes = 0;
+    for (int i = 0; i < assetCount; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        // text and meshes, which the pack compresses, so they are decoded into memory
+        _make_asset(i % 2 == 0 ? 0 : 2, seed, &assets[i]);
+        writer.Add(names[i], assets[i].data(), assets[i].size(), true);
+        assetBytes += assets[i].size();
+    }
+    AssetPack pack;
+    if (!writer.Write(RESOURCE_BENCH_PACK) || !pack.Open(RESOURCE_BENCH_PACK)) {
+        BinaryLog::Flush();
+        fprintf(stderr, "resource bench: can't write %s\n", RESOURCE_BENCH_PACK);
+        return 1;
+    }
+    {
+        AssetLoader loader(&pack, 2);
+        ResourceManager manager((size_t) ((double) assetBytes * RESOURCE_BENCH_BUDGET_SHARE),
+                                0);
+        for (int i = 0; i < assetCount; ++i) {
+            manager.AddAsset(&loader, names[i].c_str(), 0);
+        }
+        int frames = 0;
+        int64_t startNs = Trace::NowNs();
+        for (int i = 0; i < assetCount; ++i) {
+            // a frame polls until its asset is in, each asset checked as it arrives
+            while (!manager.Acquire(i)) {
+                manager.EndFrame();
+                ++frames;
+                std::this_thread::yield();
+            }
+            AssetView view;
+            ok = manager.GetAssetData(i, &view) && view.size == assets[i].size() &&
+                 memcmp(view.data, assets[i].data(), view.size) == 0 && ok;
+            manager.EndFrame();
+            ++frames;
+        }
+        const int64_t streamNs = Trace::NowNs() - startNs;
+        ResourceManager::Stats stats = manager.GetStats();
+        printf("  assets   %d streamed in %.3f ms over %d frames, %.1f ms load latency, "
+               "%llu evictions, peak %.1f MB of %.1f MB\n", assetCount,
+               (double) streamNs / 1e6, frames,
+               (double) stats.loadNs / 1e6 / (double) stats.loads,
+               (unsigned long long) stats.evictions, (double) stats.peakCpuBytes / 1e6,
+               (double) assetBytes / 1e6);
+        ok = stats.cpuBytes <= manager.GetCpuBudget() && ok;
+        startNs = Trace::NowNs();
+        manager.Trim(0, 0);
+        printf("           trimmed to nothing in %.3f ms\n",
+               (double) (Trace::NowNs() - startNs) / 1e6);
+        ok = manager.GetStats().cpuBytes == 0 && ok;
+    }
+
+    BinaryLog::Flush();
+    if (!ok) {
+        fprintf(stderr, "resource bench: a resource failed, came back wrong or broke a budget\n");
+        return 1;
+    }
+    return 0;
+}
+
+// a snapshot with a section of each kind of field, and one no reader knows
+static void _write_test_snapshot(SnapshotWriter *writer, const std::string &text) {
+    writer->BeginSection(1);
+    writer->WriteU32(0xdeadbeefu);
+    writer->WriteU64(0x0123456789abcdefULL);
+    writer->WriteI32(-42);
+    writer->WriteF32(3.25f);
+    writer->EndSection();
+    writer->BeginSection(99);
+    writer->WriteU64(7);
+    writer->EndSection();
+    writer->BeginSection(2);
+    writer->WriteString(text);
+    writer->EndSection();
+    writer->Finish();
+}
+
+// reads back what _write_test_snapshot() wrote, skipping the unknown section
+static bool _read_test_snapshot(const uint8_t *data, size_t size, const std::string &text) {
+    SnapshotReader reader;
+    if (!reader.Open(data, size)) {
+        return false;
+    }
+    bool ok = true;
+    int sections = 0;
+    uint32_t tag;
+    while (reader.NextSection(&tag)) {
+        ++sections;
+        if (tag == 1) {
+            uint32_t u32 = 0;
+            uint64_t u64 = 0;
+            int32_t i32 = 0;
+            float f32 = 0.0f;
+            ok = reader.ReadU32(&u32) && reader.ReadU64(&u64) && reader.ReadI32(&i32) &&
+                 reader.ReadF32(&f32) && u32 == 0xdeadbeefu && u64 == 0x0123456789abcdefULL &&
+                 i32 == -42 && f32 == 3.25f && ok;
+        } else if (tag == 2) {
+            std::string value;
+            ok = reader.ReadString(&value, 1024) && value == text && ok;
+        }
+    }
+    return ok && sections == 3 && !reader.HasFailed();
+}
+
+static bool _snapshot_format_test() {
+    const std::string text = "tunnel \xce\xb1 text\n";
+    SnapshotWriter writer;
+    _write_test_snapshot(&writer, text);
+    const std::vector<uint8_t> snapshot(writer.GetData(), writer.GetData() + writer.GetSize());
+    bool ok = _read_test_snapshot(snapshot.data(), snapshot.size(), text);
+    printf("  round trip        %zu bytes, 3 sections%s\n", snapshot.size(), ok ? "" : "  WRONG");
+
+    // reusing a writer starts over
+    writer.Clear();
+    _write_test_snapshot(&writer, text);
+    const bool reused = writer.GetSize() == snapshot.size() &&
+                        memcmp(writer.GetData(), snapshot.data(), snapshot.size()) == 0;
+    printf("  reused writer     %s\n", reused ? "same bytes" : "DIFFERENT BYTES");
+    ok = reused && ok;
+
+    // every way a snapshot can be unusable
+    struct Damage {
+        const char *name;
+        // byte flipped, none if past the end
+        size_t offset;
+        size_t size;
+    };
+    const Damage damages[] = {
+            {"flipped bit", snapshot.size() - 3, snapshot.size()},
+            {"other version", offsetof(SnapshotHeader, version), snapshot.size()},
+            {"truncated", snapshot.size(), snapshot.size() - 5},
+            {"header only", snapshot.size(), sizeof(SnapshotHeader) - 1},
+            {"empty", snapshot.size(), 0},
+    };
+    SnapshotReader reader;
+    for (const Damage &damage : damages) {
+        std::vector<uint8_t> damaged = snapshot;
+        if (damage.offset < damaged.size()) {
+            damaged[damage.offset] ^= 0x10;
+        }
+        damaged.resize(damage.size);
+        const bool rejected = !reader.Open(damaged.data(), damaged.size());
+        printf("  %-17s %s\n", damage.name, rejected ? "rejected" : "ACCEPTED");
+        ok = rejected && ok;
+    }
+
+    // reads past their section, and strings longer than allowed, fail
+    uint32_t tag;
+    bool overrun = reader.Open(snapshot.data(), snapshot.size()) && reader.NextSection(&tag);
+    uint8_t field[21];
+    overrun = overrun && !reader.Read(field, sizeof(field)) && reader.HasFailed();
+    bool tooLong = reader.Open(snapshot.data(), snapshot.size());
+    while (reader.NextSection(&tag)) {
+        if (tag == 2) {
+            std::string value;
+            tooLong = tooLong && !reader.ReadString(&value, text.size() - 1) &&
+                      reader.HasFailed();
+        }
+    }
+    printf("  overrun           %s\n", overrun ? "rejected" : "ACCEPTED");
+    printf("  long string       %s\n", tooLong ? "rejected" : "ACCEPTED");
+    return overrun && tooLong && ok;
+}
+
+// Hands the engine one set of fidelity parameters on its first poll, as Tuning
+// Fork hands over the training or downloaded ones at startup.
+struct StartupReporter : public NullPerformanceReporter {
+    FidelityParams params;
+    bool polled = false;
+
+    bool PollFidelityParams(FidelityParams *params) override {
+        *params = this->params;
+        const bool first = !polled;
+        polled = true;
+        return first;
+    }
+};
+
+static bool _same_fidelity(const FidelityParams &a, const FidelityParams &b) {
+    return a.tunnelSectionCount == b.tunnelSectionCount &&
+           a.tunnelSectionLength == b.tunnelSectionLength;
+}
+
+// runs an engine on a new platform, launched with savedState if there is one
+static NativeEngine *_snapshot_engine(HeadlessPlatform *platform, long frames,
+                                      const std::vector<uint8_t> &savedState) {
+    if (!savedState.empty()) {
+        platform->SetSavedState(savedState.data(), savedState.size());
+    }
+    platform->AddCommand(0, PLATFORM_CMD_INIT_WINDOW);
+    platform->AddCommand(0, PLATFORM_CMD_START);
+    platform->AddCommand(0, PLATFORM_CMD_RESUME);
+    platform->AddCommand(0, PLATFORM_CMD_GAINED_FOCUS);
+    platform->AddCommand(frames, PLATFORM_CMD_LOST_FOCUS);
+    platform->AddCommand(frames, PLATFORM_CMD_PAUSE);
+    platform->AddCommand(frames, PLATFORM_CMD_STOP);
+    platform->AddCommand(frames, PLATFORM_CMD_SAVE_STATE);
+    platform->AddCommand(frames, PLATFORM_CMD_TERM_WINDOW);
+    platform->AddCommand(frames, PLATFORM_CMD_DESTROY);
+    return new NativeEngine(platform);
+}
+
+static int _snapshot_test(int frames) {
+    bool ok = _snapshot_format_test();
+
+    // the first process runs, saves its state on the way out and is killed
+    std::vector<uint8_t> saved;
+    SimState savedSim;
+    {
+        HeadlessPlatform platform(HEADLESS_SURFACE_WIDTH, HEADLESS_SURFACE_HEIGHT,
+                                  HEADLESS_DEFAULT_PIPELINE_DIR);
+        NativeEngine *engine = _snapshot_engine(&platform, frames, saved);
+        engine->GameLoop();
+        savedSim = engine->GetSimState();
+        const void *data;
+        size_t size;
+        if (platform.GetSavedState(&data, &size)) {
+            saved.assign((const uint8_t *) data, (const uint8_t *) data + size);
+        }
+        delete engine;
+    }
+    if (saved.empty()) {
+        BinaryLog::Flush();
+        fprintf(stderr, "snapshot test: the engine saved nothing\n");
+        return 1;
+    }
+
+    // the next one resumes from it, and would save exactly the same again
+    {
+        HeadlessPlatform platform(HEADLESS_SURFACE_WIDTH, HEADLESS_SURFACE_HEIGHT,
+                                  HEADLESS_DEFAULT_PIPELINE_DIR);
+        NativeEngine *engine = _snapshot_engine(&platform, frames, saved);
+        const SimState resumed = engine->GetSimState();
+        SnapshotWriter writer;
+        engine->WriteSnapshot(&writer);
+        writer.Finish();
+        const bool same = resumed.step == savedSim.step && resumed.cameraZ == savedSim.cameraZ &&
+                          writer.GetSize() == saved.size() &&
+                          memcmp(writer.GetData(), saved.data(), saved.size()) == 0;
+
+        // saving and restoring as they happen on a device, many times for the worst case
+        int64_t maxWriteNs = 0, maxReadNs = 0, writeNs = 0, readNs = 0;
+        bool restored = true;
+        for (int i = 0; i < SNAPSHOT_TEST_ITERATIONS; ++i) {
+            int64_t startNs = Trace::NowNs();
+            writer.Clear();
+            engine->WriteSnapshot(&writer);
+            writer.Finish();
+            platform.SaveState(writer.GetData(), writer.GetSize());
+            int64_t ns = Trace::NowNs() - startNs;
+            writeNs += ns;
+            maxWriteNs = ns > maxWriteNs ? ns : maxWriteNs;
+
+            startNs = Trace::NowNs();
+            restored = engine->ReadSnapshot(writer.GetData(), writer.GetSize()) && restored;
+            ns = Trace::NowNs() - startNs;
+            readNs += ns;
+            maxReadNs = ns > maxReadNs ? ns : maxReadNs;
+        }
+
+        engine->GameLoop();
+        const SimState ended = engine->GetSimState();
+        delete engine;
+        BinaryLog::Flush();
+        printf("  engine            %zu byte snapshot at step %llu, camera at %.1f\n",
+               saved.size(), (unsigned long long) savedSim.step, (double) savedSim.cameraZ);
+        printf("  resumed           %s, then ran on to step %llu\n",
+               same ? "same state" : "DIFFERENT STATE", (unsigned long long) ended.step);
+        printf("  save              avg %8.2f us  max %8.2f us\n",
+               (double) writeNs / SNAPSHOT_TEST_ITERATIONS / 1e3, (double) maxWriteNs / 1e3);
+        printf("  restore           avg %8.2f us  max %8.2f us\n",
+               (double) readNs / SNAPSHOT_TEST_ITERATIONS / 1e3, (double) maxReadNs / 1e3);
+        ok = same && restored && savedSim.step > 0 && ended.step > savedSim.step &&
+             maxWriteNs < SNAPSHOT_TEST_MAX_NS && maxReadNs < SNAPSHOT_TEST_MAX_NS && ok;
+    }
+
+    // a level the device settled on outlives the training parameters handed over
+    // at the next startup, while downloaded ones still replace it
+    {
+        const FidelityParams training = {RENDER_TUNNEL_SECTION_COUNT, TUNNEL_SECTION_LENGTH};
+        const FidelityParams high = {HIGH_TUNNEL_SECTION_COUNT, HIGH_TUNNEL_SECTION_LENGTH};
+        const FidelityParams downloaded = {HIGH_TUNNEL_SECTION_COUNT - 1,
+                                           HIGH_TUNNEL_SECTION_LENGTH};
+        std::vector<uint8_t> settled;
+        {
+            StartupReporter reporter;
+            reporter.params = high;
+            HeadlessPlatform platform(HEADLESS_SURFACE_WIDTH, HEADLESS_SURFACE_HEIGHT,
+                                      HEADLESS_DEFAULT_PIPELINE_DIR);
+            platform.SetPerformanceReporter(&reporter);
+            NativeEngine *engine = _snapshot_engine(&platform, frames, settled);
+            engine->GameLoop();
+            const void *data;
+            size_t size;
+            if (_same_fidelity(engine->GetFidelityParams(), high) &&
+                platform.GetSavedState(&data, &size)) {
+                settled.assign((const uint8_t *) data, (const uint8_t *) data + size);
+            }
+            delete engine;
+        }
+        // relaunched with the training parameters, then with downloaded ones
+        const FidelityParams handedOver[] = {training, downloaded};
+        const FidelityParams expected[] = {high, downloaded};
+        bool followed[2] = {false, false};
+        for (int i = 0; i < 2 && !settled.empty(); ++i) {
+            StartupReporter reporter;
+            reporter.params = handedOver[i];
+            HeadlessPlatform platform(HEADLESS_SURFACE_WIDTH, HEADLESS_SURFACE_HEIGHT,
+                                      HEADLESS_DEFAULT_PIPELINE_DIR);
+            platform.SetPerformanceReporter(&reporter);
+            NativeEngine *engine = _snapshot_engine(&platform, frames, settled);
+            engine->GameLoop();
+            followed[i] = reporter.polled &&
+                          _same_fidelity(engine->GetFidelityParams(), expected[i]);
+            delete engine;
+        }
+        BinaryLog::Flush();
+        printf("  restored fidelity %s over the training parameters, %s by downloaded ones\n",
+               settled.empty() ? "NOT SAVED" : followed[0] ? "kept" : "LOST",
+               followed[1] ? "replaced" : "NOT REPLACED");
+        ok = followed[0] && followed[1] && ok;
+    }
+
+    // a damaged snapshot means a cold start, not a crash or a half restored state
+    {
+        std::vector<uint8_t> damaged = saved;
+        damaged[damaged.size() / 2] ^= 0xff;
+        HeadlessPlatform platform(HEADLESS_SURFACE_WIDTH, HEADLESS_SURFACE_HEIGHT,
+                                  HEADLESS_DEFAULT_PIPELINE_DIR);
+        NativeEngine *engine = _snapshot_engine(&platform, 1, damaged);
+        const bool cold = engine->GetSimState().step == 0;
+        delete engine;
+        BinaryLog::Flush();
+        printf("  damaged snapshot  %s\n", cold ? "cold start" : "RESTORED");
+        ok = cold && ok;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "snapshot test: failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void _stand_in_task(void *data) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(*(const int64_t *) data));
+}
+
+// every task started after its dependencies ended, and calling thread tasks ran there
+static bool _check_startup_order(const StartupGraph &graph) {
+    bool ok = true;
+    for (int id = 0; id < graph.GetTaskCount(); ++id) {
+        const StartupGraph::Task &task = graph.GetTask(id);
+        ok = task.endNs >= task.startNs && task.startNs >= 0 && ok;
+        ok = (task.thread != STARTUP_CALLING_THREAD || task.worker == 0) && ok;
+        for (int dependency : task.dependencies) {
+            ok = graph.GetTask(dependency).endNs <= task.startNs && ok;
+        }
+    }
+    return ok;
+}
+
+static int64_t _critical_path_ns(const StartupGraph &graph, std::vector<int> *path) {
+    graph.GetCriticalPath(path);
+    int64_t ns = 0;
+    for (int id : *path) {
+        ns += graph.GetTask(id).endNs - graph.GetTask(id).startNs;
+    }
+    return ns;
+}
+
+static int _startup_test(int taskCount) {
+    // the Android startup, with costs like a mid-range device's
+    struct StandIn {
+        const char *name;
+        int64_t costNs;
+        int thread;
+        // index of the task it waits for, -1 for none
+        int dependency;
+    };
+    static const StandIn kAndroidStartup[] = {
+            {"swappy", 12000000LL, STARTUP_CALLING_THREAD, -1},
+            {"tuning fork", 30000000LL, STARTUP_ANY_THREAD, 0},
+            {"choreographer", 2000000LL, STARTUP_CALLING_THREAD, 1},
+            {"pipeline cache", 3000000LL, STARTUP_ANY_THREAD, -1},
+            {"asset pack", 6000000LL, STARTUP_ANY_THREAD, -1},
+            {"audio", 20000000LL, STARTUP_ANY_THREAD, -1},
+    };
+    const int standInCount = sizeof(kAndroidStartup) / sizeof(kAndroidStartup[0]);
+    int64_t costs[standInCount];
+    StartupGraph android;
+    int64_t serialNs = 0;
+    for (int i = 0; i < standInCount; ++i) {
+        costs[i] = kAndroidStartup[i].costNs;
+        android.AddTask(kAndroidStartup[i].name, _stand_in_task, &costs[i],
+                        kAndroidStartup[i].thread);
+        if (kAndroidStartup[i].dependency >= 0) {
+            android.AddDependency(i, kAndroidStartup[i].dependency);
+        }
+        serialNs += costs[i];
+    }
+    android.Run(3);
+    android.Log();
+    BinaryLog::Flush();
+
+    std::vector<int> path;
+    int64_t pathNs = _critical_path_ns(android, &path);
+    printf("android startup stand-ins, 3 workers:\n");
+    for (int id = 0; id < standInCount; ++id) {
+        const StartupGraph::Task &task = android.GetTask(id);
+        printf("  %-16s %7.2f .. %7.2f ms  %s %d\n", task.name, (double) task.startNs / 1e6,
+               (double) task.endNs / 1e6, task.worker == 0 ? "caller" : "worker", task.worker);
+    }
+    const bool expectedPath = path.size() == 3 && path[0] == 0 && path[1] == 1 && path[2] == 2;
+    printf("  %.2f ms, %.2f ms one after another, critical path %.2f ms%s\n",
+           (double) android.GetElapsedNs() / 1e6, (double) serialNs / 1e6, (double) pathNs / 1e6,
+           expectedPath ? "" : "  UNEXPECTED PATH");
+    bool ok = _check_startup_order(android) && expectedPath &&
+              android.GetElapsedNs() < pathNs + STARTUP_TEST_SLACK_NS;
+
+    // random graphs: tasks only depend on earlier ones, so any order of adding is valid
+    std::vector<int64_t> randomCosts(taskCount);
+    uint32_t seed = 12345;
+    for (int workers = 1; workers <= STARTUP_TEST_MAX_WORKERS; workers *= 2) {
+        StartupGraph graph;
+        serialNs = 0;
+        seed = 12345;
+        for (int id = 0; id < taskCount; ++id) {
+            seed = seed * 1664525u + 1013904223u;
+            randomCosts[id] = 200000LL + (seed >> 8) % 1800000LL;
+            serialNs += randomCosts[id];
+            graph.AddTask("task", _stand_in_task, &randomCosts[id],
+                          (seed >> 4) % 8 == 0 ? STARTUP_CALLING_THREAD : STARTUP_ANY_THREAD);
+            for (int i = 0; i < 3 && id > 0; ++i) {
+                seed = seed * 1664525u + 1013904223u;
+                if ((seed >> 12) % 3 == 0) {
+                    graph.AddDependency(id, (int) ((seed >> 16) % id));
+                }
+            }
+        }
+        graph.Run(workers);
+        pathNs = _critical_path_ns(graph, &path);
+        const bool ordered = _check_startup_order(graph);
+        printf("%d random tasks, %d worker%s: %7.2f ms, %7.2f ms one after another, "
+               "critical path %zu tasks %.2f ms%s\n", taskCount, workers, workers > 1 ? "s" : " ",
+               (double) graph.GetElapsedNs() / 1e6, (double) serialNs / 1e6, path.size(),
+               (double) pathNs / 1e6, ordered ? "" : "  OUT OF ORDER");
+        ok = ordered && graph.GetElapsedNs() <= serialNs + STARTUP_TEST_SLACK_NS && ok;
+    }
+
+    BinaryLog::Flush();
+    if (!ok) {
+        fprintf(stderr, "startup test: tasks ran out of order or didn't overlap\n");
+        return 1;
+    }
+    return 0;
+}
+
+// what the player did before the oscillator bank: sinf() of a float phase, per channel
+struct ScalarSine {
+    float phase;
+    double increment;
+};
+
+static void _render_scalar_sines(ScalarSine *sines, int count, float *out, int frameCount) {
+    const float twoPi = (float) (2.0 * M_PI);
+    for (int i = 0; i < frameCount; ++i) {
+        float sample = 0.0f;
+        for (int s = 0; s < count; ++s) {
+            sample += 0.5f * sinf(sines[s].phase);
+            sines[s].phase += sines[s].increment;
+            if (sines[s].phase >= twoPi) sines[s].phase -= twoPi;
+        }
+        out[2 * i] = out[2 * i + 1] = sample;
+    }
+}
+
+static int _oscillator_bench(int seconds) {
+    const int sampleRate = OSCILLATOR_BENCH_SAMPLE_RATE;
+    const long frames = (long) seconds * sampleRate;
+    float out[2 * OSCILLATOR_BENCH_CALLBACK_FRAMES];
+    bool ok = true;
+
+    // accuracy: the bank's sine against sin() at the frequency it really runs at,
+    // and the old loop against the frequency it was asked for
+    {
+        OscillatorBank bank(sampleRate);
+        const int id = bank.Add(OSCILLATOR_SINE, 440.0, 1.0f);
+        const double cyclesPerFrame = bank.GetFrequency(id) / sampleRate;
+        ScalarSine old = {0.0f, 440.0 * 2.0 * M_PI / sampleRate};
+        float oldOut[2 * OSCILLATOR_BENCH_CALLBACK_FRAMES];
+        double maxError = 0.0, oldMaxError = 0.0;
+        bool stereo = true;
+        for (long frame = 0; frame < frames;) {
+            // odd sizes, so blocks end in the middle of a group of four
+            const int count = (int) ((frame / OSCILLATOR_BENCH_CALLBACK_FRAMES) % 3 == 0
+                                     ? OSCILLATOR_BENCH_CALLBACK_FRAMES - 1
+                                     : OSCILLATOR_BENCH_CALLBACK_FRAMES);
+            const int n = (int) (frames - frame < count ? frames - frame : count);
+            bank.Render(out, n, 2);
+            _render_scalar_sines(&old, 1, oldOut, n);
+            for (int i = 0; i < n; ++i) {
+                const double cycles = fmod((double) (frame + i) * cyclesPerFrame, 1.0);
+                maxError = fmax(maxError, fabs(out[2 * i] - sin(2.0 * M_PI * cycles)));
+                const double oldCycles = fmod((double) (frame + i) * 440.0 / sampleRate, 1.0);
+                oldMaxError = fmax(oldMaxError,
+                                   fabs(oldOut[2 * i] / 0.5 - sin(2.0 * M_PI * oldCycles)));
+                stereo = out[2 * i] == out[2 * i + 1] && stereo;
+            }
+            frame += n;
+        }
+        printf("sine over %d s: largest error %.2e (at %.6f Hz), old sinf loop %.2e\n", seconds,
+               maxError, bank.GetFrequency(id), oldMaxError);
+        ok = maxError < OSCILLATOR_TEST_MAX_ERROR && stereo && ok;
+    }
+
+    // the other waves stay in [-1, 1], and noise averages out to about 0
+    {
+        static const char *kWaveNames[] = {"sine", "saw", "square", "noise"};
+        for (int wave = OSCILLATOR_SAW; wave <= OSCILLATOR_NOISE; ++wave) {
+            OscillatorBank bank(sampleRate);
+            bank.Add(wave, 997.0, 1.0f);
+            float low = 1.0f, high = -1.0f;
+            double sum = 0.0;
+            for (long frame = 0; frame < frames; frame += OSCILLATOR_BENCH_CALLBACK_FRAMES) {
+                bank.Render(out, OSCILLATOR_BENCH_CALLBACK_FRAMES, 1);
+                for (int i = 0; i < OSCILLATOR_BENCH_CALLBACK_FRAMES; ++i) {
+                    low = fminf(low, out[i]);
+                    high = fmaxf(high, out[i]);
+                    sum += out[i];
+                }
+            }
+            const double mean = sum / (double) frames;
+            printf("%-6s between %.4f and %.4f, mean %.4f\n", kWaveNames[wave], low, high, mean);
+            ok = low >= -1.0f && high <= 1.0f && high - low > 1.9f && fabs(mean) < 0.01 && ok;
+        }
+    }
+
+    // cost per output frame of a few oscillators, stereo, in callback sized blocks
+    printf("ns per stereo frame:    sine     saw  square   noise  old sinf\n");
+    static const int kCounts[] = {1, 4, OSCILLATOR_MAX_COUNT};
+    for (int count : kCounts) {
+        printf("%2d oscillator%s     ", count, count > 1 ? "s" : " ");
+        // keeps the rendering from being optimized out
+        volatile float sink = 0.0f;
+        for (int wave = OSCILLATOR_SINE; wave <= OSCILLATOR_NOISE; ++wave) {
+            OscillatorBank bank(sampleRate);
+            for (int i = 0; i < count; ++i) {
+                bank.Add(wave, 110.0 * (i + 1), 0.5f / count);
+            }
+            const int64_t startNs = Trace::NowNs();
+            for (long frame = 0; frame < frames; frame += OSCILLATOR_BENCH_CALLBACK_FRAMES) {
+                bank.Render(out, OSCILLATOR_BENCH_CALLBACK_FRAMES, 2);
+                sink = sink + out[0];
+            }
+            printf("%8.2f", (double) (Trace::NowNs() - startNs) / (double) frames);
+        }
+        ScalarSine old[OSCILLATOR_MAX_COUNT];
+        for (int i = 0; i < count; ++i) {
+            old[i].phase = 0.0f;
+            old[i].increment = 110.0 * (i + 1) * 2.0 * M_PI / sampleRate;
+        }
+        const int64_t startNs = Trace::NowNs();
+        for (long frame = 0; frame < frames; frame += OSCILLATOR_BENCH_CALLBACK_FRAMES) {
+            _render_scalar_sines(old, count, out, OSCILLATOR_BENCH_CALLBACK_FRAMES);
+            sink = sink + out[0];
+        }
+        printf("  %8.2f\n", (double) (Trace::NowNs() - startNs) / (double) frames);
+    }
+
+    BinaryLog::Flush();
+    if (!ok) {
+        fprintf(stderr, "oscillator bench: a waveform is off\n");
+        return 1;
+    }
+    return 0;
+}
+
+// the largest move between consecutive samples of either channel of a stereo callback
+static float _largest_step(const float *out, int frameCount, float *last) {
+    float largest = 0.0f;
+    for (int i = 0; i < frameCount; ++i) {
+        for (int channel = 0; channel < 2; ++channel) {
+            largest = fmaxf(largest, fabsf(out[2 * i + channel] - last[channel]));
+            last[channel] = out[2 * i + channel];
+        }
+    }
+    return largest;
+}
+
+// what the audio thread of the mixer test does: callbacks as an Oboe stream would make them
+struct FakeStream {
+    AudioMixer *mixer;
+    int callbacks;
+    std::atomic<bool> done;
+    RealtimeViolations violations;
+    int64_t maxCallbackNs;
+    bool finite;
+};
+
+static void _fake_stream_main(FakeStream *stream) {
+    Trace::SetThreadName("Audio");
+    float out[2 * MIXER_TEST_CALLBACK_FRAMES];
+    for (int i = 0; i < stream->callbacks; ++i) {
+        const int64_t startNs = Trace::NowNs();
+        RealtimeCheckBegin();
+        {
+            TRACE_SCOPE("AudioCallback");
+            stream->mixer->Render(out, MIXER_TEST_CALLBACK_FRAMES, 2);
+        }
+        RealtimeCheckEnd(&stream->violations);
+        const int64_t callbackNs = Trace::NowNs() - startNs;
+        stream->maxCallbackNs = callbackNs > stream->maxCallbackNs ? callbackNs
+                                                                   : stream->maxCallbackNs;
+        for (int j = 0; j < 2 * MIXER_TEST_CALLBACK_FRAMES; ++j) {
+            stream->finite = std::isfinite(out[j]) && fabsf(out[j]) <= MIXER_MAX_VOICES &&
+                             stream->finite;
+        }
+        std::this_thread::yield();
+    }
+    stream->done.store(true, std::memory_order_release);
+}
+
+static int _mixer_test(int callbacks) {
+    float out[2 * MIXER_TEST_CALLBACK_FRAMES];
+    bool ok = true;
+
+    // clicks: a low tone whose gain and pan jump every callback, then stops
+    {
+        AudioMixer mixer(MIXER_TEST_SAMPLE_RATE);
+        const int voice = mixer.Play(OSCILLATOR_SINE, MIXER_TEST_TONE_HZ, 1.0f, 0.0f);
+        float last[2] = {0.0f, 0.0f};
+        float largest = 0.0f;
+        for (int i = 0; i < 200; ++i) {
+            mixer.Render(out, MIXER_TEST_CALLBACK_FRAMES, 2);
+            largest = fmaxf(largest, _largest_step(out, MIXER_TEST_CALLBACK_FRAMES, last));
+            mixer.SetGain(voice, i % 2 == 0 ? 0.0f : 1.0f);
+            mixer.SetPan(voice, i % 3 == 0 ? -1.0f : 1.0f);
+        }
+        mixer.Stop(voice);
+        float tail = 0.0f;
+        for (int i = 0; i < 3; ++i) {
+            mixer.Render(out, MIXER_TEST_CALLBACK_FRAMES, 2);
+            largest = fmaxf(largest, _largest_step(out, MIXER_TEST_CALLBACK_FRAMES, last));
+        }
+        for (int i = 0; i < 2 * MIXER_TEST_CALLBACK_FRAMES; ++i) {
+            tail = fmaxf(tail, fabsf(out[i]));
+        }
+        printf("clicks: largest step %.4f (at most %.4f), %d voices left, tail %.6f\n", largest,
+               MIXER_TEST_MAX_STEP, mixer.GetPlayingCount(), tail);
+        ok = largest <= MIXER_TEST_MAX_STEP && mixer.GetPlayingCount() == 0 && tail == 0.0f && ok;
+    }
+
+    // real-time safety: a game thread sending everything while the stream runs
+    {
+        AudioMixer mixer(MIXER_TEST_SAMPLE_RATE);
+        FakeStream stream;
+        stream.mixer = &mixer;
+        stream.callbacks = callbacks;
+        stream.done.store(false, std::memory_order_relaxed);
+        memset(&stream.violations, 0, sizeof(stream.violations));
+        stream.maxCallbackNs = 0;
+        stream.finite = true;
+        std::thread audio(_fake_stream_main, &stream);
+
+        std::vector<int> playing;
+        uint32_t seed = 12345;
+        while (!stream.done.load(std::memory_order_acquire)) {
+            seed = seed * 1664525u + 1013904223u;
+            const int action = (seed >> 8) % 8;
+            const float value = (float) ((seed >> 12) % 1000) / 1000.0f;
+            if (action == 0 || playing.empty()) {
+                const int voice = mixer.Play((int) ((seed >> 4) % 4), 100.0 + 1000.0 * value,
+                                             0.5f * value, 2.0f * value - 1.0f);
+                if (voice >= 0) {
+                    playing.push_back(voice);
+                }
+            } else {
+                const size_t index = (seed >> 16) % playing.size();
+                const int voice = playing[index];
+                if (action == 1) {
+                    mixer.Stop(voice);
+                    playing.erase(playing.begin() + index);
+                } else if (action < 4) {
+                    mixer.SetGain(voice, value);
+                } else if (action < 6) {
+                    mixer.SetPan(voice, 2.0f * value - 1.0f);
+                } else if (action == 6) {
+                    mixer.SetFrequency(voice, 100.0 + 1000.0 * value);
+                } else if ((seed >> 20) % 64 == 0) {
+                    mixer.StopAll();
+                    playing.clear();
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+        audio.join();
+
+        const AudioMixer::Stats &stats = mixer.GetStats();
+        const RealtimeViolations &violations = stream.violations;
+        printf("%d callbacks: %llu commands (%llu dropped, %llu plays refused), longest "
+               "callback %.1f us; in callbacks %llu allocations, %llu frees, %llu locks%s\n",
+               callbacks, (unsigned long long) stats.commandsSent,
+               (unsigned long long) stats.commandsDropped,
+               (unsigned long long) stats.voicesRefused, (double) stream.maxCallbackNs / 1e3,
+               (unsigned long long) violations.allocations, (unsigned long long) violations.frees,
+               (unsigned long long) violations.locks,
+               RealtimeCheckAvailable() ? "" : " (not counted on this libc)");
+        ok = violations.allocations == 0 && violations.frees == 0 && violations.locks == 0 &&
+             stream.finite && ok;
+    }
+
+    // scaling: cost per frame as voices are added
+    printf("voices  ns per frame  ns per voice frame\n");
+    for (int voices = 1; voices <= MIXER_MAX_VOICES; voices *= 2) {
+        AudioMixer mixer(MIXER_TEST_SAMPLE_RATE);
+        for (int i = 0; i < voices; ++i) {
+            mixer.Play(OSCILLATOR_SINE, 110.0 * (i + 1), 1.0f / voices,
+                       2.0f * i / voices - 1.0f);
+        }
+        // past the ramps in
+        for (int i = 0; i < 2; ++i) {
+            mixer.Render(out, MIXER_TEST_CALLBACK_FRAMES, 2);
+        }
+        const int64_t startNs = Trace::NowNs();
+        for (int i = 0; i < callbacks; ++i) {
+            mixer.Render(out, MIXER_TEST_CALLBACK_FRAMES, 2);
+        }
+        const double frameNs = (double) (Trace::NowNs() - startNs) /
+                               ((double) callbacks * MIXER_TEST_CALLBACK_FRAMES);
+        printf("%6d  %12.2f  %18.2f\n", voices, frameNs, frameNs / voices);
+    }
+
+    BinaryLog::Flush();
+    if (!ok) {
+        fprintf(stderr, "mixer test: a change clicked or a callback wasn't real-time safe\n");
+        return 1;
+    }
+    return 0;
+}
+
+// A spell of the simulated stream. Each callback the audio thread wakes up to
+// half a burst late, and now and then (spikeChance per callback) much later,
+// nearly spikeBursts, the device's worst case. The stream underruns when that's
+// more than the buffer holds past the burst being played, so the smallest
+// buffer that never underruns is settledBursts.
+struct LatencySpell {
+    const char *name;
+    // of the test's seconds
+    int lengths;
+    double spikeChance;
+    double spikeBursts;
+    int settledBursts;
+};
+
+static double _uniform(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return (double) (*seed >> 8) / (double) (1 << 24);
+}
+
+static int _latency_test(int seconds) {
+    if (seconds < LATENCY_TEST_MIN_SECONDS) {
+        fprintf(stderr, "latency test: the tuner can't settle in spells of %d seconds, "
+                        "they need at least %d\n", seconds, LATENCY_TEST_MIN_SECONDS);
+        return 1;
+    }
+    static const LatencySpell kSpells[] = {
+            {"quiet", 1, 1.0 / 200.0, 1.4, 3},
+            {"busy", 1, 1.0 / 500.0, 3.5, 5},
+            {"quiet again", 2, 1.0 / 200.0, 1.4, 3},
+            {"hostile", 1, 1.0 / 50.0, 30.0, LATENCY_TEST_CAPACITY_BURSTS},
+    };
+    const int32_t burst = LATENCY_TEST_BURST_FRAMES;
+    const int32_t capacity = LATENCY_TEST_CAPACITY_BURSTS * burst;
+    LatencyTuner tuner;
+    tuner.Reset(burst, capacity, LATENCY_TEST_SAMPLE_RATE);
+    int32_t underrunCount = 0;
+    uint32_t seed = 12345;
+    bool ok = true;
+
+    printf("spell         seconds  buffer  latency  underruns  grown  shrunk  failed\n");
+    for (const LatencySpell &spell : kSpells) {
+        LatencyTuner::Stats before;
+        tuner.GetStats(&before);
+        const long callbacks = (long) spell.lengths * seconds * LATENCY_TEST_SAMPLE_RATE / burst;
+        int32_t smallest = capacity, largest = 0;
+        // callbacks of the spell's second half at each size, in bursts
+        long atSize[LATENCY_TEST_CAPACITY_BURSTS + 1] = {0};
+        for (long i = 0; i < callbacks; ++i) {
+            double lateBursts = 0.5 * _uniform(&seed);
+            if (_uniform(&seed) < spell.spikeChance) {
+                lateBursts = spell.spikeBursts * (0.9 + 0.1 * _uniform(&seed));
+            }
+            if (lateBursts * burst > tuner.GetBufferSize() - burst) {
+                ++underrunCount;
+            }
+            tuner.Update(underrunCount, burst);
+            const int32_t bufferSize = tuner.GetBufferSize();
+            smallest = bufferSize < smallest ? bufferSize : smallest;
+            largest = bufferSize > largest ? bufferSize : largest;
+            if (i >= callbacks / 2 && bufferSize <= capacity) {
+                ++atSize[bufferSize / burst];
+            }
+        }
+        // where it spent most of that, leaving out its tries of smaller sizes
+        int settledBursts = 0;
+        for (int bursts = 1; bursts <= LATENCY_TEST_CAPACITY_BURSTS; ++bursts) {
+            settledBursts = atSize[bursts] > atSize[settledBursts] ? bursts : settledBursts;
+        }
+
+        LatencyTuner::Stats after;
+        tuner.GetStats(&after);
+        printf("%-12s %8d  %6d  %5.1f ms  %9d  %5d  %6d  %6d\n", spell.name,
+               spell.lengths * seconds, settledBursts * burst,
+               1000.0 * settledBursts * burst / LATENCY_TEST_SAMPLE_RATE,
+               after.underruns - before.underruns, after.increases - before.increases,
+               after.decreases - before.decreases, after.failedDecreases - before.failedDecreases);
+        // it settles where it should, and never goes past the capacity or under a burst
+        const bool settled = settledBursts == spell.settledBursts;
+        if (!settled) {
+            fprintf(stderr, "latency test: %s spell settled at %d bursts, expected %d\n",
+                    spell.name, settledBursts, spell.settledBursts);
+        }
+        ok = settled && smallest >= burst && largest <= capacity && ok;
+    }
+
+    LatencyTuner::Stats stats;
+    tuner.GetStats(&stats);
+    printf("%d underruns in all, %d of them from decreases that didn't hold\n", stats.underruns,
+           stats.failedDecreases);
+    BinaryLog::Flush();
+    return ok ? 0 : 1;
+}
+
+// the stream test's track: a chord whose notes swell and fade across the
+// stereo field, over a little noise
+static void _make_track(int seconds, std::vector<int16_t> *samples) {
+    static const double kNotes[] = {110.0, 164.81, 220.0, 277.18, 329.63};
+    const int noteCount = (int) (sizeof(kNotes) / sizeof(kNotes[0]));
+    const long frameCount = (long) seconds * STREAM_TEST_SAMPLE_RATE;
+    samples->resize(2 * frameCount);
+    uint32_t seed = 12345;
+    for (long i = 0; i < frameCount; ++i) {
+        const double t = (double) i / STREAM_TEST_SAMPLE_RATE;
+        double left = 0.0, right = 0.0;
+        for (int note = 0; note < noteCount; ++note) {
+            const double swell = 0.5 + 0.5 * sin(2.0 * M_PI * (0.1 + 0.07 * note) * t);
+            const double value = 0.15 * swell * sin(2.0 * M_PI * kNotes[note] * t);
+            const double pan = (double) note / (noteCount - 1);
+            left += (1.0 - pan) * value;
+            right += pan * value;
+        }
+        const double noise = 0.01 * (2.0 * _uniform(&seed) - 1.0);
+        (*samples)[2 * i] = (int16_t) lrint(32767.0 * (left + noise));
+        (*samples)[2 * i + 1] = (int16_t) lrint(32767.0 * (right + noise));
+    }
+}
+
+// what the audio thread of the stream test does: reads a callback's worth at a
+// time and checks it against the track decoded up front
+struct StreamReader {
+    SoundStream *stream;
+    const int16_t *expected;
+    long frameCount;
+    // at the rate the frames play, or as fast as it can
+    bool paced;
+    long readFrames;
+    long wrongFrames;
+    int minBufferedFrames;
+    int64_t maxReadNs;
+    RealtimeViolations violations;
+};
+
+static void _stream_reader_main(StreamReader *reader) {
+    Trace::SetThreadName("Audio");
+    float left[STREAM_TEST_CALLBACK_FRAMES], right[STREAM_TEST_CALLBACK_FRAMES];
+    const int64_t periodNs = (int64_t) STREAM_TEST_CALLBACK_FRAMES * 1000000000LL /
+                             STREAM_TEST_SAMPLE_RATE;
+    int64_t nextNs = Trace::NowNs();
+    while (reader->readFrames < reader->frameCount && !reader->stream->IsFinished()) {
+        if (reader->paced) {
+            nextNs += periodNs;
+            const int64_t waitNs = nextNs - Trace::NowNs();
+            if (waitNs > 0) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(waitNs));
+            }
+        }
+        // the ring drains at the end of the track
+        const int buffered = reader->stream->GetBufferedFrames();
+        if (reader->readFrames + SOUND_STREAM_RING_FRAMES < reader->frameCount) {
+            reader->minBufferedFrames = buffered < reader->minBufferedFrames
+                                        ? buffered : reader->minBufferedFrames;
+        }
+        const int64_t startNs = Trace::NowNs();
+        RealtimeCheckBegin();
+        const int count = reader->stream->Read(left, right, STREAM_TEST_CALLBACK_FRAMES);
+        RealtimeCheckEnd(&reader->violations);
+        const int64_t readNs = Trace::NowNs() - startNs;
+        reader->maxReadNs = readNs > reader->maxReadNs ? readNs : reader->maxReadNs;
+
+        for (int i = 0; i < count && reader->readFrames + i < reader->frameCount; ++i) {
+            const int16_t *frame = reader->expected + 2 * (reader->readFrames + i);
+            if (left[i] != frame[0] * (1.0f / 32768.0f) ||
+                right[i] != frame[1] * (1.0f / 32768.0f)) {
+                ++reader->wrongFrames;
+            }
+        }
+        reader->readFrames += count;
+    }
+}
+
+static bool _stream_run(SoundStreamer *streamer, const AssetView &view,
+                        const std::vector<int16_t> &decoded, bool paced) {
+    StreamReader reader;
+    reader.stream = streamer->Open(view, false);
+    if (reader.stream == NULL) {
+        return false;
+    }
+    reader.expected = decoded.data();
+    reader.frameCount = (long) decoded.size() / 2;
+    reader.paced = paced;
+    reader.readFrames = 0;
+    reader.wrongFrames = 0;
+    reader.minBufferedFrames = SOUND_STREAM_RING_FRAMES;
+    reader.maxReadNs = 0;
+    memset(&reader.violations, 0, sizeof(reader.violations));
+
+    const int64_t startNs = Trace::NowNs();
+    std::thread audio(_stream_reader_main, &reader);
+    audio.join();
+    const double seconds = (double) (Trace::NowNs() - startNs) / 1e9;
+
+    const int underruns = reader.stream->GetUnderruns();
+    const bool finished = reader.stream->IsFinished();
+    streamer->Close(reader.stream);
+    const RealtimeViolations &violations = reader.violations;
+    printf("%-9s  %7.2f  %9ld  %5ld  %9d  %8d  %7.1f us  %llu/%llu/%llu%s\n",
+           paced ? "real time" : "flat out", seconds, reader.readFrames, reader.wrongFrames,
+           underruns, reader.minBufferedFrames, (double) reader.maxReadNs / 1e3,
+           (unsigned long long) violations.allocations, (unsigned long long) violations.frees,
+           (unsigned long long) violations.locks,
+           RealtimeCheckAvailable() ? "" : " (not counted on this libc)");
+    // reading fast enough has to run dry, but never lose or reorder a frame
+    return reader.readFrames == reader.frameCount && reader.wrongFrames == 0 && finished &&
+           (paced ? underruns == 0 : underruns > 0) && violations.allocations == 0 &&
+           violations.frees == 0 && violations.locks == 0;
+}
+
+static int _stream_test(int seconds) {
+    bool ok = true;
+
+    // the track, packed as it is, as the app's music would be
+    std::vector<int16_t> track;
+    _make_track(seconds, &track);
+    const long frameCount = (long) track.size() / 2;
+    std::vector<uint8_t> file;
+    int64_t startNs = Trace::NowNs();
+    ImaAdpcmEncodeWav(track.data(), frameCount, 2, STREAM_TEST_SAMPLE_RATE,
+                      STREAM_TEST_BLOCK_SIZE, &file);
+    const int64_t encodeNs = Trace::NowNs() - startNs;
+    AssetPackWriter writer;
+    AssetPack pack;
+    AssetView view;
+    if (!writer.Add(STREAM_TEST_ASSET, file.data(), file.size(), false) ||
+        !writer.Write(STREAM_TEST_PACK) || !pack.Open(STREAM_TEST_PACK) ||
+        !pack.GetView(pack.Find(STREAM_TEST_ASSET), &view)) {
+        BinaryLog::Flush();
+        fprintf(stderr, "stream test: can't pack the track into %s\n", STREAM_TEST_PACK);
+        return 1;
+    }
+    printf("%d s track: %zu KB as PCM, %zu KB as IMA ADPCM, encoded in %.1f ms; "
+           "a stream holds %zu KB\n", seconds, track.size() * sizeof(int16_t) / 1024,
+           view.size / 1024, (double) encodeNs / 1e6, sizeof(SoundStream) / 1024);
+
+    // decoding straight out of the mapping, until it has taken long enough to time
+    ImaAdpcmInfo info;
+    if (!ImaAdpcmParseWav(view.data, view.size, &info) || info.frameCount != frameCount) {
+        BinaryLog::Flush();
+        fprintf(stderr, "stream test: the packed track doesn't parse\n");
+        return 1;
+    }
+    std::vector<int16_t> decoded(2 * (frameCount + info.framesPerBlock));
+    int passes = 0;
+    int64_t decodeNs = 0;
+    while (decodeNs < 200000000LL || passes < 3) {
+        startNs = Trace::NowNs();
+        int16_t *out = decoded.data();
+        for (size_t offset = 0; offset < info.dataSize; offset += info.blockSize) {
+            const size_t left = info.dataSize - offset;
+            out += 2 * ImaAdpcmDecodeBlock(info, info.data + offset,
+                                           left < (size_t) info.blockSize ? left
+                                                                          : info.blockSize,
+                                           out);
+        }
+        decodeNs += Trace::NowNs() - startNs;
+        ++passes;
+    }
+    decoded.resize(2 * frameCount);
+    double signal = 0.0, noise = 0.0;
+    for (size_t i = 0; i < track.size(); ++i) {
+        const double error = (double) decoded[i] - track[i];
+        signal += (double) track[i] * track[i];
+        noise += error * error;
+    }
+    const double snr = 10.0 * log10(signal / (noise > 0.0 ? noise : 1.0));
+    const double frameNs = (double) decodeNs / ((double) passes * frameCount);
+    printf("decode: %.2f ns per frame, %.0f MB/s of ADPCM, %.0fx real time; SNR %.1f dB "
+           "(at least %.1f)\n", frameNs, (double) view.size * passes * 1e3 / (double) decodeNs,
+           1e9 / STREAM_TEST_SAMPLE_RATE / frameNs, snr, STREAM_TEST_MIN_SNR_DB);
+    ok = snr >= STREAM_TEST_MIN_SNR_DB && ok;
+
+    // the ring, read by a fake audio thread while the streamer's thread refills it
+    SoundStreamer streamer(STREAM_TEST_SAMPLE_RATE);
+    printf("run        seconds     frames  wrong  underruns  min ring     longest  "
+           "allocs/frees/locks\n");
+    ok = _stream_run(&streamer, view, decoded, true) && ok;
+    ok = _stream_run(&streamer, view, decoded, false) && ok;
+
+    // a looping stream through the mixer, held by its voice until that has faded out
+    {
+        AudioMixer mixer(STREAM_TEST_SAMPLE_RATE);
+        SoundStream *stream = streamer.Open(view, true);
+        const int voice = stream != NULL ? mixer.PlayStream(stream, 1.0f, 0.0f) : -1;
+        float out[2 * STREAM_TEST_CALLBACK_FRAMES];
+        float loudest = 0.0f;
+        RealtimeViolations violations;
+        memset(&violations, 0, sizeof(violations));
+        for (int i = 0; i < 20 && voice >= 0; ++i) {
+            RealtimeCheckBegin();
+            mixer.Render(out, STREAM_TEST_CALLBACK_FRAMES, 2);
+            RealtimeCheckEnd(&violations);
+            for (int j = 0; j < 2 * STREAM_TEST_CALLBACK_FRAMES; ++j) {
+                loudest = fmaxf(loudest, fabsf(out[j]));
+            }
+        }
+        // a stop that doesn't fit in the queue leaves the stream to be closed later
+        int refusedStops = 0;
+        for (int i = 0; i < MIXER_QUEUE_SIZE; ++i) {
+            mixer.SetGain(voice, 1.0f);
+        }
+        while (!mixer.Stop(voice) && refusedStops < 2) {
+            ++refusedStops;
+            mixer.Render(out, STREAM_TEST_CALLBACK_FRAMES, 2);
+        }
+        if (refusedStops == 1) {
+            streamer.Close(stream);
+        }
+        // still held while it fades
+        const bool heldWhileFading = streamer.GetStats().closingStreams == 1;
+        for (int i = 0; i < 3; ++i) {
+            mixer.Render(out, STREAM_TEST_CALLBACK_FRAMES, 2);
+        }
+        int closing = 1;
+        for (int i = 0; i < 100 && closing > 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(SOUND_STREAMER_PERIOD_MS));
+            closing = streamer.GetStats().closingStreams;
+        }
+        printf("mixer: loudest %.3f, %d voices left, stop %s, stream %s, then %s; in "
+               "callbacks %llu allocations, %llu frees, %llu locks\n", loudest,
+               mixer.GetPlayingCount(),
+               refusedStops == 1 ? "refused while the queue was full" : "NOT REFUSED ONCE",
+               heldWhileFading ? "held while fading" : "let go early",
+               closing == 0 ? "freed" : "never freed",
+               (unsigned long long) violations.allocations, (unsigned long long) violations.frees,
+               (unsigned long long) violations.locks);
+        ok = voice >= 0 && loudest > 0.05f && refusedStops == 1 && heldWhileFading &&
+             closing == 0 && mixer.GetPlayingCount() == 0 && violations.allocations == 0 &&
+             violations.frees == 0 && violations.locks == 0 && ok;
+    }
+
+    const SoundStreamer::Stats stats = streamer.GetStats();
+    printf("streamer: %llu frames decoded in %.1f ms\n",
+           (unsigned long long) stats.decodedFrames, (double) stats.decodeNs / 1e6);
+    BinaryLog::Flush();
+    if (!ok) {
+        fprintf(stderr, "stream test: the track came out wrong or reading wasn't real-time "
+                        "safe\n");
+        return 1;
+    }
+    return 0;
+}
+
+static uint32_t _next_random(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+// Fills inputBuffer with a frame of random motion events as GameActivity would
+// batch them, and expected with the samples cooking them must give.
+static void _make_input_frame(uint32_t *seed, int64_t frameNs, android_input_buffer *inputBuffer,
+                              TouchBatch *expected) {
+    static const int kActions[] = {
+            AMOTION_EVENT_ACTION_DOWN, AMOTION_EVENT_ACTION_POINTER_DOWN,
+            AMOTION_EVENT_ACTION_MOVE, AMOTION_EVENT_ACTION_MOVE, AMOTION_EVENT_ACTION_MOVE,
+            AMOTION_EVENT_ACTION_POINTER_UP, AMOTION_EVENT_ACTION_UP,
+            AMOTION_EVENT_ACTION_CANCEL,
+    };
+    inputBuffer->motionEventsCount = 0;
+    inputBuffer->historicalSamplesCount = 0;
+    const int eventCount = 1 + (int) (_next_random(seed) % INPUT_TEST_MAX_EVENTS);
+    for (int e = 0; e < eventCount; ++e) {
+        GameActivityMotionEvent *motionEvent =
+                &inputBuffer->motionEvents[inputBuffer->motionEventsCount++];
+        memset(motionEvent, 0, sizeof(*motionEvent));
+        const int pointerCount =
+                1 + (int) (_next_random(seed) % GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT);
+        const int actionMasked = kActions[_next_random(seed) % (sizeof(kActions) / sizeof(int))];
+        const int actionIndex = (int) (_next_random(seed) % pointerCount);
+        const bool onScreen = _next_random(seed) % 8 != 0;
+        motionEvent->pointerCount = pointerCount;
+        motionEvent->action =
+                actionMasked | (actionIndex << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+        // a mouse, which the cooker keeps off screen
+        motionEvent->source = onScreen ? AINPUT_SOURCE_TOUCHSCREEN : 0x00002002;
+        motionEvent->eventTime = frameNs + (e + 1) * INPUT_TEST_FRAME_NS / (eventCount + 1);
+        for (int p = 0; p < pointerCount; ++p) {
+            motionEvent->pointers[p].id = 3 * p + (int) (_next_random(seed) % 3);
+            motionEvent->pointers[p].axisValues[AMOTION_EVENT_AXIS_X] =
+                    (float) (_next_random(seed) % 1920);
+            motionEvent->pointers[p].axisValues[AMOTION_EVENT_AXIS_Y] =
+                    (float) (_next_random(seed) % 1080);
+        }
+
+        // sample-major history, as much as still fits in the buffer
+        const int room = (int) (NATIVE_APP_GLUE_MAX_HISTORICAL_POINTER_SAMPLES -
+                                inputBuffer->historicalSamplesCount) / pointerCount;
+        int historySize = (int) (_next_random(seed) % (INPUT_TEST_MAX_HISTORY + 1));
+        historySize = historySize < room ? historySize : room;
+        motionEvent->historicalStart = (int) inputBuffer->historicalSamplesCount;
+        motionEvent->historicalCount = historySize * pointerCount;
+        for (int h = 0; h < historySize; ++h) {
+            const int64_t timeNs = motionEvent->eventTime - (historySize - h) * 1000000LL;
+            for (int p = 0; p < pointerCount; ++p) {
+                GameActivityHistoricalPointerAxes *sample =
+                        &inputBuffer->historicalAxisSamples[inputBuffer->historicalSamplesCount++];
+                sample->eventTime = timeNs;
+                sample->axisValues[AMOTION_EVENT_AXIS_X] = (float) (_next_random(seed) % 1920);
+                sample->axisValues[AMOTION_EVENT_AXIS_Y] = (float) (_next_random(seed) % 1080);
+                expected->Add(motionEvent->pointers[p].id,
+                              sample->axisValues[AMOTION_EVENT_AXIS_X],
+                              sample->axisValues[AMOTION_EVENT_AXIS_Y], timeNs,
+                              COOKED_EVENT_TYPE_POINTER_MOVE, onScreen);
+            }
+        }
+        if (historySize == 0 && _next_random(seed) % 8 == 0) {
+            // history reaching past the buffer's is ignored
+            motionEvent->historicalStart = NATIVE_APP_GLUE_MAX_HISTORICAL_POINTER_SAMPLES;
+            motionEvent->historicalCount = pointerCount;
+        }
+
+        for (int p = 0; p < pointerCount; ++p) {
+            int phase = COOKED_EVENT_TYPE_POINTER_MOVE;
+            if (actionMasked == AMOTION_EVENT_ACTION_CANCEL ||
+                (p == actionIndex && actionMasked != AMOTION_EVENT_ACTION_MOVE)) {
+                phase = actionMasked == AMOTION_EVENT_ACTION_DOWN ||
+                        actionMasked == AMOTION_EVENT_ACTION_POINTER_DOWN ?
+                        COOKED_EVENT_TYPE_POINTER_DOWN : COOKED_EVENT_TYPE_POINTER_UP;
+            }
+            expected->Add(motionEvent->pointers[p].id,
+                          GameActivityPointerAxes_getX(&motionEvent->pointers[p]),
+                          GameActivityPointerAxes_getY(&motionEvent->pointers[p]),
+                          motionEvent->eventTime, phase, onScreen);
+        }
+    }
+}
+
+// the index of the first sample the batches disagree on, -1 if they are the same
+static int _compare_touch_batches(const TouchBatch &batch, const TouchBatch &expected) {
+    const int count = batch.count < expected.count ? batch.count : expected.count;
+    for (int i = 0; i < count; ++i) {
+        if (batch.pointerId[i] != expected.pointerId[i] || batch.x[i] != expected.x[i] ||
+            batch.y[i] != expected.y[i] || batch.timeNs[i] != expected.timeNs[i] ||
+            batch.phase[i] != expected.phase[i] ||
+            batch.isOnScreen[i] != expected.isOnScreen[i]) {
+            return i;
+        }
+    }
+    return batch.count == expected.count ? -1 : count;
+}
+
+static void _make_text_input(int frame, char *text, size_t size, GameTextInputState *state) {
+    snprintf(text, size, "tunnel %d", frame);
+    state->text_UTF8 = text;
+    state->text_length = (int32_t) strlen(text);
+    state->selection.start = state->selection.end = state->text_length;
+    state->composingRegion.start = state->composingRegion.end = -1;
+}
+
+static bool _check_replayed_text(int frame, const InputReplayText &replayed) {
+    if (frame % INPUT_TEST_TEXT_FRAMES != 0) {
+        return !replayed.present;
+    }
+    char text[32];
+    GameTextInputState state;
+    _make_text_input(frame, text, sizeof(text), &state);
+    return replayed.present && replayed.textLength == state.text_length &&
+           memcmp(replayed.text, text, state.text_length + 1) == 0 &&
+           replayed.selectionStart == state.selection.start &&
+           replayed.selectionEnd == state.selection.end &&
+           replayed.composingStart == state.composingRegion.start &&
+           replayed.composingEnd == state.composingRegion.end;
+}
+
+// records frames of random input with some text input, replays the recording and
+// checks every frame cooks to the same samples as the input that was recorded
+static bool _input_replay_test(int frames, android_input_buffer *inputBuffer, TouchBatch *batch,
+                               TouchBatch *expected) {
+    InputRecorder recorder;
+    if (!recorder.Open(INPUT_TEST_RECORDING)) {
+        BinaryLog::Flush();
+        return false;
+    }
+    uint32_t seed = 54321;
+    char text[32];
+    GameTextInputState state;
+    int64_t recordNs = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        expected->Clear();
+        _make_input_frame(&seed, frame * INPUT_TEST_FRAME_NS, inputBuffer, expected);
+        const int64_t startNs = Trace::NowNs();
+        recorder.RecordMotionEvents(inputBuffer);
+        if (frame % INPUT_TEST_TEXT_FRAMES == 0) {
+            _make_text_input(frame, text, sizeof(text), &state);
+            recorder.RecordTextInput(&state);
+        }
+        recorder.EndFrame(frame, frame * INPUT_TEST_FRAME_NS);
+        recordNs += Trace::NowNs() - startNs;
+    }
+    recorder.Close();
+
+    InputReplayer replayer;
+    const bool opened = replayer.Open(INPUT_TEST_RECORDING);
+    // the recorder's and replayer's messages go before the report
+    BinaryLog::Flush();
+    if (!opened) {
+        return false;
+    }
+    seed = 54321;
+    int64_t replayNs = 0;
+    int replayed = 0, wrong = 0;
+    while (true) {
+        InputRecordFrame record;
+        InputReplayText replayedText;
+        const int64_t startNs = Trace::NowNs();
+        const android_input_buffer *replayedBuffer = replayer.ReadFrame(&record, &replayedText);
+        if (replayedBuffer == NULL) {
+            break;
+        }
+        batch->Clear();
+        CookInputBuffer(replayedBuffer, batch);
+        replayNs += Trace::NowNs() - startNs;
+
+        const int frame = replayed++;
+        expected->Clear();
+        _make_input_frame(&seed, frame * INPUT_TEST_FRAME_NS, inputBuffer, expected);
+        if (record.frame != (uint64_t) frame || record.timeNs != frame * INPUT_TEST_FRAME_NS ||
+            _compare_touch_batches(*batch, *expected) >= 0 ||
+            !_check_replayed_text(frame, replayedText)) {
+            if (wrong++ < 5) {
+                fprintf(stderr, "input test: replayed frame %d differs from the recorded one\n",
+                        frame);
+            }
+        }
+    }
+
+    struct stat st;
+    const long long size = stat(INPUT_TEST_RECORDING, &st) == 0 ? (long long) st.st_size : 0;
+    printf("  record      %8.2f us/frame, %lld bytes\n", (double) recordNs / 1e3 / frames, size);
+    printf("  replay      %8.2f us/frame with cooking\n",
+           replayed > 0 ? (double) replayNs / 1e3 / replayed : 0.0);
+    printf("  round trip  %d of %d frames replayed, %d wrong%s\n", replayed, frames, wrong,
+           replayed == frames && wrong == 0 ? "" : "  WRONG");
+    return replayed == frames && wrong == 0;
+}
+
+static int _input_test(int frames) {
+    android_input_buffer *inputBuffer = new android_input_buffer;
+    memset(inputBuffer, 0, sizeof(*inputBuffer));
+    TouchBatch *batch = new TouchBatch;
+    TouchBatch *expected = new TouchBatch;
+    uint32_t seed = 12345;
+    int64_t samples = 0, events = 0, cookNs = 0;
+    int failures = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        expected->Clear();
+        _make_input_frame(&seed, frame * INPUT_TEST_FRAME_NS, inputBuffer, expected);
+        batch->Clear();
+        const int cooked = CookInputBuffer(inputBuffer, batch);
+        const int wrong = _compare_touch_batches(*batch, *expected);
+        if (wrong >= 0 || cooked != expected->count) {
+            if (failures++ < 5) {
+                fprintf(stderr, "input test: frame %d cooked %d samples, expected %d, "
+                                "first wrong sample %d\n", frame, cooked, expected->count, wrong);
+            }
+            continue;
+        }
+
+        const int64_t startNs = Trace::NowNs();
+        for (int repeat = 0; repeat < INPUT_TEST_COOK_REPEATS; ++repeat) {
+            batch->Clear();
+            CookInputBuffer(inputBuffer, batch);
+        }
+        cookNs += Trace::NowNs() - startNs;
+        samples += (int64_t) expected->count * INPUT_TEST_COOK_REPEATS;
+        events += (int64_t) inputBuffer->motionEventsCount * INPUT_TEST_COOK_REPEATS;
+    }
+
+    // a full batch counts what doesn't fit as dropped
+    expected->Clear();
+    _make_input_frame(&seed, frames * INPUT_TEST_FRAME_NS, inputBuffer, expected);
+    batch->Clear();
+    int offered = 0;
+    while (offered <= TOUCH_BATCH_CAPACITY) {
+        CookInputBuffer(inputBuffer, batch);
+        offered += expected->count;
+    }
+    const bool full = batch->count == TOUCH_BATCH_CAPACITY &&
+                      batch->dropped == offered - TOUCH_BATCH_CAPACITY;
+
+    printf("%d frames, %lld motion events, %lld samples cooked\n", frames,
+           (long long) events / INPUT_TEST_COOK_REPEATS,
+           (long long) samples / INPUT_TEST_COOK_REPEATS);
+    printf("  cook        %8.2f ns/sample  %8.2f ns/event\n",
+           samples > 0 ? (double) cookNs / (double) samples : 0.0,
+           events > 0 ? (double) cookNs / (double) events : 0.0);
+    printf("  wrong       %d frames\n", failures);
+    printf("  full batch  %d kept, %d dropped of %d%s\n", batch->count, batch->dropped, offered,
+           full ? "" : "  WRONG");
+    const bool replayed = _input_replay_test(frames, inputBuffer, batch, expected);
+    delete expected;
+    delete batch;
+    delete inputBuffer;
+    return failures == 0 && full && replayed ? 0 : 1;
+}
+
+// an item of the SPSC test, as large as a cooked event; words follow from the
+// sequence number so a torn or stale copy shows
+struct SpscTestItem {
+    uint64_t sequence;
+    uint64_t words[5];
+};
+
+static void _make_spsc_item(uint64_t sequence, SpscTestItem *item) {
+    item->sequence = sequence;
+    for (int i = 0; i < 5; ++i) {
+        item->words[i] = (sequence + 1) * 0x9e3779b97f4a7c15ull * (uint64_t) (i + 1);
+    }
+}
+
+static bool _check_spsc_item(const SpscTestItem &item, uint64_t sequence) {
+    SpscTestItem expected;
+    _make_spsc_item(sequence, &expected);
+    return memcmp(&item, &expected, sizeof(item)) == 0;
+}
+
+// from one thread: a full ring refuses items, a partial batch goes in, and
+// everything comes back out in order
+template<size_t Capacity>
+static bool _spsc_fill_test() {
+    SpscRing<SpscTestItem, Capacity> *ring = new SpscRing<SpscTestItem, Capacity>;
+    SpscTestItem items[Capacity + 1];
+    for (size_t i = 0; i < Capacity + 1; ++i) {
+        _make_spsc_item(i, &items[i]);
+    }
+    bool ok = ring->IsEmpty() && ring->Push(items[0]) &&
+              ring->PushMany(items + 1, Capacity) == Capacity - 1 && ring->Size() == Capacity &&
+              !ring->Push(items[Capacity]) && ring->PushMany(items, 1) == 0;
+    SpscTestItem item;
+    for (size_t i = 0; ok && i < Capacity / 2; ++i) {
+        ok = ring->Pop(&item) && _check_spsc_item(item, i);
+    }
+    SpscTestItem popped[Capacity];
+    ok = ok && ring->PopMany(popped, Capacity) == Capacity - Capacity / 2;
+    for (size_t i = 0; ok && i < Capacity - Capacity / 2; ++i) {
+        ok = _check_spsc_item(popped[i], Capacity / 2 + i);
+    }
+    ok = ok && ring->IsEmpty() && !ring->Pop(&item) && ring->PopMany(popped, Capacity) == 0;
+    delete ring;
+    return ok;
+}
+
+struct SpscTestRun {
+    int64_t elapsedNs;
+    // times the producer found the ring full and the consumer found it empty
+    int64_t fullSpins;
+    int64_t emptySpins;
+    // the first item that came out wrong, -1 if none did
+    int64_t wrongItem;
+};
+
+// passes itemCount items from a producer thread to this one; each side mixes single
+// items and batches of random sizes
+template<size_t Capacity>
+static SpscTestRun _spsc_run(int itemCount) {
+    SpscRing<SpscTestItem, Capacity> *ring = new SpscRing<SpscTestItem, Capacity>;
+    SpscTestRun run;
+    memset(&run, 0, sizeof(run));
+    run.wrongItem = -1;
+    std::atomic<int64_t> fullSpins(0);
+
+    const int64_t startNs = Trace::NowNs();
+    std::thread producer([ring, itemCount, &fullSpins]() {
+        uint32_t seed = 12345;
+        SpscTestItem batch[SPSC_TEST_MAX_BATCH];
+        int64_t spins = 0;
+        uint64_t next = 0;
+        while (next < (uint64_t) itemCount) {
+            const uint32_t random = _next_random(&seed);
+            size_t count = 1 + random % SPSC_TEST_MAX_BATCH;
+            count = count < itemCount - next ? count : itemCount - next;
+            size_t pushed;
+            if (random & 0x10000) {
+                SpscTestItem item;
+                _make_spsc_item(next, &item);
+                pushed = ring->Push(item) ? 1 : 0;
+            } else {
+                for (size_t i = 0; i < count; ++i) {
+                    _make_spsc_item(next + i, &batch[i]);
+                }
+                pushed = ring->PushMany(batch, count);
+            }
+            next += pushed;
+            if (pushed == 0) {
+                ++spins;
+                std::this_thread::yield();
+            }
+        }
+        fullSpins.store(spins, std::memory_order_relaxed);
+    });
+
+    uint32_t seed = 54321;
+    SpscTestItem batch[SPSC_TEST_MAX_BATCH];
+    uint64_t next = 0;
+    while (next < (uint64_t) itemCount) {
+        const uint32_t random = _next_random(&seed);
+        size_t popped;
+        if (random & 0x10000) {
+            popped = ring->Pop(&batch[0]) ? 1 : 0;
+        } else {
+            popped = ring->PopMany(batch, 1 + random % SPSC_TEST_MAX_BATCH);
+        }
+        for (size_t i = 0; i < popped; ++i) {
+            if (run.wrongItem < 0 && !_check_spsc_item(batch[i], next + i)) {
+                run.wrongItem = (int64_t) (next + i);
+            }
+        }
+        next += popped;
+        if (popped == 0) {
+            ++run.emptySpins;
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    run.elapsedNs = Trace::NowNs() - startNs;
+    run.fullSpins = fullSpins.load(std::memory_order_relaxed);
+    if (!ring->IsEmpty() && run.wrongItem < 0) {
+        // more came out than went in
+        run.wrongItem = itemCount;
+    }
+    delete ring;
+    return run;
+}
+
+static bool _spsc_report(const char *name, size_t capacity, int itemCount,
+                         const SpscTestRun &run) {
+    printf("  %-5s ring of %4zu  %6.2f ns/item, %lld full and %lld empty spins",
+           name, capacity, (double) run.elapsedNs / itemCount, (long long) run.fullSpins,
+           (long long) run.emptySpins);
+    if (run.wrongItem >= 0) {
+        printf("  WRONG item %lld\n", (long long) run.wrongItem);
+        return false;
+    }
+    printf("\n");
+    return true;
+}
+
+static int _spsc_test(int itemCount) {
+    const bool filled = _spsc_fill_test<SPSC_TEST_SMALL_CAPACITY>() &&
+                        _spsc_fill_test<SPSC_TEST_LARGE_CAPACITY>();
+    printf("%d items\n", itemCount);
+    printf("  fill and drain    %s\n", filled ? "in order" : "WRONG");
+
+    const SpscTestRun small = _spsc_run<SPSC_TEST_SMALL_CAPACITY>(itemCount);
+    const SpscTestRun large = _spsc_run<SPSC_TEST_LARGE_CAPACITY>(itemCount);
+    bool ok = _spsc_report("small", SPSC_TEST_SMALL_CAPACITY, itemCount, small);
+    ok = _spsc_report("large", SPSC_TEST_LARGE_CAPACITY, itemCount, large) && ok;
+    return filled && ok ? 0 : 1;
+}
+
+enum LogTestEnum {
+    LOG_TEST_ENUM_VALUE = 3,
+};
+
+// what the log test's sink was handed, from the formatter's thread
+static std::mutex sLogTestLock;
+static std::vector<std::string> sLogTestMessages;
+
+static void _log_test_sink(int, const char *, int64_t, const char *message) {
+    std::lock_guard<std::mutex> lock(sLogTestLock);
+    sLogTestMessages.push_back(message);
+}
+
+static void _null_log_sink(int, const char *, int64_t, const char *) {
+}
+
+// logs a message and adds what snprintf() makes of it to expected
+template<typename... Args>
+static void _log_case(std::vector<std::string> *expected, const char *fmt,
+                      const Args &... args) {
+    char message[BinaryLog::kMaxMessageLength];
+    snprintf(message, sizeof(message), fmt, args...);
+    expected->push_back(message);
+    BinaryLog::Write(LOG_LEVEL_INFO, "LogTest", fmt, args...);
+}
+
+static bool _log_round_trip() {
+    std::vector<std::string> expected;
+    int value = 7;
+    _log_case(&expected, "%d %u %ld %lld %zu", -5, 7u, -123456789L, 1LL << 40, (size_t) 99);
+    _log_case(&expected, "%.3f %g %e", 3.14159, 2.5f, -1e-7);
+    _log_case(&expected, "%c%c %x %08X %o %hhu", 'o', 'k', 255, 0xbeefu, 8, (uint8_t) 200);
+    _log_case(&expected, "%-8s|%5d|%d%%", "left", 42, 50);
+    _log_case(&expected, "%p %d", (void *) &value, LOG_TEST_ENUM_VALUE);
+    _log_case(&expected, "%s", "");
+
+    // strings are copied when logged, not when formatted
+    char buffer[16];
+    strcpy(buffer, "before");
+    _log_case(&expected, "copied %s", buffer);
+    strcpy(buffer, "after");
+
+    BinaryLog::Write(LOG_LEVEL_INFO, "LogTest", "missing %s", (const char *) NULL);
+    expected.push_back("missing (null)");
+
+    // strings are cut at their limit, and messages at theirs
+    const std::string longString(BinaryLog::kMaxStringArgLength + 50, 'x');
+    BinaryLog::Write(LOG_LEVEL_INFO, "LogTest", "long %s", longString.c_str());
+    expected.push_back("long " + longString.substr(0, BinaryLog::kMaxStringArgLength));
+    std::string longFormat(BinaryLog::kMaxMessageLength + 100, 'y');
+    _log_case(&expected, longFormat.c_str());
+
+    BinaryLog::Flush();
+    std::lock_guard<std::mutex> lock(sLogTestLock);
+    bool ok = sLogTestMessages.size() == expected.size();
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const bool same = i < sLogTestMessages.size() && sLogTestMessages[i] == expected[i];
+        if (!same) {
+            printf("  message %zu     \"%.60s\"  WRONG, expected \"%.60s\"\n", i,
+                   i < sLogTestMessages.size() ? sLogTestMessages[i].c_str() : "",
+                   expected[i].c_str());
+        }
+        ok = same && ok;
+    }
+    printf("  round trip    %zu of %zu messages as snprintf() formats them\n",
+           sLogTestMessages.size(), expected.size());
+    sLogTestMessages.clear();
+    return ok;
+}
+
+// threads that log and exit hand their rings on, so there is always one for the next
+static bool _log_thread_turnover() {
+    const uint64_t dropped = BinaryLog::GetDroppedCount();
+    for (int i = 0; i < LOG_TEST_THREADS; ++i) {
+        std::thread thread([i]() {
+            BinaryLog::Write(LOG_LEVEL_INFO, "LogTest", "thread %d", i);
+        });
+        thread.join();
+    }
+    BinaryLog::Flush();
+    std::lock_guard<std::mutex> lock(sLogTestLock);
+    bool ok = sLogTestMessages.size() == LOG_TEST_THREADS &&
+              BinaryLog::GetDroppedCount() == dropped;
+    for (size_t i = 0; ok && i < sLogTestMessages.size(); ++i) {
+        ok = sLogTestMessages[i] == "thread " + std::to_string(i);
+    }
+    printf("  threads       %zu of %d threads logged%s\n", sLogTestMessages.size(),
+           LOG_TEST_THREADS, ok ? "" : "  WRONG");
+    sLogTestMessages.clear();
+    return ok;
+}
+
+// the formatter sleeps through a quiet spell, and the next message wakes it
+static bool _log_idle() {
+    BinaryLog::Flush();
+    // let it finish with anything the engine logged and go to sleep
+    std::this_thread::sleep_for(std::chrono::milliseconds(LOG_TEST_IDLE_LATENCY_MS));
+    const uint64_t wakeups = BinaryLog::GetFormatterWakeups();
+    std::this_thread::sleep_for(std::chrono::milliseconds(LOG_TEST_IDLE_MS));
+    const uint64_t idleWakeups = BinaryLog::GetFormatterWakeups() - wakeups;
+
+    const int64_t startNs = Trace::NowNs();
+    BinaryLog::Write(LOG_LEVEL_INFO, "LogTest", "wake up");
+    bool formatted = false;
+    int64_t latencyNs = 0;
+    while (!formatted && latencyNs < LOG_TEST_IDLE_LATENCY_MS * 1000000LL) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> lock(sLogTestLock);
+        formatted = !sLogTestMessages.empty();
+        latencyNs = Trace::NowNs() - startNs;
+    }
+    std::lock_guard<std::mutex> lock(sLogTestLock);
+    const bool ok = idleWakeups <= LOG_TEST_IDLE_MAX_WAKEUPS && formatted &&
+                    sLogTestMessages[0] == "wake up";
+    printf("  idle          %llu wakeups in %d ms, then formatted after %.1f ms%s\n",
+           (unsigned long long) idleWakeups, LOG_TEST_IDLE_MS, (double) latencyNs / 1e6,
+           ok ? "" : "  WRONG");
+    sLogTestMessages.clear();
+    return ok;
+}
+
+static int _log_test(int messageCount) {
+    // the engine's messages so far go out as usual
+    BinaryLog::Flush();
+    printf("%d messages\n", messageCount);
+    BinaryLog::SetSink(_log_test_sink);
+    bool ok = _log_round_trip();
+    ok = _log_thread_turnover() && ok;
+    ok = _log_idle() && ok;
+
+    // a typical message, logged in batches a ring holds and flushed in between
+    BinaryLog::SetSink(_null_log_sink);
+    const uint64_t dropped = BinaryLog::GetDroppedCount();
+    const char *phase = "render";
+    int64_t logNs = 0, formatNs = 0;
+    for (int first = 0; first < messageCount; first += LOG_TEST_BATCH) {
+        const int last = first + LOG_TEST_BATCH < messageCount ? first + LOG_TEST_BATCH :
+                         messageCount;
+        int64_t startNs = Trace::NowNs();
+        for (int i = first; i < last; ++i) {
+            BinaryLog::Write(LOG_LEVEL_INFO, "LogTest", "frame %d: %s took %.2f ms", i, phase,
+                             (double) i * 0.001);
+        }
+        const int64_t nowNs = Trace::NowNs();
+        logNs += nowNs - startNs;
+        BinaryLog::Flush();
+        formatNs += Trace::NowNs() - nowNs;
+    }
+    const uint64_t droppedNow = BinaryLog::GetDroppedCount();
+
+    // what formatting on the calling thread used to cost
+    char message[BinaryLog::kMaxMessageLength];
+    int64_t startNs = Trace::NowNs();
+    for (int i = 0; i < messageCount; ++i) {
+        snprintf(message, sizeof(message), "frame %d: %s took %.2f ms", i, phase,
+                 (double) i * 0.001);
+    }
+    const int64_t snprintfNs = Trace::NowNs() - startNs;
+    BinaryLog::SetSink(BinaryLog::PlatformSink);
+
+    printf("  log call      %6.1f ns/message, %llu dropped\n", (double) logNs / messageCount,
+           (unsigned long long) (droppedNow - dropped));
+    printf("  formatting    %6.1f ns/message on the formatter\n",
+           (double) formatNs / messageCount);
+    printf("  snprintf()    %6.1f ns/message\n", (double) snprintfNs / messageCount);
+    return ok && droppedNow == dropped ? 0 : 1;
+}
+
+struct TimestepRun {
+    FixedTimestep::Stats stats;
+    // steps run or dropped against the time that went by, which must match
+    int64_t lostNs;
+    // how far the rendered state's pace was off the clock's, at worst
+    double worstPaceError;
+    bool alphaInRange;
+};
+
+// runs frameCount frames about periodNs apart and renders as the engine does;
+// with a stall, one frame takes stallNs longer
+static TimestepRun _timestep_run(int64_t periodNs, int frameCount, int64_t stallNs) {
+    FakeFrameClock clock;
+    FixedTimestep timestep(&clock, TIMESTEP_TEST_STEP_NS, TIMESTEP_TEST_MAX_STEPS);
+    SimState previous, current;
+    memset(&previous, 0, sizeof(previous));
+    current = previous;
+
+    TimestepRun run;
+    memset(&run, 0, sizeof(run));
+    run.alphaInRange = true;
+    uint32_t seed = 12345;
+    const int stallFrame = stallNs > 0 ? frameCount / 2 : -1;
+    double lastSimNs = 0.0;
+    int64_t elapsedNs = 0;
+    for (int frame = 0; frame < frameCount; ++frame) {
+        int64_t frameNs = 0;
+        if (frame > 0) {
+            const double jitter = TIMESTEP_TEST_JITTER *
+                                  ((double) (_next_random(&seed) % 2001) / 1000.0 - 1.0);
+            frameNs = (int64_t) ((double) periodNs * (1.0 + jitter));
+            frameNs += frame == stallFrame ? stallNs : 0;
+            clock.Advance(frameNs);
+            elapsedNs += frameNs;
+        }
+        const int steps = timestep.BeginFrame();
+        for (int i = 0; i < steps; ++i) {
+            previous = current;
+            UpdateSimState(&current, timestep.GetStepSeconds());
+        }
+        const float alpha = timestep.GetAlpha();
+        run.alphaInRange = run.alphaInRange && alpha >= 0.0f && alpha < 1.0f;
+
+        // the time of the state that is rendered, a step behind the clock, keeps
+        // pace with it except over the stall
+        const double simNs = ((double) previous.step + alpha) * TIMESTEP_TEST_STEP_NS;
+        if (frame > 0 && frame != stallFrame) {
+            const double error = fabs((simNs - lastSimNs) / (double) frameNs - 1.0);
+            run.worstPaceError = error > run.worstPaceError ? error : run.worstPaceError;
+        }
+        lastSimNs = simNs;
+    }
+
+    // the first frame runs a step of its own, what is left of the time waits in
+    // the accumulator
+    run.stats = timestep.GetStats();
+    const int64_t accountedNs =
+            (int64_t) (run.stats.steps + run.stats.droppedSteps) * TIMESTEP_TEST_STEP_NS +
+            llround((double) timestep.GetAlpha() * TIMESTEP_TEST_STEP_NS);
+    run.lostNs = TIMESTEP_TEST_STEP_NS + elapsedNs - accountedNs;
+    return run;
+}
+
+static int _timestep_test(int frameCount) {
+    static const int kRates[] = {30, 50, 60, 90, 120, 144};
+    bool ok = true;
+    printf("%d frames at each rate\n", frameCount);
+    for (int rate : kRates) {
+        const TimestepRun run = _timestep_run(1000000000LL / rate, frameCount, 0);
+        // a few ns go to the float alpha
+        const bool kept = llabs(run.lostNs) < 1000 && run.stats.droppedSteps == 0;
+        const bool steady = run.worstPaceError < TIMESTEP_TEST_MAX_PACE_ERROR;
+        // frames never more than a step long run no step now and then, frames never
+        // shorter run more than one
+        const bool shaped = (rate <= 60 || run.stats.extraSteps == 0) &&
+                            (rate >= 60 || run.stats.idleFrames == 0);
+        printf("  %3d Hz  %7llu steps, %6llu idle frames, %6llu extra steps, "
+               "pace off by %.5f%%%s\n", rate, (unsigned long long) run.stats.steps,
+               (unsigned long long) run.stats.idleFrames,
+               (unsigned long long) run.stats.extraSteps, run.worstPaceError * 100.0,
+               kept && steady && shaped && run.alphaInRange ? "" : "  WRONG");
+        ok = kept && steady && shaped && run.alphaInRange && ok;
+    }
+
+    // a one second stall runs the most steps a frame may and drops the rest
+    const int64_t stallNs = 1000000000LL;
+    const TimestepRun stalled = _timestep_run(1000000000LL / 60, frameCount < 2 ? 2 : frameCount,
+                                              stallNs);
+    // the stalled frame itself and the time left over from the frame before it may
+    // add up to two steps
+    const uint64_t leastDropped = stallNs / TIMESTEP_TEST_STEP_NS - TIMESTEP_TEST_MAX_STEPS;
+    const bool dropped = llabs(stalled.lostNs) < 1000 &&
+                         stalled.stats.droppedSteps >= leastDropped &&
+                         stalled.stats.droppedSteps <= leastDropped + 2;
+    printf("  stall   %llu steps dropped, %lld ns lost%s\n",
+           (unsigned long long) stalled.stats.droppedSteps, (long long) stalled.lostNs,
+           dropped ? "" : "  WRONG");
+
+    // time spent paused is forgotten
+    FakeFrameClock clock;
+    FixedTimestep timestep(&clock, TIMESTEP_TEST_STEP_NS, TIMESTEP_TEST_MAX_STEPS);
+    timestep.BeginFrame();
+    clock.Advance(TIMESTEP_TEST_STEP_NS / 2);
+    timestep.BeginFrame();
+    timestep.Reset();
+    clock.Advance(10 * stallNs);
+    const bool forgotten = timestep.BeginFrame() == 1 && timestep.GetAlpha() == 0.0f &&
+                           timestep.GetStats().droppedSteps == 0;
+    printf("  pause   %s\n", forgotten ? "forgotten" : "CAUGHT UP");
+    return ok && dropped && forgotten ? 0 : 1;
+}
+
+struct JobTestShared {
+    std::atomic<int> groupDone;
+    std::atomic<int> early;
+    std::vector<std::atomic<int>> runs;
+    std::vector<uint32_t> results;
+};
+
+struct JobTestJob {
+    JobTestShared *shared;
+    int index;
+};
+
+static void _job_test_group(void *data) {
+    JobTestShared *shared = (JobTestShared *) data;
+    shared->groupDone.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void _job_test_flood(void *data) {
+    JobTestJob *job = (JobTestJob *) data;
+    job->shared->runs[job->index].fetch_add(1, std::memory_order_relaxed);
+}
+
+static void _job_test_dependent(void *data) {
+    JobTestJob *job = (JobTestJob *) data;
+    if (job->shared->groupDone.load(std::memory_order_relaxed) != JOB_TEST_GROUP_JOBS) {
+        job->shared->early.fetch_add(1, std::memory_order_relaxed);
+    }
+    job->shared->runs[job->index].fetch_add(1, std::memory_order_relaxed);
+}
+
+static void _job_test_items(void *data, int begin, int end) {
+    JobTestShared *shared = (JobTestShared *) data;
+    for (int i = begin; i < end; ++i) {
+        uint32_t value = (uint32_t) i;
+        for (int round = 0; round < JOB_TEST_ITEM_ROUNDS; ++round) {
+            value = value * 1664525u + 1013904223u;
+        }
+        shared->results[i] = value;
+    }
+}
+
+// submits more jobs than a queue holds, half of them waiting on a group submitted
+// first, and checks each ran once and none before the group was done
+static bool _job_flood(int workerCount) {
+    JobSystem jobs(workerCount, JOB_CORES_ANY);
+    JobTestShared shared;
+    shared.groupDone = 0;
+    shared.early = 0;
+    shared.runs = std::vector<std::atomic<int>>(JOB_TEST_FLOOD_JOBS);
+    std::vector<JobTestJob> flood(JOB_TEST_FLOOD_JOBS);
+
+    JobCounter group(0), done(0);
+    for (int i = 0; i < JOB_TEST_GROUP_JOBS; ++i) {
+        jobs.Submit(_job_test_group, &shared, &group);
+    }
+    for (int i = 0; i < JOB_TEST_FLOOD_JOBS; ++i) {
+        flood[i].shared = &shared;
+        flood[i].index = i;
+        if (i % 2 == 0) {
+            jobs.Submit(_job_test_dependent, &flood[i], &done, &group);
+        } else {
+            jobs.Submit(_job_test_flood, &flood[i], &done);
+        }
+    }
+    jobs.Wait(&done);
+    jobs.Wait(&group);
+
+    int wrongRuns = 0;
+    for (int i = 0; i < JOB_TEST_FLOOD_JOBS; ++i) {
+        wrongRuns += shared.runs[i].load() != 1 ? 1 : 0;
+    }
+    const bool ok = wrongRuns == 0 && shared.early.load() == 0;
+    BinaryLog::Flush();
+    printf("  flood, %d workers   %d jobs, %d didn't run once, %d ran early%s\n", workerCount,
+           JOB_TEST_FLOOD_JOBS, wrongRuns, shared.early.load(), ok ? "" : "  WRONG");
+    return ok;
+}
+
+static int64_t _job_scaling_run(int workerCount, int itemCount, JobTestShared *shared) {
+    JobSystem jobs(workerCount, JOB_CORES_ANY);
+    const int64_t startNs = Trace::NowNs();
+    JobCounter done(0);
+    jobs.ParallelFor(itemCount, JOB_TEST_BATCH, _job_test_items, shared, &done);
+    jobs.Wait(&done);
+    return Trace::NowNs() - startNs;
+}
+
+// a CPU as the job system sees it: each core's maximum frequency in kHz
+struct CoreLayout {
+    const char *name;
+    std::vector<long> frequencies;
+    std::vector<int> big;
+    std::vector<int> little;
+};
+
+static bool _job_cores_test() {
+    const CoreLayout layouts[] = {
+            {"tri-cluster", {1800000, 1800000, 1800000, 1800000, 2400000, 2400000, 2400000,
+                             3000000}, {4, 5, 6, 7}, {0, 1, 2, 3}},
+            {"big.LITTLE", {1800000, 1800000, 1800000, 1800000, 2400000, 2400000, 2400000,
+                            2400000}, {4, 5, 6, 7}, {0, 1, 2, 3}},
+            {"one fast core", {1800000, 1800000, 1800000, 2800000}, {0, 1, 2, 3}, {0, 1, 2}},
+            {"homogeneous", {2000000, 2000000, 2000000, 2000000}, {0, 1, 2, 3}, {0, 1, 2, 3}},
+            {"unknown", {0, 0}, {0, 1}, {0, 1}},
+    };
+    bool ok = true;
+    for (const CoreLayout &layout : layouts) {
+        std::vector<int> big, little;
+        JobSystem::GetCores(JOB_CORES_BIG, layout.frequencies, &big);
+        JobSystem::GetCores(JOB_CORES_LITTLE, layout.frequencies, &little);
+        const bool right = big == layout.big && little == layout.little;
+        printf("  %-19s %zu cores, %zu big, %zu little%s\n", layout.name,
+               layout.frequencies.size(), big.size(), little.size(), right ? "" : "  WRONG");
+        ok = right && ok;
+    }
+    return ok;
+}
+
+static int _job_test(int itemCount) {
+    const int cores = (int) std::thread::hardware_concurrency();
+    printf("%d items, %d cores\n", itemCount, cores);
+    bool ok = _job_flood(1);
+    ok = _job_flood(4) && ok;
+    ok = _job_cores_test() && ok;
+
+    // the same work with more and more workers
+    JobTestShared shared;
+    shared.results.resize(itemCount);
+    std::vector<uint32_t> expected;
+    int64_t oneWorkerNs = 0;
+    const int workerCounts[] = {1, 2, 4, cores};
+    for (int i = 0; i < 4; ++i) {
+        const int workerCount = workerCounts[i];
+        if (workerCount < 1 || (i == 3 && workerCount <= 4)) {
+            continue;
+        }
+        std::fill(shared.results.begin(), shared.results.end(), 0);
+        const int64_t elapsedNs = _job_scaling_run(workerCount, itemCount, &shared);
+        bool same = true;
+        if (expected.empty()) {
+            expected = shared.results;
+            oneWorkerNs = elapsedNs;
+        } else {
+            same = shared.results == expected;
+        }
+        BinaryLog::Flush();
+        printf("  %2d workers          %8.2f ms, %.2fx one worker%s\n", workerCount,
+               (double) elapsedNs / 1e6, (double) oneWorkerNs / (double) elapsedNs,
+               same ? "" : "  WRONG RESULTS");
+        ok = same && ok;
+    }
+    return ok ? 0 : 1;
+}
+
+struct SchedulerRun {
+    FrameScheduler::Stats stats;
+    // vsyncs that went by without a new frame
+    uint64_t missedVsyncs;
+    uint64_t spikes;
+    // from starting a frame to the vsync that shows it
+    int64_t averageLatencyNs;
+};
+
+// Runs frameCount frames of costNs, give or take the jitter, against a vsync every
+// periodNs. Presenting returns at the vsync that shows the frame, one frame per
+// vsync. The loop waits as the engine does, in whole milliseconds; when polling,
+// a frame starts as soon as the last present returns.
+static SchedulerRun _scheduler_run(int64_t periodNs, int64_t costNs, int frameCount, bool poll,
+                                   bool spiky) {
+    FakeFrameClock clock;
+    FrameScheduler scheduler(&clock);
+    scheduler.SetPresentPeriod(periodNs);
+
+    SchedulerRun run;
+    memset(&run, 0, sizeof(run));
+    uint32_t seed = 777;
+    int64_t lastVsync = -1;
+    int64_t latencyNs = 0;
+    for (int frame = 0; frame < frameCount; ++frame) {
+        int waitMs;
+        while (!poll && (waitMs = scheduler.GetWaitMs()) > 0) {
+            clock.Advance(waitMs * 1000000LL);
+        }
+        scheduler.BeginFrame();
+        const int64_t startNs = clock.NowNs();
+
+        const double jitter = SCHEDULER_TEST_JITTER *
+                              ((double) (_next_random(&seed) % 2001) / 1000.0 - 1.0);
+        int64_t frameCostNs = (int64_t) ((double) costNs * (1.0 + jitter));
+        if (spiky && frame % SCHEDULER_TEST_SPIKE_FRAMES == SCHEDULER_TEST_SPIKE_FRAMES - 1) {
+            frameCostNs *= 2;
+            ++run.spikes;
+        }
+        clock.Advance(frameCostNs);
+        scheduler.BeginPresent();
+
+        int64_t vsync = (clock.NowNs() + periodNs - 1) / periodNs;
+        vsync = vsync > lastVsync ? vsync : lastVsync + 1;
+        if (lastVsync >= 0) {
+            run.missedVsyncs += vsync - lastVsync - 1;
+        }
+        lastVsync = vsync;
+        clock.Set(vsync * periodNs);
+        scheduler.EndFrame();
+        latencyNs += clock.NowNs() - startNs;
+    }
+    run.stats = scheduler.GetStats();
+    run.averageLatencyNs = latencyNs / frameCount;
+    return run;
+}
+
+static int _scheduler_test(int frameCount) {
+    static const int kRates[] = {60, 90, 120};
+    static const double kLoads[] = {0.25, 0.6};
+    bool ok = true;
+    printf("%d frames per run\n", frameCount);
+    for (int rate : kRates) {
+        const int64_t periodNs = 1000000000LL / rate;
+        for (double load : kLoads) {
+            const int64_t costNs = (int64_t) ((double) periodNs * load);
+            const SchedulerRun paced = _scheduler_run(periodNs, costNs, frameCount, false, false);
+            const SchedulerRun polled = _scheduler_run(periodNs, costNs, frameCount, true, false);
+            // heavy frames at high rates leave no whole millisecond to wait
+            const bool sooner = paced.averageLatencyNs < polled.averageLatencyNs ||
+                                (paced.averageLatencyNs == polled.averageLatencyNs &&
+                                 (load > 0.5 || frameCount < 2));
+            const bool right = paced.missedVsyncs == 0 && paced.stats.missedDeadlines == 0 &&
+                               sooner;
+            printf("  %3d Hz, %2.0f%% load  latency %6.2f ms, %6.2f ms polling, "
+                   "%llu vsyncs missed%s\n", rate, load * 100.0,
+                   (double) paced.averageLatencyNs / 1e6,
+                   (double) polled.averageLatencyNs / 1e6,
+                   (unsigned long long) paced.missedVsyncs, right ? "" : "  WRONG");
+            ok = right && ok;
+        }
+    }
+
+    // a frame costing twice the estimate can miss its vsync, but the estimate jumps
+    // up at once, so the frames after it don't
+    const int64_t periodNs = 1000000000LL / 60;
+    const SchedulerRun spiky = _scheduler_run(periodNs, periodNs / 4, frameCount, false, true);
+    const bool absorbed = spiky.missedVsyncs <= spiky.spikes &&
+                          spiky.stats.missedDeadlines == spiky.missedVsyncs;
+    printf("  spikes  %llu of %llu missed their vsync, latency %.2f ms%s\n",
+           (unsigned long long) spiky.missedVsyncs, (unsigned long long) spiky.spikes,
+           (double) spiky.averageLatencyNs / 1e6, absorbed ? "" : "  WRONG");
+
+    // without a present period there is nothing to wait for
+    FakeFrameClock clock;
+    FrameScheduler unpaced(&clock);
+    unpaced.BeginFrame();
+    clock.Advance(periodNs / 4);
+    unpaced.BeginPresent();
+    unpaced.EndFrame();
+    const bool noWait = unpaced.GetWaitNs() == 0;
+    printf("  unpaced %s\n", noWait ? "never waits" : "WAITS");
+    return ok && absorbed && noWait ? 0 : 1;
+}
+
+// what a thread-safe arena's fast path would cost: a compare-and-swap per allocation
+struct AtomicBumpArena {
+    uint8_t *data;
+    size_t size;
+    std::atomic<size_t> offset;
+
+    void *Allocate(size_t bytes, size_t alignment) {
+        size_t current = offset.load(std::memory_order_relaxed);
+        size_t start;
+        do {
+            start = (current + alignment - 1) & ~(alignment - 1);
+            if (start + bytes > size) {
+                return NULL;
+            }
+        } while (!offset.compare_exchange_weak(current, start + bytes,
+                                               std::memory_order_relaxed));
+        return data + start;
+    }
+};
+
+static int _arena_bench(int frameCount) {
+    std::vector<uint16_t> sizes(ARENA_BENCH_ALLOCATIONS);
+    uint32_t seed = 4242;
+    for (uint16_t &size : sizes) {
+        size = (uint16_t) (ARENA_BENCH_MIN_SIZE +
+                           _next_random(&seed) % (ARENA_BENCH_MAX_SIZE - ARENA_BENCH_MIN_SIZE + 1));
+    }
+    const size_t alignment = alignof(std::max_align_t);
+    std::vector<void *> blocks(ARENA_BENCH_ALLOCATIONS);
+    // the last block of each frame is kept, so no loop can be left out
+    volatile uintptr_t sink = 0;
+
+    // every block is written to, so each way pays for touching its memory
+    FrameArena arena(ARENA_BENCH_BUFFER_SIZE);
+    bool laidOut = true;
+    int64_t startNs = Trace::NowNs();
+    for (int frame = 0; frame < frameCount; ++frame) {
+        for (int i = 0; i < ARENA_BENCH_ALLOCATIONS; ++i) {
+            uint8_t *block = (uint8_t *) arena.Allocate(sizes[i]);
+            block[0] = (uint8_t) i;
+            blocks[i] = block;
+        }
+        if (frame == 0) {
+            // in order, aligned and apart
+            for (int i = 0; i < ARENA_BENCH_ALLOCATIONS; ++i) {
+                const uintptr_t address = (uintptr_t) blocks[i];
+                laidOut = laidOut && address % alignment == 0 &&
+                          (i == 0 || address >= (uintptr_t) blocks[i - 1] + sizes[i - 1]);
+            }
+        }
+        sink = sink + (uintptr_t) blocks[ARENA_BENCH_ALLOCATIONS - 1];
+        arena.EndFrame();
+    }
+    const int64_t arenaNs = Trace::NowNs() - startNs;
+
+    AtomicBumpArena atomicArena;
+    atomicArena.data = (uint8_t *) aligned_alloc(64, ARENA_BENCH_BUFFER_SIZE);
+    atomicArena.size = ARENA_BENCH_BUFFER_SIZE;
+    startNs = Trace::NowNs();
+    for (int frame = 0; frame < frameCount; ++frame) {
+        atomicArena.offset.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < ARENA_BENCH_ALLOCATIONS; ++i) {
+            uint8_t *block = (uint8_t *) atomicArena.Allocate(sizes[i], alignment);
+            block[0] = (uint8_t) i;
+            blocks[i] = block;
+        }
+        sink = sink + (uintptr_t) blocks[ARENA_BENCH_ALLOCATIONS - 1];
+    }
+    const int64_t atomicNs = Trace::NowNs() - startNs;
+    free(atomicArena.data);
+
+    startNs = Trace::NowNs();
+    for (int frame = 0; frame < frameCount; ++frame) {
+        for (int i = 0; i < ARENA_BENCH_ALLOCATIONS; ++i) {
+            uint8_t *block = (uint8_t *) malloc(sizes[i]);
+            block[0] = (uint8_t) i;
+            blocks[i] = block;
+        }
+        sink = sink + (uintptr_t) blocks[ARENA_BENCH_ALLOCATIONS - 1];
+        for (int i = 0; i < ARENA_BENCH_ALLOCATIONS; ++i) {
+            free(blocks[i]);
+        }
+    }
+    const int64_t mallocNs = Trace::NowNs() - startNs;
+
+    const FrameArena::Stats &stats = arena.GetStats();
+    const double allocations = (double) frameCount * ARENA_BENCH_ALLOCATIONS;
+    const bool ok = laidOut && stats.overflowAllocations == 0;
+    printf("%d frames of %d allocations of %d-%d bytes, %zu bytes a frame\n", frameCount,
+           ARENA_BENCH_ALLOCATIONS, ARENA_BENCH_MIN_SIZE, ARENA_BENCH_MAX_SIZE, stats.highWater);
+    printf("  arena         %6.1f ns/allocation\n", (double) arenaNs / allocations);
+    printf("  atomic arena  %6.1f ns/allocation\n", (double) atomicNs / allocations);
+    printf("  malloc+free   %6.1f ns/allocation\n", (double) mallocNs / allocations);
+    printf("  %llu overflowed, blocks %s\n", (unsigned long long) stats.overflowAllocations,
+           laidOut ? "aligned and apart" : "MISPLACED");
+    return ok ? 0 : 1;
+}
+
+// the exported scopes of the trace test's names
+struct TraceTestCounts {
+    int turnoverScopes;
+    int realtimeScopes;
+};
+
+static int _count_matches(const std::string &text, const char *pattern) {
+    int count = 0;
+    for (size_t at = text.find(pattern); at != std::string::npos;
+         at = text.find(pattern, at + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+static bool _count_trace(TraceTestCounts *counts) {
+    FILE *file = tmpfile();
+    if (file == NULL || !Trace::WriteJson(file, 0, UINT64_MAX)) {
+        if (file != NULL) {
+            fclose(file);
+        }
+        return false;
+    }
+    std::string text;
+    rewind(file);
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, read);
+    }
+    fclose(file);
+    counts->turnoverScopes = _count_matches(text, "\"name\":\"TraceTestTurnover\",\"cat\"");
+    counts->realtimeScopes = _count_matches(text, "\"name\":\"TraceTestRealtime\",\"cat\"");
+    return true;
+}
+
+static int _trace_test(int threadCount) {
+    Trace::Start();
+
+    // more threads than rings, each done before the next starts
+    for (int i = 0; i < threadCount; ++i) {
+        std::thread([]() {
+            TRACE_SCOPE("TraceTestTurnover");
+        }).join();
+    }
+    TraceTestCounts turnover;
+    bool ok = _count_trace(&turnover);
+    const int ringCount = Trace::GetRingCount();
+    ok = ok && turnover.turnoverScopes == threadCount;
+    printf("%d threads, %d scopes exported from %d rings%s\n", threadCount,
+           turnover.turnoverScopes, ringCount, ok ? "" : "  WRONG");
+
+    std::thread([]() {
+        Trace::SetThreadRealtime("TraceTestRealtime");
+        TRACE_SCOPE("TraceTestRealtime");
+    }).join();
+    TraceTestCounts realtime;
+    const bool setAside = _count_trace(&realtime) && realtime.realtimeScopes == 1 &&
+                          Trace::GetRingCount() == ringCount;
+    printf("  realtime thread  %d scope, %d rings%s\n", realtime.realtimeScopes,
+           Trace::GetRingCount(), setAside ? "" : "  WRONG");
+
+    // this thread's ring is taken by the first scope, before the clock starts
+    {
+        TRACE_SCOPE("TraceTestCost");
+    }
+    int64_t startNs = Trace::NowNs();
+    for (int i = 0; i < TRACE_TEST_SCOPES; ++i) {
+        TRACE_SCOPE("TraceTestCost");
+    }
+    const int64_t tracingNs = Trace::NowNs() - startNs;
+    Trace::Stop();
+    startNs = Trace::NowNs();
+    for (int i = 0; i < TRACE_TEST_SCOPES; ++i) {
+        TRACE_SCOPE("TraceTestCost");
+    }
+    const int64_t stoppedNs = Trace::NowNs() - startNs;
+    BinaryLog::Flush();
+    printf("  scope            %.1f ns tracing, %.1f ns stopped\n",
+           (double) tracingNs / TRACE_TEST_SCOPES, (double) stoppedNs / TRACE_TEST_SCOPES);
+    return ok && setAside ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    long frames = HEADLESS_DEFAULT_FRAMES;
+    int touchPointers = 0;
+    const char *tracePath = NULL;
+    long traceFrames = HEADLESS_DEFAULT_TRACE_FRAMES;
+    int renderBenchCommands = 0;
+    int tunnelBenchSections = 0;
+    int fidelityFeedFrames = 0;
+    int resolutionFeedFrames = 0;
+    int cullBenchObjects = 0;
+    const char *pipelineDir = HEADLESS_DEFAULT_PIPELINE_DIR;
+    const char *pipelineTestDir = NULL;
+    int assetBenchAssets = 0;
+    const char *assetPack = NULL;
+    int contextLossFrames = 0;
+    int resourceBenchResources = 0;
+    int snapshotTestFrames = 0;
+    int startupTestTasks = 0;
+    int oscillatorBenchSeconds = 0;
+    int mixerTestCallbacks = 0;
+    int latencyTestSeconds = 0;
+    int streamTestSeconds = 0;
+    int inputTestFrames = 0;
+    int spscTestItems = 0;
+    int logTestMessages = 0;
+    int timestepTestFrames = 0;
+    int jobTestItems = 0;
+    int schedulerTestFrames = 0;
+    int arenaBenchFrames = 0;
+    int traceTestThreads = 0;
+    for (int i = 1; i < argc; ++i) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            _usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--frames") == 0) {
+            frames = atol(value);
+        } else if (strcmp(argv[i], "--touches") == 0) {
+            touchPointers = atoi(value);
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            tracePath = value;
+        } else if (strcmp(argv[i], "--trace-frames") == 0) {
+            traceFrames = atol(value);
+        } else if (strcmp(argv[i], "--render-bench") == 0) {
+            renderBenchCommands = atoi(value);
+            if (renderBenchCommands <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--tunnel-bench") == 0) {
+            tunnelBenchSections = atoi(value);
+            if (tunnelBenchSections <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--fidelity-feed") == 0) {
+            fidelityFeedFrames = atoi(value);
+            if (fidelityFeedFrames <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--resolution-feed") == 0) {
+            resolutionFeedFrames = atoi(value);
+            if (resolutionFeedFrames <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--cull-bench") == 0) {
+            cullBenchObjects = atoi(value);
+            if (cullBenchObjects <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pipeline-dir") == 0) {
+            pipelineDir = value;
+        } else if (strcmp(argv[i], "--pipeline-test") == 0) {
+            pipelineTestDir = value;
+        } else if (strcmp(argv[i], "--asset-bench") == 0) {
+            assetBenchAssets = atoi(value);
+            if (assetBenchAssets <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--asset-pack") == 0) {
+            assetPack = value;
+        } else if (strcmp(argv[i], "--context-loss") == 0) {
+            contextLossFrames = atoi(value);
+            if (contextLossFrames <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--resource-bench") == 0) {
+            resourceBenchResources = atoi(value);
+            if (resourceBenchResources <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--snapshot-test") == 0) {
+            snapshotTestFrames = atoi(value);
+            if (snapshotTestFrames <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--startup-test") == 0) {
+            startupTestTasks = atoi(value);
+            if (startupTestTasks <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--oscillator-bench") == 0) {
+            oscillatorBenchSeconds = atoi(value);
+            if (oscillatorBenchSeconds <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--mixer-test") == 0) {
+            mixerTestCallbacks = atoi(value);
+            if (mixerTestCallbacks <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--latency-test") == 0) {
+            latencyTestSeconds = atoi(value);
+            if (latencyTestSeconds <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--stream-test") == 0) {
+            streamTestSeconds = atoi(value);
+            if (streamTestSeconds <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--input-test") == 0) {
+            inputTestFrames = atoi(value);
+            if (inputTestFrames <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--spsc-test") == 0) {
+            spscTestItems = atoi(value);
+            if (spscTestItems <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--log-test") == 0) {
+            logTestMessages = atoi(value);
+            if (logTestMessages <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--timestep-test") == 0) {
+            timestepTestFrames = atoi(value);
+            if (timestepTestFrames <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--job-test") == 0) {
+            jobTestItems = atoi(value);
+            if (jobTestItems <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--scheduler-test") == 0) {
+            schedulerTestFrames = atoi(value);
+            if (schedulerTestFrames <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--arena-bench") == 0) {
+            arenaBenchFrames = atoi(value);
+            if (arenaBenchFrames <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--trace-test") == 0) {
+            traceTestThreads = atoi(value);
+            if (traceTestThreads <= 0) {
+                _usage(argv[0]);
+                return 1;
+            }
+        } else {
+            _usage(argv[0]);
+            return 1;
+        }
+        ++i;
+    }
+    if (frames <= 0 || touchPointers < 0 || traceFrames <= 0) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    if (renderBenchCommands > 0) {
+        return _render_bench(renderBenchCommands);
+    }
+    if (tunnelBenchSections > 0) {
+        return _tunnel_bench(tunnelBenchSections);
+    }
+    if (fidelityFeedFrames > 0) {
+        return _fidelity_feed(fidelityFeedFrames);
+    }
+    if (resolutionFeedFrames > 0) {
+        return _resolution_feed(resolutionFeedFrames);
+    }
+    if (cullBenchObjects > 0) {
+        return _cull_bench(cullBenchObjects);
+    }
+    if (pipelineTestDir != NULL) {
+        return _pipeline_test(pipelineTestDir);
+    }
+    if (assetBenchAssets > 0) {
+        return _asset_bench(assetBenchAssets);
+    }
+    if (contextLossFrames > 0) {
+        return _context_loss_test(contextLossFrames);
+    }
+    if (resourceBenchResources > 0) {
+        return _resource_bench(resourceBenchResources);
+    }
+    if (snapshotTestFrames > 0) {
+        return _snapshot_test(snapshotTestFrames);
+    }
+    if (startupTestTasks > 0) {
+        return _startup_test(startupTestTasks);
+    }
+    if (oscillatorBenchSeconds > 0) {
+        return _oscillator_bench(oscillatorBenchSeconds);
+    }
+    if (mixerTestCallbacks > 0) {
+        return _mixer_test(mixerTestCallbacks);
+    }
+    if (latencyTestSeconds > 0) {
+        return _latency_test(latencyTestSeconds);
+    }
+    if (streamTestSeconds > 0) {
+        return _stream_test(streamTestSeconds);
+    }
+    if (inputTestFrames > 0) {
+        return _input_test(inputTestFrames);
+    }
+    if (spscTestItems > 0) {
+        return _spsc_test(spscTestItems);
+    }
+    if (logTestMessages > 0) {
+        return _log_test(logTestMessages);
+    }
+    if (timestepTestFrames > 0) {
+        return _timestep_test(timestepTestFrames);
+    }
+    if (jobTestItems > 0) {
+        return _job_test(jobTestItems);
+    }
+    if (schedulerTestFrames > 0) {
+        return _scheduler_test(schedulerTestFrames);
+    }
+    if (arenaBenchFrames > 0) {
+        return _arena_bench(arenaBenchFrames);
+    }
+    if (traceTestThreads > 0) {
+        return _trace_test(traceTestThreads);
+    }
+
+    if (tracePath != NULL) {
+        Trace::Start();
+    }
+
+    HeadlessPlatform *platform = new HeadlessPlatform(HEADLESS_SURFACE_WIDTH,
+                                                      HEADLESS_SURFACE_HEIGHT, pipelineDir);
+    platform->SetSyntheticTouches(touchPointers);
+    if (assetPack != NULL && !platform->OpenAssetPack(assetPack)) {
+        BinaryLog::Flush();
+        fprintf(stderr, "can't open asset pack %s\n", assetPack);
+        return 1;
+    }
+    platform->AddCommand(0, PLATFORM_CMD_INIT_WINDOW);
+    platform->AddCommand(0, PLATFORM_CMD_START);
+    platform->AddCommand(0, PLATFORM_CMD_RESUME);
+    platform->AddCommand(0, PLATFORM_CMD_GAINED_FOCUS);
+    platform->AddCommand(frames, PLATFORM_CMD_LOST_FOCUS);
+    platform->AddCommand(frames, PLATFORM_CMD_PAUSE);
+    platform->AddCommand(frames, PLATFORM_CMD_STOP);
+    platform->AddCommand(frames, PLATFORM_CMD_TERM_WINDOW);
+    platform->AddCommand(frames, PLATFORM_CMD_DESTROY);
+
+    NativeEngine *engine = new NativeEngine(platform);
+    const int64_t startNs = platform->GetClock()->NowNs();
+    engine->GameLoop();
+    const int64_t elapsedNs = platform->GetClock()->NowNs() - startNs;
+
+    if (tracePath != NULL) {
+        Trace::Stop();
+        Trace::WriteJsonFile(tracePath, frames > traceFrames ? frames - traceFrames : 0, frames - 1);
+    }
+
+    // let the engine's own messages out before the report
+    BinaryLog::Flush();
+
+    const FrameStats &stats = engine->GetFrameStats();
+    printf("%llu frames in %.3f s, %.1f fps\n", (unsigned long long) stats.frames,
+           (double) elapsedNs / 1e9,
+           elapsedNs > 0 ? (double) stats.frames * 1e9 / (double) elapsedNs : 0.0);
+    const FrameScheduler::Stats &schedulerStats = engine->GetSchedulerStats();
+    printf("  idle %.1f ms, busy %.1f ms\n", (double) schedulerStats.idleNs / 1e6,
+           (double) schedulerStats.busyNs / 1e6);
+    for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+        const FramePhaseStats &phaseStats = stats.phases[phase];
+        printf("  %-10s avg %8.2f us  max %8.2f us\n", FrameStats::GetPhaseName(phase),
+               phaseStats.count > 0 ? (double) phaseStats.totalNs / phaseStats.count / 1e3 : 0.0,
+               (double) phaseStats.maxNs / 1e3);
+    }
+
+    delete engine;
+    delete platform;
+    BinaryLog::Flush();
+    return 0;
+}
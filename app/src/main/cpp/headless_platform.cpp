@@ -0,0 +1,237 @@
+#include "headless_platform.hpp"
+#include <cmath>
+#include <cstring>
+#include "Log.h"
+#include "input_cooker.hpp"
+#include "input_types.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// radius of the circles synthetic pointers move on, as a fraction of the surface height
+#define HEADLESS_TOUCH_RADIUS 0.25f
+// frames a synthetic pointer takes to go once around its circle
+#define HEADLESS_TOUCH_PERIOD_FRAMES 120
+
+// threads decoding compressed assets
+#define HEADLESS_ASSET_LOADER_WORKERS 1
+
+HeadlessPlatform::HeadlessPlatform(int surfaceWidth, int surfaceHeight,
+                                   const std::string &pipelineDirectory)
+        : mPipelineCache(&mShaderCompiler, pipelineDirectory),
+          mRenderContext(&mContextLayer, &mGpuResources) {
+    mCommandCallback = NULL;
+    mCommandUserData = NULL;
+    mNextCommand = 0;
+    mDestroyRequested = false;
+    mNextContextError = 0;
+    mSurfaceWidth = surfaceWidth;
+    mSurfaceHeight = surfaceHeight;
+    mPresentedFrames = 0;
+    mSyntheticPointers = 0;
+    mInputFrame = 0;
+    mInputBuffer = new android_input_buffer;
+    memset(mInputBuffer, 0, sizeof(*mInputBuffer));
+    mAssetLoader = NULL;
+    mPerformanceReporter = &mNullPerformanceReporter;
+
+    // the programs go with a lost context, as they would on a device
+    GpuResourceRecipe pipelines = {"pipelines", GPU_RESOURCE_PRIORITY_DRAW, NULL,
+                                   [](void *data, bool) {
+                                       ((PipelineCache *) data)->ForgetPrograms();
+                                   }, &mPipelineCache};
+    mGpuResources.Register(pipelines);
+}
+
+HeadlessPlatform::~HeadlessPlatform() {
+    mRenderContext.KillDisplay();
+    delete mAssetLoader;
+    delete mInputBuffer;
+}
+
+bool HeadlessPlatform::OpenAssetPack(const char *path) {
+    delete mAssetLoader;
+    mAssetLoader = NULL;
+    if (!mAssetPack.Open(path)) {
+        return false;
+    }
+    mAssetLoader = new AssetLoader(&mAssetPack, HEADLESS_ASSET_LOADER_WORKERS);
+    return true;
+}
+
+void HeadlessPlatform::AddCommand(uint64_t frame, int32_t cmd) {
+    ScriptedCommand command = {frame, cmd};
+    mScript.push_back(command);
+}
+
+void HeadlessPlatform::AddContextError(uint64_t frame, int error) {
+    ScriptedCommand contextError = {frame, error};
+    mContextErrors.push_back(contextError);
+}
+
+void HeadlessPlatform::SetSavedState(const void *data, size_t size) {
+    mSavedState.assign((const uint8_t *) data, (const uint8_t *) data + size);
+}
+
+void HeadlessPlatform::SetSyntheticTouches(int pointerCount) {
+    const int maxPointers =
+            GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT * NATIVE_APP_GLUE_MAX_NUM_MOTION_EVENTS;
+    if (pointerCount > maxPointers) {
+        ALOGW("HeadlessPlatform: %d synthetic pointers don't fit in an input buffer, using %d",
+              pointerCount, maxPointers);
+        pointerCount = maxPointers;
+    }
+    mSyntheticPointers = pointerCount;
+}
+
+void HeadlessPlatform::SetCommandCallback(PlatformCommandCallback callback, void *userData) {
+    mCommandCallback = callback;
+    mCommandUserData = userData;
+}
+
+void HeadlessPlatform::DispatchCommand(int32_t cmd) {
+    if (cmd == PLATFORM_CMD_DESTROY) {
+        mDestroyRequested = true;
+    }
+    if (mCommandCallback != NULL) {
+        mCommandCallback(mCommandUserData, cmd);
+    }
+}
+
+bool HeadlessPlatform::PollEvent(int timeoutMs) {
+    if (mNextCommand < mScript.size()) {
+        const ScriptedCommand &command = mScript[mNextCommand];
+        // nothing presents while the engine blocks, so a blocking poll skips ahead
+        // to the next command instead of waiting for its frame
+        if (command.frame <= mPresentedFrames || timeoutMs != 0) {
+            ++mNextCommand;
+            DispatchCommand(command.cmd);
+            return true;
+        }
+        return false;
+    }
+
+    if (timeoutMs != 0) {
+        // the script is over and the engine would wait forever
+        mDestroyRequested = true;
+        return true;
+    }
+    return false;
+}
+
+bool HeadlessPlatform::IsDestroyRequested() {
+    return mDestroyRequested;
+}
+
+void HeadlessPlatform::PollInput(TouchBatch *batch) {
+    const int64_t nowNs = mClock.NowNs();
+    const float angleStep = 2.0f * (float) M_PI / HEADLESS_TOUCH_PERIOD_FRAMES;
+    const float radius = HEADLESS_TOUCH_RADIUS * (float) mSurfaceHeight;
+    mInputBuffer->motionEventsCount = 0;
+    mInputBuffer->historicalSamplesCount = 0;
+    for (int first = 0; first < mSyntheticPointers;
+         first += GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT) {
+        GameActivityMotionEvent *motionEvent =
+                &mInputBuffer->motionEvents[mInputBuffer->motionEventsCount++];
+        const int left = mSyntheticPointers - first;
+        motionEvent->action = AMOTION_EVENT_ACTION_MOVE;
+        motionEvent->source = AINPUT_SOURCE_TOUCHSCREEN;
+        motionEvent->eventTime = nowNs;
+        motionEvent->pointerCount = left < GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT ?
+                                    left : GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT;
+        for (uint32_t p = 0; p < motionEvent->pointerCount; ++p) {
+            const int i = first + (int) p;
+            const float angle = (float) (mInputFrame % HEADLESS_TOUCH_PERIOD_FRAMES) * angleStep +
+                                (float) i;
+            GameActivityPointerAxes *pointer = &motionEvent->pointers[p];
+            pointer->id = i;
+            pointer->axisValues[AMOTION_EVENT_AXIS_X] =
+                    0.5f * (float) mSurfaceWidth + radius * cosf(angle);
+            pointer->axisValues[AMOTION_EVENT_AXIS_Y] =
+                    0.5f * (float) mSurfaceHeight + radius * sinf(angle);
+        }
+    }
+    if (mInputBuffer->motionEventsCount != 0) {
+        CookInputBuffer(mInputBuffer, batch);
+    }
+    ++mInputFrame;
+}
+
+bool HeadlessPlatform::PollTextInputChanged() {
+    return false;
+}
+
+void HeadlessPlatform::GetTextInput(std::string *text) {
+    text->clear();
+}
+
+void HeadlessPlatform::SetTextInputVisible(bool) {
+}
+
+bool HeadlessPlatform::AttachWindow() {
+    return true;
+}
+
+bool HeadlessPlatform::PrepareToRender() {
+    return mRenderContext.Prepare();
+}
+
+void HeadlessPlatform::GetSurfaceSize(int *width, int *height) {
+    *width = mSurfaceWidth;
+    *height = mSurfaceHeight;
+}
+
+void HeadlessPlatform::BeginFrame(int, int) {
+}
+
+bool HeadlessPlatform::Present() {
+    while (mNextContextError < mContextErrors.size() &&
+           mContextErrors[mNextContextError].frame <= mPresentedFrames) {
+        mContextLayer.FailCall(FAKE_CONTEXT_SWAP, mContextErrors[mNextContextError++].cmd);
+    }
+    if (!mRenderContext.Present()) {
+        return false;
+    }
+    ++mPresentedFrames;
+    return true;
+}
+
+int64_t HeadlessPlatform::GetPresentPeriodNs() {
+    // the null presenter never blocks, frames run back to back
+    return 0;
+}
+
+void HeadlessPlatform::KillSurface() {
+    mRenderContext.KillSurface();
+}
+
+void HeadlessPlatform::UpdateWindowInsets() {
+}
+
+bool HeadlessPlatform::GetSavedState(const void **data, size_t *size) {
+    if (mSavedState.empty()) {
+        return false;
+    }
+    *data = mSavedState.data();
+    *size = mSavedState.size();
+    return true;
+}
+
+void HeadlessPlatform::SaveState(const void *data, size_t size) {
+    SetSavedState(data, size);
+}
+
+void HeadlessPlatform::OpenAudio() {
+}
+
+void HeadlessPlatform::StartAudio() {
+}
+
+void HeadlessPlatform::PauseAudio() {
+}
+
+void HeadlessPlatform::StopAudio() {
+}
+
+bool HeadlessPlatform::GetAudioStats(AudioStats *) {
+    return false;
+}
@@ -0,0 +1,172 @@
+#ifndef agdktunnel_headless_platform_hpp
+#define agdktunnel_headless_platform_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "asset_loader.hpp"
+#include "asset_pack.hpp"
+#include "gpu_resource_registry.hpp"
+#include "performance_reporter.hpp"
+#include "pipeline_cache.hpp"
+#include "platform.hpp"
+#include "render_backend.hpp"
+#include "render_context.hpp"
+
+struct android_input_buffer;
+
+/*
+ * Platform for running the engine on a host without a display. Lifecycle commands
+ * come from a script keyed on the number of presented frames, presenting only
+ * counts frames, and touch input can be synthesized every frame to load the
+ * input path; it is reported as GameActivity would and goes through the input
+ * cooker. Programs come from a fake compiler, their binaries are saved to
+ * pipelineDirectory. Assets load from a pack only once one is opened. The
+ * display, surface and context are fakes that can be made to fail. Saved
+ * state stays in memory, to be handed to the next platform.
+ */
+class HeadlessPlatform : public Platform {
+public:
+    HeadlessPlatform(int surfaceWidth, int surfaceHeight, const std::string &pipelineDirectory);
+
+    ~HeadlessPlatform() override;
+
+    // maps the pack and starts loading assets from it
+    bool OpenAssetPack(const char *path);
+
+    // delivers cmd once frame frames have been presented; commands run in the order added
+    void AddCommand(uint64_t frame, int32_t cmd);
+
+    // presenting fails with error (CONTEXT_ERROR_*) once frame frames have been presented
+    void AddContextError(uint64_t frame, int error);
+
+    // generates a touch sample for each of pointerCount pointers every frame, as
+    // move events of GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT pointers at most
+    void SetSyntheticTouches(int pointerCount);
+
+    // launches as if a previous process had saved this state
+    void SetSavedState(const void *data, size_t size);
+
+    // reports to reporter, which must outlive the platform, instead of to nobody
+    void SetPerformanceReporter(PerformanceReporter *reporter) {
+        mPerformanceReporter = reporter;
+    }
+
+    uint64_t GetPresentedFrames() const {
+        return mPresentedFrames;
+    }
+
+    void SetCommandCallback(PlatformCommandCallback callback, void *userData) override;
+    bool PollEvent(int timeoutMs) override;
+    bool IsDestroyRequested() override;
+
+    void PollInput(TouchBatch *batch) override;
+    bool PollTextInputChanged() override;
+    void GetTextInput(std::string *text) override;
+    void SetTextInputVisible(bool visible) override;
+
+    bool AttachWindow() override;
+    bool PrepareToRender() override;
+    void GetSurfaceSize(int *width, int *height) override;
+    void BeginFrame(int width, int height) override;
+
+    RenderBackend *GetRenderBackend() override {
+        return &mRenderBackend;
+    }
+
+    PipelineCache *GetPipelineCache() override {
+        return &mPipelineCache;
+    }
+
+    FakeShaderCompiler *GetShaderCompiler() {
+        return &mShaderCompiler;
+    }
+
+    AssetLoader *GetAssetLoader() override {
+        return mAssetLoader;
+    }
+
+    RenderContext *GetRenderContext() override {
+        return &mRenderContext;
+    }
+
+    FakeContextLayer *GetContextLayer() {
+        return &mContextLayer;
+    }
+
+    bool Present() override;
+    int64_t GetPresentPeriodNs() override;
+
+    int64_t GetGpuFrameNs() override {
+        return -1;
+    }
+    void KillSurface() override;
+    void UpdateWindowInsets() override;
+    bool GetSavedState(const void **data, size_t *size) override;
+    void SaveState(const void *data, size_t size) override;
+
+    FrameClock *GetClock() override {
+        return &mClock;
+    }
+
+    PerformanceReporter *GetPerformanceReporter() override {
+        return mPerformanceReporter;
+    }
+
+    AudioMixer *GetAudioMixer() override {
+        return NULL;
+    }
+
+    SoundStreamer *GetSoundStreamer() override {
+        return NULL;
+    }
+
+    void OpenAudio() override;
+    void StartAudio() override;
+    void PauseAudio() override;
+    void StopAudio() override;
+    bool GetAudioStats(AudioStats *stats) override;
+
+private:
+    struct ScriptedCommand {
+        uint64_t frame;
+        int32_t cmd;
+    };
+
+    void DispatchCommand(int32_t cmd);
+
+    PlatformCommandCallback mCommandCallback;
+    void *mCommandUserData;
+
+    std::vector<ScriptedCommand> mScript;
+    size_t mNextCommand;
+    bool mDestroyRequested;
+
+    // CONTEXT_ERROR_* in place of cmd
+    std::vector<ScriptedCommand> mContextErrors;
+    size_t mNextContextError;
+
+    int mSurfaceWidth, mSurfaceHeight;
+    uint64_t mPresentedFrames;
+
+    int mSyntheticPointers;
+    uint64_t mInputFrame;
+    android_input_buffer *mInputBuffer;
+
+    // what the engine saved last, or what the previous process did
+    std::vector<uint8_t> mSavedState;
+
+    SteadyFrameClock mClock;
+    NullPerformanceReporter mNullPerformanceReporter;
+    PerformanceReporter *mPerformanceReporter;
+    NullRenderBackend mRenderBackend;
+    FakeShaderCompiler mShaderCompiler;
+    PipelineCache mPipelineCache;
+    FakeContextLayer mContextLayer;
+    GpuResourceRegistry mGpuResources;
+    RenderContext mRenderContext;
+    AssetPack mAssetPack;
+    AssetLoader *mAssetLoader;
+};
+
+#endif
@@ -0,0 +1,257 @@
+#include "ima_adpcm.hpp"
+#include <cstring>
+#include "Log.h"
+
+#define LOG_TAG "GameActivityTutorial"
+
+namespace {
+    const int16_t kStepTable[89] = {
+            7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55,
+            60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+            337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411,
+            1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+            5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500,
+            20350, 22385, 24623, 27086, 29794, 32767};
+
+    const int8_t kIndexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+    struct ChannelState {
+        int predictor;
+        int index;
+    };
+
+    inline uint16_t read16(const uint8_t *p) {
+        return (uint16_t) (p[0] | (p[1] << 8));
+    }
+
+    inline uint32_t read32(const uint8_t *p) {
+        return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+               ((uint32_t) p[3] << 24);
+    }
+
+    void append16(std::vector<uint8_t> *file, uint32_t value) {
+        file->push_back((uint8_t) value);
+        file->push_back((uint8_t) (value >> 8));
+    }
+
+    void append32(std::vector<uint8_t> *file, uint32_t value) {
+        append16(file, value & 0xffff);
+        append16(file, value >> 16);
+    }
+
+    void append_tag(std::vector<uint8_t> *file, const char *tag) {
+        for (int i = 0; i < 4; ++i) {
+            file->push_back((uint8_t) tag[i]);
+        }
+    }
+
+    inline int16_t decode_nibble(ChannelState *state, int nibble) {
+        const int step = kStepTable[state->index];
+        int difference = step >> 3;
+        if (nibble & 1) {
+            difference += step >> 2;
+        }
+        if (nibble & 2) {
+            difference += step >> 1;
+        }
+        if (nibble & 4) {
+            difference += step;
+        }
+        int predictor = (nibble & 8) ? state->predictor - difference
+                                     : state->predictor + difference;
+        predictor = predictor < -32768 ? -32768 : (predictor > 32767 ? 32767 : predictor);
+        const int index = state->index + kIndexTable[nibble];
+        state->predictor = predictor;
+        state->index = index < 0 ? 0 : (index > 88 ? 88 : index);
+        return (int16_t) predictor;
+    }
+
+    // the nibble that gets closest to sample; decodes it too, so the state
+    // follows the decoder's exactly
+    int encode_nibble(ChannelState *state, int sample) {
+        const int step = kStepTable[state->index];
+        int delta = sample - state->predictor;
+        int nibble = 0;
+        if (delta < 0) {
+            nibble = 8;
+            delta = -delta;
+        }
+        if (delta >= step) {
+            nibble |= 4;
+            delta -= step;
+        }
+        if (delta >= step >> 1) {
+            nibble |= 2;
+            delta -= step >> 1;
+        }
+        if (delta >= step >> 2) {
+            nibble |= 1;
+        }
+        decode_nibble(state, nibble);
+        return nibble;
+    }
+
+    int frames_per_block(int blockSize, int channelCount) {
+        return (blockSize - 4 * channelCount) * 2 / channelCount + 1;
+    }
+}
+
+bool ImaAdpcmParseWav(const uint8_t *file, size_t size, ImaAdpcmInfo *info) {
+    memset(info, 0, sizeof(*info));
+    if (size < 12 || memcmp(file, "RIFF", 4) != 0 || memcmp(file + 8, "WAVE", 4) != 0) {
+        ALOGE("ImaAdpcm: not a .wav file");
+        return false;
+    }
+    bool haveFormat = false;
+    int64_t factFrames = -1;
+    size_t offset = 12;
+    while (offset + 8 <= size) {
+        const uint8_t *chunk = file + offset;
+        const size_t chunkSize = read32(chunk + 4);
+        const size_t available = size - offset - 8;
+        const size_t bodySize = chunkSize < available ? chunkSize : available;
+        if (memcmp(chunk, "fmt ", 4) == 0 && bodySize >= 20) {
+            if (read16(chunk + 8) != IMA_ADPCM_WAVE_FORMAT || read16(chunk + 22) != 4) {
+                ALOGE("ImaAdpcm: format %u with %u bits isn't IMA ADPCM", read16(chunk + 8),
+                      read16(chunk + 22));
+                return false;
+            }
+            info->channelCount = read16(chunk + 10);
+            info->sampleRate = (int) read32(chunk + 12);
+            info->blockSize = read16(chunk + 20);
+            info->framesPerBlock = read16(chunk + 26);
+            haveFormat = true;
+        } else if (memcmp(chunk, "fact", 4) == 0 && bodySize >= 4) {
+            factFrames = read32(chunk + 8);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            info->data = chunk + 8;
+            info->dataSize = bodySize;
+            break;
+        }
+        // chunks are padded to an even size
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    if (!haveFormat || info->data == NULL) {
+        ALOGE("ImaAdpcm: .wav file without %s", haveFormat ? "data" : "a format");
+        return false;
+    }
+
+    const int channelCount = info->channelCount;
+    const int headerSize = 4 * channelCount;
+    if (channelCount < 1 || channelCount > IMA_ADPCM_MAX_CHANNELS || info->sampleRate <= 0 ||
+        info->blockSize <= headerSize || (info->blockSize - headerSize) % headerSize != 0 ||
+        info->framesPerBlock != frames_per_block(info->blockSize, channelCount) ||
+        info->framesPerBlock > IMA_ADPCM_MAX_BLOCK_FRAMES) {
+        ALOGE("ImaAdpcm: can't play %d channels at %d Hz in %d byte blocks of %d frames",
+              channelCount, info->sampleRate, info->blockSize, info->framesPerBlock);
+        return false;
+    }
+
+    // what the blocks hold, of which the fact chunk may claim less for padding
+    const size_t fullBlocks = info->dataSize / info->blockSize;
+    const size_t lastSize = info->dataSize % info->blockSize;
+    int64_t frameCount = (int64_t) fullBlocks * info->framesPerBlock;
+    if (lastSize > (size_t) headerSize) {
+        frameCount += 1 + (int64_t) ((lastSize - headerSize) / headerSize) * 8;
+    }
+    info->frameCount = factFrames >= 0 && factFrames < frameCount ? factFrames : frameCount;
+    return true;
+}
+
+int ImaAdpcmDecodeBlock(const ImaAdpcmInfo &info, const uint8_t *block, size_t size,
+                        int16_t *out) {
+    const int channelCount = info.channelCount;
+    const size_t headerSize = 4 * channelCount;
+    if (size < headerSize) {
+        return 0;
+    }
+    if (size > (size_t) info.blockSize) {
+        size = info.blockSize;
+    }
+
+    ChannelState states[IMA_ADPCM_MAX_CHANNELS];
+    for (int channel = 0; channel < channelCount; ++channel) {
+        const uint8_t *header = block + 4 * channel;
+        states[channel].predictor = (int16_t) read16(header);
+        states[channel].index = header[2] > 88 ? 88 : header[2];
+        out[channel] = (int16_t) states[channel].predictor;
+    }
+
+    // each run holds eight frames of every channel, four bytes per channel
+    const int runCount = (int) ((size - headerSize) / headerSize);
+    const uint8_t *in = block + headerSize;
+    int16_t *frame = out + channelCount;
+    for (int run = 0; run < runCount; ++run) {
+        for (int channel = 0; channel < channelCount; ++channel) {
+            ChannelState *state = &states[channel];
+            int16_t *sample = frame + channel;
+            for (int i = 0; i < 4; ++i) {
+                const uint8_t byte = in[i];
+                sample[0] = decode_nibble(state, byte & 0x0f);
+                sample[channelCount] = decode_nibble(state, byte >> 4);
+                sample += 2 * channelCount;
+            }
+            in += 4;
+        }
+        frame += 8 * channelCount;
+    }
+    return 1 + 8 * runCount;
+}
+
+void ImaAdpcmEncodeWav(const int16_t *samples, int64_t frameCount, int channelCount,
+                       int sampleRate, int blockSize, std::vector<uint8_t> *file) {
+    const int headerSize = 4 * channelCount;
+    const int framesPerBlock = frames_per_block(blockSize, channelCount);
+    const int64_t blockCount = (frameCount + framesPerBlock - 1) / framesPerBlock;
+    const uint32_t dataSize = (uint32_t) (blockCount * blockSize);
+
+    file->clear();
+    file->reserve(44 + dataSize);
+    append_tag(file, "RIFF");
+    append32(file, 4 + 28 + 12 + 8 + dataSize);
+    append_tag(file, "WAVE");
+    append_tag(file, "fmt ");
+    append32(file, 20);
+    append16(file, IMA_ADPCM_WAVE_FORMAT);
+    append16(file, channelCount);
+    append32(file, sampleRate);
+    append32(file, (uint32_t) ((int64_t) sampleRate * blockSize / framesPerBlock));
+    append16(file, blockSize);
+    append16(file, 4);
+    append16(file, 2);
+    append16(file, framesPerBlock);
+    append_tag(file, "fact");
+    append32(file, 4);
+    append32(file, (uint32_t) frameCount);
+    append_tag(file, "data");
+    append32(file, dataSize);
+
+    // the step index carries over from block to block, like other encoders do
+    ChannelState states[IMA_ADPCM_MAX_CHANNELS];
+    memset(states, 0, sizeof(states));
+    for (int64_t first = 0; first < frameCount; first += framesPerBlock) {
+        for (int channel = 0; channel < channelCount; ++channel) {
+            const int16_t sample = samples[first * channelCount + channel];
+            states[channel].predictor = sample;
+            append16(file, (uint16_t) sample);
+            file->push_back((uint8_t) states[channel].index);
+            file->push_back(0);
+        }
+        // past the end, a short last block repeats the last frame
+        const int runCount = (blockSize - headerSize) / headerSize;
+        for (int run = 0; run < runCount; ++run) {
+            for (int channel = 0; channel < channelCount; ++channel) {
+                for (int i = 0; i < 4; ++i) {
+                    int nibbles[2];
+                    for (int half = 0; half < 2; ++half) {
+                        int64_t frame = first + 1 + run * 8 + 2 * i + half;
+                        frame = frame < frameCount ? frame : frameCount - 1;
+                        nibbles[half] = encode_nibble(&states[channel],
+                                                      samples[frame * channelCount + channel]);
+                    }
+                    file->push_back((uint8_t) (nibbles[0] | (nibbles[1] << 4)));
+                }
+            }
+        }
+    }
+}
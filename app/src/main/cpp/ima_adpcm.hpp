@@ -0,0 +1,47 @@
+#ifndef agdktunnel_ima_adpcm_hpp
+#define agdktunnel_ima_adpcm_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * IMA ADPCM in .wav files (WAVE_FORMAT_IMA_ADPCM), four bits a sample. Each
+ * block starts with every channel's sample and step index, then holds the
+ * channels' nibbles in interleaved runs of eight, so blocks decode on their own
+ * and a file can be streamed a block at a time out of a mapping. Files made by
+ * common encoders (e.g. ffmpeg's adpcm_ima_wav) play as they are.
+ */
+
+#define IMA_ADPCM_WAVE_FORMAT 0x11
+#define IMA_ADPCM_MAX_CHANNELS 2
+// the most frames a block may decode to, to bound the decoder's buffers
+#define IMA_ADPCM_MAX_BLOCK_FRAMES 8192
+
+struct ImaAdpcmInfo {
+    int channelCount;
+    int sampleRate;
+    // bytes a block takes, the last may be shorter, and frames a full one decodes to
+    int blockSize;
+    int framesPerBlock;
+    int64_t frameCount;
+    // the blocks, inside the file
+    const uint8_t *data;
+    size_t dataSize;
+};
+
+// Reads the header of an IMA ADPCM .wav file held in memory, false unless this
+// decoder plays it. The blocks are left where they are.
+bool ImaAdpcmParseWav(const uint8_t *file, size_t size, ImaAdpcmInfo *info);
+
+// Decodes a block of size bytes into interleaved samples, which hold
+// framesPerBlock frames. Returns its frames, 0 if the block is too short.
+int ImaAdpcmDecodeBlock(const ImaAdpcmInfo &info, const uint8_t *block, size_t size,
+                        int16_t *out);
+
+// Encodes interleaved samples as an IMA ADPCM .wav file with blocks of
+// blockSize bytes; for tools and tests.
+void ImaAdpcmEncodeWav(const int16_t *samples, int64_t frameCount, int channelCount,
+                       int sampleRate, int blockSize, std::vector<uint8_t> *file);
+
+#endif
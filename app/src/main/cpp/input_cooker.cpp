@@ -0,0 +1,76 @@
+#include "input_cooker.hpp"
+#include <cstddef>
+#include "input_types.hpp"
+
+static int _action_phase(int actionMasked) {
+    switch (actionMasked) {
+        case AMOTION_EVENT_ACTION_DOWN:
+        case AMOTION_EVENT_ACTION_POINTER_DOWN:
+            return COOKED_EVENT_TYPE_POINTER_DOWN;
+        case AMOTION_EVENT_ACTION_UP:
+        case AMOTION_EVENT_ACTION_POINTER_UP:
+        case AMOTION_EVENT_ACTION_CANCEL:
+            return COOKED_EVENT_TYPE_POINTER_UP;
+        default:
+            return COOKED_EVENT_TYPE_POINTER_MOVE;
+    }
+}
+
+int CookMotionEvent(const GameActivityMotionEvent *motionEvent,
+                    const GameActivityHistoricalPointerAxes *history, TouchBatch *batch) {
+    const int pointerCount = (int) motionEvent->pointerCount;
+    if (pointerCount <= 0) {
+        return 0;
+    }
+
+    const int action = motionEvent->action;
+    const int actionMasked = action & AMOTION_EVENT_ACTION_MASK;
+    const int actionIndex = (action & AMOTION_EVENT_ACTION_POINTER_INDEX_MASK) >>
+                            AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
+    const int actionPhase = _action_phase(actionMasked);
+    const bool onScreen = motionEvent->source == AINPUT_SOURCE_TOUCHSCREEN;
+    const int before = batch->count;
+
+    // Historical samples are laid out sample-major: all pointers of the oldest
+    // sample, then all pointers of the next one, and so on. They only carry
+    // movement, the action itself applies to the current sample.
+    if (history != NULL && motionEvent->historicalCount > 0) {
+        const int historySize = motionEvent->historicalCount / pointerCount;
+        for (int h = 0; h < historySize; ++h) {
+            const GameActivityHistoricalPointerAxes *sample = &history[h * pointerCount];
+            for (int p = 0; p < pointerCount; ++p) {
+                batch->Add(motionEvent->pointers[p].id,
+                           sample[p].axisValues[AMOTION_EVENT_AXIS_X],
+                           sample[p].axisValues[AMOTION_EVENT_AXIS_Y],
+                           sample[p].eventTime, COOKED_EVENT_TYPE_POINTER_MOVE, onScreen);
+            }
+        }
+    }
+
+    for (int p = 0; p < pointerCount; ++p) {
+        const GameActivityPointerAxes *pointer = &motionEvent->pointers[p];
+        // only the pointer named by the action index goes down or up, the others
+        // move; a cancel lifts every pointer
+        int phase = (p == actionIndex || actionMasked == AMOTION_EVENT_ACTION_CANCEL) ?
+                    actionPhase : COOKED_EVENT_TYPE_POINTER_MOVE;
+        batch->Add(pointer->id, GameActivityPointerAxes_getX(pointer),
+                   GameActivityPointerAxes_getY(pointer), motionEvent->eventTime, phase, onScreen);
+    }
+
+    return batch->count - before;
+}
+
+int CookInputBuffer(const android_input_buffer *inputBuffer, TouchBatch *batch) {
+    int cooked = 0;
+    for (uint64_t i = 0; i < inputBuffer->motionEventsCount; ++i) {
+        const GameActivityMotionEvent *motionEvent = &inputBuffer->motionEvents[i];
+        const GameActivityHistoricalPointerAxes *history = NULL;
+        if (motionEvent->historicalCount > 0 &&
+            (uint64_t) (motionEvent->historicalStart + motionEvent->historicalCount) <=
+            inputBuffer->historicalSamplesCount) {
+            history = &inputBuffer->historicalAxisSamples[motionEvent->historicalStart];
+        }
+        cooked += CookMotionEvent(motionEvent, history, batch);
+    }
+    return cooked;
+}
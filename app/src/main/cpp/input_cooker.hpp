@@ -0,0 +1,109 @@
+#ifndef agdktunnel_input_cooker_hpp
+#define agdktunnel_input_cooker_hpp
+
+#include <cstdint>
+
+struct android_input_buffer;
+struct GameActivityMotionEvent;
+struct GameActivityHistoricalPointerAxes;
+
+struct CookedEvent {
+    int type;
+
+    // for pointer events
+    int motionPointerId;
+    bool motionIsOnScreen;
+    float motionX, motionY;
+    float motionMinX, motionMaxX;
+    float motionMinY, motionMaxY;
+
+    // whether a text input has occurred
+    bool textInputState;
+};
+
+// event type
+#define COOKED_EVENT_TYPE_POINTER_DOWN 0
+#define COOKED_EVENT_TYPE_POINTER_UP 1
+#define COOKED_EVENT_TYPE_POINTER_MOVE 2
+#define COOKED_EVENT_TYPE_TEXT_INPUT 7
+
+// maximum number of touch samples cooked per frame, counting every pointer of
+// every motion event plus the historical samples batched into each of them
+#define TOUCH_BATCH_CAPACITY 1024
+
+/*
+ * A whole frame of touch input in structure-of-arrays form. Sample i is
+ * described by pointerId[i], x[i], y[i], timeNs[i] and phase[i] (one of the
+ * COOKED_EVENT_TYPE_POINTER_* values). Samples are stored in the order they
+ * happened, historical samples of an event before its current sample.
+ */
+struct TouchBatch {
+    int count;
+
+    // samples that did not fit in the batch this frame
+    int dropped;
+
+    // motion range of on-screen samples
+    float minX, maxX;
+    float minY, maxY;
+
+    int32_t pointerId[TOUCH_BATCH_CAPACITY];
+    float x[TOUCH_BATCH_CAPACITY];
+    float y[TOUCH_BATCH_CAPACITY];
+    int64_t timeNs[TOUCH_BATCH_CAPACITY];
+    uint8_t phase[TOUCH_BATCH_CAPACITY];
+    uint8_t isOnScreen[TOUCH_BATCH_CAPACITY];
+
+    void Clear() {
+        count = 0;
+        dropped = 0;
+    }
+
+    void SetScreenSize(int width, int height) {
+        minX = 0.0f;
+        maxX = (float) width;
+        minY = 0.0f;
+        maxY = (float) height;
+    }
+
+    bool Add(int32_t id, float sx, float sy, int64_t t, int ph, bool onScreen) {
+        if (count >= TOUCH_BATCH_CAPACITY) {
+            ++dropped;
+            return false;
+        }
+        pointerId[count] = id;
+        x[count] = sx;
+        y[count] = sy;
+        timeNs[count] = t;
+        phase[count] = (uint8_t) ph;
+        isOnScreen[count] = onScreen ? 1 : 0;
+        ++count;
+        return true;
+    }
+
+    // copies sample i out as a CookedEvent, for consumers that want one event at a time
+    void GetEvent(int i, CookedEvent *ev) const {
+        ev->type = phase[i];
+        ev->motionPointerId = pointerId[i];
+        ev->motionIsOnScreen = isOnScreen[i] != 0;
+        ev->motionX = x[i];
+        ev->motionY = y[i];
+        ev->motionMinX = ev->motionIsOnScreen ? minX : 0.0f;
+        ev->motionMaxX = ev->motionIsOnScreen ? maxX : 0.0f;
+        ev->motionMinY = ev->motionIsOnScreen ? minY : 0.0f;
+        ev->motionMaxY = ev->motionIsOnScreen ? maxY : 0.0f;
+        ev->textInputState = false;
+    }
+};
+
+// Cooks every pointer of one motion event, historical samples first. history points at
+// the first of the event's historical samples (may be NULL if it has none).
+// Returns the number of samples added to the batch.
+int CookMotionEvent(const GameActivityMotionEvent *motionEvent,
+                    const GameActivityHistoricalPointerAxes *history, TouchBatch *batch);
+
+// Cooks every motion event of an input buffer into the batch, appending to what is
+// already there. Returns the number of samples added to the batch.
+int CookInputBuffer(const android_input_buffer *inputBuffer, TouchBatch *batch);
+
+#endif
@@ -0,0 +1,308 @@
+#include "input_recorder.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include "Log.h"
+#include "input_types.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// largest motion payload a single GameActivityMotionEvent can produce
+#define MAX_MOTION_PAYLOAD_SIZE (sizeof(InputRecordMotion) + \
+    GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT * sizeof(InputRecordPointer) + \
+    NATIVE_APP_GLUE_MAX_HISTORICAL_POINTER_SAMPLES * sizeof(InputRecordHistoricalSample))
+
+InputRecorder::InputRecorder() {
+    mFile = NULL;
+}
+
+InputRecorder::~InputRecorder() {
+    Close();
+}
+
+bool InputRecorder::Open(const char *path) {
+    Close();
+    mFile = fopen(path, "wb");
+    if (mFile == NULL) {
+        ALOGE("InputRecorder: failed to open %s", path);
+        return false;
+    }
+
+    InputRecordHeader header;
+    header.magic = INPUT_RECORD_MAGIC;
+    header.version = INPUT_RECORD_VERSION;
+    fwrite(&header, sizeof(header), 1, mFile);
+    ALOGI("InputRecorder: recording input to %s", path);
+    return true;
+}
+
+void InputRecorder::Close() {
+    if (mFile != NULL) {
+        fclose(mFile);
+        mFile = NULL;
+    }
+}
+
+void InputRecorder::WriteChunk(uint32_t type, const void *payload, size_t size) {
+    InputRecordChunk chunk;
+    chunk.type = type;
+    chunk.size = (uint32_t) size;
+    fwrite(&chunk, sizeof(chunk), 1, mFile);
+    fwrite(payload, size, 1, mFile);
+}
+
+void InputRecorder::RecordMotionEvents(const android_input_buffer *inputBuffer) {
+    if (mFile == NULL) {
+        return;
+    }
+
+    uint8_t payload[MAX_MOTION_PAYLOAD_SIZE];
+    for (uint64_t i = 0; i < inputBuffer->motionEventsCount; ++i) {
+        const GameActivityMotionEvent *motionEvent = &inputBuffer->motionEvents[i];
+
+        InputRecordMotion motion;
+        motion.action = motionEvent->action;
+        motion.source = motionEvent->source;
+        motion.eventTime = motionEvent->eventTime;
+        motion.pointerCount = motionEvent->pointerCount;
+        motion.historicalCount = 0;
+        if (motionEvent->historicalCount > 0 &&
+            (uint64_t) (motionEvent->historicalStart + motionEvent->historicalCount) <=
+            inputBuffer->historicalSamplesCount) {
+            motion.historicalCount = motionEvent->historicalCount;
+        }
+
+        uint8_t *out = payload;
+        memcpy(out, &motion, sizeof(motion));
+        out += sizeof(motion);
+
+        for (uint32_t p = 0; p < motion.pointerCount; ++p) {
+            InputRecordPointer pointer;
+            pointer.id = motionEvent->pointers[p].id;
+            pointer.x = GameActivityPointerAxes_getX(&motionEvent->pointers[p]);
+            pointer.y = GameActivityPointerAxes_getY(&motionEvent->pointers[p]);
+            memcpy(out, &pointer, sizeof(pointer));
+            out += sizeof(pointer);
+        }
+
+        const GameActivityHistoricalPointerAxes *history =
+                &inputBuffer->historicalAxisSamples[motionEvent->historicalStart];
+        for (uint32_t h = 0; h < motion.historicalCount; ++h) {
+            InputRecordHistoricalSample sample;
+            sample.eventTime = history[h].eventTime;
+            sample.x = history[h].axisValues[AMOTION_EVENT_AXIS_X];
+            sample.y = history[h].axisValues[AMOTION_EVENT_AXIS_Y];
+            memcpy(out, &sample, sizeof(sample));
+            out += sizeof(sample);
+        }
+
+        WriteChunk(INPUT_RECORD_CHUNK_MOTION, payload, out - payload);
+    }
+}
+
+void InputRecorder::RecordTextInput(const GameTextInputState *state) {
+    if (mFile == NULL) {
+        return;
+    }
+
+    InputRecordText text;
+    text.textLength = state->text_length;
+    text.selectionStart = state->selection.start;
+    text.selectionEnd = state->selection.end;
+    text.composingStart = state->composingRegion.start;
+    text.composingEnd = state->composingRegion.end;
+
+    InputRecordChunk chunk;
+    chunk.type = INPUT_RECORD_CHUNK_TEXT;
+    chunk.size = (uint32_t) (sizeof(text) + text.textLength + 1);
+    fwrite(&chunk, sizeof(chunk), 1, mFile);
+    fwrite(&text, sizeof(text), 1, mFile);
+    fwrite(state->text_UTF8, text.textLength, 1, mFile);
+    fputc(0, mFile);
+}
+
+void InputRecorder::EndFrame(uint64_t frame, int64_t timeNs) {
+    if (mFile == NULL) {
+        return;
+    }
+
+    InputRecordFrame record;
+    record.frame = frame;
+    record.timeNs = timeNs;
+    WriteChunk(INPUT_RECORD_CHUNK_FRAME, &record, sizeof(record));
+}
+
+InputReplayer::InputReplayer() {
+    mData = NULL;
+    mSize = 0;
+    mOffset = 0;
+    mInputBuffer = new android_input_buffer;
+    memset(mInputBuffer, 0, sizeof(*mInputBuffer));
+}
+
+InputReplayer::~InputReplayer() {
+    Close();
+    delete mInputBuffer;
+}
+
+bool InputReplayer::Open(const char *path) {
+    Close();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ALOGE("InputReplayer: failed to open %s", path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(InputRecordHeader)) {
+        ALOGE("InputReplayer: %s is not an input recording", path);
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        ALOGE("InputReplayer: failed to map %s", path);
+        return false;
+    }
+
+    InputRecordHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != INPUT_RECORD_MAGIC || header.version != INPUT_RECORD_VERSION) {
+        ALOGE("InputReplayer: %s has magic %08x version %u, expected %08x version %u", path,
+              header.magic, header.version, INPUT_RECORD_MAGIC, INPUT_RECORD_VERSION);
+        munmap(data, st.st_size);
+        return false;
+    }
+
+    // the whole session is read sequentially exactly once
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    mData = (const uint8_t *) data;
+    mSize = st.st_size;
+    mOffset = sizeof(header);
+    ALOGI("InputReplayer: replaying input from %s (%zu bytes)", path, mSize);
+    return true;
+}
+
+void InputReplayer::Close() {
+    if (mData != NULL) {
+        munmap((void *) mData, mSize);
+        mData = NULL;
+        mSize = 0;
+        mOffset = 0;
+    }
+}
+
+void InputReplayer::Rewind() {
+    mOffset = sizeof(InputRecordHeader);
+}
+
+bool InputReplayer::ReadMotion(const uint8_t *payload, size_t size) {
+    InputRecordMotion motion;
+    if (size < sizeof(motion)) {
+        return false;
+    }
+    memcpy(&motion, payload, sizeof(motion));
+
+    if (motion.pointerCount > GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT ||
+        size != sizeof(motion) + motion.pointerCount * sizeof(InputRecordPointer) +
+                motion.historicalCount * sizeof(InputRecordHistoricalSample)) {
+        return false;
+    }
+    if (mInputBuffer->motionEventsCount >= NATIVE_APP_GLUE_MAX_NUM_MOTION_EVENTS ||
+        mInputBuffer->historicalSamplesCount + motion.historicalCount >
+        NATIVE_APP_GLUE_MAX_HISTORICAL_POINTER_SAMPLES) {
+        // cannot happen for recordings made from a buffer of the same size
+        return false;
+    }
+
+    GameActivityMotionEvent *motionEvent =
+            &mInputBuffer->motionEvents[mInputBuffer->motionEventsCount++];
+    memset(motionEvent, 0, sizeof(*motionEvent));
+    motionEvent->action = motion.action;
+    motionEvent->source = motion.source;
+    motionEvent->eventTime = motion.eventTime;
+    motionEvent->pointerCount = motion.pointerCount;
+
+    const uint8_t *in = payload + sizeof(motion);
+    for (uint32_t p = 0; p < motion.pointerCount; ++p) {
+        InputRecordPointer pointer;
+        memcpy(&pointer, in, sizeof(pointer));
+        in += sizeof(pointer);
+        motionEvent->pointers[p].id = pointer.id;
+        motionEvent->pointers[p].axisValues[AMOTION_EVENT_AXIS_X] = pointer.x;
+        motionEvent->pointers[p].axisValues[AMOTION_EVENT_AXIS_Y] = pointer.y;
+    }
+
+    motionEvent->historicalStart = (int) mInputBuffer->historicalSamplesCount;
+    motionEvent->historicalCount = (int) motion.historicalCount;
+    for (uint32_t h = 0; h < motion.historicalCount; ++h) {
+        InputRecordHistoricalSample sample;
+        memcpy(&sample, in, sizeof(sample));
+        in += sizeof(sample);
+        GameActivityHistoricalPointerAxes *axes =
+                &mInputBuffer->historicalAxisSamples[mInputBuffer->historicalSamplesCount++];
+        axes->eventTime = sample.eventTime;
+        axes->axisValues[AMOTION_EVENT_AXIS_X] = sample.x;
+        axes->axisValues[AMOTION_EVENT_AXIS_Y] = sample.y;
+    }
+    return true;
+}
+
+const android_input_buffer *InputReplayer::ReadFrame(InputRecordFrame *frame,
+                                                     InputReplayText *text) {
+    mInputBuffer->motionEventsCount = 0;
+    mInputBuffer->historicalSamplesCount = 0;
+    text->present = false;
+
+    while (mData != NULL && mOffset + sizeof(InputRecordChunk) <= mSize) {
+        InputRecordChunk chunk;
+        memcpy(&chunk, mData + mOffset, sizeof(chunk));
+        const uint8_t *payload = mData + mOffset + sizeof(chunk);
+        if (chunk.size > mSize - mOffset - sizeof(chunk)) {
+            ALOGE("InputReplayer: truncated chunk at offset %zu", mOffset);
+            break;
+        }
+        mOffset += sizeof(chunk) + chunk.size;
+
+        switch (chunk.type) {
+            case INPUT_RECORD_CHUNK_FRAME:
+                if (chunk.size == sizeof(InputRecordFrame)) {
+                    memcpy(frame, payload, sizeof(*frame));
+                    return mInputBuffer;
+                }
+                break;
+            case INPUT_RECORD_CHUNK_MOTION:
+                if (!ReadMotion(payload, chunk.size)) {
+                    ALOGW("InputReplayer: skipping malformed motion chunk");
+                }
+                break;
+            case INPUT_RECORD_CHUNK_TEXT: {
+                InputRecordText record;
+                if (chunk.size >= sizeof(record)) {
+                    memcpy(&record, payload, sizeof(record));
+                    if (record.textLength >= 0 &&
+                        chunk.size == sizeof(record) + record.textLength + 1) {
+                        text->present = true;
+                        text->text = (const char *) payload + sizeof(record);
+                        text->textLength = record.textLength;
+                        text->selectionStart = record.selectionStart;
+                        text->selectionEnd = record.selectionEnd;
+                        text->composingStart = record.composingStart;
+                        text->composingEnd = record.composingEnd;
+                    }
+                }
+                break;
+            }
+            default:
+                // unknown chunks are skipped so the format can grow
+                break;
+        }
+    }
+    return NULL;
+}
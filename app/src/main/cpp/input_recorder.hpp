@@ -0,0 +1,140 @@
+#ifndef agdktunnel_input_recorder_hpp
+#define agdktunnel_input_recorder_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+struct android_input_buffer;
+struct GameTextInputState;
+
+/*
+ * Input recording file format (little endian, no padding between records):
+ *
+ *   InputRecordHeader
+ *   { InputRecordChunk, payload }*
+ *
+ * A frame's MOTION and TEXT chunks are followed by a FRAME chunk carrying the
+ * frame number and the time the frame's input was sampled, so empty frames are
+ * preserved too and a replay consumes input at exactly the recorded cadence.
+ */
+#define INPUT_RECORD_MAGIC 0x52494147 // "GAIR"
+#define INPUT_RECORD_VERSION 1
+
+#define INPUT_RECORD_CHUNK_FRAME 1
+#define INPUT_RECORD_CHUNK_MOTION 2
+#define INPUT_RECORD_CHUNK_TEXT 3
+
+struct InputRecordHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct InputRecordChunk {
+    uint32_t type;
+    uint32_t size; // payload bytes following this chunk header
+};
+
+// FRAME payload
+struct InputRecordFrame {
+    uint64_t frame;
+    int64_t timeNs;
+};
+
+// MOTION payload, followed by pointerCount InputRecordPointers and then
+// historicalCount InputRecordHistoricalSamples (sample-major, like GameActivity)
+struct InputRecordMotion {
+    int32_t action;
+    int32_t source;
+    int64_t eventTime;
+    uint32_t pointerCount;
+    uint32_t historicalCount;
+};
+
+struct InputRecordPointer {
+    int32_t id;
+    float x, y;
+};
+
+struct InputRecordHistoricalSample {
+    int64_t eventTime;
+    float x, y;
+};
+
+// TEXT payload, followed by textLength bytes of UTF-8 and a terminating zero
+struct InputRecordText {
+    int32_t textLength;
+    int32_t selectionStart, selectionEnd;
+    int32_t composingStart, composingEnd;
+};
+
+class InputRecorder {
+public:
+    InputRecorder();
+
+    ~InputRecorder();
+
+    bool Open(const char *path);
+
+    void Close();
+
+    bool IsOpen() const {
+        return mFile != NULL;
+    }
+
+    // records every motion event of the buffer, call before the buffer is cleared
+    void RecordMotionEvents(const android_input_buffer *inputBuffer);
+
+    void RecordTextInput(const GameTextInputState *state);
+
+    // closes the current frame
+    void EndFrame(uint64_t frame, int64_t timeNs);
+
+private:
+    void WriteChunk(uint32_t type, const void *payload, size_t size);
+
+    FILE *mFile;
+};
+
+// text input state of a replayed frame; text points into the mapped file
+struct InputReplayText {
+    bool present;
+    const char *text;
+    int32_t textLength;
+    int32_t selectionStart, selectionEnd;
+    int32_t composingStart, composingEnd;
+};
+
+class InputReplayer {
+public:
+    InputReplayer();
+
+    ~InputReplayer();
+
+    // maps the recording into memory
+    bool Open(const char *path);
+
+    void Close();
+
+    bool IsOpen() const {
+        return mData != NULL;
+    }
+
+    // Rebuilds the next recorded frame into an input buffer that can go straight
+    // through CookInputBuffer. Returns NULL once the recording is exhausted.
+    const android_input_buffer *ReadFrame(InputRecordFrame *frame, InputReplayText *text);
+
+    // restarts the replay from the first frame
+    void Rewind();
+
+private:
+    bool ReadMotion(const uint8_t *payload, size_t size);
+
+    const uint8_t *mData;
+    size_t mSize;
+    size_t mOffset;
+
+    android_input_buffer *mInputBuffer;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef agdktunnel_input_types_hpp
+#define agdktunnel_input_types_hpp
+
+/*
+ * The GameActivity input types the input cooker and recorder work on. On Android
+ * they come from the native app glue. Host builds get stand-ins here with the
+ * same names, fields and limits, so synthetic input buffers and recordings go
+ * through the same code.
+ */
+#ifdef __ANDROID__
+
+#include "game-activity/native_app_glue/android_native_app_glue.h"
+
+#else
+
+#include <cstdint>
+
+// limits of the GameActivity version the app builds against
+#define GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT 48
+#define GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT 8
+#define NATIVE_APP_GLUE_MAX_NUM_MOTION_EVENTS 16
+#define NATIVE_APP_GLUE_MAX_HISTORICAL_POINTER_SAMPLES 64
+
+// values from android/input.h
+enum {
+    AMOTION_EVENT_ACTION_MASK = 0xff,
+    AMOTION_EVENT_ACTION_POINTER_INDEX_MASK = 0xff00,
+    AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT = 8,
+    AMOTION_EVENT_ACTION_DOWN = 0,
+    AMOTION_EVENT_ACTION_UP = 1,
+    AMOTION_EVENT_ACTION_MOVE = 2,
+    AMOTION_EVENT_ACTION_CANCEL = 3,
+    AMOTION_EVENT_ACTION_POINTER_DOWN = 5,
+    AMOTION_EVENT_ACTION_POINTER_UP = 6,
+};
+
+enum {
+    AMOTION_EVENT_AXIS_X = 0,
+    AMOTION_EVENT_AXIS_Y = 1,
+};
+
+enum {
+    AINPUT_SOURCE_TOUCHSCREEN = 0x00001002,
+};
+
+struct GameActivityPointerAxes {
+    int32_t id;
+    int32_t toolType;
+    float axisValues[GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+    float rawX;
+    float rawY;
+};
+
+struct GameActivityHistoricalPointerAxes {
+    int64_t eventTime;
+    float axisValues[GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+};
+
+inline float GameActivityPointerAxes_getX(const GameActivityPointerAxes *pointerInfo) {
+    return pointerInfo->axisValues[AMOTION_EVENT_AXIS_X];
+}
+
+inline float GameActivityPointerAxes_getY(const GameActivityPointerAxes *pointerInfo) {
+    return pointerInfo->axisValues[AMOTION_EVENT_AXIS_Y];
+}
+
+struct GameActivityMotionEvent {
+    int32_t deviceId;
+    int32_t source;
+    int32_t action;
+    int64_t eventTime;
+    int64_t downTime;
+    int32_t flags;
+    int32_t metaState;
+    int32_t actionButton;
+    int32_t buttonState;
+    int32_t classification;
+    int32_t edgeFlags;
+    uint32_t pointerCount;
+    GameActivityPointerAxes pointers[GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT];
+    float precisionX;
+    float precisionY;
+    int historicalStart;
+    int historicalCount;
+};
+
+// only the motion half of the glue's buffer; the cooker has no use for key events
+struct android_input_buffer {
+    GameActivityMotionEvent motionEvents[NATIVE_APP_GLUE_MAX_NUM_MOTION_EVENTS];
+    uint64_t motionEventsCount;
+    GameActivityHistoricalPointerAxes
+            historicalAxisSamples[NATIVE_APP_GLUE_MAX_HISTORICAL_POINTER_SAMPLES];
+    uint64_t historicalSamplesCount;
+};
+
+// from game-text-input/gametextinput.h
+struct GameTextInputSpan {
+    int32_t start;
+    int32_t end;
+};
+
+struct GameTextInputState {
+    const char *text_UTF8;
+    int32_t text_length;
+    GameTextInputSpan selection;
+    GameTextInputSpan composingRegion;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,380 @@
+#include "job_system.hpp"
+#include <sched.h>
+#include <unistd.h>
+#include <cstdio>
+#include "Log.h"
+#include "trace.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// how many times an idle worker looks for work before going to sleep
+#define JOB_SYSTEM_IDLE_SPINS 64
+
+namespace {
+    thread_local JobSystem *tJobSystem = NULL;
+    thread_local int tWorkerIndex = -1;
+
+    long read_max_frequency(int cpu) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq",
+                 cpu);
+        FILE *file = fopen(path, "r");
+        if (file == NULL) {
+            return 0;
+        }
+        long frequency = 0;
+        if (fscanf(file, "%ld", &frequency) != 1) {
+            frequency = 0;
+        }
+        fclose(file);
+        return frequency;
+    }
+}
+
+bool JobSystem::WorkerQueue::Push(Job *job) {
+    const int64_t b = bottom.load(std::memory_order_relaxed);
+    const int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= JOB_SYSTEM_MAX_JOBS_PER_THREAD) {
+        return false;
+    }
+    jobs[b & (JOB_SYSTEM_MAX_JOBS_PER_THREAD - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job *JobSystem::WorkerQueue::Pop() {
+    const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    Job *job = NULL;
+    if (t <= b) {
+        job = jobs[b & (JOB_SYSTEM_MAX_JOBS_PER_THREAD - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // last job, race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                job = NULL;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+    } else {
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job *JobSystem::WorkerQueue::Steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom.load(std::memory_order_acquire);
+
+    if (t < b) {
+        Job *job = jobs[t & (JOB_SYSTEM_MAX_JOBS_PER_THREAD - 1)].load(std::memory_order_relaxed);
+        if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+JobSystem::JobSystem(int workerCount, int coreClass) {
+    GetCores(coreClass, &mCores);
+    if (workerCount <= 0) {
+        workerCount = mCores.empty() ? (int) std::thread::hardware_concurrency() :
+                      (int) mCores.size();
+    }
+    mWorkerCount = workerCount > 0 ? workerCount : 1;
+
+    mQueues = new WorkerQueue[mWorkerCount];
+    for (int i = 0; i < mWorkerCount; ++i) {
+        mQueues[i].top.store(0, std::memory_order_relaxed);
+        mQueues[i].bottom.store(0, std::memory_order_relaxed);
+        mQueues[i].poolNext = 0;
+        for (int j = 0; j < JOB_SYSTEM_MAX_JOBS_PER_THREAD; ++j) {
+            mQueues[i].pool[j].busy.store(false, std::memory_order_relaxed);
+        }
+    }
+    mQueuedJobs.store(0);
+    mSleepingWorkers.store(0);
+    mQuit.store(false);
+
+    // the creating thread is worker 0
+    tJobSystem = this;
+    tWorkerIndex = 0;
+
+    for (int i = 1; i < mWorkerCount; ++i) {
+        mThreads.push_back(std::thread(&JobSystem::WorkerMain, this, i));
+    }
+    ALOGI("JobSystem: %d workers on %d %s cores", mWorkerCount, (int) mCores.size(),
+          coreClass == JOB_CORES_BIG ? "big" : coreClass == JOB_CORES_LITTLE ? "little" : "any");
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(mSleepLock);
+        mQuit.store(true);
+    }
+    mSleepCondition.notify_all();
+    for (size_t i = 0; i < mThreads.size(); ++i) {
+        mThreads[i].join();
+    }
+    delete[] mQueues;
+
+    if (tJobSystem == this) {
+        tJobSystem = NULL;
+        tWorkerIndex = -1;
+    }
+}
+
+void JobSystem::GetCores(int coreClass, std::vector<int> *cores) {
+    const int count = (int) sysconf(_SC_NPROCESSORS_CONF);
+    std::vector<long> frequencies(count > 0 ? count : 0);
+    for (int cpu = 0; cpu < count; ++cpu) {
+        frequencies[cpu] = read_max_frequency(cpu);
+    }
+    GetCores(coreClass, frequencies, cores);
+}
+
+void JobSystem::GetCores(int coreClass, const std::vector<long> &frequencies,
+                         std::vector<int> *cores) {
+    cores->clear();
+    const int count = (int) frequencies.size();
+
+    long minFrequency = 0;
+    int fasterCount = 0;
+    for (int cpu = 0; cpu < count; ++cpu) {
+        if (frequencies[cpu] > 0 && (minFrequency == 0 || frequencies[cpu] < minFrequency)) {
+            minFrequency = frequencies[cpu];
+        }
+    }
+    for (int cpu = 0; cpu < count; ++cpu) {
+        if (frequencies[cpu] > minFrequency) {
+            ++fasterCount;
+        }
+    }
+
+    for (int cpu = 0; cpu < count; ++cpu) {
+        bool match = true;
+        // without frequency information every core belongs to every class
+        if (frequencies[cpu] > 0) {
+            if (coreClass == JOB_CORES_BIG) {
+                // a single faster core leaves no pool, the rest count as big then
+                match = fasterCount < 2 || frequencies[cpu] > minFrequency;
+            } else if (coreClass == JOB_CORES_LITTLE) {
+                match = frequencies[cpu] == minFrequency;
+            }
+        }
+        if (match) {
+            cores->push_back(cpu);
+        }
+    }
+}
+
+void JobSystem::WorkerMain(int index) {
+    tJobSystem = this;
+    tWorkerIndex = index;
+
+    char name[32];
+    snprintf(name, sizeof(name), "JobWorker %d", index);
+    Trace::SetThreadName(name);
+
+    if (!mCores.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (size_t i = 0; i < mCores.size(); ++i) {
+            CPU_SET(mCores[i], &set);
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            ALOGW("JobSystem: worker %d could not be pinned", index);
+        }
+    }
+
+    while (!mQuit.load(std::memory_order_acquire)) {
+        bool ranJob = false;
+        for (int spin = 0; spin < JOB_SYSTEM_IDLE_SPINS && !ranJob; ++spin) {
+            ranJob = RunOneJob(index);
+            if (!ranJob) {
+                std::this_thread::yield();
+            }
+        }
+        if (ranJob) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mSleepLock);
+        mSleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        mSleepCondition.wait(lock, [this]() {
+            return mQuit.load(std::memory_order_acquire) ||
+                   mQueuedJobs.load(std::memory_order_seq_cst) > 0;
+        });
+        mSleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+Job *JobSystem::AllocateJob() {
+    WorkerQueue &queue = mQueues[tWorkerIndex];
+    while (1) {
+        for (int i = 0; i < JOB_SYSTEM_MAX_JOBS_PER_THREAD; ++i) {
+            Job *job = &queue.pool[queue.poolNext++ & (JOB_SYSTEM_MAX_JOBS_PER_THREAD - 1)];
+            // pairs with Execute() giving the slot back once it has read the job
+            if (!job->busy.load(std::memory_order_acquire)) {
+                job->busy.store(true, std::memory_order_relaxed);
+                return job;
+            }
+        }
+        // every slot is queued or running somewhere, help them finish
+        if (!RunOneJob(tWorkerIndex)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::Push(Job *job) {
+    // A full queue makes room by running what is queued. Running this job instead
+    // could start it before its dependency is done.
+    while (!mQueues[tWorkerIndex].Push(job)) {
+        if (!RunOneJob(tWorkerIndex)) {
+            std::this_thread::yield();
+        }
+    }
+    mQueuedJobs.fetch_add(1, std::memory_order_seq_cst);
+    if (mSleepingWorkers.load(std::memory_order_seq_cst) > 0) {
+        // taking the lock orders this wakeup after a worker's check of mQueuedJobs
+        { std::lock_guard<std::mutex> lock(mSleepLock); }
+        mSleepCondition.notify_one();
+    }
+}
+
+void JobSystem::Submit(JobFunction function, void *data, JobCounter *counter,
+                       JobCounter *dependency) {
+    if (counter != NULL) {
+        counter->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (tJobSystem != this) {
+        // not one of our threads, run it right here
+        Job job = {function, data, counter, NULL, NULL, 0, 0, {false}};
+        if (dependency != NULL) {
+            Wait(dependency);
+        }
+        Execute(&job);
+        return;
+    }
+
+    Job *job = AllocateJob();
+    job->function = function;
+    job->data = data;
+    job->counter = counter;
+    job->dependency = dependency;
+    job->rangeFunction = NULL;
+    job->begin = job->end = 0;
+    Push(job);
+}
+
+void JobSystem::ParallelFor(int count, int batchSize, JobRangeFunction function, void *data,
+                            JobCounter *counter, JobCounter *dependency) {
+    if (batchSize <= 0) {
+        batchSize = 1;
+    }
+    for (int begin = 0; begin < count; begin += batchSize) {
+        const int end = begin + batchSize < count ? begin + batchSize : count;
+        if (counter != NULL) {
+            counter->fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (tJobSystem != this) {
+            if (dependency != NULL) {
+                Wait(dependency);
+            }
+            Job job = {NULL, data, counter, NULL, function, begin, end, {false}};
+            Execute(&job);
+            continue;
+        }
+
+        Job *job = AllocateJob();
+        job->function = NULL;
+        job->data = data;
+        job->counter = counter;
+        job->dependency = dependency;
+        job->rangeFunction = function;
+        job->begin = begin;
+        job->end = end;
+        Push(job);
+    }
+}
+
+Job *JobSystem::FindJob(int index) {
+    Job *job = mQueues[index].Pop();
+    if (job != NULL) {
+        return job;
+    }
+    for (int i = 1; i < mWorkerCount; ++i) {
+        job = mQueues[(index + i) % mWorkerCount].Steal();
+        if (job != NULL) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+bool JobSystem::RunOneJob(int index) {
+    Job *job = FindJob(index);
+    if (job == NULL) {
+        return false;
+    }
+    mQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+    if (job->dependency != NULL && job->dependency->load(std::memory_order_acquire) > 0) {
+        // Not ready yet. Run the oldest job of our own queue instead, which is
+        // where whatever we depend on most likely sits, and queue this one again.
+        // Each push refills a slot that taking a job out of this queue just freed
+        // (a job stolen from elsewhere means this queue was empty), so these
+        // pushes never find it full.
+        Job *other = mQueues[index].Steal();
+        Push(job);
+        if (other == NULL) {
+            return false;
+        }
+        mQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        job = other;
+        if (job->dependency != NULL && job->dependency->load(std::memory_order_acquire) > 0) {
+            Push(job);
+            return false;
+        }
+    }
+
+    Execute(job);
+    return true;
+}
+
+void JobSystem::Execute(Job *job) {
+    // the slot goes back to its pool before the job runs, which may submit more
+    const JobFunction function = job->function;
+    const JobRangeFunction rangeFunction = job->rangeFunction;
+    void *data = job->data;
+    JobCounter *counter = job->counter;
+    const int begin = job->begin, end = job->end;
+    job->busy.store(false, std::memory_order_release);
+
+    if (rangeFunction != NULL) {
+        rangeFunction(data, begin, end);
+    } else {
+        function(data);
+    }
+    if (counter != NULL) {
+        counter->fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void JobSystem::Wait(JobCounter *counter) {
+    const int index = tJobSystem == this ? tWorkerIndex : -1;
+    while (counter->load(std::memory_order_acquire) > 0) {
+        if (index < 0 || !RunOneJob(index)) {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef agdktunnel_job_system_hpp
+#define agdktunnel_job_system_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// jobs a single thread may have queued and running, must be a power of two
+#define JOB_SYSTEM_MAX_JOBS_PER_THREAD 4096
+
+// which cores the worker threads may run on
+#define JOB_CORES_ANY 0
+#define JOB_CORES_BIG 1
+#define JOB_CORES_LITTLE 2
+
+typedef void (*JobFunction)(void *data);
+typedef void (*JobRangeFunction)(void *data, int begin, int end);
+
+// Counts the unfinished jobs of a group. Submitting a job increments it, the job
+// finishing decrements it; waiting on a counter waits for it to reach zero.
+typedef std::atomic<int> JobCounter;
+
+struct Job {
+    JobFunction function;
+    void *data;
+
+    // decremented when the job finishes, may be NULL
+    JobCounter *counter;
+
+    // the job does not start before this counter reaches zero, may be NULL
+    JobCounter *dependency;
+
+    // for range jobs
+    JobRangeFunction rangeFunction;
+    int begin, end;
+
+    // the pool slot holds a queued or running job and can't be handed out
+    std::atomic<bool> busy;
+};
+
+class JobSystem {
+public:
+    // The thread creating the job system becomes worker 0 and is the only thread
+    // outside the pool that may submit jobs or wait on counters. workerCount
+    // includes that thread; zero picks one worker per core of the chosen class.
+    JobSystem(int workerCount, int coreClass);
+
+    ~JobSystem();
+
+    int GetWorkerCount() const {
+        return mWorkerCount;
+    }
+
+    void Submit(JobFunction function, void *data, JobCounter *counter,
+                JobCounter *dependency = NULL);
+
+    // splits [0, count) into batches of batchSize and runs them in parallel
+    void ParallelFor(int count, int batchSize, JobRangeFunction function, void *data,
+                     JobCounter *counter, JobCounter *dependency = NULL);
+
+    // runs other jobs until the counter reaches zero
+    void Wait(JobCounter *counter);
+
+    // Ids of the online cores of a class. Little cores are those with the lowest
+    // maximum frequency and big ones the rest, so the prime core of a tri-cluster
+    // CPU is big too; on a homogeneous CPU, or one with a single faster core,
+    // every core is big.
+    static void GetCores(int coreClass, std::vector<int> *cores);
+
+    // the same for each core's maximum frequency, 0 where it isn't known
+    static void GetCores(int coreClass, const std::vector<long> &frequencies,
+                         std::vector<int> *cores);
+
+private:
+    // Chase-Lev work-stealing deque of job pointers. The owner pushes and pops at
+    // the bottom, other workers steal from the top.
+    struct WorkerQueue {
+        alignas(64) std::atomic<int64_t> top;
+        alignas(64) std::atomic<int64_t> bottom;
+        std::atomic<Job *> jobs[JOB_SYSTEM_MAX_JOBS_PER_THREAD];
+
+        // job storage, recycled round robin skipping the busy slots
+        Job pool[JOB_SYSTEM_MAX_JOBS_PER_THREAD];
+        uint32_t poolNext;
+
+        bool Push(Job *job);
+        Job *Pop();
+        Job *Steal();
+    };
+
+    void WorkerMain(int index);
+    Job *AllocateJob();
+    void Push(Job *job);
+    Job *FindJob(int index);
+    bool RunOneJob(int index);
+    void Execute(Job *job);
+
+    int mWorkerCount;
+    WorkerQueue *mQueues;
+    std::vector<std::thread> mThreads;
+    std::vector<int> mCores;
+
+    // number of queued jobs, lets idle workers sleep instead of spinning
+    std::atomic<int> mQueuedJobs;
+    std::atomic<int> mSleepingWorkers;
+    std::atomic<bool> mQuit;
+    std::mutex mSleepLock;
+    std::condition_variable mSleepCondition;
+};
+
+#endif
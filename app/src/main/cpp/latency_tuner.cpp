@@ -0,0 +1,94 @@
+#include "latency_tuner.hpp"
+#include <cstring>
+
+LatencyTuner::LatencyTuner() {
+    Reset(0, 0, 0);
+}
+
+void LatencyTuner::Reset(int32_t framesPerBurst, int32_t capacityFrames, int32_t sampleRate) {
+    mFramesPerBurst = framesPerBurst;
+    mCapacity = capacityFrames;
+    mSampleRate = sampleRate;
+    mLastUnderrunCount = 0;
+    mQuietFrames = 0;
+    mCalmFrames = 0;
+    mTryingDecrease = false;
+    memset(mFailures, 0, sizeof(mFailures));
+
+    int32_t bufferSize = framesPerBurst * LATENCY_TUNER_START_BURSTS;
+    mBufferSize.store(bufferSize < capacityFrames ? bufferSize : capacityFrames,
+                      std::memory_order_relaxed);
+    mUnderruns.store(0, std::memory_order_relaxed);
+    mIncreases.store(0, std::memory_order_relaxed);
+    mDecreases.store(0, std::memory_order_relaxed);
+    mFailedDecreases.store(0, std::memory_order_relaxed);
+}
+
+int LatencyTuner::GetLevel(int32_t bufferSize) const {
+    const int level = bufferSize / mFramesPerBurst;
+    return level < LATENCY_TUNER_MAX_BURSTS ? level : LATENCY_TUNER_MAX_BURSTS - 1;
+}
+
+bool LatencyTuner::Update(int32_t underrunCount, int32_t frameCount) {
+    if (mFramesPerBurst <= 0) {
+        return false;
+    }
+    const int32_t bufferSize = mBufferSize.load(std::memory_order_relaxed);
+
+    if (underrunCount > mLastUnderrunCount) {
+        mUnderruns.fetch_add(underrunCount - mLastUnderrunCount, std::memory_order_relaxed);
+        mLastUnderrunCount = underrunCount;
+        mQuietFrames = 0;
+        mCalmFrames = 0;
+        if (mTryingDecrease) {
+            // this size is too small for now, and waits longer before it's tried again
+            mTryingDecrease = false;
+            mFailedDecreases.fetch_add(1, std::memory_order_relaxed);
+            uint8_t &failures = mFailures[GetLevel(bufferSize)];
+            failures = failures < 31 ? failures + 1 : failures;
+        }
+        if (bufferSize >= mCapacity) {
+            return false;
+        }
+        const int32_t larger = bufferSize + mFramesPerBurst;
+        mBufferSize.store(larger < mCapacity ? larger : mCapacity, std::memory_order_relaxed);
+        mIncreases.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    mQuietFrames += frameCount;
+    mCalmFrames += frameCount;
+    const int64_t quietFrames = (int64_t) mSampleRate * LATENCY_TUNER_QUIET_MS / 1000;
+    const int64_t maxQuietFrames = (int64_t) mSampleRate * LATENCY_TUNER_MAX_QUIET_MS / 1000;
+    if (mCalmFrames >= maxQuietFrames) {
+        // whatever made the smaller sizes underrun may have passed
+        mCalmFrames = 0;
+        for (int i = 0; i < LATENCY_TUNER_MAX_BURSTS; ++i) {
+            mFailures[i] = mFailures[i] > 0 ? mFailures[i] - 1 : 0;
+        }
+    }
+    if (mTryingDecrease && mQuietFrames >= quietFrames) {
+        // the last decrease held
+        mTryingDecrease = false;
+    }
+    if (bufferSize <= mFramesPerBurst) {
+        return false;
+    }
+    const int32_t smaller = bufferSize - mFramesPerBurst;
+    const int64_t waitFrames = quietFrames << mFailures[GetLevel(smaller)];
+    if (waitFrames > maxQuietFrames || mQuietFrames < waitFrames) {
+        return false;
+    }
+    mBufferSize.store(smaller, std::memory_order_relaxed);
+    mDecreases.fetch_add(1, std::memory_order_relaxed);
+    mQuietFrames = 0;
+    mTryingDecrease = true;
+    return true;
+}
+
+void LatencyTuner::GetStats(Stats *stats) const {
+    stats->underruns = mUnderruns.load(std::memory_order_relaxed);
+    stats->increases = mIncreases.load(std::memory_order_relaxed);
+    stats->decreases = mDecreases.load(std::memory_order_relaxed);
+    stats->failedDecreases = mFailedDecreases.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,80 @@
+#ifndef agdktunnel_latency_tuner_hpp
+#define agdktunnel_latency_tuner_hpp
+
+#include <atomic>
+#include <cstdint>
+
+// bursts a new stream's buffer starts at
+#define LATENCY_TUNER_START_BURSTS 2
+// how long the stream must go without an underrun before a burst less is
+// tried; doubled for each time that size underran, and no more tries past the
+// most. Each time the most passes without an underrun, one failure is forgotten.
+#define LATENCY_TUNER_QUIET_MS 5000
+#define LATENCY_TUNER_MAX_QUIET_MS 80000
+// buffer sizes, in bursts, whose failures are remembered; larger ones share the last
+#define LATENCY_TUNER_MAX_BURSTS 64
+
+/*
+ * Finds the smallest buffer an audio stream plays without underruns in. Each
+ * new underrun adds a burst to the buffer, up to its capacity. After a quiet
+ * spell a burst is taken away again; if that underruns too, the burst comes
+ * back and the next try of that size waits twice as long, so a device that
+ * really needs the bigger buffer glitches a handful of times at most, while a
+ * smaller size that never failed is tried again as soon as things calm down.
+ * Long calm spells wear the failures off, so a size that failed under load is
+ * tried again once the load has gone.
+ *
+ * Reset() and Update() run on the audio thread (or while it's stopped);
+ * GetBufferSize() and GetStats() from any thread.
+ */
+class LatencyTuner {
+public:
+    struct Stats {
+        int32_t underruns;
+        int32_t increases;
+        int32_t decreases;
+        // decreases that underran and were taken back
+        int32_t failedDecreases;
+    };
+
+    LatencyTuner();
+
+    // a new stream; its underrun count starts from 0
+    void Reset(int32_t framesPerBurst, int32_t capacityFrames, int32_t sampleRate);
+
+    // With the stream's underrun count so far and the frames of this callback.
+    // Returns true if the buffer size changed.
+    bool Update(int32_t underrunCount, int32_t frameCount);
+
+    // in frames
+    int32_t GetBufferSize() const {
+        return mBufferSize.load(std::memory_order_relaxed);
+    }
+
+    void GetStats(Stats *stats) const;
+
+private:
+    // the buffer size in bursts, as an index of mFailures
+    int GetLevel(int32_t bufferSize) const;
+
+    int32_t mFramesPerBurst;
+    int32_t mCapacity;
+    int32_t mSampleRate;
+    int32_t mLastUnderrunCount;
+    // frames since the last underrun or change
+    int64_t mQuietFrames;
+    // frames since the last underrun or forgotten failure
+    int64_t mCalmFrames;
+    // the last change was a decrease that hasn't held for a quiet spell yet
+    bool mTryingDecrease;
+    // decreases to each size, in bursts, that underran
+    uint8_t mFailures[LATENCY_TUNER_MAX_BURSTS];
+
+    std::atomic<int32_t> mBufferSize;
+    std::atomic<int32_t> mUnderruns;
+    std::atomic<int32_t> mIncreases;
+    std::atomic<int32_t> mDecreases;
+    std::atomic<int32_t> mFailedDecreases;
+};
+
+#endif
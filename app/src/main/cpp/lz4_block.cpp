@@ -0,0 +1,228 @@
+#include "lz4_block.hpp"
+#include <cstring>
+
+// matches are at least this long
+#define LZ4_MIN_MATCH 4
+// the last match starts at least this many bytes before the end of the input...
+#define LZ4_MATCH_FIND_LIMIT 12
+// ...and the last bytes are always literals
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MAX_OFFSET 65535
+
+// size of the compressor's position table, as a power of two
+#define LZ4_HASH_LOG 12
+
+// bytes the decoder copies at once where there is room for it
+#define LZ4_FAST_COPY 16
+
+// after 2^n misses in a row the compressor starts skipping ahead faster
+#define LZ4_SKIP_TRIGGER 6
+
+namespace {
+    inline uint32_t read32(const uint8_t *p) {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t hash_sequence(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+    }
+
+    // a length field's extension bytes: runs of 255 and a final byte below 255
+    inline uint8_t *write_length(uint8_t *op, size_t length) {
+        while (length >= 255) {
+            *op++ = 255;
+            length -= 255;
+        }
+        *op++ = (uint8_t) length;
+        return op;
+    }
+
+    // a token, literal run and optional match; NULL if it doesn't fit
+    uint8_t *write_sequence(uint8_t *op, uint8_t *oend, const uint8_t *literals,
+                            size_t literalLength, size_t offset, size_t matchLength) {
+        const size_t worstCase = 1 + literalLength / 255 + 1 + literalLength + 2 +
+                                 matchLength / 255 + 1;
+        if (worstCase > (size_t) (oend - op)) {
+            return NULL;
+        }
+
+        uint8_t *token = op++;
+        *token = (uint8_t) ((literalLength < 15 ? literalLength : 15) << 4);
+        if (literalLength >= 15) {
+            op = write_length(op, literalLength - 15);
+        }
+        if (literalLength > 0) {
+            memcpy(op, literals, literalLength);
+            op += literalLength;
+        }
+
+        if (matchLength > 0) {
+            *op++ = (uint8_t) offset;
+            *op++ = (uint8_t) (offset >> 8);
+            const size_t code = matchLength - LZ4_MIN_MATCH;
+            *token |= (uint8_t) (code < 15 ? code : 15);
+            if (code >= 15) {
+                op = write_length(op, code - 15);
+            }
+        }
+        return op;
+    }
+}
+
+size_t Lz4Compress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity) {
+    if (srcSize > LZ4_MAX_INPUT_SIZE) {
+        return 0;
+    }
+    uint8_t *op = dst;
+    uint8_t *const oend = dst + dstCapacity;
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *const iend = src + srcSize;
+
+    if (srcSize > LZ4_MATCH_FIND_LIMIT) {
+        const uint8_t *const matchFindLimit = iend - LZ4_MATCH_FIND_LIMIT;
+        const uint8_t *const matchLimit = iend - LZ4_LAST_LITERALS;
+
+        // positions + 1 of the latest occurrence of each hashed sequence, 0 for none
+        uint32_t table[1 << LZ4_HASH_LOG];
+        memset(table, 0, sizeof(table));
+
+        unsigned misses = 0;
+        while (ip < matchFindLimit) {
+            const uint32_t sequence = read32(ip);
+            const uint32_t hash = hash_sequence(sequence);
+            const uint32_t candidate = table[hash];
+            table[hash] = (uint32_t) (ip - src) + 1;
+
+            const uint8_t *match = src + candidate - 1;
+            if (candidate == 0 || ip - match > LZ4_MAX_OFFSET || read32(match) != sequence) {
+                // incompressible stretches are crossed in growing steps
+                ip += 1 + (misses++ >> LZ4_SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+
+            // extend the match backwards over pending literals, then forwards
+            while (ip > anchor && match > src && ip[-1] == match[-1]) {
+                --ip;
+                --match;
+            }
+            size_t matchLength = LZ4_MIN_MATCH;
+            while (ip + matchLength < matchLimit && ip[matchLength] == match[matchLength]) {
+                ++matchLength;
+            }
+
+            op = write_sequence(op, oend, anchor, (size_t) (ip - anchor), (size_t) (ip - match),
+                                matchLength);
+            if (op == NULL) {
+                return 0;
+            }
+            ip += matchLength;
+            anchor = ip;
+
+            // remember a position inside the match too, it helps the next search
+            if (ip < matchFindLimit) {
+                table[hash_sequence(read32(ip - 2))] = (uint32_t) (ip - 2 - src) + 1;
+            }
+        }
+    }
+
+    op = write_sequence(op, oend, anchor, (size_t) (iend - anchor), 0, 0);
+    return op != NULL ? (size_t) (op - dst) : 0;
+}
+
+int64_t Lz4Decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity) {
+    const uint8_t *ip = src;
+    const uint8_t *const iend = src + srcSize;
+    uint8_t *op = dst;
+    uint8_t *const oend = dst + dstCapacity;
+
+    while (ip < iend) {
+        const unsigned token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            unsigned byte;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                byte = *ip++;
+                literalLength += byte;
+            } while (byte == 255);
+        }
+        if (literalLength > (size_t) (iend - ip) || literalLength > (size_t) (oend - op)) {
+            return -1;
+        }
+        if (literalLength <= LZ4_FAST_COPY && iend - ip >= LZ4_FAST_COPY &&
+            oend - op >= LZ4_FAST_COPY) {
+            // short runs are the common case, a fixed size copy beats a sized one
+            memcpy(op, ip, LZ4_FAST_COPY);
+        } else {
+            memcpy(op, ip, literalLength);
+        }
+        ip += literalLength;
+        op += literalLength;
+
+        if (ip == iend) {
+            // the last sequence has no match
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+        const size_t offset = ip[0] | ((size_t) ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t) (op - dst)) {
+            return -1;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15) {
+            unsigned byte;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                byte = *ip++;
+                matchLength += byte;
+            } while (byte == 255);
+        }
+        matchLength += LZ4_MIN_MATCH;
+        if (matchLength > (size_t) (oend - op)) {
+            return -1;
+        }
+
+        const uint8_t *match = op - offset;
+        if (offset >= LZ4_FAST_COPY && (size_t) (oend - op) >= matchLength + LZ4_FAST_COPY) {
+            // whole chunks, overshooting into space later sequences overwrite
+            for (size_t copied = 0; copied < matchLength; copied += LZ4_FAST_COPY) {
+                memcpy(op + copied, match + copied, LZ4_FAST_COPY);
+            }
+            op += matchLength;
+        } else if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+            op += matchLength;
+        } else if (offset >= 8) {
+            // overlapping, but whole words never overlap their own source
+            size_t copied = 0;
+            for (; copied + 8 <= matchLength; copied += 8) {
+                memcpy(op + copied, match + copied, 8);
+            }
+            for (; copied < matchLength; ++copied) {
+                op[copied] = match[copied];
+            }
+            op += matchLength;
+        } else {
+            // short repeating pattern
+            for (size_t i = 0; i < matchLength; ++i) {
+                op[i] = match[i];
+            }
+            op += matchLength;
+        }
+    }
+    return (int64_t) (op - dst);
+}
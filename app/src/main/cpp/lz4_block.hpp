@@ -0,0 +1,29 @@
+#ifndef agdktunnel_lz4_block_hpp
+#define agdktunnel_lz4_block_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * The LZ4 block format: a greedy single-pass compressor, and a decoder that
+ * never reads or writes out of bounds whatever the input. Blocks interoperate
+ * with the reference LZ4 implementation's block functions.
+ */
+
+// largest input a block may hold
+#define LZ4_MAX_INPUT_SIZE 0x7e000000
+
+// worst case compressed size of size bytes
+inline size_t Lz4CompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+// Compresses src into dst. Returns the compressed size, or 0 if it doesn't fit
+// in dstCapacity bytes.
+size_t Lz4Compress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity);
+
+// Decompresses a block into dst. Returns the decompressed size, or -1 if the
+// block is malformed or would decompress to more than dstCapacity bytes.
+int64_t Lz4Decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity);
+
+#endif
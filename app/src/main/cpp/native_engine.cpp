@@ -1,433 +1,467 @@
 #include "native_engine.hpp"
-#include "game-activity/native_app_glue/android_native_app_glue.h"
-#include <EGL/egl.h>
-#include <GLES3/gl3.h>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <string>
 #include "Log.h"
-#include "swappy/swappyGL.h"
+#include "asset_loader.hpp"
+#include "audio_mixer.hpp"
+#include "game_consts.hpp"
+#include "input_cooker.hpp"
+#include "performance_reporter.hpp"
+#include "pipeline_cache.hpp"
+#include "render_backend.hpp"
+#include "render_context.hpp"
+#include "shaders.hpp"
+#include "sound_streamer.hpp"
+#include "trace.hpp"
 
 #define LOG_TAG "GameActivityTutorial"
 #define VLOGD ALOGD
 
-struct CookedEvent {
-    int type;
+// the simulation runs at a fixed 60Hz whatever the display refresh rate
+#define SIMULATION_STEP_NS 16666667LL
+// frame time beyond this many steps is dropped instead of caught up
+#define SIMULATION_MAX_STEPS_PER_FRAME 5
 
-    // for pointer events
-    int motionPointerId;
-    bool motionIsOnScreen;
-    float motionX, motionY;
-    float motionMinX, motionMaxX;
-    float motionMinY, motionMaxY;
+// size of each of the two frame arena buffers
+#define FRAME_ARENA_SIZE (256 * 1024)
 
-    // whether a text input has occurred
-    bool textInputState;
-};
+// worker count for the job system including the game thread, 0 for one per big core
+#define JOB_SYSTEM_WORKER_COUNT 0
 
-// event type
-#define COOKED_EVENT_TYPE_POINTER_DOWN 0
-#define COOKED_EVENT_TYPE_POINTER_UP 1
-#define COOKED_EVENT_TYPE_POINTER_MOVE 2
-#define COOKED_EVENT_TYPE_TEXT_INPUT 7
+// memory the resource manager keeps resident before it evicts the least recently used
+#define RESOURCE_CPU_BUDGET (64 * 1024 * 1024)
+#define RESOURCE_GPU_BUDGET (128 * 1024 * 1024)
 
-typedef bool (*CookedEventCallback)(struct CookedEvent *event);
+// what is kept of the budgets when the system runs low on memory
+#define RESOURCE_LOW_MEMORY_CPU_TARGET (RESOURCE_CPU_BUDGET / 4)
+#define RESOURCE_LOW_MEMORY_GPU_TARGET (RESOURCE_GPU_BUDGET / 4)
 
-NativeEngine *NativeEngine::_singleton = NULL;
+// the tone a touch plays while it is down: pitch and pan follow it across the screen
+#define TOUCH_TONE_LOW_HZ 220.0
+#define TOUCH_TONE_HIGH_HZ 880.0
+#define TOUCH_TONE_GAIN 0.2f
 
-NativeEngine::NativeEngine(struct android_app *app) {
-    mApp = app;
+// music looped while the engine runs, if the pack has it: an IMA ADPCM .wav at
+// the stream's 48kHz, streamed out of the pack
+#define MUSIC_ASSET "music/tunnel.wav"
+#define MUSIC_GAIN 0.5f
 
-    mEglDisplay = EGL_NO_DISPLAY;
-    mEglSurface = EGL_NO_SURFACE;
-    mEglContext = EGL_NO_CONTEXT;
-    mEglConfig = 0;
+// sections of the engine's snapshot
+#define SNAPSHOT_SECTION_SIMULATION 1
+#define SNAPSHOT_SECTION_QUALITY 2
 
-    mHasFocus = mIsVisible = mHasWindow = false;
-    mHasGLObjects = false;
-    mIsFirstFrame = true;
-
-    mSurfWidth = mSurfHeight = 0;
-    _singleton = this;
-    mIsInputMode = false;
+NativeEngine *NativeEngine::_singleton = NULL;
 
-    mTextInputState.text_UTF8 = "";
-    mTextInputState.text_length = 0;
-    mTextInputState.selection.start = 0;
-    mTextInputState.selection.end = 0;
-    mTextInputState.composingRegion.start = -1;
-    mTextInputState.composingRegion.end = -1;
+// the fidelity levels the controller moves between, cheapest first
+static const FidelityParams FIDELITY_LEVELS[] = {
+        {RENDER_TUNNEL_SECTION_COUNT, TUNNEL_SECTION_LENGTH},
+        {HIGH_TUNNEL_SECTION_COUNT, HIGH_TUNNEL_SECTION_LENGTH},
+};
 
-    ALOGI("Calling SwappyGL_init");
-    SwappyGL_init(GetJniEnv(), mApp->activity->javaGameActivity);
-    SwappyGL_setSwapIntervalNS(SWAPPY_SWAP_60FPS);
+// the level a cold start begins at, whose parameters the APK trains with
+#define FIDELITY_TRAINING_LEVEL 0
 
-    mTuningManager = new TuningManager(GetJniEnv(), app->activity->javaGameActivity, app->config);
+// the far plane: just past the last section of the window
+static float _tunnel_far_z(const FidelityParams &params) {
+    return (float) (params.tunnelSectionCount + 1) * params.tunnelSectionLength;
 }
 
-NativeEngine::~NativeEngine() {
-    delete mTuningManager;
-    SwappyGL_destroy();
-    KillContext();
+static void _handle_cmd_proxy(void *userData, int32_t cmd) {
+    NativeEngine *engine = (NativeEngine *) userData;
+    engine->HandleCommand(cmd);
 }
 
-JNIEnv *NativeEngine::GetJniEnv() {
-    if (!mJniEnv) {
-        ALOGI("Attaching current thread to JNI.");
-        if (0 != mApp->activity->vm->AttachCurrentThread(&mJniEnv, NULL)) {
-            ALOGE("*** FATAL ERROR: Failed to attach thread to JNI.");
-        }
-        ALOGI("Attached current thread to JNI, %p", mJniEnv);
-    }
-    return mJniEnv;
-}
+NativeEngine::NativeEngine(Platform *platform)
+        : mTimestep(platform->GetClock(), SIMULATION_STEP_NS, SIMULATION_MAX_STEPS_PER_FRAME),
+          mFrameScheduler(platform->GetClock()),
+          mFrameArena(FRAME_ARENA_SIZE),
+          mFidelityController(FIDELITY_LEVELS, sizeof(FIDELITY_LEVELS) / sizeof(FIDELITY_LEVELS[0]),
+                              FIDELITY_TRAINING_LEVEL),
+          mResources(RESOURCE_CPU_BUDGET, RESOURCE_GPU_BUDGET) {
+    mPlatform = platform;
 
-bool NativeEngine::InitDisplay() {
-    if (mEglDisplay != EGL_NO_DISPLAY) {
-        return true;
-    }
+    mHasFocus = mIsVisible = mHasWindow = false;
+    mHasGLObjects = false;
+    mIsLoading = true;
+    mPipelineGeneration = 0;
 
-    mEglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
-    if (EGL_FALSE == eglInitialize(mEglDisplay, 0, 0)) {
-        ALOGE("NativeEngine: failed to init display, error %d", eglGetError());
-        return false;
-    }
-    return true;
-}
+    mSurfWidth = mSurfHeight = 0;
+    memset(&mSimState, 0, sizeof(mSimState));
+    mPrevSimState = mSimState;
+    mWasAnimating = false;
 
-bool NativeEngine::InitSurface() {
-//    ASSERT(mEglDisplay != EGL_NO_DISPLAY);
-    if (mEglSurface != EGL_NO_SURFACE) {
-        return true;
-    }
-
-    EGLint numConfigs;
-    const EGLint attribs[] = {
-            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT, // request OpenGL ES 2.0
-            EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
-            EGL_BLUE_SIZE, 8,
-            EGL_GREEN_SIZE, 8,
-            EGL_RED_SIZE, 8,
-            EGL_DEPTH_SIZE, 16,
-            EGL_NONE
-    };
-
-    // Pick the first EGLConfig that matches.
-    eglChooseConfig(mEglDisplay, attribs, &mEglConfig, 1, &numConfigs);
-    mEglSurface = eglCreateWindowSurface(mEglDisplay, mEglConfig, mApp->window,
-                                         NULL);
-    if (mEglSurface == EGL_NO_SURFACE) {
-        ALOGE("Failed to create EGL surface, EGL error %d", eglGetError());
-        return false;
+    // the game thread is worker 0 of the job system
+    mJobSystem = new JobSystem(JOB_SYSTEM_WORKER_COUNT, JOB_CORES_BIG);
+    _singleton = this;
+    mIsInputMode = false;
+    mDroppedCookedEvents = 0;
+    mTouchVoice = -1;
+    mTouchPointerId = -1;
+    mMusic = NULL;
+    mMusicVoice = -1;
+    mFrameStats.Clear();
+    mFidelityParams = mFidelityController.GetParams();
+    mRestoredFidelity = false;
+    mVisibleSectionCount = 0;
+    mCulledSections = 0;
+    Trace::SetThreadName("Game");
+
+    // every asset in the pack is managed, none is loaded before it is acquired
+    AssetLoader *assetLoader = mPlatform->GetAssetLoader();
+    if (assetLoader != NULL) {
+        const AssetPack *pack = assetLoader->GetPack();
+        for (int i = 0; i < pack->GetEntryCount(); ++i) {
+            mResources.AddAsset(assetLoader, pack->GetName(i), 0);
+        }
     }
-    return true;
-}
-
-bool NativeEngine::InitContext() {
-//    ASSERT(mEglDisplay != EGL_NO_DISPLAY);
-    if (mEglContext != EGL_NO_CONTEXT) {
-        return true;
+    StartMusic();
+
+    // a process killed in the background left where it was
+    const void *savedState;
+    size_t savedStateSize;
+    if (mPlatform->GetSavedState(&savedState, &savedStateSize)) {
+        const int64_t startNs = mPlatform->GetClock()->NowNs();
+        if (ReadSnapshot(savedState, savedStateSize)) {
+            ALOGI("NativeEngine: resumed from a %zu byte snapshot in %.3f ms", savedStateSize,
+                  (double) (mPlatform->GetClock()->NowNs() - startNs) / 1e6);
+        } else {
+            ALOGW("NativeEngine: ignoring saved state, starting cold");
+        }
     }
 
-    // OpenGL ES 2.0
-    EGLint attribList[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
-    mEglContext = eglCreateContext(mEglDisplay, mEglConfig, NULL, attribList);
-    if (mEglContext == EGL_NO_CONTEXT) {
-        ALOGE("Failed to create EGL context, EGL error %d", eglGetError());
-        return false;
-    }
-    return true;
+    mPlatform->SetCommandCallback(_handle_cmd_proxy, this);
 }
 
-void NativeEngine::ConfigureOpenGL() {
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
-    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+NativeEngine::~NativeEngine() {
+    mPlatform->SetCommandCallback(NULL, NULL);
+    StopMusic();
+    delete mJobSystem;
+    if (_singleton == this) {
+        _singleton = NULL;
+    }
 }
 
-static void _handle_cmd_proxy(struct android_app *app, int32_t cmd) {
-    NativeEngine *engine = (NativeEngine *) app->userData;
-    engine->HandleCommand(cmd);
+void NativeEngine::WriteSnapshot(SnapshotWriter *writer) {
+    writer->BeginSection(SNAPSHOT_SECTION_SIMULATION);
+    writer->WriteU64(mSimState.step);
+    writer->WriteF32(mSimState.cameraZ);
+    writer->EndSection();
+
+    // the quality the device settled on, so it doesn't have to be found again
+    writer->BeginSection(SNAPSHOT_SECTION_QUALITY);
+    writer->WriteI32(mFidelityController.GetLevel());
+    writer->WriteI32(mFidelityParams.tunnelSectionCount);
+    writer->WriteF32(mFidelityParams.tunnelSectionLength);
+    writer->WriteI32(mResolutionController.GetStep());
+    writer->EndSection();
 }
 
-static bool _cook_game_activity_motion_event(GameActivityMotionEvent *motionEvent,
-                                             int screenWidth, int screenHeight,
-                                             CookedEventCallback callback) {
-    if (motionEvent->pointerCount > 0) {
-        int action = motionEvent->action;
-        int actionMasked = action & AMOTION_EVENT_ACTION_MASK;
-        int ptrIndex = (action & AMOTION_EVENT_ACTION_POINTER_INDEX_MASK) >>
-                                                                          AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
-
-        if (ptrIndex < motionEvent->pointerCount) {
-            struct CookedEvent ev;
-            memset(&ev, 0, sizeof(ev));
-
-            if (actionMasked == AMOTION_EVENT_ACTION_DOWN || actionMasked ==
-                                                             AMOTION_EVENT_ACTION_POINTER_DOWN) {
-                ev.type = COOKED_EVENT_TYPE_POINTER_DOWN;
-            } else if (actionMasked == AMOTION_EVENT_ACTION_UP || actionMasked ==
-                                                                  AMOTION_EVENT_ACTION_POINTER_UP) {
-                ev.type = COOKED_EVENT_TYPE_POINTER_UP;
-            } else {
-                ev.type = COOKED_EVENT_TYPE_POINTER_MOVE;
-            }
-
-            ev.motionPointerId = motionEvent->pointers[ptrIndex].id;
-            ev.motionIsOnScreen = motionEvent->source == AINPUT_SOURCE_TOUCHSCREEN;
-            ev.motionX = GameActivityPointerAxes_getX(&motionEvent->pointers[ptrIndex]);
-            ev.motionY = GameActivityPointerAxes_getY(&motionEvent->pointers[ptrIndex]);
-
-            if (ev.motionIsOnScreen) {
-                // use screen size as the motion range
-                ev.motionMinX = 0.0f;
-                ev.motionMaxX = screenWidth;
-                ev.motionMinY = 0.0f;
-                ev.motionMaxY = screenHeight;
-            }
-
-            return callback(&ev);
+bool NativeEngine::ReadSnapshot(const void *data, size_t size) {
+    SnapshotReader reader;
+    if (!reader.Open(data, size)) {
+        return false;
+    }
+    SimState simState = mSimState;
+    int32_t fidelityLevel = mFidelityController.GetLevel();
+    FidelityParams fidelityParams = mFidelityParams;
+    int32_t resolutionStep = mResolutionController.GetStep();
+    uint32_t tag;
+    while (reader.NextSection(&tag)) {
+        switch (tag) {
+            case SNAPSHOT_SECTION_SIMULATION:
+                reader.ReadU64(&simState.step);
+                reader.ReadF32(&simState.cameraZ);
+                break;
+            case SNAPSHOT_SECTION_QUALITY:
+                reader.ReadI32(&fidelityLevel);
+                reader.ReadI32(&fidelityParams.tunnelSectionCount);
+                reader.ReadF32(&fidelityParams.tunnelSectionLength);
+                reader.ReadI32(&resolutionStep);
+                break;
+            default:
+                // from a newer build
+                break;
         }
     }
-    return false;
-}
-
-static bool _cooked_event_callback(struct CookedEvent *event) {
-    switch (event->type) {
-        case COOKED_EVENT_TYPE_POINTER_DOWN:
-            ALOGD("COOKED_EVENT_TYPE_POINTER_DOWN: %f %f %f %f %f %f %d",
-                  event->motionX, event->motionY, event->motionMinX, event->motionMinY, event->motionMaxX, event->motionMaxY, event->motionIsOnScreen);
-            NativeEngine::GetInstance()->mIsInputMode = !NativeEngine::GetInstance()->mIsInputMode;
-            NativeEngine::GetInstance()->UpdateInputMode();
-            return true;
-        case COOKED_EVENT_TYPE_POINTER_UP:
-            ALOGD("COOKED_EVENT_TYPE_POINTER_UP: %f %f %f %f %f %f %d",
-                  event->motionX, event->motionY, event->motionMinX, event->motionMinY, event->motionMaxX, event->motionMaxY, event->motionIsOnScreen);
-            return true;
-        case COOKED_EVENT_TYPE_POINTER_MOVE:
-            ALOGD("COOKED_EVENT_TYPE_POINTER_MOVE: %f %f %f %f %f %f %d",
-                  event->motionX, event->motionY, event->motionMinX, event->motionMinY, event->motionMaxX, event->motionMaxY, event->motionIsOnScreen);
-            return true;
-        default:
-            return false;
+    if (reader.HasFailed() || !std::isfinite(simState.cameraZ) || simState.cameraZ < 0.0f ||
+        fidelityParams.tunnelSectionCount < 1 ||
+        fidelityParams.tunnelSectionCount > MAX_TUNNEL_SECTION_COUNT ||
+        !(fidelityParams.tunnelSectionLength > 0.0f)) {
+        ALOGW("NativeEngine: snapshot doesn't hold a usable state");
+        return false;
     }
+
+    // the tunnel is rebuilt around the camera by the first frame
+    mSimState = mPrevSimState = simState;
+    mFidelityController.SetLevel(fidelityLevel);
+    mFidelityParams = fidelityParams;
+    mRestoredFidelity = true;
+    mResolutionController.SetStep(resolutionStep);
+    PerformanceReporter *reporter = mPlatform->GetPerformanceReporter();
+    reporter->ReportFidelityParams(mFidelityParams);
+    reporter->ReportResolutionStep(mResolutionController.GetStep());
+    return true;
 }
 
 void NativeEngine::UpdateInputMode() {
-    if(mIsInputMode) {
-        GameActivity_setTextInputState(mApp->activity, &mTextInputState);
-        GameActivity_showSoftInput(mApp->activity, 0);
-    } else {
-        GameActivity_hideSoftInput(mApp->activity, 0);
-    }
+    mPlatform->SetTextInputVisible(mIsInputMode);
 }
 
 void NativeEngine::HandleCommand(int32_t cmd) {
+    TRACE_SCOPE("HandleCommand");
     VLOGD("NativeEngine: handling command %d.", cmd);
     switch (cmd) {
-        case APP_CMD_SAVE_STATE:
+        case PLATFORM_CMD_SAVE_STATE:
             // The system has asked us to save our current state.
-            VLOGD("NativeEngine: APP_CMD_SAVE_STATE");
+            VLOGD("NativeEngine: PLATFORM_CMD_SAVE_STATE");
+            {
+                const int64_t startNs = mPlatform->GetClock()->NowNs();
+                mSnapshot.Clear();
+                WriteSnapshot(&mSnapshot);
+                mSnapshot.Finish();
+                mPlatform->SaveState(mSnapshot.GetData(), mSnapshot.GetSize());
+                ALOGI("NativeEngine: saved a %zu byte snapshot in %.3f ms", mSnapshot.GetSize(),
+                      (double) (mPlatform->GetClock()->NowNs() - startNs) / 1e6);
+            }
             break;
-        case APP_CMD_INIT_WINDOW:
+        case PLATFORM_CMD_INIT_WINDOW:
             // We have a window!
-            VLOGD("NativeEngine: APP_CMD_INIT_WINDOW");
-            if (mApp->window != NULL) {
+            VLOGD("NativeEngine: PLATFORM_CMD_INIT_WINDOW");
+            if (mPlatform->AttachWindow()) {
                 mHasWindow = true;
-                SwappyGL_setWindow(mApp->window);
             }
             VLOGD("HandleCommand(%d): hasWindow = %d, hasFocus = %d", cmd,
                   mHasWindow ? 1 : 0, mHasFocus ? 1 : 0);
-
-            mSinePlayer.startAudio();
             break;
-        case APP_CMD_TERM_WINDOW:
+        case PLATFORM_CMD_TERM_WINDOW:
             // The window is going away -- kill the surface
-            VLOGD("NativeEngine: APP_CMD_TERM_WINDOW");
-            KillSurface();
+            VLOGD("NativeEngine: PLATFORM_CMD_TERM_WINDOW");
+            // nothing is drawn until a new window comes, so GPU memory goes while
+            // the context is still current to delete it
+            mResources.Trim(RESOURCE_CPU_BUDGET, 0);
+            mPlatform->KillSurface();
             mHasWindow = false;
             break;
-        case APP_CMD_GAINED_FOCUS:
-            VLOGD("NativeEngine: APP_CMD_GAINED_FOCUS");
+        case PLATFORM_CMD_GAINED_FOCUS:
+            VLOGD("NativeEngine: PLATFORM_CMD_GAINED_FOCUS");
             mHasFocus = true;
             break;
-        case APP_CMD_LOST_FOCUS:
-            VLOGD("NativeEngine: APP_CMD_LOST_FOCUS");
+        case PLATFORM_CMD_LOST_FOCUS:
+            VLOGD("NativeEngine: PLATFORM_CMD_LOST_FOCUS");
             mHasFocus = false;
             break;
-        case APP_CMD_PAUSE:
-            VLOGD("NativeEngine: APP_CMD_PAUSE");
+        case PLATFORM_CMD_PAUSE:
+            VLOGD("NativeEngine: PLATFORM_CMD_PAUSE");
+            // still open, so a resume is quick
+            mPlatform->PauseAudio();
             break;
-        case APP_CMD_RESUME:
-            VLOGD("NativeEngine: APP_CMD_RESUME");
+        case PLATFORM_CMD_RESUME:
+            VLOGD("NativeEngine: PLATFORM_CMD_RESUME");
+            mPlatform->StartAudio();
             break;
-        case APP_CMD_STOP:
-            VLOGD("NativeEngine: APP_CMD_STOP");
+        case PLATFORM_CMD_STOP:
+            VLOGD("NativeEngine: PLATFORM_CMD_STOP");
             mIsVisible = false;
+            LogStats();
+            // nothing plays in the background, and the audio device can sleep
+            mPlatform->StopAudio();
             break;
-        case APP_CMD_START:
-            VLOGD("NativeEngine: APP_CMD_START");
+        case PLATFORM_CMD_START:
+            VLOGD("NativeEngine: PLATFORM_CMD_START");
             mIsVisible = true;
+            mPlatform->OpenAudio();
             break;
-        case APP_CMD_WINDOW_RESIZED:
-        case APP_CMD_CONFIG_CHANGED:
-            VLOGD("NativeEngine: %s", cmd == APP_CMD_WINDOW_RESIZED ?
-                                      "APP_CMD_WINDOW_RESIZED" : "APP_CMD_CONFIG_CHANGED");
+        case PLATFORM_CMD_WINDOW_RESIZED:
+        case PLATFORM_CMD_CONFIG_CHANGED:
+            VLOGD("NativeEngine: %s", cmd == PLATFORM_CMD_WINDOW_RESIZED ?
+                                      "PLATFORM_CMD_WINDOW_RESIZED" :
+                                      "PLATFORM_CMD_CONFIG_CHANGED");
             break;
-        case APP_CMD_LOW_MEMORY:
-            VLOGD("NativeEngine: APP_CMD_LOW_MEMORY");
+        case PLATFORM_CMD_LOW_MEMORY:
+            VLOGD("NativeEngine: PLATFORM_CMD_LOW_MEMORY");
+            mResources.Trim(RESOURCE_LOW_MEMORY_CPU_TARGET, RESOURCE_LOW_MEMORY_GPU_TARGET);
             if (!mHasWindow) {
+                // the context's own objects are rebuilt when a window comes back
                 VLOGD("NativeEngine: trimming memory footprint (deleting GL objects).");
-//                KillGLObjects();
+                mPlatform->GetRenderContext()->KillContext();
             }
             break;
-        case APP_CMD_CONTENT_RECT_CHANGED:
-            VLOGD("NativeEngine: APP_CMD_CONTENT_RECT_CHANGED");
+        case PLATFORM_CMD_CONTENT_RECT_CHANGED:
+            VLOGD("NativeEngine: PLATFORM_CMD_CONTENT_RECT_CHANGED");
             break;
-        case APP_CMD_WINDOW_REDRAW_NEEDED:
-            VLOGD("NativeEngine: APP_CMD_WINDOW_REDRAW_NEEDED");
+        case PLATFORM_CMD_WINDOW_REDRAW_NEEDED:
+            VLOGD("NativeEngine: PLATFORM_CMD_WINDOW_REDRAW_NEEDED");
             break;
-        case APP_CMD_WINDOW_INSETS_CHANGED:
-            VLOGD("NativeEngine: APP_CMD_WINDOW_INSETS_CHANGED");
-            ARect insets;
-            // Log all the insets types
-            for (int type = 0; type < GAMECOMMON_INSETS_TYPE_COUNT; ++type) {
-                GameActivity_getWindowInsets(mApp->activity, (GameCommonInsetsType)type, &insets);
-//                VLOGD("%s insets: left=%d right=%d top=%d bottom=%d",
-//                      sInsetsTypeName[type], insets.left, insets.right, insets.top, insets.bottom);
-            }
+        case PLATFORM_CMD_WINDOW_INSETS_CHANGED:
+            VLOGD("NativeEngine: PLATFORM_CMD_WINDOW_INSETS_CHANGED");
+            mPlatform->UpdateWindowInsets();
             break;
         default:
             VLOGD("NativeEngine: (unknown command).");
             break;
     }
 
-    VLOGD("NativeEngine: STATUS: F%d, V%d, W%d, EGL: D %p, S %p, CTX %p, CFG %p",
-          mHasFocus, mIsVisible, mHasWindow, mEglDisplay, mEglSurface, mEglContext,
-          mEglConfig);
-}
-
-bool NativeEngine::IsAnimating() {
-//    VLOGD("NativeEngine: IsAnimating %d %d %d", mHasFocus, mIsVisible, mHasWindow);
-    return mHasFocus && mIsVisible && mHasWindow;
+    VLOGD("NativeEngine: STATUS: F%d, V%d, W%d", mHasFocus, mIsVisible, mHasWindow);
 }
 
-// kill context
-void NativeEngine::KillContext() {
-    eglMakeCurrent(mEglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
-
-    if (mEglContext != EGL_NO_CONTEXT) {
-        eglDestroyContext(mEglDisplay, mEglContext);
-        mEglContext = EGL_NO_CONTEXT;
+void NativeEngine::LogStats() {
+    ALOGI("NativeEngine: simulation %llu frames, %llu steps, %llu idle frames, "
+          "%llu extra steps, %llu dropped steps",
+          (unsigned long long) mTimestep.GetStats().frames,
+          (unsigned long long) mTimestep.GetStats().steps,
+          (unsigned long long) mTimestep.GetStats().idleFrames,
+          (unsigned long long) mTimestep.GetStats().extraSteps,
+          (unsigned long long) mTimestep.GetStats().droppedSteps);
+    ALOGI("NativeEngine: scheduler %llu frames, %.1f ms idle, %.1f ms busy, "
+          "%llu missed deadlines",
+          (unsigned long long) mFrameScheduler.GetStats().frames,
+          (double) mFrameScheduler.GetStats().idleNs / 1e6,
+          (double) mFrameScheduler.GetStats().busyNs / 1e6,
+          (unsigned long long) mFrameScheduler.GetStats().missedDeadlines);
+    ALOGI("NativeEngine: frame arena high water %zu of %zu bytes, "
+          "%llu overflow allocations (%llu bytes)",
+          mFrameArena.GetStats().highWater, mFrameArena.GetBufferSize(),
+          (unsigned long long) mFrameArena.GetStats().overflowAllocations,
+          (unsigned long long) mFrameArena.GetStats().overflowBytes);
+    const PipelineCache::Stats pipelineStats = mPlatform->GetPipelineCache()->GetStats();
+    ALOGI("NativeEngine: pipelines %llu compiled (%.1f ms), %llu loaded (%.1f ms), "
+          "%llu rejected binaries, %llu failed, %llu waits",
+          (unsigned long long) pipelineStats.compiles, (double) pipelineStats.compileNs / 1e6,
+          (unsigned long long) pipelineStats.diskLoads, (double) pipelineStats.diskLoadNs / 1e6,
+          (unsigned long long) pipelineStats.rejectedBinaries,
+          (unsigned long long) pipelineStats.failures,
+          (unsigned long long) pipelineStats.backgroundWaits);
+    const RenderContext::Stats &contextStats = mPlatform->GetRenderContext()->GetStats();
+    ALOGI("NativeEngine: render context %llu contexts, %llu surfaces, %llu errors, "
+          "%llu recoveries (last %.1f ms, max %.1f ms)",
+          (unsigned long long) contextStats.contextsCreated,
+          (unsigned long long) contextStats.surfacesCreated,
+          (unsigned long long) contextStats.errors,
+          (unsigned long long) contextStats.recoveries,
+          (double) contextStats.lastRecoveryNs / 1e6, (double) contextStats.maxRecoveryNs / 1e6);
+    ALOGI("NativeEngine: fidelity level %d, %llu upgrades (%llu reverted), "
+          "%llu downgrades",
+          mFidelityController.GetLevel(),
+          (unsigned long long) mFidelityController.GetStats().upgrades,
+          (unsigned long long) mFidelityController.GetStats().revertedUpgrades,
+          (unsigned long long) mFidelityController.GetStats().downgrades);
+    ALOGI("NativeEngine: resolution scale %.2f, %llu downscales, %llu upscales",
+          (double) mResolutionController.GetScale(),
+          (unsigned long long) mResolutionController.GetStats().downscales,
+          (unsigned long long) mResolutionController.GetStats().upscales);
+    ALOGI("NativeEngine: tunnel built %llu sections, %llu resets, %llu culled",
+          (unsigned long long) mTunnel.GetStats().sectionsBuilt,
+          (unsigned long long) mTunnel.GetStats().resets,
+          (unsigned long long) mCulledSections);
+    const ResourceManager::Stats &resourceStats = mResources.GetStats();
+    ALOGI("NativeEngine: resources %llu hits, %llu loads (%.1f ms), %llu evictions, "
+          "%llu trims, %zu KB CPU (peak %zu KB), %zu KB GPU (peak %zu KB)",
+          (unsigned long long) resourceStats.hits, (unsigned long long) resourceStats.loads,
+          (double) resourceStats.loadNs / 1e6, (unsigned long long) resourceStats.evictions,
+          (unsigned long long) resourceStats.trims, resourceStats.cpuBytes / 1024,
+          resourceStats.peakCpuBytes / 1024, resourceStats.gpuBytes / 1024,
+          resourceStats.peakGpuBytes / 1024);
+    AssetLoader *assetLoader = mPlatform->GetAssetLoader();
+    if (assetLoader != NULL) {
+        const AssetLoader::Stats assetStats = assetLoader->GetStats();
+        ALOGI("NativeEngine: assets %llu requests, %llu views, %llu decoded (%.1f ms), "
+              "%llu failed",
+              (unsigned long long) assetStats.requests, (unsigned long long) assetStats.views,
+              (unsigned long long) assetStats.decodes, (double) assetStats.decodeNs / 1e6,
+              (unsigned long long) assetStats.failures);
     }
-}
-
-void NativeEngine::KillSurface() {
-    eglMakeCurrent(mEglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
-    if (mEglSurface != EGL_NO_SURFACE) {
-        eglDestroySurface(mEglDisplay, mEglSurface);
-        mEglSurface = EGL_NO_SURFACE;
+    AudioMixer *mixer = mPlatform->GetAudioMixer();
+    if (mixer != NULL) {
+        ALOGI("NativeEngine: audio %d voices playing, %llu commands (%llu dropped), "
+              "%llu plays refused",
+              mixer->GetPlayingCount(), (unsigned long long) mixer->GetStats().commandsSent,
+              (unsigned long long) mixer->GetStats().commandsDropped,
+              (unsigned long long) mixer->GetStats().voicesRefused);
     }
-}
-
-// also causes context and surface to get killed
-void NativeEngine::KillDisplay() {
-    KillContext();
-    KillSurface();
-
-    if (mEglDisplay != EGL_NO_DISPLAY) {
-        ALOGI("NativeEngine: terminating display now.");
-        eglTerminate(mEglDisplay);
-        mEglDisplay = EGL_NO_DISPLAY;
+    SoundStreamer *streamer = mPlatform->GetSoundStreamer();
+    if (streamer != NULL) {
+        const SoundStreamer::Stats streamStats = streamer->GetStats();
+        ALOGI("NativeEngine: %d sound streams, %llu frames decoded (%.1f ms), %d underruns",
+              streamStats.openStreams, (unsigned long long) streamStats.decodedFrames,
+              (double) streamStats.decodeNs / 1e6, streamStats.underruns);
     }
-}
-
-bool NativeEngine::HandleEglError(EGLint error) {
-    switch (error) {
-        case EGL_SUCCESS:
-            // nothing to do
-            return true;
-        case EGL_CONTEXT_LOST:
-            ALOGW("NativeEngine: egl error: EGL_CONTEXT_LOST. Recreating context.");
-            KillContext();
-            exit(-1);
-            return true;
-        case EGL_BAD_CONTEXT:
-            ALOGW("NativeEngine: egl error: EGL_BAD_CONTEXT. Recreating context.");
-            KillContext();
-            exit(-1);
-            return true;
-        case EGL_BAD_DISPLAY:
-            ALOGW("NativeEngine: egl error: EGL_BAD_DISPLAY. Recreating display.");
-            KillDisplay();
-            exit(-1);
-            return true;
-        case EGL_BAD_SURFACE:
-            ALOGW("NativeEngine: egl error: EGL_BAD_SURFACE. Recreating display.");
-            KillSurface();
-            exit(-1);
-            return true;
-        default:
-            ALOGW("NativeEngine: unknown egl error: %d", error);
-            exit(-1);
-            return false;
+    AudioStats audioStats;
+    if (mPlatform->GetAudioStats(&audioStats)) {
+        ALOGI("NativeEngine: audio stream %s, buffer %d of %d frames (burst %d, %.1f ms "
+              "latency), %d underruns, buffer grown %d and shrunk %d times, %d reopens",
+              audioStats.playing ? "playing" : (audioStats.open ? "paused" : "closed"),
+              audioStats.bufferSize, audioStats.bufferCapacity, audioStats.framesPerBurst,
+              audioStats.latencyMs, audioStats.underruns, audioStats.bufferIncreases,
+              audioStats.bufferDecreases, audioStats.reopens);
     }
 }
 
-bool NativeEngine::PrepareToRender() {
-    if (mEglDisplay == EGL_NO_DISPLAY || mEglSurface == EGL_NO_SURFACE ||
-        mEglContext == EGL_NO_CONTEXT) {
-
-        // create display if needed
-        if (!InitDisplay()) {
-            ALOGE("NativeEngine: failed to create display.");
-            return false;
-        }
-
-        // create surface if needed
-        if (!InitSurface()) {
-            ALOGE("NativeEngine: failed to create surface.");
-            return false;
-        }
-
-        // create context if needed
-        if (!InitContext()) {
-            ALOGE("NativeEngine: failed to create context.");
-            return false;
-        }
-
-        ALOGI("NativeEngine: binding surface and context (display %p, surface %p, context %p)",
-              mEglDisplay, mEglSurface, mEglContext);
-
-        // bind them
-        if (EGL_FALSE == eglMakeCurrent(mEglDisplay, mEglSurface, mEglSurface, mEglContext)) {
-            ALOGE("NativeEngine: eglMakeCurrent failed, EGL error %d", eglGetError());
-            HandleEglError(eglGetError());
-        }
+bool NativeEngine::IsAnimating() {
+//    VLOGD("NativeEngine: IsAnimating %d %d %d", mHasFocus, mIsVisible, mHasWindow);
+    return mHasFocus && mIsVisible && mHasWindow;
+}
 
-        // configure our global OpenGL settings
-        ConfigureOpenGL();
-    }
-    return true;
+void NativeEngine::EndPhase(int phase, int64_t *phaseStartNs) {
+    const int64_t nowNs = mPlatform->GetClock()->NowNs();
+    mFrameStats.Add(phase, nowNs - *phaseStartNs);
+    *phaseStartNs = nowNs;
 }
 
 void NativeEngine::DoFrame() {
+    TRACE_SCOPE("DoFrame");
+    int64_t phaseStartNs = mPlatform->GetClock()->NowNs();
+
+    // advance the simulation in fixed steps on a worker while this thread gets the
+    // context and surface ready, then render between the last two states
+    struct SimulationJob {
+        NativeEngine *engine;
+        int steps;
+    } simulationJob = {this, mTimestep.BeginFrame()};
+    JobCounter simulationDone(0);
+    mJobSystem->Submit([](void *data) {
+        SimulationJob *job = (SimulationJob *) data;
+        job->engine->StepSimulation(job->steps);
+    }, &simulationJob, &simulationDone);
+
     // prepare to render (create context, surfaces, etc, if needed)
-    if (!PrepareToRender()) {
-        // not ready
+    bool prepared;
+    {
+        TRACE_SCOPE("PrepareToRender");
+        prepared = mPlatform->PrepareToRender();
+    }
+    if (!prepared) {
+        // not ready; the job still points at this frame
         ALOGE("NativeEngine: preparation to render failed.");
+        mJobSystem->Wait(&simulationDone);
+        mFrameArena.EndFrame();
         return;
     }
 
-    if (mIsFirstFrame) {
-        mIsFirstFrame = false;
-        mTuningManager->FinishLoading();
+    PipelineCache *pipelines = mPlatform->GetPipelineCache();
+    if (!mHasGLObjects || mPipelineGeneration != pipelines->GetGeneration()) {
+        // a new context: build its programs in the background, the first frames don't need them
+        pipelines->StartPrecompile(ENGINE_PIPELINES, ENGINE_PIPELINE_COUNT);
+        // resources holding objects of a lost context load again when next acquired
+        mResources.ForgetGpuResources();
+        mPipelineGeneration = pipelines->GetGeneration();
+        mHasGLObjects = true;
     }
+    if (mIsLoading && pipelines->IsPrecompileDone()) {
+        // loading time includes building the pipelines
+        mIsLoading = false;
+        mPlatform->GetPerformanceReporter()->FinishLoading();
+    }
+    UpdateFidelityParams();
 
     // how big is the surface? We query every frame because it's cheap, and some
     // strange devices out there change the surface size without calling any callbacks...
     int width, height;
-    eglQuerySurface(mEglDisplay, mEglSurface, EGL_WIDTH, &width);
-    eglQuerySurface(mEglDisplay, mEglSurface, EGL_HEIGHT, &height);
+    {
+        TRACE_SCOPE("SurfaceQuery");
+        mPlatform->GetSurfaceSize(&width, &height);
+    }
 
     if (width != mSurfWidth || height != mSurfHeight) {
         // notify scene manager that the surface has changed size
@@ -435,78 +469,360 @@ void NativeEngine::DoFrame() {
               width, height);
         mSurfWidth = width;
         mSurfHeight = height;
-        glViewport(0, 0, mSurfWidth, mSurfHeight);
     }
+    EndPhase(FRAME_PHASE_PREPARE, &phaseStartNs);
+
+    {
+        TRACE_SCOPE("WaitSimulation");
+        mJobSystem->Wait(&simulationDone);
+    }
+    EndPhase(FRAME_PHASE_SIMULATION, &phaseStartNs);
+
+    {
+        TRACE_SCOPE("Render");
+        RenderFrame(LerpSimState(mPrevSimState, mSimState, mTimestep.GetAlpha()));
+    }
+    EndPhase(FRAME_PHASE_RENDER, &phaseStartNs);
+
+    mFrameScheduler.BeginPresent();
+    {
+        TRACE_SCOPE("Present");
+        mPlatform->Present();
+    }
+    mFrameScheduler.EndFrame();
+    EndPhase(FRAME_PHASE_PRESENT, &phaseStartNs);
+
+    // judge the level on the work done, blocking in present only says we kept up
+    const int64_t periodNs = mPlatform->GetPresentPeriodNs();
+    mFidelityController.SetBudget(periodNs);
+    if (mFidelityController.AddFrame(mFrameScheduler.GetStats().lastBusyNs)) {
+        mFidelityParams = mFidelityController.GetParams();
+        mRestoredFidelity = false;
+        mPlatform->GetPerformanceReporter()->ReportFidelityParams(mFidelityParams);
+    }
+    // resolution follows the GPU's share of the frame where it can be measured
+    mResolutionController.SetBudget(periodNs);
+    if (mResolutionController.AddFrame(mFrameScheduler.GetStats().lastBusyNs,
+                                       mPlatform->GetGpuFrameNs())) {
+        mPlatform->GetPerformanceReporter()->ReportResolutionStep(mResolutionController.GetStep());
+    }
+    ++mFrameStats.frames;
 
-    // Swap buffers.
-    if (!SwappyGL_swap(mEglDisplay, mEglSurface)) {        // failed to swap buffers...
-        ALOGW("NativeEngine: SwappyGL_swap failed, EGL error %d", eglGetError());
-        HandleEglError(eglGetError());
+    mResources.EndFrame();
+    mFrameArena.EndFrame();
+}
+
+void NativeEngine::StepSimulation(int steps) {
+    TRACE_SCOPE("StepSimulation");
+    for (int i = 0; i < steps; ++i) {
+        mPrevSimState = mSimState;
+        UpdateSimState(&mSimState, mTimestep.GetStepSeconds());
     }
 }
 
-void NativeEngine::GameLoop() {
-    mApp->userData = this;
-    mApp->onAppCmd = _handle_cmd_proxy;
+void NativeEngine::UpdateFidelityParams() {
+    FidelityParams params;
+    if (!mPlatform->GetPerformanceReporter()->PollFidelityParams(&params)) {
+        return;
+    }
+    const FidelityParams &training = FIDELITY_LEVELS[FIDELITY_TRAINING_LEVEL];
+    if (mRestoredFidelity && params.tunnelSectionCount == training.tunnelSectionCount &&
+        params.tunnelSectionLength == training.tunnelSectionLength) {
+        ALOGI("NativeEngine: keeping the restored fidelity over the training parameters");
+        return;
+    }
+    mRestoredFidelity = false;
+    if (params.tunnelSectionCount != mFidelityParams.tunnelSectionCount ||
+        params.tunnelSectionLength != mFidelityParams.tunnelSectionLength) {
+        ALOGI("NativeEngine: fidelity changed to %d tunnel sections of length %.1f",
+              params.tunnelSectionCount, (double) params.tunnelSectionLength);
+    }
+    mFidelityParams = params;
+    // the controller carries on from the nearest of its levels
+    mFidelityController.SetLevel(mFidelityController.FindLevel(params));
+}
+
+void NativeEngine::CullTunnel(const SimState &state) {
+    TRACE_SCOPE("CullTunnel");
+    const int sectionCount = mTunnel.GetWindowSections(mTunnelSections, MAX_TUNNEL_SECTION_COUNT);
+
+    // the camera rides the centre line, looking at a point further down it
+    float eye[3], target[3];
+    TunnelGeometry::GetCenter(state.cameraZ, &eye[0], &eye[1]);
+    eye[2] = state.cameraZ;
+    TunnelGeometry::GetCenter(state.cameraZ + CAMERA_LOOK_AHEAD, &target[0], &target[1]);
+    target[2] = state.cameraZ + CAMERA_LOOK_AHEAD;
+    float forward[3] = {target[0] - eye[0], target[1] - eye[1], target[2] - eye[2]};
+    const float length = sqrtf(forward[0] * forward[0] + forward[1] * forward[1] +
+                               forward[2] * forward[2]);
+    for (int i = 0; i < 3; ++i) {
+        forward[i] /= length;
+    }
+    const float up[3] = {0.0f, 1.0f, 0.0f};
+    const float aspect = mSurfHeight > 0 ? (float) mSurfWidth / (float) mSurfHeight : 1.0f;
+    Frustum frustum;
+    MakeFrustum(&frustum, eye, forward, up, CAMERA_FOV_Y, aspect, CAMERA_NEAR,
+                _tunnel_far_z(mFidelityParams));
+
+    float x[MAX_TUNNEL_SECTION_COUNT], y[MAX_TUNNEL_SECTION_COUNT];
+    float z[MAX_TUNNEL_SECTION_COUNT], radius[MAX_TUNNEL_SECTION_COUNT];
+    for (int i = 0; i < sectionCount; ++i) {
+        x[i] = mTunnelSections[i]->center[0];
+        y[i] = mTunnelSections[i]->center[1];
+        z[i] = mTunnelSections[i]->center[2];
+        radius[i] = mTunnelSections[i]->radius;
+    }
+    mVisibleSectionCount = CullSpheres(frustum, x, y, z, radius, sectionCount, mVisibleSections);
+    mCulledSections += sectionCount - mVisibleSectionCount;
+}
+
+void NativeEngine::RenderFrame(const SimState &state) {
+    {
+        TRACE_SCOPE("UpdateTunnel");
+        mTunnel.Update(state.cameraZ, mFidelityParams.tunnelSectionCount,
+                       mFidelityParams.tunnelSectionLength, TUNNEL_MAX_SECTION_BUILDS_PER_FRAME);
+    }
+    CullTunnel(state);
+
+    mRenderCommands.Clear();
+    mRenderCommands.AddClear(MakeRenderSortKey(RENDER_LAYER_OPAQUE, 0, 0, 0),
+                             RENDER_CLEAR_COLOR | RENDER_CLEAR_DEPTH, 0x000000ff);
+
+    // The visible sections get their draws once section meshes are uploaded;
+    // until then culling only feeds the stats.
 
+    if (mRenderCommands.GetDropped() > 0) {
+        ALOGW("NativeEngine: render command buffer full, dropped %d commands",
+              mRenderCommands.GetDropped());
+    }
+    mRenderCommands.Sort();
+
+    int renderWidth, renderHeight;
+    mResolutionController.GetRenderSize(mSurfWidth, mSurfHeight, &renderWidth, &renderHeight);
+    mPlatform->BeginFrame(renderWidth, renderHeight);
+    mPlatform->GetRenderBackend()->Execute(mRenderCommands);
+}
+
+void NativeEngine::GameLoop() {
     while (1) {
-        int events;
-        struct android_poll_source* source;
+        // scopes from here on belong to the frame about to be rendered
+        Trace::SetFrame(mFrameStats.frames);
 
         // If not animating, block until we get an event;
         // If animating, don't block.
-        while ((ALooper_pollAll(IsAnimating() ? 0 : -1, NULL, &events,
-                                (void **) &source)) >= 0) {
-            if (source != NULL) {
-                source->process(mApp, source);
+        const bool wasAnimating = IsAnimating();
+        int64_t phaseStartNs = mPlatform->GetClock()->NowNs();
+        while (mPlatform->PollEvent(IsAnimating() ? 0 : -1)) {
+            if (mPlatform->IsDestroyRequested()) {
+                return;
             }
-            if (mApp->destroyRequested) {
+        }
+        if (wasAnimating) {
+            // blocking waits while paused are not frame time
+            EndPhase(FRAME_PHASE_EVENTS, &phaseStartNs);
+        }
+
+        if (IsAnimating()) {
+            if (!mWasAnimating) {
+                // don't try to catch up on the time we spent paused
+                mTimestep.Reset();
+                mFrameScheduler.Reset();
+            }
+            if (!WaitForFrame()) {
                 return;
             }
+            mFrameScheduler.BeginFrame();
         }
+        phaseStartNs = mPlatform->GetClock()->NowNs();
 
-        HandleGameActivityInput();
+        // producer side: cook this frame's input into the event ring
+        HandleInput();
 
-        if (mApp->textInputState) {
+        if (mPlatform->PollTextInputChanged()) {
             struct CookedEvent ev;
+            memset(&ev, 0, sizeof(ev));
             ev.type = COOKED_EVENT_TYPE_TEXT_INPUT;
             ev.textInputState = true;
-            //_cooked_event_callback(&ev);
-            OnTextInput();
-            mApp->textInputState = 0;
+            PublishCookedEvent(ev);
         }
 
+        // consumer side: the game drains everything cooked so far
+        DrainCookedEvents();
+        EndPhase(FRAME_PHASE_INPUT, &phaseStartNs);
+
         if (IsAnimating()) {
             DoFrame();
         }
+        mWasAnimating = IsAnimating();
     }
 }
 
-void NativeEngine::HandleGameActivityInput() {
-    // Swap input buffers so we don't miss any events while processing inputBuffer.
-    android_input_buffer* inputBuffer = android_app_swap_input_buffers(mApp);
-    // Early exit if no events.
-    if (inputBuffer == nullptr) return;
-
-    if (inputBuffer->motionEventsCount != 0) {
-        for (uint64_t i = 0; i < inputBuffer->motionEventsCount; ++i) {
-            GameActivityMotionEvent* motionEvent = &inputBuffer->motionEvents[i];
-            // Didn't belong to a game controller, process it ourselves if it is a touch event
-            _cook_game_activity_motion_event(motionEvent, mSurfWidth, mSurfHeight, _cooked_event_callback);
+bool NativeEngine::WaitForFrame() {
+    TRACE_SCOPE("WaitForFrame");
+    mFrameScheduler.SetPresentPeriod(mPlatform->GetPresentPeriodNs());
+
+    // sleep on the event source rather than spinning, still handling events right away
+    int waitMs;
+    while (IsAnimating() && (waitMs = mFrameScheduler.GetWaitMs()) > 0) {
+        if (mPlatform->PollEvent(waitMs) && mPlatform->IsDestroyRequested()) {
+            return false;
         }
-        android_app_clear_motion_events(inputBuffer);
     }
+    return true;
 }
 
+void NativeEngine::HandleInput() {
+    TRACE_SCOPE("PollInput");
+    mTouchBatch.Clear();
+    mTouchBatch.SetScreenSize(mSurfWidth, mSurfHeight);
+
+    mPlatform->PollInput(&mTouchBatch);
+
+    if (mTouchBatch.dropped > 0) {
+        ALOGW("NativeEngine: touch batch full, dropped %d samples", mTouchBatch.dropped);
+    }
+    PublishTouchBatch(mTouchBatch);
+}
+
+void NativeEngine::PublishTouchBatch(const TouchBatch &batch) {
+    struct CookedEvent ev;
+    for (int i = 0; i < batch.count; ++i) {
+        batch.GetEvent(i, &ev);
+        PublishCookedEvent(ev);
+    }
+}
+
+void NativeEngine::PublishCookedEvent(const CookedEvent &ev) {
+    if (!mCookedEvents.Push(ev)) {
+        ++mDroppedCookedEvents;
+    }
+}
+
+void NativeEngine::DrainCookedEvents() {
+    TRACE_SCOPE("DrainInput");
+    struct CookedEvent events[64];
+    size_t count;
+    while ((count = mCookedEvents.PopMany(events, sizeof(events) / sizeof(events[0]))) > 0) {
+        for (size_t i = 0; i < count; ++i) {
+            HandleCookedEvent(events[i]);
+        }
+    }
+
+    if (mDroppedCookedEvents > 0) {
+        ALOGW("NativeEngine: cooked event ring full, dropped %d events", mDroppedCookedEvents);
+        mDroppedCookedEvents = 0;
+    }
+}
+
+bool NativeEngine::HandleCookedEvent(const CookedEvent &event) {
+    switch (event.type) {
+        case COOKED_EVENT_TYPE_POINTER_DOWN:
+            VLOGD("COOKED_EVENT_TYPE_POINTER_DOWN: id %d %f %f", event.motionPointerId,
+                  event.motionX, event.motionY);
+            mIsInputMode = !mIsInputMode;
+            UpdateInputMode();
+            StartTouchTone(event);
+            return true;
+        case COOKED_EVENT_TYPE_POINTER_UP:
+            VLOGD("COOKED_EVENT_TYPE_POINTER_UP: id %d %f %f", event.motionPointerId,
+                  event.motionX, event.motionY);
+            StopTouchTone(event);
+            return true;
+        case COOKED_EVENT_TYPE_POINTER_MOVE:
+            MoveTouchTone(event);
+            return true;
+        case COOKED_EVENT_TYPE_TEXT_INPUT:
+            OnTextInput();
+            return true;
+        default:
+            return false;
+    }
+}
+
+// where the touch is across the screen, 0 at the left edge to 1 at the right
+static float _touch_across(const CookedEvent &event) {
+    const float width = event.motionMaxX - event.motionMinX;
+    if (width <= 0.0f) {
+        return 0.5f;
+    }
+    const float across = (event.motionX - event.motionMinX) / width;
+    return across < 0.0f ? 0.0f : (across > 1.0f ? 1.0f : across);
+}
+
+static double _touch_tone_hz(float across) {
+    return TOUCH_TONE_LOW_HZ * pow(TOUCH_TONE_HIGH_HZ / TOUCH_TONE_LOW_HZ, (double) across);
+}
+
+void NativeEngine::StartTouchTone(const CookedEvent &event) {
+    AudioMixer *mixer = mPlatform->GetAudioMixer();
+    if (mixer == NULL || mTouchVoice >= 0) {
+        return;
+    }
+    const float across = _touch_across(event);
+    mTouchVoice = mixer->Play(OSCILLATOR_SINE, _touch_tone_hz(across), TOUCH_TONE_GAIN,
+                              2.0f * across - 1.0f);
+    mTouchPointerId = mTouchVoice >= 0 ? event.motionPointerId : -1;
+}
+
+void NativeEngine::MoveTouchTone(const CookedEvent &event) {
+    AudioMixer *mixer = mPlatform->GetAudioMixer();
+    if (mixer == NULL || mTouchVoice < 0 || event.motionPointerId != mTouchPointerId) {
+        return;
+    }
+    const float across = _touch_across(event);
+    mixer->SetFrequency(mTouchVoice, _touch_tone_hz(across));
+    mixer->SetPan(mTouchVoice, 2.0f * across - 1.0f);
+}
+
+void NativeEngine::StopTouchTone(const CookedEvent &event) {
+    AudioMixer *mixer = mPlatform->GetAudioMixer();
+    if (mixer == NULL || mTouchVoice < 0 || event.motionPointerId != mTouchPointerId) {
+        return;
+    }
+    mixer->Stop(mTouchVoice);
+    mTouchVoice = -1;
+    mTouchPointerId = -1;
+}
+
+void NativeEngine::StartMusic() {
+    AudioMixer *mixer = mPlatform->GetAudioMixer();
+    SoundStreamer *streamer = mPlatform->GetSoundStreamer();
+    AssetLoader *assetLoader = mPlatform->GetAssetLoader();
+    if (mixer == NULL || streamer == NULL || assetLoader == NULL) {
+        return;
+    }
+    const AssetPack *pack = assetLoader->GetPack();
+    const int index = pack->Find(MUSIC_ASSET);
+    if (index < 0) {
+        return;
+    }
+    AssetView view;
+    if (!pack->GetView(index, &view)) {
+        ALOGW("NativeEngine: %s is compressed in the pack, can't stream it", MUSIC_ASSET);
+        return;
+    }
+    mMusic = streamer->Open(view, true);
+    if (mMusic != NULL) {
+        mMusicVoice = mixer->PlayStream(mMusic, MUSIC_GAIN, 0.0f);
+    }
+}
+
+void NativeEngine::StopMusic() {
+    if (mMusic == NULL) {
+        return;
+    }
+    // A voice that didn't hear the stop still plays the stream, which can't be
+    // freed under it; the streamer frees it with the rest when it goes.
+    if (mPlatform->GetAudioMixer()->Stop(mMusicVoice)) {
+        mPlatform->GetSoundStreamer()->Close(mMusic);
+    } else {
+        ALOGW("NativeEngine: mixer queue full, leaving the music's stream open");
+    }
+    mMusic = NULL;
+    mMusicVoice = -1;
+}
 
 void NativeEngine::OnTextInput() {
-    auto activity = mApp->activity;
-    GameActivity_getTextInputState(activity, [](void *context, const GameTextInputState *state) {
-        VLOGD("InputString: %s", state->text_UTF8);
-        NativeEngine::GetInstance()->mTextInputState = *state;
-    }, this);
-    ARect insets;
-    GameTextInput_getImeInsets(GameActivity_getTextInput(activity), &insets);
-//    VLOGD("NativeEngine", "IME insets: left=%d right=%d top=%d bottom=%d",
-//                        insets.left, insets.right, insets.top, insets.bottom);
+    mPlatform->GetTextInput(&mInputText);
+    VLOGD("NativeEngine: text input: %s", mInputText.c_str());
 }
@@ -3,23 +3,35 @@
 
 #pragma once
 
-#include <EGL/egl.h>
-#include <game-text-input/gametextinput.h>
-#include "OboeSinePlayer.h"
-#include "tuning_manager.hpp"
+#include <string>
+#include "fidelity_controller.hpp"
+#include "fixed_timestep.hpp"
+#include "frame_arena.hpp"
+#include "frame_scheduler.hpp"
+#include "frame_stats.hpp"
+#include "frustum_culling.hpp"
+#include "input_cooker.hpp"
+#include "job_system.hpp"
+#include "performance_reporter.hpp"
+#include "platform.hpp"
+#include "render_commands.hpp"
+#include "resolution_controller.hpp"
+#include "resource_manager.hpp"
+#include "sim_state.hpp"
+#include "snapshot.hpp"
+#include "sound_streamer.hpp"
+#include "spsc_ring.hpp"
+#include "tunnel_geometry.hpp"
 
 class NativeEngine {
 public:
-    // create an engine
-    NativeEngine(struct android_app *app);
+    // create an engine running on the given platform, which must outlive it
+    NativeEngine(Platform *platform);
     ~NativeEngine();
 
     // runs application until it dies
     void GameLoop();
 
-    // returns the JNI environment
-    JNIEnv *GetJniEnv();
-
     void HandleCommand(int32_t cmd);
     static NativeEngine *GetInstance() {
         return _singleton;
@@ -27,49 +39,146 @@ public:
 
     void UpdateInputMode();
 
+    const FrameStats &GetFrameStats() const {
+        return mFrameStats;
+    }
+
+    // scratch memory for the current frame, valid until the end of the next one
+    FrameArena *GetFrameArena() {
+        return &mFrameArena;
+    }
+
+    const FrameScheduler::Stats &GetSchedulerStats() const {
+        return mFrameScheduler.GetStats();
+    }
+
+    const SimState &GetSimState() const {
+        return mSimState;
+    }
+
+    const FidelityParams &GetFidelityParams() const {
+        return mFidelityParams;
+    }
+
+    // adds the state a relaunched process resumes from to the writer
+    void WriteSnapshot(SnapshotWriter *writer);
+
+    // resumes from a snapshot, false (and nothing changed) if it can't be used
+    bool ReadSnapshot(const void *data, size_t size);
+
+    // the pack's assets and whatever else is loaded on demand and evicted under pressure
+    ResourceManager *GetResourceManager() {
+        return &mResources;
+    }
+
     bool mIsInputMode;
-    GameTextInputState mTextInputState;
 
 private:
     bool IsAnimating();
     void DoFrame();
-    void HandleGameActivityInput();
-
-    bool InitDisplay();
-    bool InitSurface();
-    bool InitContext();
-    void ConfigureOpenGL();
-    bool PrepareToRender();
-
-    // kill context
-    void KillContext();
-    void KillSurface();
-    void KillDisplay(); // also causes context and surface to get killed
-    bool HandleEglError(EGLint error);
+    // sleeps until shortly before the next present deadline; false if destroy was requested
+    bool WaitForFrame();
+    void StepSimulation(int steps);
+    void RenderFrame(const SimState &state);
+    void CullTunnel(const SimState &state);
+    void HandleInput();
+    void PublishTouchBatch(const TouchBatch &batch);
+    void PublishCookedEvent(const CookedEvent &ev);
+    void DrainCookedEvents();
+    bool HandleCookedEvent(const CookedEvent &event);
+    // a tone plays while the first touch is down
+    void StartTouchTone(const CookedEvent &event);
+    void MoveTouchTone(const CookedEvent &event);
+    void StopTouchTone(const CookedEvent &event);
+    // loops the pack's music, if it has any, while the engine runs
+    void StartMusic();
+    void StopMusic();
     void OnTextInput();
+    void UpdateFidelityParams();
+    // logs the counters of the frame loop's parts
+    void LogStats();
 
-    // android_app structure
-    struct android_app *mApp;
-    static NativeEngine *_singleton;
+    // adds the time since *phaseStartNs to a phase and restarts the phase timer
+    void EndPhase(int phase, int64_t *phaseStartNs);
 
-    EGLDisplay mEglDisplay;
-    EGLSurface mEglSurface;
-    EGLContext mEglContext;
-    EGLConfig mEglConfig;
+    Platform *mPlatform;
+    static NativeEngine *_singleton;
 
     bool mHasFocus, mIsVisible, mHasWindow;
     bool mHasGLObjects;
-    bool mIsFirstFrame;
+    // until the first frame is up with every pipeline built
+    bool mIsLoading;
+    // pipeline cache generation the pipelines were last started for
+    uint32_t mPipelineGeneration;
 
     int mSurfWidth, mSurfHeight;
 
-    // JNI environment
-    JNIEnv *mJniEnv;
+    // fixed-step simulation; rendering interpolates between the last two states
+    FixedTimestep mTimestep;
+    SimState mPrevSimState, mSimState;
+    bool mWasAnimating;
+
+    // when to start each frame so it is ready just before its present deadline
+    FrameScheduler mFrameScheduler;
+
+    // per-frame engine work runs on these workers
+    JobSystem *mJobSystem;
+
+    // touch samples cooked this frame
+    TouchBatch mTouchBatch;
+
+    // cooked events travel from the input stage to the game through this ring, so
+    // cooking can move to its own thread without touching the consumer side
+    SpscRing<CookedEvent, 1024> mCookedEvents;
+    int mDroppedCookedEvents;
+
+    // last text received from the soft keyboard
+    std::string mInputText;
+
+    // the mixer's voice for the tone of the touch that is down, and its pointer
+    int mTouchVoice;
+    int mTouchPointerId;
+
+    // the music's stream and the voice playing it
+    SoundStream *mMusic;
+    int mMusicVoice;
+
+    FrameStats mFrameStats;
+
+    // the frame's draw commands, sorted before they go to the platform's backend
+    RenderCommandBuffer mRenderCommands;
+
+    // transient allocations of the game thread, recycled at the end of every DoFrame
+    FrameArena mFrameArena;
+
+    // quality settings currently in effect, from the controller or the performance reporter
+    FidelityParams mFidelityParams;
+
+    // moves between fidelity levels as frame costs rise and fall
+    FidelityController mFidelityController;
+
+    // The level came from a snapshot. Until it changes, the training parameters
+    // a performance reporter hands over don't replace it; on a device those are
+    // the APK's defaults, not anything measured there.
+    bool mRestoredFidelity;
+
+    // scales the frame below the surface size when the GPU can't keep up
+    ResolutionController mResolutionController;
+
+    // tunnel sections around the camera, streamed in as it moves
+    TunnelGeometry mTunnel;
+
+    // this frame's built sections, and which of them the camera can see
+    const TunnelGeometry::Section *mTunnelSections[MAX_TUNNEL_SECTION_COUNT];
+    uint32_t mVisibleSections[MAX_TUNNEL_SECTION_COUNT];
+    int mVisibleSectionCount;
+    uint64_t mCulledSections;
 
-    // Tuning manager instance
-    TuningManager *mTuningManager;
+    // loads on demand within the memory budgets, sheds on low memory and window loss
+    ResourceManager mResources;
 
-    OboeSinePlayer mSinePlayer;
+    // kept so saving state doesn't allocate once it has been done
+    SnapshotWriter mSnapshot;
 };
 
-#endif//__NATIVE_ENGINE_H__
\ No newline at end of file
+#endif//__NATIVE_ENGINE_H__
@@ -0,0 +1,170 @@
+#include "oscillator_bank.hpp"
+#include <cmath>
+#include <cstring>
+#include "simd.hpp"
+
+namespace {
+    // one cycle of phase
+    const double kPhaseRange = 4294967296.0;
+
+    // Taylor series of sin(2 pi v), good to 6e-8 for v in [-0.25, 0.25]
+    const float kSine1 = 6.28318531f;
+    const float kSine3 = -41.3417022f;
+    const float kSine5 = 81.6052493f;
+    const float kSine7 = -76.7058598f;
+    const float kSine9 = 42.0586939f;
+    const float kSine11 = -15.0946426f;
+
+    // sin(2 pi phase / 2^32): as cos(2 pi t) with t = phase / 2^32 - 0.25 wrapped to
+    // [-0.5, 0.5), which is sin(2 pi (0.25 - |t|)) with the argument in the polynomial's range
+    inline Float4 sine(Int4 phase) {
+        const Float4 t = Float4Mul(Int4ToFloat4(Int4Add(phase, Int4Set1(-0x40000000))),
+                                   Float4Set1((float) (1.0 / kPhaseRange)));
+        const Float4 v = Float4Sub(Float4Set1(0.25f), Float4Abs(t));
+        const Float4 v2 = Float4Mul(v, v);
+        Float4 y = Float4MulAdd(Float4Set1(kSine11), v2, Float4Set1(kSine9));
+        y = Float4MulAdd(y, v2, Float4Set1(kSine7));
+        y = Float4MulAdd(y, v2, Float4Set1(kSine5));
+        y = Float4MulAdd(y, v2, Float4Set1(kSine3));
+        y = Float4MulAdd(y, v2, Float4Set1(kSine1));
+        return Float4Mul(y, v);
+    }
+
+    inline void accumulate(float *block, Float4 y, Float4 amplitude) {
+        Float4Store(block, Float4MulAdd(y, amplitude, Float4Load(block)));
+    }
+}
+
+OscillatorBank::OscillatorBank(int sampleRate) {
+    mCount = 0;
+    mSampleRate = sampleRate;
+    memset(mOscillators, 0, sizeof(mOscillators));
+    memset(mBlock, 0, sizeof(mBlock));
+}
+
+int OscillatorBank::Add(int wave, double frequency, float amplitude) {
+    if (mCount >= OSCILLATOR_MAX_COUNT) {
+        return -1;
+    }
+    const int id = mCount++;
+    Oscillator &oscillator = mOscillators[id];
+    oscillator.amplitude = amplitude;
+    // xorshift state must not be 0
+    for (int lane = 0; lane < 4; ++lane) {
+        oscillator.noise[lane] = (int32_t) (0x9e3779b9u * (uint32_t) (id * 4 + lane + 1) | 1u);
+    }
+    Restart(id, wave, frequency);
+    return id;
+}
+
+void OscillatorBank::Restart(int id, int wave, double frequency) {
+    mOscillators[id].wave = wave;
+    mOscillators[id].phase = 0;
+    SetFrequency(id, frequency);
+}
+
+void OscillatorBank::SetFrequency(int id, double frequency) {
+    const double nyquist = mSampleRate * 0.5;
+    frequency = frequency < 0.0 ? 0.0 : (frequency > nyquist ? nyquist : frequency);
+    mOscillators[id].increment = (uint32_t) llround(frequency / mSampleRate * kPhaseRange);
+}
+
+void OscillatorBank::SetAmplitude(int id, float amplitude) {
+    mOscillators[id].amplitude = amplitude;
+}
+
+double OscillatorBank::GetFrequency(int id) const {
+    return mOscillators[id].increment * (double) mSampleRate / kPhaseRange;
+}
+
+void OscillatorBank::RenderBlock(int frameCount) {
+    memset(mBlock, 0, ((frameCount + 3) & ~3) * sizeof(float));
+    for (int id = 0; id < mCount; ++id) {
+        Accumulate(id, mBlock, frameCount);
+    }
+}
+
+void OscillatorBank::Accumulate(int id, float *mono, int frameCount) {
+    // whole groups of four; the samples past frameCount are computed and ignored
+    const int sampleCount = (frameCount + 3) & ~3;
+    Oscillator &oscillator = mOscillators[id];
+    const uint32_t p = oscillator.phase;
+    const uint32_t inc = oscillator.increment;
+    const int32_t lanes[4] = {(int32_t) p, (int32_t) (p + inc), (int32_t) (p + 2 * inc),
+                              (int32_t) (p + 3 * inc)};
+    Int4 phase = Int4Load(lanes);
+    const Int4 step = Int4Set1((int32_t) (4 * inc));
+    const Float4 amplitude = Float4Set1(oscillator.amplitude);
+
+    switch (oscillator.wave) {
+        case OSCILLATOR_SINE:
+            for (int i = 0; i < sampleCount; i += 4) {
+                accumulate(mono + i, sine(phase), amplitude);
+                phase = Int4Add(phase, step);
+            }
+            break;
+        case OSCILLATOR_SAW:
+            // the phase as a signed fraction of a cycle, from 0 up to 1 then -1 up to 0
+            for (int i = 0; i < sampleCount; i += 4) {
+                const Float4 y = Float4Mul(Int4ToFloat4(phase),
+                                           Float4Set1((float) (2.0 / kPhaseRange)));
+                accumulate(mono + i, y, amplitude);
+                phase = Int4Add(phase, step);
+            }
+            break;
+        case OSCILLATOR_SQUARE:
+            // 1 for the first half of the cycle, -1 for the second
+            for (int i = 0; i < sampleCount; i += 4) {
+                const Float4 half = Int4ToFloat4(Int4ShiftRight(phase, 31));
+                accumulate(mono + i, Float4MulAdd(half, Float4Set1(-2.0f), Float4Set1(1.0f)),
+                           amplitude);
+                phase = Int4Add(phase, step);
+            }
+            break;
+        case OSCILLATOR_NOISE: {
+            // a xorshift generator per lane
+            Int4 state = Int4Load(oscillator.noise);
+            for (int i = 0; i < sampleCount; i += 4) {
+                state = Int4Xor(state, Int4ShiftLeft(state, 13));
+                state = Int4Xor(state, Int4ShiftRight(state, 17));
+                state = Int4Xor(state, Int4ShiftLeft(state, 5));
+                const Float4 y = Float4Mul(Int4ToFloat4(state),
+                                           Float4Set1((float) (2.0 / kPhaseRange)));
+                accumulate(mono + i, y, amplitude);
+            }
+            Int4Store(oscillator.noise, state);
+            break;
+        }
+        default:
+            break;
+    }
+    oscillator.phase = p + inc * (uint32_t) frameCount;
+}
+
+void OscillatorBank::Render(float *out, int frameCount, int channelCount) {
+    while (frameCount > 0) {
+        const int count = frameCount < OSCILLATOR_BLOCK_FRAMES ? frameCount
+                                                               : OSCILLATOR_BLOCK_FRAMES;
+        RenderBlock(count);
+
+        int i = 0;
+        if (channelCount == 1) {
+            memcpy(out, mBlock, count * sizeof(float));
+            i = count;
+        } else if (channelCount == 2) {
+            for (; i + 4 <= count; i += 4) {
+                const Float4 m = Float4Load(mBlock + i);
+                Float4Store(out + 2 * i, Float4ZipLow(m, m));
+                Float4Store(out + 2 * i + 4, Float4ZipHigh(m, m));
+            }
+        }
+        for (; i < count; ++i) {
+            for (int channel = 0; channel < channelCount; ++channel) {
+                out[i * channelCount + channel] = mBlock[i];
+            }
+        }
+
+        out += count * channelCount;
+        frameCount -= count;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef agdktunnel_oscillator_bank_hpp
+#define agdktunnel_oscillator_bank_hpp
+
+#include <cstdint>
+
+// waveforms
+#define OSCILLATOR_SINE 0
+// saw and square aren't band-limited, they alias at high pitches
+#define OSCILLATOR_SAW 1
+#define OSCILLATOR_SQUARE 2
+#define OSCILLATOR_NOISE 3
+
+// oscillators a bank holds
+#define OSCILLATOR_MAX_COUNT 32
+// frames rendered at once; a multiple of 4
+#define OSCILLATOR_BLOCK_FRAMES 256
+
+/*
+ * Oscillators summed into interleaved float frames four samples at a time (see
+ * simd.hpp). Phase is a uint32_t that wraps once per cycle, so it never drifts
+ * no matter how long the oscillator runs; the frequency is rounded to a
+ * multiple of sampleRate / 2^32 Hz. Sine is a polynomial of the phase,
+ * accurate to about 2e-7.
+ *
+ * Render() doesn't allocate or lock, so it can run in the audio callback; the
+ * other methods must not run at the same time as it.
+ */
+class OscillatorBank {
+public:
+    explicit OscillatorBank(int sampleRate);
+
+    // returns the oscillator's id, -1 if the bank is full
+    int Add(int wave, double frequency, float amplitude);
+
+    void SetFrequency(int id, double frequency);
+
+    void SetAmplitude(int id, float amplitude);
+
+    // starts the oscillator over from phase 0 as another wave
+    void Restart(int id, int wave, double frequency);
+
+    // the frequency the oscillator actually runs at
+    double GetFrequency(int id) const;
+
+    int GetCount() const {
+        return mCount;
+    }
+
+    void Clear() {
+        mCount = 0;
+    }
+
+    // writes frameCount frames of the oscillators' sum, the same on every channel
+    void Render(float *out, int frameCount, int channelCount);
+
+    // adds frameCount samples of one oscillator to mono, which has room for
+    // frameCount rounded up to a multiple of 4
+    void Accumulate(int id, float *mono, int frameCount);
+
+private:
+    struct Oscillator {
+        int wave;
+        uint32_t phase;
+        uint32_t increment;
+        float amplitude;
+        // xorshift state of each lane, for noise
+        int32_t noise[4];
+    };
+
+    // sums frameCount (up to OSCILLATOR_BLOCK_FRAMES) frames into mBlock
+    void RenderBlock(int frameCount);
+
+    Oscillator mOscillators[OSCILLATOR_MAX_COUNT];
+    int mCount;
+    int mSampleRate;
+
+    alignas(16) float mBlock[OSCILLATOR_BLOCK_FRAMES];
+};
+
+#endif
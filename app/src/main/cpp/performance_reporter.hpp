@@ -0,0 +1,55 @@
+#ifndef agdktunnel_performance_reporter_hpp
+#define agdktunnel_performance_reporter_hpp
+
+class StartupGraph;
+
+// The quality settings the performance backend may change while the game runs.
+struct FidelityParams {
+    // tunnel sections rendered ahead of the camera
+    int tunnelSectionCount;
+    float tunnelSectionLength;
+};
+
+// Where the engine reports loading and frame events. On Android this is the
+// TuningManager feeding the Android Performance Tuner.
+class PerformanceReporter {
+public:
+    virtual ~PerformanceReporter() = default;
+
+    virtual void StartLoading() = 0;
+
+    virtual void FinishLoading() = 0;
+
+    // Stores the fidelity parameters in *params and returns true if they changed
+    // since the last call. May be called every frame.
+    virtual bool PollFidelityParams(FidelityParams *params) = 0;
+
+    // the game switched to these fidelity parameters by itself
+    virtual void ReportFidelityParams(const FidelityParams &params) = 0;
+
+    // the frame is now rendered at this ResolutionController step
+    virtual void ReportResolutionStep(int step) = 0;
+
+    // how startup went, reported along with the loading time
+    virtual void ReportStartup(const StartupGraph &graph) = 0;
+};
+
+// for platforms without a performance backend
+class NullPerformanceReporter : public PerformanceReporter {
+public:
+    void StartLoading() override {}
+
+    void FinishLoading() override {}
+
+    bool PollFidelityParams(FidelityParams *) override {
+        return false;
+    }
+
+    void ReportFidelityParams(const FidelityParams &) override {}
+
+    void ReportResolutionStep(int) override {}
+
+    void ReportStartup(const StartupGraph &) override {}
+};
+
+#endif
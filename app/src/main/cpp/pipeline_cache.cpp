@@ -0,0 +1,322 @@
+#include "pipeline_cache.hpp"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include "Log.h"
+#include "trace.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// bump whenever the binary file layout or the meaning of a key changes
+#define PIPELINE_CACHE_VERSION 1
+
+// 'PIPE'
+#define PIPELINE_BINARY_MAGIC 0x45504950u
+
+// larger saved binaries are taken as corrupt
+#define PIPELINE_BINARY_MAX_SIZE (16 * 1024 * 1024)
+
+namespace {
+    // every saved binary starts with this
+    struct BinaryHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t driverHash;
+        uint64_t key;
+        // hash of the binary's bytes, catches truncated and corrupt files
+        uint64_t checksum;
+        uint32_t format;
+        uint32_t size;
+    };
+
+    const uint64_t kFnvOffset = 14695981039346656037ULL;
+    const uint64_t kFnvPrime = 1099511628211ULL;
+
+    uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+        const uint8_t *bytes = (const uint8_t *) data;
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * kFnvPrime;
+        }
+        return hash;
+    }
+
+    uint64_t fnv1a_string(uint64_t hash, const char *text) {
+        // the terminator keeps ("ab", "c") and ("a", "bc") apart
+        return fnv1a(hash, text, strlen(text) + 1);
+    }
+}
+
+PipelineCache::PipelineCache(ShaderCompiler *compiler, const std::string &directory) {
+    mCompiler = compiler;
+    mDirectory = directory;
+    mDriverHash = 0;
+    mHasDriverHash = false;
+    mEntryCount = 0;
+    mGeneration = 0;
+    memset(&mStats, 0, sizeof(mStats));
+    mPrecompiling.store(false);
+    mCancelPrecompile.store(false);
+
+    if (mkdir(mDirectory.c_str(), 0700) != 0 && errno != EEXIST) {
+        ALOGW("PipelineCache: can't create %s, binaries won't be saved", mDirectory.c_str());
+    }
+}
+
+PipelineCache::~PipelineCache() {
+    WaitPrecompile();
+}
+
+uint64_t PipelineCache::Hash(const PipelineDesc &desc) {
+    uint64_t hash = fnv1a_string(kFnvOffset, desc.vertexSource);
+    hash = fnv1a_string(hash, desc.fragmentSource);
+    return fnv1a(hash, &desc.flags, sizeof(desc.flags));
+}
+
+std::string PipelineCache::GetPath(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016" PRIx64 ".bin", key);
+    return mDirectory + name;
+}
+
+uint32_t PipelineCache::GetProgram(const PipelineDesc &desc) {
+    return Acquire(desc, false);
+}
+
+uint32_t PipelineCache::Acquire(const PipelineDesc &desc, bool background) {
+    const uint64_t key = Hash(desc);
+    std::unique_lock<std::mutex> lock(mLock);
+    for (int i = 0; i < mEntryCount; ++i) {
+        Entry &entry = mEntries[i];
+        if (entry.key != key) {
+            continue;
+        }
+        if (entry.state == ENTRY_BUILDING) {
+            if (!background) {
+                ++mStats.backgroundWaits;
+            }
+            mBuilt.wait(lock, [&entry]() {
+                return entry.state != ENTRY_BUILDING;
+            });
+        } else if (entry.state == ENTRY_READY && !background) {
+            ++mStats.memoryHits;
+        }
+        return entry.state == ENTRY_READY ? entry.program : 0;
+    }
+
+    if (mEntryCount == PIPELINE_CACHE_MAX_PIPELINES) {
+        ALOGE("PipelineCache: more than %d pipelines, can't add %s",
+              PIPELINE_CACHE_MAX_PIPELINES, desc.name);
+        return 0;
+    }
+    Entry &entry = mEntries[mEntryCount++];
+    entry.key = key;
+    entry.program = 0;
+    entry.state = ENTRY_BUILDING;
+    entry.background = background;
+    if (!mHasDriverHash) {
+        mDriverHash = fnv1a_string(kFnvOffset, mCompiler->GetDriverId().c_str());
+        mHasDriverHash = true;
+    }
+
+    lock.unlock();
+    const uint32_t program = Build(desc, key);
+    lock.lock();
+
+    entry.program = program;
+    entry.state = program != 0 ? ENTRY_READY : ENTRY_FAILED;
+    mBuilt.notify_all();
+    return program;
+}
+
+uint32_t PipelineCache::Build(const PipelineDesc &desc, uint64_t key) {
+    TRACE_SCOPE("BuildPipeline");
+    int64_t startNs = Trace::NowNs();
+    uint32_t program = LoadBinary(key);
+    if (program != 0) {
+        std::lock_guard<std::mutex> lock(mLock);
+        ++mStats.diskLoads;
+        mStats.diskLoadNs += Trace::NowNs() - startNs;
+        return program;
+    }
+
+    startNs = Trace::NowNs();
+    program = mCompiler->CompileProgram(desc);
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (program == 0) {
+            ++mStats.failures;
+        } else {
+            ++mStats.compiles;
+            mStats.compileNs += Trace::NowNs() - startNs;
+        }
+    }
+    if (program == 0) {
+        ALOGE("PipelineCache: failed to build %s", desc.name);
+        return 0;
+    }
+    SaveBinary(key, program);
+    return program;
+}
+
+uint32_t PipelineCache::LoadBinary(uint64_t key) {
+    const std::string path = GetPath(key);
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    BinaryHeader header;
+    std::vector<uint8_t> binary;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic == PIPELINE_BINARY_MAGIC &&
+                 header.version == PIPELINE_CACHE_VERSION &&
+                 header.driverHash == mDriverHash &&
+                 header.key == key &&
+                 header.size > 0 && header.size <= PIPELINE_BINARY_MAX_SIZE;
+    if (valid) {
+        binary.resize(header.size);
+        valid = fread(binary.data(), 1, header.size, file) == header.size &&
+                fnv1a(kFnvOffset, binary.data(), header.size) == header.checksum;
+    }
+    fclose(file);
+
+    uint32_t program = 0;
+    if (valid) {
+        program = mCompiler->LoadProgramBinary(binary.data(), binary.size(), header.format);
+    }
+    if (program == 0) {
+        // stale or broken, it gets replaced once the program is compiled
+        ALOGI("PipelineCache: discarding saved binary %s", path.c_str());
+        unlink(path.c_str());
+        std::lock_guard<std::mutex> lock(mLock);
+        ++mStats.rejectedBinaries;
+    }
+    return program;
+}
+
+void PipelineCache::SaveBinary(uint64_t key, uint32_t program) {
+    std::vector<uint8_t> binary;
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    if (!mCompiler->GetProgramBinary(program, &binary, &header.format) || binary.empty()) {
+        return;
+    }
+    header.magic = PIPELINE_BINARY_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.driverHash = mDriverHash;
+    header.key = key;
+    header.checksum = fnv1a(kFnvOffset, binary.data(), binary.size());
+    header.size = (uint32_t) binary.size();
+
+    // write aside and rename, so a crash never leaves half a file under the real name
+    const std::string path = GetPath(key);
+    const std::string tempPath = path + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == NULL) {
+        return;
+    }
+    const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                         fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+    if (fclose(file) != 0 || !written || rename(tempPath.c_str(), path.c_str()) != 0) {
+        ALOGW("PipelineCache: failed to save %s", path.c_str());
+        unlink(tempPath.c_str());
+    }
+}
+
+void PipelineCache::StartPrecompile(const PipelineDesc *descs, int count) {
+    WaitPrecompile();
+    mPrecompiling.store(true, std::memory_order_release);
+    mPrecompileThread = std::thread(&PipelineCache::PrecompileMain, this, descs, count);
+}
+
+void PipelineCache::PrecompileMain(const PipelineDesc *descs, int count) {
+    Trace::SetThreadName("PipelinePrecompile");
+    if (mCompiler->AttachThread()) {
+        for (int i = 0; i < count && !mCancelPrecompile.load(std::memory_order_acquire); ++i) {
+            Acquire(descs[i], true);
+        }
+        mCompiler->DetachThread();
+    } else {
+        ALOGW("PipelineCache: can't compile in the background, pipelines build on first use");
+    }
+    mPrecompiling.store(false, std::memory_order_release);
+}
+
+void PipelineCache::WaitPrecompile() {
+    if (mPrecompileThread.joinable()) {
+        mPrecompileThread.join();
+    }
+}
+
+void PipelineCache::ForgetPrograms() {
+    // what is left to build would be built for a dead context
+    mCancelPrecompile.store(true, std::memory_order_release);
+    WaitPrecompile();
+    mCancelPrecompile.store(false, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mLock);
+    mEntryCount = 0;
+    ++mGeneration;
+}
+
+PipelineCache::Stats PipelineCache::GetStats() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+FakeShaderCompiler::FakeShaderCompiler() {
+    mDriverId = "fake";
+    mCompileCostNs = 0;
+}
+
+void FakeShaderCompiler::SetDriverId(const std::string &driverId) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mDriverId = driverId;
+}
+
+std::string FakeShaderCompiler::GetDriverId() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mDriverId;
+}
+
+uint32_t FakeShaderCompiler::CompileProgram(const PipelineDesc &desc) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(mCompileCostNs));
+    std::lock_guard<std::mutex> lock(mLock);
+    mPrograms.push_back(PipelineCache::Hash(desc));
+    return (uint32_t) mPrograms.size();
+}
+
+bool FakeShaderCompiler::GetProgramBinary(uint32_t program, std::vector<uint8_t> *binary,
+                                          uint32_t *format) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (program == 0 || program > mPrograms.size()) {
+        return false;
+    }
+    // the pipeline hash, then the hash of the driver that made it
+    const uint64_t words[2] = {mPrograms[program - 1],
+                               fnv1a_string(kFnvOffset, mDriverId.c_str())};
+    binary->assign((const uint8_t *) words, (const uint8_t *) words + sizeof(words));
+    *format = 1;
+    return true;
+}
+
+uint32_t FakeShaderCompiler::LoadProgramBinary(const uint8_t *binary, size_t size,
+                                               uint32_t format) {
+    std::lock_guard<std::mutex> lock(mLock);
+    uint64_t words[2];
+    if (format != 1 || size != sizeof(words)) {
+        return 0;
+    }
+    memcpy(words, binary, sizeof(words));
+    if (words[1] != fnv1a_string(kFnvOffset, mDriverId.c_str())) {
+        return 0;
+    }
+    mPrograms.push_back(words[0]);
+    return (uint32_t) mPrograms.size();
+}
+
+void FakeShaderCompiler::DeleteProgram(uint32_t) {
+}
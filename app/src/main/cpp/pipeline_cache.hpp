@@ -0,0 +1,184 @@
+#ifndef agdktunnel_pipeline_cache_hpp
+#define agdktunnel_pipeline_cache_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// most distinct pipelines a cache holds
+#define PIPELINE_CACHE_MAX_PIPELINES 64
+
+// Everything a program is built from. GL programs don't depend on the render
+// state flags, but they are part of the key so a pipeline is always identified by
+// the complete state it is drawn with.
+struct PipelineDesc {
+    // for logs only
+    const char *name;
+    const char *vertexSource;
+    const char *fragmentSource;
+    // RENDER_FLAG_*
+    uint32_t flags;
+};
+
+// Turns shader sources into programs and programs into persistable binaries.
+class ShaderCompiler {
+public:
+    virtual ~ShaderCompiler() = default;
+
+    // identifies the driver; binaries saved under another driver are discarded
+    virtual std::string GetDriverId() = 0;
+
+    // compiles and links the program, 0 on failure
+    virtual uint32_t CompileProgram(const PipelineDesc &desc) = 0;
+
+    virtual bool GetProgramBinary(uint32_t program, std::vector<uint8_t> *binary,
+                                  uint32_t *format) = 0;
+
+    // creates a program from a saved binary, 0 if the driver rejects it
+    virtual uint32_t LoadProgramBinary(const uint8_t *binary, size_t size, uint32_t format) = 0;
+
+    virtual void DeleteProgram(uint32_t program) = 0;
+
+    // Makes compiling possible on the calling thread, e.g. by making a context
+    // current that shares objects with the render context, and undoes it.
+    virtual bool AttachThread() {
+        return true;
+    }
+
+    virtual void DetachThread() {}
+};
+
+/*
+ * Programs keyed by a hash of their sources and render state. A program is built
+ * on first use: from the binary saved in the cache directory if there is one for
+ * the current driver and cache version, otherwise by compiling it, after which
+ * its binary is saved for the next run. A list of pipelines can be built ahead of
+ * use on a background thread; asking for one that is being built there waits for
+ * it instead of building it twice.
+ *
+ * GetProgram() and StartPrecompile() are for the render thread.
+ */
+class PipelineCache {
+public:
+    struct Stats {
+        // programs found already built
+        uint64_t memoryHits;
+        // programs created from saved binaries
+        uint64_t diskLoads;
+        uint64_t compiles;
+        // saved binaries discarded as stale, corrupt or rejected by the driver
+        uint64_t rejectedBinaries;
+        uint64_t failures;
+        // lookups that waited for the background thread
+        uint64_t backgroundWaits;
+        int64_t compileNs;
+        int64_t diskLoadNs;
+    };
+
+    // binaries are kept in directory, which is created if needed
+    PipelineCache(ShaderCompiler *compiler, const std::string &directory);
+
+    ~PipelineCache();
+
+    PipelineCache(const PipelineCache &) = delete;
+    PipelineCache &operator=(const PipelineCache &) = delete;
+
+    // the program for desc, built if needed; 0 if it can't be built
+    uint32_t GetProgram(const PipelineDesc &desc);
+
+    // builds the pipelines on a background thread; descs must stay valid until it is done
+    void StartPrecompile(const PipelineDesc *descs, int count);
+
+    bool IsPrecompileDone() const {
+        return !mPrecompiling.load(std::memory_order_acquire);
+    }
+
+    void WaitPrecompile();
+
+    // Forgets all programs, e.g. because their context was lost. Saved binaries
+    // stay, so building them again is cheap. A precompile still running stops
+    // after the program it is on. Advances the generation.
+    void ForgetPrograms();
+
+    // changes whenever the programs were forgotten
+    uint32_t GetGeneration() const {
+        return mGeneration;
+    }
+
+    static uint64_t Hash(const PipelineDesc &desc);
+
+    Stats GetStats();
+
+private:
+    enum EntryState {
+        ENTRY_BUILDING,
+        ENTRY_READY,
+        ENTRY_FAILED
+    };
+
+    struct Entry {
+        uint64_t key;
+        uint32_t program;
+        EntryState state;
+        // built by the background thread
+        bool background;
+    };
+
+    uint32_t Acquire(const PipelineDesc &desc, bool background);
+    uint32_t Build(const PipelineDesc &desc, uint64_t key);
+    uint32_t LoadBinary(uint64_t key);
+    void SaveBinary(uint64_t key, uint32_t program);
+    std::string GetPath(uint64_t key) const;
+    void PrecompileMain(const PipelineDesc *descs, int count);
+
+    ShaderCompiler *mCompiler;
+    std::string mDirectory;
+
+    // hash of the compiler's driver id, read when the first program is built
+    uint64_t mDriverHash;
+    bool mHasDriverHash;
+
+    std::mutex mLock;
+    std::condition_variable mBuilt;
+    Entry mEntries[PIPELINE_CACHE_MAX_PIPELINES];
+    int mEntryCount;
+    uint32_t mGeneration;
+    Stats mStats;
+
+    std::thread mPrecompileThread;
+    std::atomic<bool> mPrecompiling;
+    std::atomic<bool> mCancelPrecompile;
+};
+
+// Compiler for hosts: "compiles" by sleeping for a set time, and produces
+// binaries that only load under the driver id they were made with.
+class FakeShaderCompiler : public ShaderCompiler {
+public:
+    FakeShaderCompiler();
+
+    void SetDriverId(const std::string &driverId);
+
+    void SetCompileCostNs(int64_t costNs) {
+        mCompileCostNs = costNs;
+    }
+
+    std::string GetDriverId() override;
+    uint32_t CompileProgram(const PipelineDesc &desc) override;
+    bool GetProgramBinary(uint32_t program, std::vector<uint8_t> *binary,
+                          uint32_t *format) override;
+    uint32_t LoadProgramBinary(const uint8_t *binary, size_t size, uint32_t format) override;
+    void DeleteProgram(uint32_t program) override;
+
+private:
+    std::mutex mLock;
+    std::string mDriverId;
+    int64_t mCompileCostNs;
+    // the pipeline hash of each program, by program - 1
+    std::vector<uint64_t> mPrograms;
+};
+
+#endif
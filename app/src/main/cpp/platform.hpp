@@ -0,0 +1,164 @@
+#ifndef agdktunnel_platform_hpp
+#define agdktunnel_platform_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "frame_clock.hpp"
+
+struct TouchBatch;
+class AssetLoader;
+class AudioMixer;
+class PerformanceReporter;
+class PipelineCache;
+class RenderBackend;
+class RenderContext;
+class SoundStreamer;
+
+// Lifecycle commands. The values match the native app glue APP_CMD_* values so the
+// Android platform can pass them straight through.
+#define PLATFORM_CMD_INIT_WINDOW 0
+#define PLATFORM_CMD_TERM_WINDOW 1
+#define PLATFORM_CMD_WINDOW_RESIZED 2
+#define PLATFORM_CMD_WINDOW_REDRAW_NEEDED 3
+#define PLATFORM_CMD_CONTENT_RECT_CHANGED 4
+#define PLATFORM_CMD_GAINED_FOCUS 5
+#define PLATFORM_CMD_LOST_FOCUS 6
+#define PLATFORM_CMD_CONFIG_CHANGED 7
+#define PLATFORM_CMD_LOW_MEMORY 8
+#define PLATFORM_CMD_START 9
+#define PLATFORM_CMD_RESUME 10
+#define PLATFORM_CMD_SAVE_STATE 11
+#define PLATFORM_CMD_PAUSE 12
+#define PLATFORM_CMD_STOP 13
+#define PLATFORM_CMD_DESTROY 14
+#define PLATFORM_CMD_WINDOW_INSETS_CHANGED 15
+
+typedef void (*PlatformCommandCallback)(void *userData, int32_t cmd);
+
+// what the audio stream is doing and how well, see Platform::GetAudioStats()
+struct AudioStats {
+    bool open;
+    bool playing;
+    int32_t framesPerBurst;
+    int32_t bufferSize;
+    int32_t bufferCapacity;
+    int32_t sampleRate;
+    // from the app writing a frame to it being heard, -1 if the stream can't tell
+    double latencyMs;
+    // since the stream opened
+    int32_t underruns;
+    int32_t bufferIncreases;
+    int32_t bufferDecreases;
+    // times the stream was lost (a headset unplugged, say) and opened again
+    int32_t reopens;
+};
+
+/*
+ * Everything NativeEngine needs from the operating system: lifecycle events,
+ * input, the window surface and its presenter, a clock, and the platform
+ * services (performance reporting, asset loading and audio). The Android
+ * implementation sits on android_app, EGL and SwappyGL; the headless one runs
+ * the same frame loop on a host with a null presenter and a scripted lifecycle.
+ */
+class Platform {
+public:
+    virtual ~Platform() = default;
+
+    // commands are delivered through the callback from inside PollEvent
+    virtual void SetCommandCallback(PlatformCommandCallback callback, void *userData) = 0;
+
+    // Processes at most one pending event source, waiting up to timeoutMs for one
+    // (-1 waits forever). Returns false when there was nothing to process.
+    virtual bool PollEvent(int timeoutMs) = 0;
+
+    virtual bool IsDestroyRequested() = 0;
+
+    // cooks the touch input that arrived since the last call into the batch
+    virtual void PollInput(TouchBatch *batch) = 0;
+
+    // returns true once for every change of the soft keyboard text
+    virtual bool PollTextInputChanged() = 0;
+
+    // current text of the soft keyboard
+    virtual void GetTextInput(std::string *text) = 0;
+
+    virtual void SetTextInputVisible(bool visible) = 0;
+
+    // called on PLATFORM_CMD_INIT_WINDOW, returns whether there is a window to render to
+    virtual bool AttachWindow() = 0;
+
+    // Creates whatever rendering needs (display, surface, context) and rebuilds
+    // the GPU resources a lost context took with it; false if not ready.
+    virtual bool PrepareToRender() = 0;
+
+    // current size of the window surface
+    virtual void GetSurfaceSize(int *width, int *height) = 0;
+
+    // Starts a frame rendered at width x height, at most the surface size; a
+    // smaller frame is scaled up to fill the surface when presented. The frame's
+    // commands then go to GetRenderBackend().
+    virtual void BeginFrame(int width, int height) = 0;
+
+    virtual RenderBackend *GetRenderBackend() = 0;
+
+    // Programs for the render backend. Its programs are forgotten (and its
+    // generation advances) whenever the rendering context is lost.
+    virtual PipelineCache *GetPipelineCache() = 0;
+
+    // loads from the app's asset pack, NULL if it has none
+    virtual AssetLoader *GetAssetLoader() = 0;
+
+    // what PrepareToRender() creates, and how recovering from its losses went
+    virtual RenderContext *GetRenderContext() = 0;
+
+    // returns false if presenting failed; whatever that lost is recreated by the
+    // next PrepareToRender()
+    virtual bool Present() = 0;
+
+    // time between presents, 0 if presenting is not paced to the display
+    virtual int64_t GetPresentPeriodNs() = 0;
+
+    // GPU time of a recently presented frame, -1 if the GPU can't be timed
+    virtual int64_t GetGpuFrameNs() = 0;
+
+    // the window surface is going away
+    virtual void KillSurface() = 0;
+
+    virtual void UpdateWindowInsets() = 0;
+
+    // What the previous process handed to SaveState() before it was killed,
+    // false if it started fresh. Only valid until the first PLATFORM_CMD_RESUME.
+    virtual bool GetSavedState(const void **data, size_t *size) = 0;
+
+    // keeps a copy of the state for the next process; called on PLATFORM_CMD_SAVE_STATE
+    virtual void SaveState(const void *data, size_t size) = 0;
+
+    virtual FrameClock *GetClock() = 0;
+
+    virtual PerformanceReporter *GetPerformanceReporter() = 0;
+
+    // plays sounds from the engine's thread, NULL if there's no audio
+    virtual AudioMixer *GetAudioMixer() = 0;
+
+    // streams sounds out of the asset pack for the mixer, NULL if there's no audio
+    virtual SoundStreamer *GetSoundStreamer() = 0;
+
+    // Opens the audio stream without starting it, so StartAudio() is quick.
+    // Called on PLATFORM_CMD_START.
+    virtual void OpenAudio() = 0;
+
+    // starts (opening it if needed) the audio stream; called on PLATFORM_CMD_RESUME
+    virtual void StartAudio() = 0;
+
+    // stops the audio stream but keeps it open; called on PLATFORM_CMD_PAUSE
+    virtual void PauseAudio() = 0;
+
+    // closes the audio stream, letting the device sleep; called on PLATFORM_CMD_STOP
+    virtual void StopAudio() = 0;
+
+    // false if there's no audio
+    virtual bool GetAudioStats(AudioStats *stats) = 0;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "realtime_check.hpp"
+#include <dlfcn.h>
+#include <pthread.h>
+#include <cstddef>
+
+namespace {
+    // what the calling thread did since RealtimeCheckBegin(); plain data, so
+    // reaching it doesn't allocate
+    thread_local bool tChecking = false;
+    thread_local RealtimeViolations tCounts;
+}
+
+#if defined(__GLIBC__)
+
+typedef int (*MutexLockFunction)(pthread_mutex_t *mutex);
+
+// glibc's own entry points, which the wrappers below forward to
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void __libc_free(void *pointer);
+
+void *malloc(size_t size) {
+    if (tChecking) {
+        ++tCounts.allocations;
+    }
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    if (tChecking) {
+        ++tCounts.allocations;
+    }
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    if (tChecking) {
+        ++tCounts.allocations;
+    }
+    return __libc_realloc(pointer, size);
+}
+
+void free(void *pointer) {
+    if (tChecking && pointer != NULL) {
+        ++tCounts.frees;
+    }
+    __libc_free(pointer);
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+    // glibc has no public name for its own, so it's looked up on the first lock
+    static MutexLockFunction sLock = NULL;
+    if (sLock == NULL) {
+        sLock = (MutexLockFunction) dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    }
+    if (tChecking) {
+        ++tCounts.locks;
+    }
+    return sLock(mutex);
+}
+}
+
+bool RealtimeCheckAvailable() {
+    return true;
+}
+
+#else
+
+bool RealtimeCheckAvailable() {
+    return false;
+}
+
+#endif
+
+void RealtimeCheckBegin() {
+    tCounts.allocations = tCounts.frees = tCounts.locks = 0;
+    tChecking = true;
+}
+
+void RealtimeCheckEnd(RealtimeViolations *violations) {
+    tChecking = false;
+    violations->allocations += tCounts.allocations;
+    violations->frees += tCounts.frees;
+    violations->locks += tCounts.locks;
+}
@@ -0,0 +1,28 @@
+#ifndef agdktunnel_realtime_check_hpp
+#define agdktunnel_realtime_check_hpp
+
+#include <cstdint>
+
+/*
+ * Counts what a thread does that a real-time thread must not: allocate, free
+ * or lock a mutex. For host tests of code that runs in the audio callback. It
+ * wraps glibc's malloc(), calloc(), realloc(), free() and pthread_mutex_lock()
+ * for the whole program, so it is only built into headless_soak; elsewhere
+ * nothing is counted.
+ */
+struct RealtimeViolations {
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t locks;
+};
+
+// false if the libc can't be wrapped, and nothing is ever counted
+bool RealtimeCheckAvailable();
+
+// starts counting on the calling thread
+void RealtimeCheckBegin();
+
+// stops counting on the calling thread, and adds what it counted to violations
+void RealtimeCheckEnd(RealtimeViolations *violations);
+
+#endif
@@ -0,0 +1,89 @@
+#include "render_backend.hpp"
+#include <cstring>
+
+RenderBackend::RenderBackend() {
+    Invalidate();
+    ResetStats();
+}
+
+void RenderBackend::Invalidate() {
+    mStateValid = false;
+    mProgram = mTexture = mVertexBuffer = 0;
+    mFlags = 0;
+}
+
+void RenderBackend::ResetStats() {
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+void RenderBackend::Execute(const RenderCommandBuffer &buffer) {
+    const int count = buffer.GetCount();
+    for (int i = 0; i < count; ++i) {
+        const RenderCommand &command = buffer.GetSorted(i);
+        ++mStats.commands;
+
+        if (command.type == RENDER_COMMAND_CLEAR) {
+            ++mStats.clears;
+            Clear(command);
+            continue;
+        }
+
+        if (!mStateValid || command.program != mProgram) {
+            BindProgram(command.program);
+            mProgram = command.program;
+            ++mStats.programBinds;
+        } else {
+            ++mStats.elided;
+        }
+        if (!mStateValid || command.texture != mTexture) {
+            BindTexture(command.texture);
+            mTexture = command.texture;
+            ++mStats.textureBinds;
+        } else {
+            ++mStats.elided;
+        }
+        if (!mStateValid || command.vertexBuffer != mVertexBuffer) {
+            BindVertexBuffer(command.vertexBuffer);
+            mVertexBuffer = command.vertexBuffer;
+            ++mStats.vertexBufferBinds;
+        } else {
+            ++mStats.elided;
+        }
+        if (!mStateValid || command.flags != mFlags) {
+            // with unknown state every flag is set explicitly
+            SetFlags(command.flags, mStateValid ? command.flags ^ mFlags : ~0u);
+            mFlags = command.flags;
+            ++mStats.stateChanges;
+        } else {
+            ++mStats.elided;
+        }
+        mStateValid = true;
+
+        ++mStats.draws;
+        Draw(command);
+    }
+}
+
+void NullRenderBackend::Clear(const RenderCommand &command) {
+    if (mRecording) {
+        mRecordedKeys.push_back(command.key);
+    }
+}
+
+void NullRenderBackend::BindProgram(uint32_t) {
+}
+
+void NullRenderBackend::BindTexture(uint32_t) {
+}
+
+void NullRenderBackend::BindVertexBuffer(uint32_t) {
+}
+
+void NullRenderBackend::SetFlags(uint32_t, uint32_t) {
+}
+
+void NullRenderBackend::Draw(const RenderCommand &command) {
+    if (mRecording) {
+        mRecordedKeys.push_back(command.key);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef agdktunnel_render_backend_hpp
+#define agdktunnel_render_backend_hpp
+
+#include <cstdint>
+#include <vector>
+#include "render_commands.hpp"
+
+/*
+ * Replays a sorted RenderCommandBuffer. The base class tracks the bound program,
+ * texture, vertex buffer and render state flags, and only calls the backend for
+ * the ones that change between commands.
+ */
+class RenderBackend {
+public:
+    struct Stats {
+        uint64_t commands;
+        uint64_t clears;
+        uint64_t draws;
+        uint64_t programBinds;
+        uint64_t textureBinds;
+        uint64_t vertexBufferBinds;
+        uint64_t stateChanges;
+        // binds and state changes skipped because nothing changed
+        uint64_t elided;
+    };
+
+    RenderBackend();
+
+    virtual ~RenderBackend() = default;
+
+    void Execute(const RenderCommandBuffer &buffer);
+
+    // forget the tracked state, e.g. after something else changed it or the context
+    // was recreated
+    void Invalidate();
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+    void ResetStats();
+
+protected:
+    virtual void Clear(const RenderCommand &command) = 0;
+    virtual void BindProgram(uint32_t program) = 0;
+    virtual void BindTexture(uint32_t texture) = 0;
+    virtual void BindVertexBuffer(uint32_t vertexBuffer) = 0;
+    virtual void SetFlags(uint32_t flags, uint32_t changed) = 0;
+    virtual void Draw(const RenderCommand &command) = 0;
+
+private:
+    bool mStateValid;
+    uint32_t mProgram;
+    uint32_t mTexture;
+    uint32_t mVertexBuffer;
+    uint32_t mFlags;
+
+    Stats mStats;
+};
+
+// Backend without a GPU: executes nothing, but counts like a real backend and can
+// record the sort keys it replayed, for benchmarking sorting and replay on a host.
+class NullRenderBackend : public RenderBackend {
+public:
+    NullRenderBackend() : mRecording(false) {}
+
+    void SetRecording(bool recording) {
+        mRecording = recording;
+    }
+
+    // keys of the commands executed since the last ClearRecording()
+    const std::vector<uint64_t> &GetRecordedKeys() const {
+        return mRecordedKeys;
+    }
+
+    void ClearRecording() {
+        mRecordedKeys.clear();
+    }
+
+protected:
+    void Clear(const RenderCommand &command) override;
+    void BindProgram(uint32_t program) override;
+    void BindTexture(uint32_t texture) override;
+    void BindVertexBuffer(uint32_t vertexBuffer) override;
+    void SetFlags(uint32_t flags, uint32_t changed) override;
+    void Draw(const RenderCommand &command) override;
+
+private:
+    bool mRecording;
+    std::vector<uint64_t> mRecordedKeys;
+};
+
+#endif
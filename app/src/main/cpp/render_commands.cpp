@@ -0,0 +1,88 @@
+#include "render_commands.hpp"
+#include <cstring>
+
+RenderCommandBuffer::RenderCommandBuffer() {
+    mCommands = new RenderCommand[RENDER_COMMAND_CAPACITY];
+    mEntries = new SortEntry[RENDER_COMMAND_CAPACITY];
+    mScratch = new SortEntry[RENDER_COMMAND_CAPACITY];
+    Clear();
+}
+
+RenderCommandBuffer::~RenderCommandBuffer() {
+    delete[] mCommands;
+    delete[] mEntries;
+    delete[] mScratch;
+}
+
+void RenderCommandBuffer::AddClear(uint64_t key, uint32_t mask, uint32_t rgba) {
+    RenderCommand *command = Add(key, RENDER_COMMAND_CLEAR);
+    if (command != nullptr) {
+        command->clear.mask = mask;
+        command->clear.rgba = rgba;
+    }
+}
+
+void RenderCommandBuffer::AddDraw(uint64_t key, uint32_t flags, uint32_t program,
+                                  uint32_t texture, uint32_t vertexBuffer, uint32_t primitive,
+                                  int32_t first, int32_t count) {
+    RenderCommand *command = Add(key, RENDER_COMMAND_DRAW);
+    if (command != nullptr) {
+        command->flags = (uint16_t) flags;
+        command->program = program;
+        command->texture = texture;
+        command->vertexBuffer = vertexBuffer;
+        command->draw.primitive = primitive;
+        command->draw.first = first;
+        command->draw.count = count;
+    }
+}
+
+void RenderCommandBuffer::Sort() {
+    if (mSorted || mCount < 2) {
+        mSorted = true;
+        return;
+    }
+
+    // LSD radix sort on bytes. All eight histograms come from one pass over the keys,
+    // and passes where every key has the same byte are skipped, which is most of
+    // them: layers and programs are few, and unused key bits are all zero.
+    uint32_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (int i = 0; i < mCount; ++i) {
+        const uint64_t key = mEntries[i].key;
+        for (int pass = 0; pass < 8; ++pass) {
+            ++histograms[pass][(key >> (pass * 8)) & 0xff];
+        }
+    }
+
+    SortEntry *from = mEntries;
+    SortEntry *to = mScratch;
+    for (int pass = 0; pass < 8; ++pass) {
+        uint32_t *histogram = histograms[pass];
+        const uint32_t firstByte = (uint32_t) ((from[0].key >> (pass * 8)) & 0xff);
+        if (histogram[firstByte] == (uint32_t) mCount) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            const uint32_t count = histogram[digit];
+            histogram[digit] = offset;
+            offset += count;
+        }
+        for (int i = 0; i < mCount; ++i) {
+            to[histogram[(from[i].key >> (pass * 8)) & 0xff]++] = from[i];
+        }
+
+        SortEntry *swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != mEntries) {
+        // an odd number of passes ran, the scratch array holds the result
+        mScratch = mEntries;
+        mEntries = from;
+    }
+    mSorted = true;
+}
@@ -0,0 +1,163 @@
+#ifndef agdktunnel_render_commands_hpp
+#define agdktunnel_render_commands_hpp
+
+#include <cstdint>
+
+// command type
+#define RENDER_COMMAND_CLEAR 0
+#define RENDER_COMMAND_DRAW 1
+
+// render state flags of a draw
+#define RENDER_FLAG_DEPTH_TEST 0x1
+#define RENDER_FLAG_BLEND 0x2
+
+// layers, drawn in this order
+#define RENDER_LAYER_OPAQUE 0
+#define RENDER_LAYER_TRANSLUCENT 1
+#define RENDER_LAYER_OVERLAY 2
+
+// clear mask bits
+#define RENDER_CLEAR_COLOR 0x1
+#define RENDER_CLEAR_DEPTH 0x2
+
+/*
+ * Sort key layout, most significant first:
+ *   63..60  layer (4 bits)     drawn in order, e.g. opaque, translucent, overlay
+ *   59..48  program (12 bits)  ids are small handles assigned by the renderer
+ *   47..32  texture (16 bits)
+ *   31..8   depth (24 bits)    front to back; translucent layers pass 1 - depth
+ *    7..0   sequence (8 bits)  tie-breaker for commands that must keep their order
+ * Clears use program 0, so they come first within their layer.
+ */
+#define RENDER_KEY_LAYER_SHIFT 60
+#define RENDER_KEY_PROGRAM_SHIFT 48
+#define RENDER_KEY_TEXTURE_SHIFT 32
+#define RENDER_KEY_DEPTH_SHIFT 8
+#define RENDER_KEY_LAYER_MASK 0xfULL
+#define RENDER_KEY_PROGRAM_MASK 0xfffULL
+#define RENDER_KEY_TEXTURE_MASK 0xffffULL
+#define RENDER_KEY_DEPTH_MASK 0xffffffULL
+#define RENDER_KEY_SEQUENCE_MASK 0xffULL
+
+// maximum number of commands per frame
+#define RENDER_COMMAND_CAPACITY 8192
+
+inline uint64_t MakeRenderSortKey(uint32_t layer, uint32_t program, uint32_t texture,
+                                  uint32_t depth, uint32_t sequence = 0) {
+    return ((layer & RENDER_KEY_LAYER_MASK) << RENDER_KEY_LAYER_SHIFT) |
+           ((program & RENDER_KEY_PROGRAM_MASK) << RENDER_KEY_PROGRAM_SHIFT) |
+           ((texture & RENDER_KEY_TEXTURE_MASK) << RENDER_KEY_TEXTURE_SHIFT) |
+           ((depth & RENDER_KEY_DEPTH_MASK) << RENDER_KEY_DEPTH_SHIFT) |
+           (sequence & RENDER_KEY_SEQUENCE_MASK);
+}
+
+// maps a depth in [0, 1] to the 24 bits of the sort key
+inline uint32_t QuantizeRenderDepth(float depth) {
+    if (depth <= 0.0f) {
+        return 0;
+    }
+    if (depth >= 1.0f) {
+        return (uint32_t) RENDER_KEY_DEPTH_MASK;
+    }
+    return (uint32_t) (depth * (float) RENDER_KEY_DEPTH_MASK);
+}
+
+// One command, plain data. Draw handles (program, texture, vertex buffer) are the
+// backend's object names; the sort key only carries the renderer's small ids.
+struct RenderCommand {
+    uint64_t key;
+    uint16_t type;
+    uint16_t flags;
+    uint32_t program;
+    uint32_t texture;
+    uint32_t vertexBuffer;
+    union {
+        // RENDER_COMMAND_DRAW
+        struct {
+            uint32_t primitive;
+            int32_t first;
+            int32_t count;
+        } draw;
+        // RENDER_COMMAND_CLEAR
+        struct {
+            uint32_t mask;
+            uint32_t rgba;
+        } clear;
+    };
+};
+
+/*
+ * A frame's render commands. Game code adds commands in any order, Sort() orders
+ * them by key with a radix sort, and a RenderBackend replays them in that order.
+ * Commands beyond the capacity are dropped and counted.
+ */
+class RenderCommandBuffer {
+public:
+    RenderCommandBuffer();
+
+    ~RenderCommandBuffer();
+
+    RenderCommandBuffer(const RenderCommandBuffer &) = delete;
+    RenderCommandBuffer &operator=(const RenderCommandBuffer &) = delete;
+
+    void Clear() {
+        mCount = 0;
+        mDropped = 0;
+        mSorted = false;
+    }
+
+    // returns the command to fill in, or NULL if the buffer is full
+    RenderCommand *Add(uint64_t key, int type) {
+        if (mCount >= RENDER_COMMAND_CAPACITY) {
+            ++mDropped;
+            return nullptr;
+        }
+        RenderCommand *command = &mCommands[mCount];
+        mEntries[mCount].key = key;
+        mEntries[mCount].index = (uint32_t) mCount;
+        ++mCount;
+        mSorted = false;
+
+        command->key = key;
+        command->type = (uint16_t) type;
+        command->flags = 0;
+        command->program = command->texture = command->vertexBuffer = 0;
+        return command;
+    }
+
+    void AddClear(uint64_t key, uint32_t mask, uint32_t rgba);
+
+    void AddDraw(uint64_t key, uint32_t flags, uint32_t program, uint32_t texture,
+                 uint32_t vertexBuffer, uint32_t primitive, int32_t first, int32_t count);
+
+    // orders the commands by key; commands with equal keys keep the order they were added
+    void Sort();
+
+    int GetCount() const {
+        return mCount;
+    }
+
+    int GetDropped() const {
+        return mDropped;
+    }
+
+    // i-th command in sorted order (in added order before Sort())
+    const RenderCommand &GetSorted(int i) const {
+        return mCommands[mEntries[i].index];
+    }
+
+private:
+    struct SortEntry {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    RenderCommand *mCommands;
+    SortEntry *mEntries;
+    SortEntry *mScratch;
+    int mCount;
+    int mDropped;
+    bool mSorted;
+};
+
+#endif
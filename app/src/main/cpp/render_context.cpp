@@ -0,0 +1,236 @@
+#include "render_context.hpp"
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "Log.h"
+#include "trace.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// time a frame spends building GPU resources beyond the ones it draws with
+#define RENDER_CONTEXT_BUILD_BUDGET_NS 2000000LL
+
+RenderContext::RenderContext(ContextLayer *layer, GpuResourceRegistry *resources) {
+    mLayer = layer;
+    mResources = resources;
+    mHasDisplay = mHasSurface = mHasContext = false;
+    mIsCurrent = mContextBound = false;
+    mErrorNs = -1;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+const char *RenderContext::GetErrorName(int error) {
+    switch (error) {
+        case CONTEXT_OK:
+            return "no error";
+        case CONTEXT_ERROR_CONTEXT:
+            return "context lost";
+        case CONTEXT_ERROR_SURFACE:
+            return "bad surface";
+        case CONTEXT_ERROR_DISPLAY:
+            return "bad display";
+        default:
+            return "unknown error";
+    }
+}
+
+bool RenderContext::Prepare() {
+    if (!mIsCurrent) {
+        if (!mHasDisplay) {
+            if (!mLayer->InitDisplay()) {
+                ALOGE("RenderContext: failed to init display");
+                return false;
+            }
+            mHasDisplay = true;
+            ++mStats.displaysCreated;
+        }
+        if (!mHasSurface) {
+            if (!mLayer->CreateSurface()) {
+                ALOGE("RenderContext: failed to create surface");
+                return false;
+            }
+            mHasSurface = true;
+            ++mStats.surfacesCreated;
+        }
+        if (!mHasContext) {
+            if (!mLayer->CreateContext()) {
+                ALOGE("RenderContext: failed to create context");
+                return false;
+            }
+            mHasContext = true;
+            ++mStats.contextsCreated;
+        }
+
+        const int error = mLayer->MakeCurrent();
+        if (error != CONTEXT_OK) {
+            ALOGE("RenderContext: binding surface and context failed, %s",
+                  GetErrorName(error));
+            HandleError(error);
+            return false;
+        }
+        mIsCurrent = mContextBound = true;
+        ALOGI("RenderContext: bound surface %llu and context %llu",
+              (unsigned long long) mStats.surfacesCreated,
+              (unsigned long long) mStats.contextsCreated);
+    }
+    return mResources->Build(RENDER_CONTEXT_BUILD_BUDGET_NS);
+}
+
+bool RenderContext::Present() {
+    const int error = mLayer->Swap();
+    if (error != CONTEXT_OK) {
+        ALOGW("RenderContext: present failed, %s", GetErrorName(error));
+        HandleError(error);
+        return false;
+    }
+    if (mErrorNs >= 0) {
+        const int64_t recoveryNs = Trace::NowNs() - mErrorNs;
+        mErrorNs = -1;
+        ++mStats.recoveries;
+        mStats.lastRecoveryNs = recoveryNs;
+        if (recoveryNs > mStats.maxRecoveryNs) {
+            mStats.maxRecoveryNs = recoveryNs;
+        }
+        ALOGI("RenderContext: recovered, first frame %.1f ms after the error",
+              (double) recoveryNs / 1e6);
+    }
+    return true;
+}
+
+void RenderContext::HandleError(int error) {
+    if (error == CONTEXT_OK) {
+        return;
+    }
+    ++mStats.errors;
+    if (mErrorNs < 0) {
+        // time to the next frame counts from the first of a run of errors
+        mErrorNs = Trace::NowNs();
+    }
+    switch (error) {
+        case CONTEXT_ERROR_CONTEXT:
+            ALOGW("RenderContext: %s, recreating context", GetErrorName(error));
+            DropContext(false);
+            break;
+        case CONTEXT_ERROR_SURFACE:
+            ALOGW("RenderContext: %s, recreating surface", GetErrorName(error));
+            KillSurface();
+            break;
+        default:
+            ALOGW("RenderContext: %s, recreating display", GetErrorName(error));
+            DropContext(false);
+            KillSurface();
+            if (mHasDisplay) {
+                mLayer->TerminateDisplay();
+                mHasDisplay = false;
+            }
+            break;
+    }
+}
+
+void RenderContext::DropContext(bool deleteObjects) {
+    if (!mHasContext) {
+        return;
+    }
+    if (mContextBound) {
+        // the objects die with the context, the recipes stay
+        mResources->ReleaseAll(deleteObjects);
+        mContextBound = false;
+    }
+    if (mIsCurrent) {
+        mLayer->ReleaseCurrent();
+        mIsCurrent = false;
+    }
+    mLayer->DestroyContext();
+    mHasContext = false;
+}
+
+void RenderContext::KillSurface() {
+    if (mIsCurrent) {
+        mLayer->ReleaseCurrent();
+        mIsCurrent = false;
+    }
+    if (mHasSurface) {
+        mLayer->DestroySurface();
+        mHasSurface = false;
+    }
+}
+
+void RenderContext::KillContext() {
+    // objects can only be deleted while their context is current
+    DropContext(mIsCurrent);
+}
+
+void RenderContext::KillDisplay() {
+    KillContext();
+    KillSurface();
+    if (mHasDisplay) {
+        ALOGI("RenderContext: terminating display now.");
+        mLayer->TerminateDisplay();
+        mHasDisplay = false;
+    }
+}
+
+FakeContextLayer::FakeContextLayer() {
+    memset(mFailError, 0, sizeof(mFailError));
+    memset(mFailCount, 0, sizeof(mFailCount));
+    mCreateContextCostNs = 0;
+}
+
+void FakeContextLayer::FailCall(int call, int error, int count) {
+    mFailError[call] = error;
+    mFailCount[call] = count;
+}
+
+const char *FakeContextLayer::GetCallName(int call) {
+    static const char *const names[FAKE_CONTEXT_CALL_COUNT] = {
+            "InitDisplay", "TerminateDisplay", "CreateSurface", "DestroySurface",
+            "CreateContext", "DestroyContext", "MakeCurrent", "ReleaseCurrent", "Swap"
+    };
+    return call >= 0 && call < FAKE_CONTEXT_CALL_COUNT ? names[call] : "?";
+}
+
+int FakeContextLayer::Call(int call) {
+    mCalls.push_back(call);
+    if (mFailCount[call] > 0) {
+        --mFailCount[call];
+        return mFailError[call] != CONTEXT_OK ? mFailError[call] : CONTEXT_ERROR_UNKNOWN;
+    }
+    return CONTEXT_OK;
+}
+
+bool FakeContextLayer::InitDisplay() {
+    return Call(FAKE_CONTEXT_INIT_DISPLAY) == CONTEXT_OK;
+}
+
+void FakeContextLayer::TerminateDisplay() {
+    Call(FAKE_CONTEXT_TERMINATE_DISPLAY);
+}
+
+bool FakeContextLayer::CreateSurface() {
+    return Call(FAKE_CONTEXT_CREATE_SURFACE) == CONTEXT_OK;
+}
+
+void FakeContextLayer::DestroySurface() {
+    Call(FAKE_CONTEXT_DESTROY_SURFACE);
+}
+
+bool FakeContextLayer::CreateContext() {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(mCreateContextCostNs));
+    return Call(FAKE_CONTEXT_CREATE_CONTEXT) == CONTEXT_OK;
+}
+
+void FakeContextLayer::DestroyContext() {
+    Call(FAKE_CONTEXT_DESTROY_CONTEXT);
+}
+
+int FakeContextLayer::MakeCurrent() {
+    return Call(FAKE_CONTEXT_MAKE_CURRENT);
+}
+
+void FakeContextLayer::ReleaseCurrent() {
+    Call(FAKE_CONTEXT_RELEASE_CURRENT);
+}
+
+int FakeContextLayer::Swap() {
+    return Call(FAKE_CONTEXT_SWAP);
+}
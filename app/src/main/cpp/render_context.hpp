@@ -0,0 +1,169 @@
+#ifndef agdktunnel_render_context_hpp
+#define agdktunnel_render_context_hpp
+
+#include <cstdint>
+#include <vector>
+#include "gpu_resource_registry.hpp"
+
+// outcome of binding or presenting, and what an error took with it
+#define CONTEXT_OK 0
+// the context is gone (EGL_CONTEXT_LOST, EGL_BAD_CONTEXT), the surface is fine
+#define CONTEXT_ERROR_CONTEXT 1
+// the surface is gone (EGL_BAD_SURFACE, EGL_BAD_NATIVE_WINDOW), the context is fine
+#define CONTEXT_ERROR_SURFACE 2
+// the display is gone (EGL_BAD_DISPLAY, EGL_NOT_INITIALIZED), and everything with it
+#define CONTEXT_ERROR_DISPLAY 3
+// anything else; everything is made again to be safe
+#define CONTEXT_ERROR_UNKNOWN 4
+
+// The display, surface and context calls RenderContext makes, so that losing
+// them can be simulated on a host. Calls are only made in a valid order: a
+// surface and a context only while there is a display, and so on.
+class ContextLayer {
+public:
+    virtual ~ContextLayer() = default;
+
+    virtual bool InitDisplay() = 0;
+    virtual void TerminateDisplay() = 0;
+
+    // for the current window
+    virtual bool CreateSurface() = 0;
+    virtual void DestroySurface() = 0;
+
+    virtual bool CreateContext() = 0;
+    virtual void DestroyContext() = 0;
+
+    // binds the surface and context to the calling thread, CONTEXT_OK or CONTEXT_ERROR_*
+    virtual int MakeCurrent() = 0;
+    virtual void ReleaseCurrent() = 0;
+
+    // presents the surface, CONTEXT_OK or CONTEXT_ERROR_*
+    virtual int Swap() = 0;
+};
+
+/*
+ * Owns the lifetime of the display, surface and context. Prepare() creates
+ * whatever is missing and makes it current, then has the resource registry
+ * build what the context needs. An error from binding or presenting drops what
+ * it invalidated and nothing else: a lost context takes the GPU resources with
+ * it, a bad surface only the surface. The next Prepare() recreates them, so a
+ * driver reset costs a few frames instead of a restart of the process.
+ *
+ * Used from the render thread only.
+ */
+class RenderContext {
+public:
+    struct Stats {
+        uint64_t displaysCreated;
+        uint64_t surfacesCreated;
+        uint64_t contextsCreated;
+        // errors handled
+        uint64_t errors;
+        // errors followed by a presented frame
+        uint64_t recoveries;
+        // from an error to the next presented frame
+        int64_t lastRecoveryNs;
+        int64_t maxRecoveryNs;
+    };
+
+    RenderContext(ContextLayer *layer, GpuResourceRegistry *resources);
+
+    // creates and binds whatever is missing; false if the frame can't be drawn yet
+    bool Prepare();
+
+    // false if presenting failed, the error has then been handled
+    bool Present();
+
+    // drops what error invalidated, to be recreated by the next Prepare()
+    void HandleError(int error);
+
+    // the window is going away
+    void KillSurface();
+
+    // releases the GPU resources and destroys the context, the surface stays
+    void KillContext();
+
+    // also kills the context and the surface
+    void KillDisplay();
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+    static const char *GetErrorName(int error);
+
+private:
+    void DropContext(bool deleteObjects);
+
+    ContextLayer *mLayer;
+    GpuResourceRegistry *mResources;
+
+    bool mHasDisplay, mHasSurface, mHasContext;
+    bool mIsCurrent;
+    // the context has been current, so it may own objects
+    bool mContextBound;
+
+    // when the error being recovered from happened, -1 when there is none
+    int64_t mErrorNs;
+
+    Stats mStats;
+};
+
+// calls a FakeContextLayer records
+#define FAKE_CONTEXT_INIT_DISPLAY 0
+#define FAKE_CONTEXT_TERMINATE_DISPLAY 1
+#define FAKE_CONTEXT_CREATE_SURFACE 2
+#define FAKE_CONTEXT_DESTROY_SURFACE 3
+#define FAKE_CONTEXT_CREATE_CONTEXT 4
+#define FAKE_CONTEXT_DESTROY_CONTEXT 5
+#define FAKE_CONTEXT_MAKE_CURRENT 6
+#define FAKE_CONTEXT_RELEASE_CURRENT 7
+#define FAKE_CONTEXT_SWAP 8
+#define FAKE_CONTEXT_CALL_COUNT 9
+
+// Context layer for hosts: records its calls, fails the ones it is told to
+// fail, and takes as long to create a context as it is told to.
+class FakeContextLayer : public ContextLayer {
+public:
+    FakeContextLayer();
+
+    // The next count calls of the kind fail; with error for MakeCurrent() and
+    // Swap(), the others just return false.
+    void FailCall(int call, int error, int count = 1);
+
+    void SetCreateContextCostNs(int64_t costNs) {
+        mCreateContextCostNs = costNs;
+    }
+
+    // FAKE_CONTEXT_* in the order they were made
+    const std::vector<int> &GetCalls() const {
+        return mCalls;
+    }
+
+    void ClearCalls() {
+        mCalls.clear();
+    }
+
+    static const char *GetCallName(int call);
+
+    bool InitDisplay() override;
+    void TerminateDisplay() override;
+    bool CreateSurface() override;
+    void DestroySurface() override;
+    bool CreateContext() override;
+    void DestroyContext() override;
+    int MakeCurrent() override;
+    void ReleaseCurrent() override;
+    int Swap() override;
+
+private:
+    // records the call, returns the error it is to fail with or CONTEXT_OK
+    int Call(int call);
+
+    std::vector<int> mCalls;
+    int mFailError[FAKE_CONTEXT_CALL_COUNT];
+    int mFailCount[FAKE_CONTEXT_CALL_COUNT];
+    int64_t mCreateContextCostNs;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "resolution_controller.hpp"
+#include <cstring>
+#include "Log.h"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// weight of the newest frame in the smoothed cost
+#define RESOLUTION_SMOOTHING 0.1
+// frames count at most this many times the smoothed cost
+#define RESOLUTION_MAX_SAMPLE_RATIO 2.0
+
+// scale down over this fraction of the budget...
+#define RESOLUTION_DOWNSCALE_LINE 0.9
+// ...for this many frames in a row, to the step predicted to cost this fraction
+#define RESOLUTION_DOWNSCALE_FRAMES 10
+#define RESOLUTION_TARGET 0.8
+
+// scale up when the next step up is predicted under this fraction of the budget...
+#define RESOLUTION_UPSCALE_LINE 0.75
+// ...for this many frames in a row
+#define RESOLUTION_UPSCALE_FRAMES 90
+
+// frames ignored after a change, GPU timings arrive a few frames late
+#define RESOLUTION_SETTLE_FRAMES 8
+
+// a downscale is checked after this many measured frames, and undone if it saved
+// less than this fraction of the predicted saving...
+#define RESOLUTION_CHECK_FRAMES 30
+#define RESOLUTION_MIN_SAVING 0.25
+// ...which holds off downscaling for this many frames, doubled each time up to the max
+#define RESOLUTION_DOWNSCALE_HOLD_FRAMES 600
+#define RESOLUTION_MAX_DOWNSCALE_HOLD_FRAMES 9600
+
+// budget until SetBudget() is called, 60Hz
+#define RESOLUTION_DEFAULT_BUDGET_NS 16666667LL
+
+namespace {
+    // fraction of the surface's width and height rendered at each step
+    const float RESOLUTION_STEP_SCALES[RESOLUTION_STEP_COUNT] = {
+            1.0f, 0.9f, 0.8f, 0.7f, 0.6f, 0.5f
+    };
+
+    // cost of a frame at step 'to' given its cost at step 'from'
+    double predict_cost(double costNs, int from, int to) {
+        const double ratio = (double) RESOLUTION_STEP_SCALES[to] / RESOLUTION_STEP_SCALES[from];
+        return costNs * ratio * ratio;
+    }
+
+    int align_size(float size) {
+        int aligned = ((int) (size + 0.5f) + RESOLUTION_ALIGNMENT / 2) / RESOLUTION_ALIGNMENT *
+                      RESOLUTION_ALIGNMENT;
+        return aligned > RESOLUTION_ALIGNMENT ? aligned : RESOLUTION_ALIGNMENT;
+    }
+}
+
+ResolutionController::ResolutionController() {
+    mBudgetNs = RESOLUTION_DEFAULT_BUDGET_NS;
+    mDownscaleHold = RESOLUTION_DOWNSCALE_HOLD_FRAMES;
+    memset(&mStats, 0, sizeof(mStats));
+    SetStep(0);
+}
+
+void ResolutionController::SetBudget(int64_t budgetNs) {
+    mBudgetNs = budgetNs > 0 ? budgetNs : RESOLUTION_DEFAULT_BUDGET_NS;
+}
+
+void ResolutionController::SetStep(int step) {
+    mStep = step < 0 ? 0 : step >= RESOLUTION_STEP_COUNT ? RESOLUTION_STEP_COUNT - 1 : step;
+    mCostNs = -1.0;
+    mSettleFrames = 0;
+    mOverBudget = mUnderBudget = 0;
+    mCheckFrames = 0;
+    mHoldFrames = 0;
+}
+
+float ResolutionController::GetStepScale(int step) {
+    return RESOLUTION_STEP_SCALES[step];
+}
+
+void ResolutionController::GetRenderSize(int surfaceWidth, int surfaceHeight, int *width,
+                                         int *height) const {
+    if (mStep == 0) {
+        // the surface as it is, however it is aligned
+        *width = surfaceWidth;
+        *height = surfaceHeight;
+        return;
+    }
+    const float scale = RESOLUTION_STEP_SCALES[mStep];
+    *width = align_size((float) surfaceWidth * scale);
+    *height = align_size((float) surfaceHeight * scale);
+}
+
+void ResolutionController::ChangeStep(int step) {
+    if (step < mStep) {
+        ++mStats.upscales;
+    } else {
+        ++mStats.downscales;
+    }
+    ALOGI("ResolutionController: scale %.2f -> %.2f, smoothed cost %.2f ms of %.2f ms",
+          (double) RESOLUTION_STEP_SCALES[mStep], (double) RESOLUTION_STEP_SCALES[step],
+          mCostNs / 1e6, (double) mBudgetNs / 1e6);
+
+    // costs at the old size say nothing about the new one
+    mStep = step;
+    mCostNs = -1.0;
+    mSettleFrames = RESOLUTION_SETTLE_FRAMES;
+    mOverBudget = mUnderBudget = 0;
+    mCheckFrames = 0;
+}
+
+bool ResolutionController::AddFrame(int64_t cpuNs, int64_t gpuNs) {
+    if (mHoldFrames > 0) {
+        --mHoldFrames;
+    }
+    if (mSettleFrames > 0) {
+        --mSettleFrames;
+        return false;
+    }
+    const double costNs = (double) (gpuNs >= 0 ? gpuNs : cpuNs);
+    if (mCostNs < 0.0) {
+        mCostNs = costNs;
+    } else {
+        // a lone spike moves the smoothed cost only so far
+        const double limitNs = mCostNs * RESOLUTION_MAX_SAMPLE_RATIO;
+        mCostNs += ((costNs < limitNs ? costNs : limitNs) - mCostNs) * RESOLUTION_SMOOTHING;
+    }
+    mStats.smoothedCostNs = (int64_t) mCostNs;
+
+    if (mCheckFrames > 0 && --mCheckFrames == 0) {
+        const double predictedSavingNs = mCostBeforeDownscaleNs - mPredictedCostNs;
+        if (mCostBeforeDownscaleNs - mCostNs < predictedSavingNs * RESOLUTION_MIN_SAVING) {
+            ++mStats.ineffectiveDownscales;
+            mHoldFrames = mDownscaleHold;
+            mDownscaleHold = mDownscaleHold * 2 < RESOLUTION_MAX_DOWNSCALE_HOLD_FRAMES ?
+                             mDownscaleHold * 2 : RESOLUTION_MAX_DOWNSCALE_HOLD_FRAMES;
+            ChangeStep(mStepBeforeDownscale);
+            return true;
+        }
+        mDownscaleHold = RESOLUTION_DOWNSCALE_HOLD_FRAMES;
+    }
+
+    const double budgetNs = (double) mBudgetNs;
+    // the frame itself must be heavy too, not just the tail of an earlier spike
+    if (mCostNs > budgetNs * RESOLUTION_DOWNSCALE_LINE && costNs > budgetNs * RESOLUTION_TARGET) {
+        mUnderBudget = 0;
+        // the last downscale is judged before there is another
+        if (++mOverBudget >= RESOLUTION_DOWNSCALE_FRAMES && mStep < RESOLUTION_STEP_COUNT - 1 &&
+            mHoldFrames == 0 && mCheckFrames == 0) {
+            int step = mStep + 1;
+            while (step < RESOLUTION_STEP_COUNT - 1 &&
+                   predict_cost(mCostNs, mStep, step) > budgetNs * RESOLUTION_TARGET) {
+                ++step;
+            }
+            const int stepBefore = mStep;
+            const double costBeforeNs = mCostNs;
+            const double predictedNs = predict_cost(mCostNs, mStep, step);
+            ChangeStep(step);
+            mStepBeforeDownscale = stepBefore;
+            mCostBeforeDownscaleNs = costBeforeNs;
+            mPredictedCostNs = predictedNs;
+            mCheckFrames = RESOLUTION_CHECK_FRAMES;
+            return true;
+        }
+        return false;
+    }
+    mOverBudget = 0;
+
+    if (mStep > 0 &&
+        predict_cost(mCostNs, mStep, mStep - 1) < budgetNs * RESOLUTION_UPSCALE_LINE) {
+        if (++mUnderBudget >= RESOLUTION_UPSCALE_FRAMES) {
+            ChangeStep(mStep - 1);
+            return true;
+        }
+    } else {
+        mUnderBudget = 0;
+    }
+    return false;
+}
@@ -0,0 +1,96 @@
+#ifndef agdktunnel_resolution_controller_hpp
+#define agdktunnel_resolution_controller_hpp
+
+#include <cstdint>
+
+// number of render scales, see RESOLUTION_STEP_SCALES in the .cpp
+#define RESOLUTION_STEP_COUNT 6
+
+// render sizes are rounded to multiples of this many pixels
+#define RESOLUTION_ALIGNMENT 8
+
+/*
+ * Picks the scale the frame is rendered at, relative to the window surface,
+ * from measured frame costs. Scales come in a few fixed steps, step 0 being
+ * the full size, so the picture doesn't shimmer through a stream of tiny size
+ * changes.
+ *
+ * Costs are smoothed and assumed to grow with the number of pixels. The scale
+ * goes down after a short run of frames over the downscale line, straight to
+ * the step predicted to bring the cost back to the target. It goes up once the
+ * cost predicted at the next step up has stayed under the lower upscale line
+ * for a long run of frames. Frames right after a change are not counted while
+ * the GPU timings catch up with the new size.
+ *
+ * A downscale that saves much less than predicted shows the frame isn't bound
+ * by its pixels (e.g. it is CPU bound and only CPU times are known): it is
+ * undone, and downscaling is held off for a while, longer each time.
+ */
+class ResolutionController {
+public:
+    struct Stats {
+        uint64_t upscales;
+        uint64_t downscales;
+        // downscales undone because they didn't pay off
+        uint64_t ineffectiveDownscales;
+        // the smoothed cost, at the current step
+        int64_t smoothedCostNs;
+    };
+
+    ResolutionController();
+
+    // time a frame may take
+    void SetBudget(int64_t budgetNs);
+
+    // Records a frame's cost: its GPU time, or its CPU time if the GPU time is
+    // unknown (negative). Returns true if this changed the step.
+    bool AddFrame(int64_t cpuNs, int64_t gpuNs);
+
+    // jumps to a step and starts over
+    void SetStep(int step);
+
+    int GetStep() const {
+        return mStep;
+    }
+
+    float GetScale() const {
+        return GetStepScale(mStep);
+    }
+
+    static float GetStepScale(int step);
+
+    // the size to render at for a surface of the given size
+    void GetRenderSize(int surfaceWidth, int surfaceHeight, int *width, int *height) const;
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+private:
+    void ChangeStep(int step);
+
+    int mStep;
+    int64_t mBudgetNs;
+
+    // exponentially smoothed cost, negative until the first frame at this step
+    double mCostNs;
+    int mSettleFrames;
+
+    // the last downscale, checked once this many frames have been measured
+    int mCheckFrames;
+    int mStepBeforeDownscale;
+    double mCostBeforeDownscaleNs;
+    double mPredictedCostNs;
+
+    // frames left without downscales, and how long the next hold lasts
+    int mHoldFrames;
+    int mDownscaleHold;
+
+    // consecutive frames over the downscale line and under the upscale line
+    int mOverBudget;
+    int mUnderBudget;
+
+    Stats mStats;
+};
+
+#endif
@@ -0,0 +1,257 @@
+#include "resource_manager.hpp"
+#include <cstring>
+#include "Log.h"
+#include "asset_loader.hpp"
+#include "trace.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// a resource added with AddAsset()
+struct ManagedAsset {
+    AssetLoader *loader;
+    const char *name;
+    int priority;
+    AssetRequest *request;
+};
+
+// Decoded assets count their buffer; views into the pack are the kernel's pages,
+// reclaimable without us, and count nothing.
+static int _load_asset(void *data, ResourceSize *size) {
+    ManagedAsset *asset = (ManagedAsset *) data;
+    if (asset->request == NULL) {
+        asset->request = asset->loader->Load(asset->name, asset->priority);
+        if (asset->request == NULL) {
+            return RESOURCE_FAILED;
+        }
+    }
+    switch (AssetLoader::GetState(asset->request)) {
+        case ASSET_LOAD_READY:
+            break;
+        case ASSET_LOAD_FAILED:
+            asset->loader->Release(asset->request);
+            asset->request = NULL;
+            return RESOURCE_FAILED;
+        default:
+            return RESOURCE_LOADING;
+    }
+    size->cpuBytes = asset->request->buffer != NULL ? asset->request->view.size : 0;
+    size->gpuBytes = 0;
+    return RESOURCE_READY;
+}
+
+static void _unload_asset(void *data, bool) {
+    ManagedAsset *asset = (ManagedAsset *) data;
+    if (asset->request != NULL) {
+        asset->loader->Release(asset->request);
+        asset->request = NULL;
+    }
+}
+
+ResourceManager::ResourceManager(size_t cpuBudgetBytes, size_t gpuBudgetBytes) {
+    mHead = mTail = -1;
+    mFrame = 0;
+    mCpuBudget = cpuBudgetBytes;
+    mGpuBudget = gpuBudgetBytes;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+ResourceManager::~ResourceManager() {
+    for (int id = 0; id < (int) mEntries.size(); ++id) {
+        if (mEntries[id].state == RESOURCE_READY || mEntries[id].state == RESOURCE_LOADING) {
+            Unload(id, true);
+        }
+    }
+    for (ManagedAsset *asset : mAssets) {
+        delete asset;
+    }
+}
+
+void ResourceManager::SetBudgets(size_t cpuBudgetBytes, size_t gpuBudgetBytes) {
+    mCpuBudget = cpuBudgetBytes;
+    mGpuBudget = gpuBudgetBytes;
+    EvictToBudget();
+}
+
+int ResourceManager::Add(const ResourceDesc &desc) {
+    Entry entry;
+    entry.desc = desc;
+    entry.state = RESOURCE_UNLOADED;
+    entry.size.cpuBytes = entry.size.gpuBytes = 0;
+    entry.prev = entry.next = -1;
+    entry.lastUsedFrame = 0;
+    entry.loadStartNs = 0;
+    mEntries.push_back(entry);
+    return (int) mEntries.size() - 1;
+}
+
+int ResourceManager::AddAsset(AssetLoader *loader, const char *name, int priority) {
+    ManagedAsset *asset = new ManagedAsset;
+    asset->loader = loader;
+    asset->name = name;
+    asset->priority = priority;
+    asset->request = NULL;
+    mAssets.push_back(asset);
+    ResourceDesc desc = {name, _load_asset, _unload_asset, asset};
+    return Add(desc);
+}
+
+int ResourceManager::Find(const char *name) const {
+    for (int id = 0; id < (int) mEntries.size(); ++id) {
+        if (strcmp(mEntries[id].desc.name, name) == 0) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+bool ResourceManager::GetAssetData(int id, AssetView *view) const {
+    const Entry &entry = mEntries[id];
+    if (entry.desc.load != _load_asset || entry.state != RESOURCE_READY) {
+        return false;
+    }
+    return AssetLoader::GetData(((const ManagedAsset *) entry.desc.data)->request, view);
+}
+
+void ResourceManager::Link(int id) {
+    Entry &entry = mEntries[id];
+    entry.prev = -1;
+    entry.next = mHead;
+    if (mHead >= 0) {
+        mEntries[mHead].prev = id;
+    } else {
+        mTail = id;
+    }
+    mHead = id;
+}
+
+void ResourceManager::Unlink(int id) {
+    Entry &entry = mEntries[id];
+    if (entry.prev >= 0) {
+        mEntries[entry.prev].next = entry.next;
+    } else {
+        mHead = entry.next;
+    }
+    if (entry.next >= 0) {
+        mEntries[entry.next].prev = entry.prev;
+    } else {
+        mTail = entry.prev;
+    }
+    entry.prev = entry.next = -1;
+}
+
+bool ResourceManager::Acquire(int id) {
+    Entry &entry = mEntries[id];
+    entry.lastUsedFrame = mFrame;
+    switch (entry.state) {
+        case RESOURCE_READY:
+            ++mStats.hits;
+            if (mHead != id) {
+                Unlink(id);
+                Link(id);
+            }
+            return true;
+        case RESOURCE_FAILED:
+            return false;
+        case RESOURCE_UNLOADED:
+            ++mStats.misses;
+            entry.state = RESOURCE_LOADING;
+            entry.loadStartNs = Trace::NowNs();
+            break;
+        default:
+            break;
+    }
+
+    ResourceSize size = {0, 0};
+    const int state = entry.desc.load(entry.desc.data, &size);
+    if (state == RESOURCE_LOADING) {
+        return false;
+    }
+    if (state != RESOURCE_READY) {
+        ALOGE("ResourceManager: failed to load %s", entry.desc.name);
+        entry.state = RESOURCE_FAILED;
+        ++mStats.failures;
+        return false;
+    }
+
+    entry.state = RESOURCE_READY;
+    entry.size = size;
+    Link(id);
+    ++mStats.loads;
+    mStats.loadNs += Trace::NowNs() - entry.loadStartNs;
+    mStats.cpuBytes += size.cpuBytes;
+    mStats.gpuBytes += size.gpuBytes;
+    if (mStats.cpuBytes > mStats.peakCpuBytes) {
+        mStats.peakCpuBytes = mStats.cpuBytes;
+    }
+    if (mStats.gpuBytes > mStats.peakGpuBytes) {
+        mStats.peakGpuBytes = mStats.gpuBytes;
+    }
+    EvictToBudget();
+    return true;
+}
+
+void ResourceManager::Unload(int id, bool deleteGpuObjects) {
+    Entry &entry = mEntries[id];
+    const int64_t startNs = Trace::NowNs();
+    if (entry.desc.unload != NULL) {
+        entry.desc.unload(entry.desc.data, deleteGpuObjects);
+    }
+    if (entry.state == RESOURCE_READY) {
+        Unlink(id);
+        mStats.cpuBytes -= entry.size.cpuBytes;
+        mStats.gpuBytes -= entry.size.gpuBytes;
+        ++mStats.evictions;
+        mStats.evictNs += Trace::NowNs() - startNs;
+    }
+    entry.state = RESOURCE_UNLOADED;
+    entry.size.cpuBytes = entry.size.gpuBytes = 0;
+}
+
+void ResourceManager::EvictToBudget() {
+    // the list is in use order, so once the coldest resource is in use they all are
+    while ((mStats.cpuBytes > mCpuBudget || mStats.gpuBytes > mGpuBudget) && mTail >= 0 &&
+           mEntries[mTail].lastUsedFrame != mFrame) {
+        Unload(mTail, true);
+    }
+}
+
+void ResourceManager::EndFrame() {
+    // loads this frame could only evict what it wasn't using
+    if (mStats.cpuBytes > mCpuBudget || mStats.gpuBytes > mGpuBudget) {
+        ++mStats.overBudgetFrames;
+    }
+    // nothing is in use by the next frame yet, so this gets back within the budgets
+    ++mFrame;
+    EvictToBudget();
+}
+
+void ResourceManager::Trim(size_t cpuTargetBytes, size_t gpuTargetBytes) {
+    TRACE_SCOPE("TrimResources");
+    const int64_t startNs = Trace::NowNs();
+    const size_t cpuBytes = mStats.cpuBytes;
+    const size_t gpuBytes = mStats.gpuBytes;
+    int id = mTail;
+    while (id >= 0 && (mStats.cpuBytes > cpuTargetBytes || mStats.gpuBytes > gpuTargetBytes)) {
+        const Entry &entry = mEntries[id];
+        const int prev = entry.prev;
+        // only what is over its target goes
+        if ((mStats.cpuBytes > cpuTargetBytes && entry.size.cpuBytes > 0) ||
+            (mStats.gpuBytes > gpuTargetBytes && entry.size.gpuBytes > 0)) {
+            Unload(id, true);
+        }
+        id = prev;
+    }
+    ++mStats.trims;
+    ALOGI("ResourceManager: trimmed %zu KB CPU, %zu KB GPU in %.2f ms, %zu KB CPU, "
+          "%zu KB GPU left", (cpuBytes - mStats.cpuBytes) / 1024,
+          (gpuBytes - mStats.gpuBytes) / 1024, (double) (Trace::NowNs() - startNs) / 1e6,
+          mStats.cpuBytes / 1024, mStats.gpuBytes / 1024);
+}
+
+void ResourceManager::ForgetGpuResources() {
+    for (int id = 0; id < (int) mEntries.size(); ++id) {
+        if (mEntries[id].state == RESOURCE_READY && mEntries[id].size.gpuBytes > 0) {
+            Unload(id, false);
+        }
+    }
+}
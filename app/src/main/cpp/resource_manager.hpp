@@ -0,0 +1,150 @@
+#ifndef agdktunnel_resource_manager_hpp
+#define agdktunnel_resource_manager_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class AssetLoader;
+struct AssetView;
+struct ManagedAsset;
+
+// states of a managed resource
+#define RESOURCE_UNLOADED 0
+#define RESOURCE_LOADING 1
+#define RESOURCE_READY 2
+#define RESOURCE_FAILED 3
+
+// memory a resident resource holds
+struct ResourceSize {
+    size_t cpuBytes;
+    size_t gpuBytes;
+};
+
+// Starts or continues loading: returns RESOURCE_LOADING until the resource is
+// resident, then RESOURCE_READY with its size filled in, or RESOURCE_FAILED.
+typedef int (*ResourceLoad)(void *data, ResourceSize *size);
+// Frees what the load made; GPU objects are only deleted if deleteGpuObjects
+// (they may be gone with their context already).
+typedef void (*ResourceUnload)(void *data, bool deleteGpuObjects);
+
+struct ResourceDesc {
+    // for logs only
+    const char *name;
+    ResourceLoad load;
+    ResourceUnload unload;
+    void *data;
+};
+
+/*
+ * Keeps resources resident within a CPU and a GPU memory budget. Resources are
+ * loaded when first acquired and kept in least recently used order; going over
+ * a budget evicts from the cold end, sparing whatever was acquired in the
+ * current frame. Trim() evicts down to a lower target, e.g. under memory
+ * pressure, sparing nothing. An evicted resource loads again the next time it
+ * is acquired.
+ *
+ * Used from the game thread only.
+ */
+class ResourceManager {
+public:
+    struct Stats {
+        // acquires that found the resource resident
+        uint64_t hits;
+        // acquires that had to start a load
+        uint64_t misses;
+        uint64_t loads;
+        uint64_t failures;
+        uint64_t evictions;
+        uint64_t trims;
+        // frames that used more than the budgets hold, evicted down when they ended
+        uint64_t overBudgetFrames;
+        size_t cpuBytes, gpuBytes;
+        size_t peakCpuBytes, peakGpuBytes;
+        // from the start of a load to the resource being resident
+        int64_t loadNs;
+        int64_t evictNs;
+    };
+
+    ResourceManager(size_t cpuBudgetBytes, size_t gpuBudgetBytes);
+
+    // unloads everything
+    ~ResourceManager();
+
+    ResourceManager(const ResourceManager &) = delete;
+    ResourceManager &operator=(const ResourceManager &) = delete;
+
+    void SetBudgets(size_t cpuBudgetBytes, size_t gpuBudgetBytes);
+
+    size_t GetCpuBudget() const {
+        return mCpuBudget;
+    }
+
+    size_t GetGpuBudget() const {
+        return mGpuBudget;
+    }
+
+    // returns the resource's id; it is not loaded until it is acquired
+    int Add(const ResourceDesc &desc);
+
+    // a resource loaded through the asset loader; the name must outlive the manager
+    int AddAsset(AssetLoader *loader, const char *name, int priority);
+
+    // id of the resource with this name, -1 if there is none
+    int Find(const char *name) const;
+
+    // Marks the resource used this frame and loads it if needed. True once it is
+    // resident; until then every call moves the load along.
+    bool Acquire(int id);
+
+    // the bytes of a resident resource added with AddAsset(), false for any other
+    bool GetAssetData(int id, AssetView *view) const;
+
+    int GetState(int id) const {
+        return mEntries[id].state;
+    }
+
+    // the frame is over: its resources can be evicted again, and are, down to the budgets
+    void EndFrame();
+
+    // evicts least recently used resources until usage is at most the targets
+    void Trim(size_t cpuTargetBytes, size_t gpuTargetBytes);
+
+    // Unloads every resource holding GPU objects without deleting them, because
+    // their context is gone; they load again on a new context when acquired.
+    void ForgetGpuResources();
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+private:
+    struct Entry {
+        ResourceDesc desc;
+        int state;
+        ResourceSize size;
+        // neighbours in the resident list, -1 at the ends
+        int prev, next;
+        uint64_t lastUsedFrame;
+        int64_t loadStartNs;
+    };
+
+    void Link(int id);
+    void Unlink(int id);
+    void Unload(int id, bool deleteGpuObjects);
+    void EvictToBudget();
+
+    std::vector<Entry> mEntries;
+    // resident resources, most recently used first
+    int mHead, mTail;
+    uint64_t mFrame;
+
+    size_t mCpuBudget, mGpuBudget;
+
+    // state of the resources added with AddAsset()
+    std::vector<ManagedAsset *> mAssets;
+
+    Stats mStats;
+};
+
+#endif
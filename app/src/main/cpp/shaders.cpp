@@ -0,0 +1,58 @@
+#include "shaders.hpp"
+#include "render_commands.hpp"
+
+namespace {
+    // tunnel walls: textured, fading into the fog with distance from the camera
+    const char *TUNNEL_VERTEX_SHADER =
+            "#version 300 es\n"
+            "uniform mat4 u_viewProjection;\n"
+            "uniform float u_cameraZ;\n"
+            "uniform float u_fogDistance;\n"
+            "layout(location = 0) in vec3 a_position;\n"
+            "layout(location = 1) in vec2 a_uv;\n"
+            "out vec2 v_uv;\n"
+            "out float v_fog;\n"
+            "void main() {\n"
+            "    v_uv = a_uv;\n"
+            "    v_fog = clamp((a_position.z - u_cameraZ) / u_fogDistance, 0.0, 1.0);\n"
+            "    gl_Position = u_viewProjection * vec4(a_position, 1.0);\n"
+            "}\n";
+
+    const char *TUNNEL_FRAGMENT_SHADER =
+            "#version 300 es\n"
+            "precision mediump float;\n"
+            "uniform sampler2D u_texture;\n"
+            "uniform vec3 u_fogColor;\n"
+            "in vec2 v_uv;\n"
+            "in float v_fog;\n"
+            "out vec4 o_color;\n"
+            "void main() {\n"
+            "    vec3 color = texture(u_texture, v_uv).rgb;\n"
+            "    o_color = vec4(mix(color, u_fogColor, v_fog * v_fog), 1.0);\n"
+            "}\n";
+
+    // flat coloured 2D shapes over the scene, in normalized device coordinates
+    const char *OVERLAY_VERTEX_SHADER =
+            "#version 300 es\n"
+            "layout(location = 0) in vec2 a_position;\n"
+            "layout(location = 1) in vec4 a_color;\n"
+            "out vec4 v_color;\n"
+            "void main() {\n"
+            "    v_color = a_color;\n"
+            "    gl_Position = vec4(a_position, 0.0, 1.0);\n"
+            "}\n";
+
+    const char *OVERLAY_FRAGMENT_SHADER =
+            "#version 300 es\n"
+            "precision mediump float;\n"
+            "in vec4 v_color;\n"
+            "out vec4 o_color;\n"
+            "void main() {\n"
+            "    o_color = v_color;\n"
+            "}\n";
+}
+
+const PipelineDesc ENGINE_PIPELINES[ENGINE_PIPELINE_COUNT] = {
+        {"tunnel", TUNNEL_VERTEX_SHADER, TUNNEL_FRAGMENT_SHADER, RENDER_FLAG_DEPTH_TEST},
+        {"overlay", OVERLAY_VERTEX_SHADER, OVERLAY_FRAGMENT_SHADER, RENDER_FLAG_BLEND},
+};
@@ -0,0 +1,14 @@
+#ifndef agdktunnel_shaders_hpp
+#define agdktunnel_shaders_hpp
+
+#include "pipeline_cache.hpp"
+
+// indices into ENGINE_PIPELINES
+#define PIPELINE_TUNNEL 0
+#define PIPELINE_OVERLAY 1
+#define ENGINE_PIPELINE_COUNT 2
+
+// every pipeline the engine draws with, built ahead of use by the pipeline cache
+extern const PipelineDesc ENGINE_PIPELINES[ENGINE_PIPELINE_COUNT];
+
+#endif
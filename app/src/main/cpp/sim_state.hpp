@@ -0,0 +1,29 @@
+#ifndef agdktunnel_sim_state_hpp
+#define agdktunnel_sim_state_hpp
+
+#include <cstdint>
+
+// how fast the camera flies down the tunnel, units per second
+#define CAMERA_SPEED 60.0f
+
+// Game state advanced by the fixed-step simulation. Everything the renderer reads
+// must be interpolatable between two consecutive states.
+struct SimState {
+    uint64_t step;
+
+    // distance travelled down the tunnel
+    float cameraZ;
+};
+
+inline void UpdateSimState(SimState *state, float dt) {
+    ++state->step;
+    state->cameraZ += CAMERA_SPEED * dt;
+}
+
+inline SimState LerpSimState(const SimState &from, const SimState &to, float alpha) {
+    SimState state = to;
+    state.cameraZ = from.cameraZ + (to.cameraZ - from.cameraZ) * alpha;
+    return state;
+}
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef agdktunnel_simd_hpp
+#define agdktunnel_simd_hpp
+
+/*
+ * Four-wide float vectors on NEON (arm64, armv7 with NEON), SSE2 (x86, x86_64 and
+ * Linux hosts) or plain C++ everywhere else. Loads and stores are unaligned.
+ * Comparisons give a Mask4 with all bits of a lane set where they hold. Int4 holds
+ * four 32-bit integers whose adds and shifts wrap like uint32_t.
+ */
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+typedef float32x4_t Float4;
+typedef uint32x4_t Mask4;
+typedef int32x4_t Int4;
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_SSE 1
+typedef __m128 Float4;
+typedef __m128 Mask4;
+typedef __m128i Int4;
+#else
+#include <cmath>
+#include <cstdint>
+#define SIMD_SCALAR 1
+struct Float4 {
+    float v[4];
+};
+struct Mask4 {
+    uint32_t v[4];
+};
+struct Int4 {
+    int32_t v[4];
+};
+#endif
+
+#if SIMD_NEON
+
+inline Float4 Float4Load(const float *p) { return vld1q_f32(p); }
+inline void Float4Store(float *p, Float4 a) { vst1q_f32(p, a); }
+inline Float4 Float4Set1(float a) { return vdupq_n_f32(a); }
+inline Float4 Float4Add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+inline Float4 Float4Sub(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+inline Float4 Float4Mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+// a * b + c
+inline Float4 Float4MulAdd(Float4 a, Float4 b, Float4 c) { return vmlaq_f32(c, a, b); }
+inline Float4 Float4Min(Float4 a, Float4 b) { return vminq_f32(a, b); }
+inline Float4 Float4Max(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+inline Mask4 Float4Greater(Float4 a, Float4 b) { return vcgtq_f32(a, b); }
+inline Mask4 Mask4And(Mask4 a, Mask4 b) { return vandq_u32(a, b); }
+inline Float4 Float4Abs(Float4 a) { return vabsq_f32(a); }
+// {a0, b0, a1, b1} and {a2, b2, a3, b3}
+inline Float4 Float4ZipLow(Float4 a, Float4 b) { return vzipq_f32(a, b).val[0]; }
+inline Float4 Float4ZipHigh(Float4 a, Float4 b) { return vzipq_f32(a, b).val[1]; }
+
+inline Int4 Int4Load(const int32_t *p) { return vld1q_s32(p); }
+inline void Int4Store(int32_t *p, Int4 a) { vst1q_s32(p, a); }
+inline Int4 Int4Set1(int32_t a) { return vdupq_n_s32(a); }
+inline Int4 Int4Add(Int4 a, Int4 b) { return vaddq_s32(a, b); }
+inline Int4 Int4Xor(Int4 a, Int4 b) { return veorq_s32(a, b); }
+inline Int4 Int4ShiftLeft(Int4 a, int n) { return vshlq_s32(a, vdupq_n_s32(n)); }
+// shifts zeros in
+inline Int4 Int4ShiftRight(Int4 a, int n) {
+    return vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(a), vdupq_n_s32(-n)));
+}
+// lanes as signed integers
+inline Float4 Int4ToFloat4(Int4 a) { return vcvtq_f32_s32(a); }
+
+// bit i set where lane i is set
+inline int Mask4Bits(Mask4 a) {
+    static const uint32_t kLaneBits[4] = {1, 2, 4, 8};
+    const uint32x4_t bits = vandq_u32(a, vld1q_u32(kLaneBits));
+    const uint32x2_t sum = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+    return (int) vget_lane_u32(vpadd_u32(sum, sum), 0);
+}
+
+#elif SIMD_SSE
+
+inline Float4 Float4Load(const float *p) { return _mm_loadu_ps(p); }
+inline void Float4Store(float *p, Float4 a) { _mm_storeu_ps(p, a); }
+inline Float4 Float4Set1(float a) { return _mm_set1_ps(a); }
+inline Float4 Float4Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+inline Float4 Float4Sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+inline Float4 Float4Mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+// a * b + c
+inline Float4 Float4MulAdd(Float4 a, Float4 b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline Float4 Float4Min(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+inline Float4 Float4Max(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+inline Mask4 Float4Greater(Float4 a, Float4 b) { return _mm_cmpgt_ps(a, b); }
+inline Mask4 Mask4And(Mask4 a, Mask4 b) { return _mm_and_ps(a, b); }
+inline Float4 Float4Abs(Float4 a) { return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))); }
+// {a0, b0, a1, b1} and {a2, b2, a3, b3}
+inline Float4 Float4ZipLow(Float4 a, Float4 b) { return _mm_unpacklo_ps(a, b); }
+inline Float4 Float4ZipHigh(Float4 a, Float4 b) { return _mm_unpackhi_ps(a, b); }
+// bit i set where lane i is set
+inline int Mask4Bits(Mask4 a) { return _mm_movemask_ps(a); }
+
+inline Int4 Int4Load(const int32_t *p) { return _mm_loadu_si128((const __m128i *) p); }
+inline void Int4Store(int32_t *p, Int4 a) { _mm_storeu_si128((__m128i *) p, a); }
+inline Int4 Int4Set1(int32_t a) { return _mm_set1_epi32(a); }
+inline Int4 Int4Add(Int4 a, Int4 b) { return _mm_add_epi32(a, b); }
+inline Int4 Int4Xor(Int4 a, Int4 b) { return _mm_xor_si128(a, b); }
+inline Int4 Int4ShiftLeft(Int4 a, int n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+// shifts zeros in
+inline Int4 Int4ShiftRight(Int4 a, int n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+// lanes as signed integers
+inline Float4 Int4ToFloat4(Int4 a) { return _mm_cvtepi32_ps(a); }
+
+#else
+
+inline Float4 Float4Load(const float *p) {
+    Float4 r = {{p[0], p[1], p[2], p[3]}};
+    return r;
+}
+
+inline void Float4Store(float *p, Float4 a) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = a.v[i];
+    }
+}
+
+inline Float4 Float4Set1(float a) {
+    Float4 r = {{a, a, a, a}};
+    return r;
+}
+
+#define SIMD_SCALAR_OP(name, expr) \
+    inline Float4 name(Float4 a, Float4 b) { \
+        Float4 r; \
+        for (int i = 0; i < 4; ++i) { \
+            r.v[i] = expr; \
+        } \
+        return r; \
+    }
+
+SIMD_SCALAR_OP(Float4Add, a.v[i] + b.v[i])
+SIMD_SCALAR_OP(Float4Sub, a.v[i] - b.v[i])
+SIMD_SCALAR_OP(Float4Mul, a.v[i] * b.v[i])
+SIMD_SCALAR_OP(Float4Min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+SIMD_SCALAR_OP(Float4Max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+
+#undef SIMD_SCALAR_OP
+
+inline Mask4 Float4Greater(Float4 a, Float4 b) {
+    Mask4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v[i] = a.v[i] > b.v[i] ? 0xffffffffu : 0;
+    }
+    return r;
+}
+
+inline Mask4 Mask4And(Mask4 a, Mask4 b) {
+    Mask4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v[i] = a.v[i] & b.v[i];
+    }
+    return r;
+}
+
+// bit i set where lane i is set
+inline int Mask4Bits(Mask4 a) {
+    return (int) ((a.v[0] & 1) | (a.v[1] & 2) | (a.v[2] & 4) | (a.v[3] & 8));
+}
+
+// a * b + c
+inline Float4 Float4MulAdd(Float4 a, Float4 b, Float4 c) {
+    return Float4Add(Float4Mul(a, b), c);
+}
+
+inline Float4 Float4Abs(Float4 a) {
+    Float4 r = {{fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3])}};
+    return r;
+}
+
+// {a0, b0, a1, b1} and {a2, b2, a3, b3}
+inline Float4 Float4ZipLow(Float4 a, Float4 b) {
+    Float4 r = {{a.v[0], b.v[0], a.v[1], b.v[1]}};
+    return r;
+}
+
+inline Float4 Float4ZipHigh(Float4 a, Float4 b) {
+    Float4 r = {{a.v[2], b.v[2], a.v[3], b.v[3]}};
+    return r;
+}
+
+inline Int4 Int4Load(const int32_t *p) {
+    Int4 r = {{p[0], p[1], p[2], p[3]}};
+    return r;
+}
+
+inline void Int4Store(int32_t *p, Int4 a) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = a.v[i];
+    }
+}
+
+inline Int4 Int4Set1(int32_t a) {
+    Int4 r = {{a, a, a, a}};
+    return r;
+}
+
+#define SIMD_SCALAR_INT_OP(name, expr) \
+    inline Int4 name(Int4 a, Int4 b) { \
+        Int4 r; \
+        for (int i = 0; i < 4; ++i) { \
+            r.v[i] = (int32_t) (expr); \
+        } \
+        return r; \
+    }
+
+SIMD_SCALAR_INT_OP(Int4Add, (uint32_t) a.v[i] + (uint32_t) b.v[i])
+SIMD_SCALAR_INT_OP(Int4Xor, a.v[i] ^ b.v[i])
+
+#undef SIMD_SCALAR_INT_OP
+
+inline Int4 Int4ShiftLeft(Int4 a, int n) {
+    Int4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v[i] = (int32_t) ((uint32_t) a.v[i] << n);
+    }
+    return r;
+}
+
+// shifts zeros in
+inline Int4 Int4ShiftRight(Int4 a, int n) {
+    Int4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v[i] = (int32_t) ((uint32_t) a.v[i] >> n);
+    }
+    return r;
+}
+
+// lanes as signed integers
+inline Float4 Int4ToFloat4(Int4 a) {
+    Float4 r = {{(float) a.v[0], (float) a.v[1], (float) a.v[2], (float) a.v[3]}};
+    return r;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,145 @@
+#include "snapshot.hpp"
+#include <cstring>
+#include "Log.h"
+#include "asset_pack.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+SnapshotWriter::SnapshotWriter() {
+    Clear();
+}
+
+void SnapshotWriter::Clear() {
+    mData.assign(sizeof(SnapshotHeader), 0);
+    mSectionStart = 0;
+    mSectionCount = 0;
+}
+
+void SnapshotWriter::BeginSection(uint32_t tag) {
+    if (mSectionStart != 0) {
+        EndSection();
+    }
+    mSectionStart = mData.size();
+    SnapshotSectionHeader section = {tag, 0};
+    Write(&section, sizeof(section));
+}
+
+void SnapshotWriter::EndSection() {
+    if (mSectionStart == 0) {
+        return;
+    }
+    SnapshotSectionHeader section;
+    memcpy(&section, mData.data() + mSectionStart, sizeof(section));
+    section.size = (uint32_t) (mData.size() - mSectionStart - sizeof(section));
+    memcpy(mData.data() + mSectionStart, &section, sizeof(section));
+    mSectionStart = 0;
+    ++mSectionCount;
+}
+
+void SnapshotWriter::Write(const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    mData.insert(mData.end(), bytes, bytes + size);
+}
+
+void SnapshotWriter::WriteString(const std::string &value) {
+    WriteU32((uint32_t) value.size());
+    Write(value.data(), value.size());
+}
+
+void SnapshotWriter::Finish() {
+    EndSection();
+    SnapshotHeader header;
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.size = (uint32_t) mData.size();
+    header.sectionCount = mSectionCount;
+    header.contentHash = AssetPack::HashContent(mData.data() + sizeof(header),
+                                                mData.size() - sizeof(header));
+    memcpy(mData.data(), &header, sizeof(header));
+}
+
+SnapshotReader::SnapshotReader() {
+    mData = NULL;
+    mSize = mOffset = mSectionEnd = 0;
+    mFailed = true;
+}
+
+bool SnapshotReader::Open(const void *data, size_t size) {
+    mData = NULL;
+    mSize = mOffset = mSectionEnd = 0;
+    mFailed = true;
+
+    SnapshotHeader header;
+    if (data == NULL || size < sizeof(header)) {
+        ALOGW("SnapshotReader: too short for a snapshot, %zu bytes", size);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION) {
+        ALOGW("SnapshotReader: not a version %d snapshot", SNAPSHOT_VERSION);
+        return false;
+    }
+    if (header.size != size) {
+        ALOGW("SnapshotReader: snapshot is %zu bytes, expected %u", size, header.size);
+        return false;
+    }
+    const uint8_t *bytes = (const uint8_t *) data;
+    if (AssetPack::HashContent(bytes + sizeof(header), size - sizeof(header)) !=
+        header.contentHash) {
+        ALOGW("SnapshotReader: snapshot is damaged");
+        return false;
+    }
+
+    mData = bytes;
+    mSize = size;
+    mOffset = mSectionEnd = sizeof(header);
+    mFailed = false;
+    return true;
+}
+
+bool SnapshotReader::NextSection(uint32_t *tag) {
+    if (mData == NULL) {
+        return false;
+    }
+    // whatever of the current section wasn't read is skipped
+    mOffset = mSectionEnd;
+    SnapshotSectionHeader section;
+    if (mSize - mOffset < sizeof(section)) {
+        return false;
+    }
+    memcpy(&section, mData + mOffset, sizeof(section));
+    mOffset += sizeof(section);
+    if (section.size > mSize - mOffset) {
+        ALOGW("SnapshotReader: section %u runs past the end", section.tag);
+        mFailed = true;
+        mSectionEnd = mOffset = mSize;
+        return false;
+    }
+    mSectionEnd = mOffset + section.size;
+    *tag = section.tag;
+    return true;
+}
+
+bool SnapshotReader::Read(void *data, size_t size) {
+    if (mFailed || size > mSectionEnd - mOffset) {
+        mFailed = true;
+        return false;
+    }
+    memcpy(data, mData + mOffset, size);
+    mOffset += size;
+    return true;
+}
+
+bool SnapshotReader::ReadString(std::string *value, size_t maxLength) {
+    uint32_t length;
+    if (!ReadU32(&length)) {
+        return false;
+    }
+    if (length > maxLength || length > mSectionEnd - mOffset) {
+        mFailed = true;
+        return false;
+    }
+    value->assign((const char *) mData + mOffset, length);
+    mOffset += length;
+    return true;
+}
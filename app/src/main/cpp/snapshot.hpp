@@ -0,0 +1,138 @@
+#ifndef agdktunnel_snapshot_hpp
+#define agdktunnel_snapshot_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Snapshot layout, all integers little endian:
+ *
+ *   SnapshotHeader
+ *   sections, each a SnapshotSectionHeader followed by its payload
+ *
+ * Readers skip sections they don't know, so a section can be added without a
+ * version change. The version changes with the layout of a section readers
+ * already know; a snapshot of another version is rejected as a whole and the
+ * game starts cold.
+ */
+
+// 'ASNP'
+#define SNAPSHOT_MAGIC 0x504e5341u
+#define SNAPSHOT_VERSION 1
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    // of the whole snapshot, header included
+    uint32_t size;
+    uint32_t sectionCount;
+    // AssetPack::HashContent() of everything after the header
+    uint64_t contentHash;
+};
+
+struct SnapshotSectionHeader {
+    uint32_t tag;
+    // of the payload
+    uint32_t size;
+};
+
+// Builds a snapshot in memory, one section at a time.
+class SnapshotWriter {
+public:
+    SnapshotWriter();
+
+    // starts over with an empty snapshot
+    void Clear();
+
+    void BeginSection(uint32_t tag);
+    void EndSection();
+
+    void Write(const void *data, size_t size);
+
+    void WriteU32(uint32_t value) {
+        Write(&value, sizeof(value));
+    }
+
+    void WriteU64(uint64_t value) {
+        Write(&value, sizeof(value));
+    }
+
+    void WriteI32(int32_t value) {
+        Write(&value, sizeof(value));
+    }
+
+    void WriteF32(float value) {
+        Write(&value, sizeof(value));
+    }
+
+    // length first, no terminator
+    void WriteString(const std::string &value);
+
+    // completes the header; the snapshot is then GetData() and GetSize()
+    void Finish();
+
+    const uint8_t *GetData() const {
+        return mData.data();
+    }
+
+    size_t GetSize() const {
+        return mData.size();
+    }
+
+private:
+    std::vector<uint8_t> mData;
+    // where the open section's header is, 0 when there is none
+    size_t mSectionStart;
+    uint32_t mSectionCount;
+};
+
+// Reads a snapshot section by section. Reading past the end of the current
+// section fails, and so does every read after it.
+class SnapshotReader {
+public:
+    SnapshotReader();
+
+    // false if the data isn't a complete, undamaged snapshot of this version
+    bool Open(const void *data, size_t size);
+
+    // moves to the next section, false after the last one
+    bool NextSection(uint32_t *tag);
+
+    bool Read(void *data, size_t size);
+
+    bool ReadU32(uint32_t *value) {
+        return Read(value, sizeof(*value));
+    }
+
+    bool ReadU64(uint64_t *value) {
+        return Read(value, sizeof(*value));
+    }
+
+    bool ReadI32(int32_t *value) {
+        return Read(value, sizeof(*value));
+    }
+
+    bool ReadF32(float *value) {
+        return Read(value, sizeof(*value));
+    }
+
+    // fails for strings longer than maxLength
+    bool ReadString(std::string *value, size_t maxLength);
+
+    // some read ran past its section
+    bool HasFailed() const {
+        return mFailed;
+    }
+
+private:
+    const uint8_t *mData;
+    size_t mSize;
+    // read position, and the end of the current section
+    size_t mOffset;
+    size_t mSectionEnd;
+    bool mFailed;
+};
+
+#endif
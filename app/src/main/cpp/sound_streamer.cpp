@@ -0,0 +1,207 @@
+#include "sound_streamer.hpp"
+#include <chrono>
+#include <cstring>
+#include "Log.h"
+#include "trace.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// frames Read() takes out of the ring at once
+#define SOUND_STREAM_READ_FRAMES 64
+
+SoundStream::SoundStream(const ImaAdpcmInfo &info, bool loop)
+        : mInfo(info), mLoop(loop), mEnded(false), mHolds(0), mUnderruns(0) {
+    mNextBlock = 0;
+    mPosition = 0;
+    mClosed = false;
+}
+
+int SoundStream::Read(float *left, float *right, int frameCount) {
+    // checked first, so running dry after it really is the end
+    const bool ended = mEnded.load(std::memory_order_acquire);
+    StreamFrame frames[SOUND_STREAM_READ_FRAMES];
+    int read = 0;
+    while (read < frameCount) {
+        const int wanted = frameCount - read < SOUND_STREAM_READ_FRAMES ? frameCount - read
+                                                                        : SOUND_STREAM_READ_FRAMES;
+        const int count = (int) mRing.PopMany(frames, wanted);
+        for (int i = 0; i < count; ++i) {
+            left[read + i] = frames[i].left * (1.0f / 32768.0f);
+            right[read + i] = frames[i].right * (1.0f / 32768.0f);
+        }
+        read += count;
+        if (count < wanted) {
+            break;
+        }
+    }
+    for (int i = read; i < frameCount; ++i) {
+        left[i] = right[i] = 0.0f;
+    }
+    if (read < frameCount && !ended) {
+        mUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    return read;
+}
+
+bool SoundStream::IsFinished() const {
+    return mEnded.load(std::memory_order_acquire) && mRing.IsEmpty();
+}
+
+SoundStreamer::SoundStreamer(int sampleRate) {
+    mSampleRate = sampleRate;
+    mQuit = false;
+    memset(&mStats, 0, sizeof(mStats));
+    mStreams.reserve(SOUND_STREAMER_MAX_STREAMS);
+    mOpenSamples.resize(IMA_ADPCM_MAX_BLOCK_FRAMES * IMA_ADPCM_MAX_CHANNELS);
+    mOpenFrames.resize(IMA_ADPCM_MAX_BLOCK_FRAMES);
+    mThread = std::thread(&SoundStreamer::ThreadMain, this);
+}
+
+SoundStreamer::~SoundStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mQuit = true;
+    }
+    mWake.notify_all();
+    mThread.join();
+    for (SoundStream *stream : mStreams) {
+        delete stream;
+    }
+}
+
+SoundStream *SoundStreamer::Open(const AssetView &view, bool loop) {
+    ImaAdpcmInfo info;
+    if (!ImaAdpcmParseWav(view.data, view.size, &info)) {
+        return NULL;
+    }
+    if (info.sampleRate != mSampleRate) {
+        ALOGE("SoundStreamer: a stream at %d Hz can't play at %d Hz", info.sampleRate,
+              mSampleRate);
+        return NULL;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mStreams.size() >= SOUND_STREAMER_MAX_STREAMS) {
+            ALOGW("SoundStreamer: %d streams open already", SOUND_STREAMER_MAX_STREAMS);
+            return NULL;
+        }
+    }
+
+    // the thread doesn't see the stream until it is added, so filling it here is safe
+    SoundStream *stream = new SoundStream(info, loop);
+    Fill(stream, mOpenSamples.data(), mOpenFrames.data());
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStreams.push_back(stream);
+        ++mStats.openStreams;
+    }
+    mWake.notify_one();
+    return stream;
+}
+
+void SoundStreamer::Close(SoundStream *stream) {
+    if (stream == NULL) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    stream->mClosed = true;
+    --mStats.openStreams;
+}
+
+SoundStreamer::Stats SoundStreamer::GetStats() {
+    std::lock_guard<std::mutex> lock(mLock);
+    Stats stats = mStats;
+    for (SoundStream *stream : mStreams) {
+        stats.closingStreams += stream->mClosed ? 1 : 0;
+        stats.underruns += stream->mClosed ? 0 : stream->GetUnderruns();
+    }
+    return stats;
+}
+
+void SoundStreamer::Fill(SoundStream *stream, int16_t *samples, StreamFrame *frames) {
+    const ImaAdpcmInfo &info = stream->mInfo;
+    const int64_t startNs = Trace::NowNs();
+    uint64_t decoded = 0;
+    while (!stream->mEnded.load(std::memory_order_relaxed) &&
+           SOUND_STREAM_RING_FRAMES - stream->mRing.Size() >= (size_t) info.framesPerBlock) {
+        const size_t left = info.dataSize - stream->mNextBlock;
+        const size_t size = left < (size_t) info.blockSize ? left : info.blockSize;
+        int frameCount = ImaAdpcmDecodeBlock(info, info.data + stream->mNextBlock, size, samples);
+        // the last block is padded past the end
+        if (frameCount > info.frameCount - stream->mPosition) {
+            frameCount = (int) (info.frameCount - stream->mPosition);
+        }
+        if (info.channelCount == 2) {
+            memcpy(frames, samples, frameCount * sizeof(StreamFrame));
+        } else {
+            for (int i = 0; i < frameCount; ++i) {
+                frames[i].left = frames[i].right = samples[i];
+            }
+        }
+        stream->mRing.PushMany(frames, frameCount);
+        decoded += frameCount;
+        stream->mNextBlock += info.blockSize;
+        stream->mPosition += frameCount;
+
+        if (stream->mNextBlock >= info.dataSize || stream->mPosition >= info.frameCount) {
+            if (stream->mLoop && stream->mPosition > 0) {
+                stream->mNextBlock = 0;
+                stream->mPosition = 0;
+            } else {
+                stream->mEnded.store(true, std::memory_order_release);
+            }
+        }
+    }
+
+    if (decoded > 0) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStats.decodedFrames += decoded;
+        mStats.decodeNs += Trace::NowNs() - startNs;
+    }
+}
+
+void SoundStreamer::ThreadMain() {
+    Trace::SetThreadName("SoundStreamer");
+    std::vector<int16_t> samples(IMA_ADPCM_MAX_BLOCK_FRAMES * IMA_ADPCM_MAX_CHANNELS);
+    std::vector<StreamFrame> frames(IMA_ADPCM_MAX_BLOCK_FRAMES);
+    std::vector<SoundStream *> streams;
+    streams.reserve(SOUND_STREAMER_MAX_STREAMS);
+
+    std::unique_lock<std::mutex> lock(mLock);
+    while (!mQuit) {
+        // closed streams go once no voice holds them; the release pairs with
+        // the audio thread's last Read()
+        for (size_t i = 0; i < mStreams.size();) {
+            SoundStream *stream = mStreams[i];
+            if (stream->mClosed && stream->mHolds.load(std::memory_order_acquire) == 0) {
+                delete stream;
+                mStreams.erase(mStreams.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+        streams.clear();
+        for (SoundStream *stream : mStreams) {
+            if (!stream->mClosed) {
+                streams.push_back(stream);
+            }
+        }
+
+        // only this thread frees streams, so they stay valid while decoding unlocked
+        lock.unlock();
+        for (SoundStream *stream : streams) {
+            TRACE_SCOPE("SoundStreamFill");
+            Fill(stream, samples.data(), frames.data());
+        }
+        lock.lock();
+
+        if (mQuit) {
+            break;
+        }
+        if (mStreams.empty()) {
+            mWake.wait(lock);
+        } else {
+            mWake.wait_for(lock, std::chrono::milliseconds(SOUND_STREAMER_PERIOD_MS));
+        }
+    }
+}
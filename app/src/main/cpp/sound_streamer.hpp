@@ -0,0 +1,151 @@
+#ifndef agdktunnel_sound_streamer_hpp
+#define agdktunnel_sound_streamer_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "asset_pack.hpp"
+#include "ima_adpcm.hpp"
+#include "spsc_ring.hpp"
+
+// frames decoded ahead of the audio thread, a power of two: 341 ms at 48kHz in 64 KB
+#define SOUND_STREAM_RING_FRAMES 16384
+// how often the streamer tops the rings up while streams are open
+#define SOUND_STREAMER_PERIOD_MS 10
+// streams open at once
+#define SOUND_STREAMER_MAX_STREAMS 8
+
+static_assert(SOUND_STREAM_RING_FRAMES >= 2 * IMA_ADPCM_MAX_BLOCK_FRAMES,
+              "a stream's ring must hold two blocks");
+
+struct StreamFrame {
+    int16_t left;
+    int16_t right;
+};
+
+/*
+ * A compressed sound played as it is decoded. The streamer's thread decodes
+ * blocks ahead into the stream's ring, and Read() takes frames out of it on
+ * the audio thread without locking or allocating. If the ring runs dry, Read()
+ * fills in silence and counts an underrun; playback carries on from the next
+ * frame decoded, so nothing is skipped.
+ *
+ * Streams are made and freed by a SoundStreamer.
+ */
+class SoundStream {
+public:
+    // Audio thread. Writes frameCount frames, silence for any not decoded yet
+    // or past the end; returns the frames that came from the stream.
+    int Read(float *left, float *right, int frameCount);
+
+    // no more frames will come, from any thread
+    bool IsFinished() const;
+
+    // times Read() ran out of decoded frames before the end, from any thread
+    int GetUnderruns() const {
+        return mUnderruns.load(std::memory_order_relaxed);
+    }
+
+    // decoded frames waiting to be read, approximate
+    int GetBufferedFrames() const {
+        return (int) mRing.Size();
+    }
+
+    // A stream is held while the mixer plays it, so a closed stream is only
+    // freed once no voice plays it any more.
+    void Acquire() {
+        mHolds.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Release() {
+        mHolds.fetch_sub(1, std::memory_order_release);
+    }
+
+private:
+    friend class SoundStreamer;
+
+    SoundStream(const ImaAdpcmInfo &info, bool loop);
+
+    ImaAdpcmInfo mInfo;
+    bool mLoop;
+
+    // streamer side: the next block and the frames decoded so far this time through
+    size_t mNextBlock;
+    int64_t mPosition;
+    // the streamer's lock guards this
+    bool mClosed;
+
+    // the last frame is in the ring
+    std::atomic<bool> mEnded;
+    std::atomic<int> mHolds;
+    std::atomic<int> mUnderruns;
+
+    SpscRing<StreamFrame, SOUND_STREAM_RING_FRAMES> mRing;
+};
+
+/*
+ * Streams IMA ADPCM .wav assets (see ima_adpcm.hpp) straight out of the mapped
+ * asset pack. A stream holds only its ring, so a track of any length costs
+ * about 64 KB and the kernel pages the compressed file in as it is read. One
+ * thread decodes ahead for every open stream; it sleeps while none are open.
+ *
+ * Open() and Close() are for one thread, the game's.
+ */
+class SoundStreamer {
+public:
+    struct Stats {
+        int openStreams;
+        // closed, but a voice still holds them
+        int closingStreams;
+        uint64_t decodedFrames;
+        // time the thread spent decoding
+        int64_t decodeNs;
+        // of the open streams
+        int underruns;
+    };
+
+    // streams are decoded for a mixer running at sampleRate
+    explicit SoundStreamer(int sampleRate);
+
+    // stops the thread and frees every stream, which nothing may play any more
+    ~SoundStreamer();
+
+    SoundStreamer(const SoundStreamer &) = delete;
+    SoundStreamer &operator=(const SoundStreamer &) = delete;
+
+    // Opens a stream of the .wav file in view, which must outlive it. The ring
+    // is filled before it returns, so the stream can play at once. NULL if the
+    // file isn't one the streamer plays or too many streams are open.
+    SoundStream *Open(const AssetView &view, bool loop);
+
+    // The stream stops decoding and is freed once no voice plays it; it may
+    // not be used afterwards.
+    void Close(SoundStream *stream);
+
+    Stats GetStats();
+
+private:
+    void ThreadMain();
+    // decodes blocks into the stream's ring while whole blocks fit
+    void Fill(SoundStream *stream, int16_t *samples, StreamFrame *frames);
+
+    int mSampleRate;
+
+    std::mutex mLock;
+    // signals new streams and quitting to the thread
+    std::condition_variable mWake;
+    std::vector<SoundStream *> mStreams;
+    bool mQuit;
+    Stats mStats;
+
+    // the game thread's buffers for filling new streams
+    std::vector<int16_t> mOpenSamples;
+    std::vector<StreamFrame> mOpenFrames;
+
+    std::thread mThread;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef agdktunnel_spsc_ring_hpp
+#define agdktunnel_spsc_ring_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define SPSC_CACHE_LINE_SIZE 64
+
+/*
+ * Bounded single-producer/single-consumer ring buffer. Push is only called from
+ * one thread and Pop from one other thread; both are wait-free and never allocate.
+ * Capacity must be a power of two. T should be trivially copyable.
+ */
+template<typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : mHead(0), mCachedTail(0), mTail(0), mCachedHead(0) {}
+
+    // producer side: returns false if the ring is full
+    bool Push(const T &item) {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        if (head - mCachedTail == Capacity) {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+            if (head - mCachedTail == Capacity) {
+                return false;
+            }
+        }
+        mItems[head & kMask] = item;
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // producer side: pushes up to count items at once, returns how many were pushed
+    size_t PushMany(const T *items, size_t count) {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        if (Capacity - (head - mCachedTail) < count) {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+        }
+        const size_t space = Capacity - (head - mCachedTail);
+        if (count > space) {
+            count = space;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            mItems[(head + i) & kMask] = items[i];
+        }
+        mHead.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // consumer side: returns false if the ring is empty
+    bool Pop(T *item) {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mCachedHead) {
+            mCachedHead = mHead.load(std::memory_order_acquire);
+            if (tail == mCachedHead) {
+                return false;
+            }
+        }
+        *item = mItems[tail & kMask];
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side: pops up to maxCount items at once, returns how many were popped
+    size_t PopMany(T *items, size_t maxCount) {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        mCachedHead = mHead.load(std::memory_order_acquire);
+        size_t count = mCachedHead - tail;
+        if (count > maxCount) {
+            count = maxCount;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            items[i] = mItems[(tail + i) & kMask];
+        }
+        mTail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // approximate when called concurrently
+    size_t Size() const {
+        return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+    }
+
+    bool IsEmpty() const {
+        return Size() == 0;
+    }
+
+    static constexpr size_t GetCapacity() {
+        return Capacity;
+    }
+
+private:
+    static constexpr size_t kMask = Capacity - 1;
+
+    // producer-owned line: write index plus its last view of the read index
+    alignas(SPSC_CACHE_LINE_SIZE) std::atomic<size_t> mHead;
+    size_t mCachedTail;
+
+    // consumer-owned line: read index plus its last view of the write index
+    alignas(SPSC_CACHE_LINE_SIZE) std::atomic<size_t> mTail;
+    size_t mCachedHead;
+
+    alignas(SPSC_CACHE_LINE_SIZE) T mItems[Capacity];
+};
+
+#endif
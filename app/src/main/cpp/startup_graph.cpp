@@ -0,0 +1,161 @@
+#include "startup_graph.hpp"
+#include <cstdio>
+#include <string>
+#include <thread>
+#include "Log.h"
+#include "trace.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+StartupGraph::StartupGraph() {
+    mDoneCount = 0;
+    mStartNs = 0;
+    mElapsedNs = 0;
+}
+
+int StartupGraph::AddTask(const char *name, StartupFunction function, void *data, int thread) {
+    Task task;
+    task.name = name;
+    task.function = function;
+    task.data = data;
+    task.thread = thread;
+    task.startNs = task.endNs = -1;
+    task.worker = -1;
+    mTasks.push_back(task);
+    mDependents.emplace_back();
+    return (int) mTasks.size() - 1;
+}
+
+void StartupGraph::AddDependency(int task, int dependency) {
+    // only earlier tasks, so there can't be a cycle
+    if (dependency < 0 || dependency >= task) {
+        ALOGE("StartupGraph: %s can't depend on task %d", mTasks[task].name, dependency);
+        return;
+    }
+    mTasks[task].dependencies.push_back(dependency);
+    mDependents[dependency].push_back(task);
+}
+
+void StartupGraph::Run(int workerCount) {
+    TRACE_SCOPE("Startup");
+    mStartNs = Trace::NowNs();
+    mWaitingFor.resize(mTasks.size());
+    for (int id = 0; id < (int) mTasks.size(); ++id) {
+        mWaitingFor[id] = (int) mTasks[id].dependencies.size();
+        if (mWaitingFor[id] == 0) {
+            (mTasks[id].thread == STARTUP_CALLING_THREAD ? mReadyCalling : mReadyAny).push_back(id);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i <= workerCount; ++i) {
+        workers.emplace_back(&StartupGraph::WorkerMain, this, i);
+    }
+    WorkerMain(0);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    for (const Task &task : mTasks) {
+        if (task.endNs > mElapsedNs) {
+            mElapsedNs = task.endNs;
+        }
+    }
+}
+
+void StartupGraph::WorkerMain(int worker) {
+    if (worker > 0) {
+        char name[32];
+        snprintf(name, sizeof(name), "Startup %d", worker);
+        Trace::SetThreadName(name);
+    }
+    for (int id = TakeTask(worker); id >= 0; id = TakeTask(worker)) {
+        RunTask(id, worker);
+    }
+}
+
+int StartupGraph::TakeTask(int worker) {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        // the calling thread sees to its own tasks first, workers can't take them
+        if (worker == 0 && !mReadyCalling.empty()) {
+            const int id = mReadyCalling.back();
+            mReadyCalling.pop_back();
+            return id;
+        }
+        if (!mReadyAny.empty()) {
+            const int id = mReadyAny.back();
+            mReadyAny.pop_back();
+            return id;
+        }
+        if (mDoneCount == (int) mTasks.size()) {
+            return -1;
+        }
+        mReady.wait(lock);
+    }
+}
+
+void StartupGraph::RunTask(int id, int worker) {
+    Task &task = mTasks[id];
+    const int64_t startNs = Trace::NowNs();
+    {
+        TraceScope scope(task.name);
+        task.function(task.data);
+    }
+    const int64_t endNs = Trace::NowNs();
+
+    std::lock_guard<std::mutex> lock(mLock);
+    task.startNs = startNs - mStartNs;
+    task.endNs = endNs - mStartNs;
+    task.worker = worker;
+    for (int dependent : mDependents[id]) {
+        if (--mWaitingFor[dependent] == 0) {
+            (mTasks[dependent].thread == STARTUP_CALLING_THREAD ? mReadyCalling : mReadyAny)
+                    .push_back(dependent);
+        }
+    }
+    ++mDoneCount;
+    mReady.notify_all();
+}
+
+void StartupGraph::GetCriticalPath(std::vector<int> *path) const {
+    path->clear();
+    int last = -1;
+    for (int id = 0; id < (int) mTasks.size(); ++id) {
+        if (last < 0 || mTasks[id].endNs > mTasks[last].endNs) {
+            last = id;
+        }
+    }
+    // back through whichever dependency finished last, the one the task waited for
+    for (int id = last; id >= 0;) {
+        path->insert(path->begin(), id);
+        int gate = -1;
+        for (int dependency : mTasks[id].dependencies) {
+            if (gate < 0 || mTasks[dependency].endNs > mTasks[gate].endNs) {
+                gate = dependency;
+            }
+        }
+        id = gate;
+    }
+}
+
+void StartupGraph::Log() const {
+    int64_t busyNs = 0;
+    for (const Task &task : mTasks) {
+        ALOGI("StartupGraph: %-16s %7.2f .. %7.2f ms on %s %d", task.name,
+              (double) task.startNs / 1e6, (double) task.endNs / 1e6,
+              task.worker == 0 ? "caller" : "worker", task.worker);
+        busyNs += task.endNs - task.startNs;
+    }
+    std::vector<int> path;
+    GetCriticalPath(&path);
+    std::string names;
+    for (int id : path) {
+        char step[64];
+        snprintf(step, sizeof(step), "%s%s %.1f", names.empty() ? "" : " -> ", mTasks[id].name,
+                 (double) (mTasks[id].endNs - mTasks[id].startNs) / 1e6);
+        names += step;
+    }
+    ALOGI("StartupGraph: %d tasks in %.2f ms, %.2f ms of work; critical path %s ms",
+          (int) mTasks.size(), (double) mElapsedNs / 1e6, (double) busyNs / 1e6, names.c_str());
+}
@@ -0,0 +1,97 @@
+#ifndef agdktunnel_startup_graph_hpp
+#define agdktunnel_startup_graph_hpp
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// where a startup task may run
+#define STARTUP_ANY_THREAD 0
+// on the thread calling Run(), e.g. because it needs that thread's looper or JNI env
+#define STARTUP_CALLING_THREAD 1
+
+typedef void (*StartupFunction)(void *data);
+
+/*
+ * Startup work as a graph of tasks. Run() starts every task once the tasks it
+ * depends on are done, on a few worker threads and the calling thread, so
+ * independent work overlaps. Each task's start and end are recorded, and the
+ * critical path (the chain of tasks that decided when startup finished) is
+ * found from them afterwards.
+ *
+ * Tasks are added and the results read from one thread; tasks must not touch
+ * the graph.
+ */
+class StartupGraph {
+public:
+    struct Task {
+        // a string literal, it also names the task's trace scope
+        const char *name;
+        StartupFunction function;
+        void *data;
+        int thread;
+        std::vector<int> dependencies;
+
+        // from Run(), relative to its start
+        int64_t startNs;
+        int64_t endNs;
+        // 0 for the calling thread, workers from 1
+        int worker;
+    };
+
+    StartupGraph();
+
+    // returns the task's id; thread is STARTUP_ANY_THREAD or STARTUP_CALLING_THREAD
+    int AddTask(const char *name, StartupFunction function, void *data,
+                int thread = STARTUP_ANY_THREAD);
+
+    // task doesn't start before dependency is done; dependency must be added first
+    void AddDependency(int task, int dependency);
+
+    // Runs every task on workerCount threads besides the calling one, and
+    // returns when they are all done. Runs once.
+    void Run(int workerCount);
+
+    int GetTaskCount() const {
+        return (int) mTasks.size();
+    }
+
+    const Task &GetTask(int id) const {
+        return mTasks[id];
+    }
+
+    // from the start of Run() to the end of the last task
+    int64_t GetElapsedNs() const {
+        return mElapsedNs;
+    }
+
+    // the tasks of the critical path, first task first
+    void GetCriticalPath(std::vector<int> *path) const;
+
+    // the timeline of every task, then the critical path
+    void Log() const;
+
+private:
+    void WorkerMain(int worker);
+    // takes a task the worker may run, -1 once every task is done
+    int TakeTask(int worker);
+    void RunTask(int id, int worker);
+
+    std::vector<Task> mTasks;
+    // tasks waiting for each task
+    std::vector<std::vector<int>> mDependents;
+
+    std::mutex mLock;
+    std::condition_variable mReady;
+    // ready tasks, and how many dependencies the others still wait for
+    std::vector<int> mReadyAny;
+    std::vector<int> mReadyCalling;
+    std::vector<int> mWaitingFor;
+    int mDoneCount;
+
+    int64_t mStartNs;
+    int64_t mElapsedNs;
+};
+
+#endif
@@ -0,0 +1,300 @@
+#include "trace.hpp"
+#include <mutex>
+#include <cstring>
+#include <vector>
+#include "Log.h"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// scopes kept per thread, must be a power of two
+#define TRACE_RING_SIZE 16384
+
+// maximum number of threads that can record at once
+#define TRACE_MAX_THREADS 32
+
+// rings set aside when tracing starts for realtime threads, which may not allocate
+#define TRACE_SPARE_RINGS 2
+
+#define TRACE_THREAD_NAME_LENGTH 32
+
+namespace {
+    struct TraceEvent {
+        const char *name;
+        int64_t startNs;
+        int64_t durationNs;
+        uint64_t frame;
+    };
+
+    // written by the owning thread only, read by the exporter
+    struct ThreadRing {
+        std::atomic<uint64_t> head;
+        // a live thread writes to the ring
+        std::atomic<bool> owned;
+        int tid;
+        // sRegisterLock guards this
+        char name[TRACE_THREAD_NAME_LENGTH];
+        TraceEvent events[TRACE_RING_SIZE];
+    };
+
+    ThreadRing *sRings[TRACE_MAX_THREADS];
+    std::atomic<int> sRingCount(0);
+    std::mutex sRegisterLock;
+
+    thread_local ThreadRing *tRing = NULL;
+    thread_local bool tRegistrationFailed = false;
+    thread_local bool tRealtime = false;
+    thread_local char tThreadName[TRACE_THREAD_NAME_LENGTH] = "";
+
+    // Gives the thread's ring up when the thread exits. Its scopes stay in the
+    // ring and are exported under the next owner's name until overwritten.
+    struct RingOwner {
+        ThreadRing *ring = NULL;
+
+        ~RingOwner() {
+            if (ring != NULL) {
+                // pairs with the next owner's claim
+                ring->owned.store(false, std::memory_order_release);
+            }
+            tRing = NULL;
+            tRegistrationFailed = true;
+        }
+    };
+
+    thread_local RingOwner tRingOwner;
+
+    // called with sRegisterLock held; an empty name numbers the thread
+    void set_ring_name(ThreadRing *ring, const char *name) {
+        if (name[0] != '\0') {
+            strncpy(ring->name, name, sizeof(ring->name));
+        } else {
+            snprintf(ring->name, sizeof(ring->name), "Thread %d", ring->tid);
+        }
+        ring->name[sizeof(ring->name) - 1] = '\0';
+    }
+
+    bool claim_ring(ThreadRing *ring) {
+        bool owned = false;
+        return ring->owned.compare_exchange_strong(owned, true, std::memory_order_acquire,
+                                                   std::memory_order_relaxed);
+    }
+
+    // called with sRegisterLock held; the ring is published already owned, or free
+    ThreadRing *add_ring(bool owned) {
+        const int ringCount = sRingCount.load(std::memory_order_relaxed);
+        if (ringCount >= TRACE_MAX_THREADS) {
+            return NULL;
+        }
+        ThreadRing *ring = new ThreadRing;
+        ring->head.store(0, std::memory_order_relaxed);
+        ring->owned.store(owned, std::memory_order_relaxed);
+        ring->tid = ringCount + 1;
+        set_ring_name(ring, "");
+        sRings[ringCount] = ring;
+        sRingCount.store(ringCount + 1, std::memory_order_release);
+        return ring;
+    }
+
+    // called with sRegisterLock held
+    int count_free_rings() {
+        const int ringCount = sRingCount.load(std::memory_order_relaxed);
+        int freeCount = 0;
+        for (int i = 0; i < ringCount; ++i) {
+            freeCount += sRings[i]->owned.load(std::memory_order_relaxed) ? 0 : 1;
+        }
+        return freeCount;
+    }
+
+    void take_ring(ThreadRing *ring) {
+        tRingOwner.ring = ring;
+        tRing = ring;
+    }
+
+    // A realtime thread only claims a ring that is already there. Without the
+    // lock it leaves the ring named after its last owner.
+    ThreadRing *get_realtime_ring() {
+        const int ringCount = sRingCount.load(std::memory_order_acquire);
+        for (int i = 0; i < ringCount; ++i) {
+            ThreadRing *ring = sRings[i];
+            if (!ring->owned.load(std::memory_order_relaxed) && claim_ring(ring)) {
+                std::unique_lock<std::mutex> lock(sRegisterLock, std::try_to_lock);
+                if (lock.owns_lock()) {
+                    set_ring_name(ring, tThreadName);
+                }
+                take_ring(ring);
+                return ring;
+            }
+        }
+        // the next scope looks again
+        return NULL;
+    }
+
+    ThreadRing *get_thread_ring() {
+        if (tRing != NULL || tRegistrationFailed) {
+            return tRing;
+        }
+        if (tRealtime) {
+            return get_realtime_ring();
+        }
+
+        // the spares are kept for realtime threads while more rings can be added
+        std::lock_guard<std::mutex> lock(sRegisterLock);
+        ThreadRing *ring = NULL;
+        if (count_free_rings() <= TRACE_SPARE_RINGS) {
+            ring = add_ring(true);
+        }
+        const int ringCount = sRingCount.load(std::memory_order_relaxed);
+        for (int i = 0; i < ringCount && ring == NULL; ++i) {
+            ring = claim_ring(sRings[i]) ? sRings[i] : NULL;
+        }
+        if (ring == NULL) {
+            tRegistrationFailed = true;
+            return NULL;
+        }
+        set_ring_name(ring, tThreadName);
+        take_ring(ring);
+        return ring;
+    }
+
+    void write_json_string(FILE *file, const char *value) {
+        fputc('"', file);
+        for (const char *c = value; *c != '\0'; ++c) {
+            if (*c == '"' || *c == '\\') {
+                fputc('\\', file);
+                fputc(*c, file);
+            } else if ((unsigned char) *c < 0x20) {
+                fprintf(file, "\\u%04x", (unsigned char) *c);
+            } else {
+                fputc(*c, file);
+            }
+        }
+        fputc('"', file);
+    }
+}
+
+namespace Trace {
+
+    std::atomic<bool> sEnabled(false);
+    std::atomic<uint64_t> sFrame(0);
+
+    void Start() {
+        {
+            // realtime threads that first record from now on find a ring ready
+            std::lock_guard<std::mutex> lock(sRegisterLock);
+            int freeCount = count_free_rings();
+            while (freeCount < TRACE_SPARE_RINGS && add_ring(false) != NULL) {
+                ++freeCount;
+            }
+        }
+        sEnabled.store(true, std::memory_order_relaxed);
+    }
+
+    void Stop() {
+        sEnabled.store(false, std::memory_order_relaxed);
+    }
+
+    void SetThreadRealtime(const char *name) {
+        if (!tRealtime) {
+            strncpy(tThreadName, name, sizeof(tThreadName));
+            tThreadName[sizeof(tThreadName) - 1] = '\0';
+            tRealtime = true;
+        }
+    }
+
+    void SetThreadName(const char *name) {
+        strncpy(tThreadName, name, sizeof(tThreadName));
+        tThreadName[sizeof(tThreadName) - 1] = '\0';
+        if (tRing != NULL) {
+            // the exporter may be reading the old name, it only ever sees a terminated one
+            std::lock_guard<std::mutex> lock(sRegisterLock);
+            memcpy(tRing->name, tThreadName, sizeof(tRing->name));
+        }
+    }
+
+    void Record(const char *name, int64_t startNs, int64_t endNs, uint64_t frame) {
+        ThreadRing *ring = get_thread_ring();
+        if (ring == NULL) {
+            return;
+        }
+        const uint64_t head = ring->head.load(std::memory_order_relaxed);
+        TraceEvent &event = ring->events[head & (TRACE_RING_SIZE - 1)];
+        event.name = name;
+        event.startNs = startNs;
+        event.durationNs = endNs - startNs;
+        event.frame = frame;
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    int GetRingCount() {
+        return sRingCount.load(std::memory_order_relaxed);
+    }
+
+    bool WriteJson(FILE *file, uint64_t firstFrame, uint64_t lastFrame) {
+        std::vector<TraceEvent> events;
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+        bool first = true;
+        const int ringCount = sRingCount.load(std::memory_order_acquire);
+        for (int i = 0; i < ringCount; ++i) {
+            ThreadRing *ring = sRings[i];
+            if (ring->head.load(std::memory_order_acquire) == 0) {
+                // a spare nothing has recorded into yet
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(sRegisterLock);
+                fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                              "\"args\":{\"name\":", first ? "" : ",\n", ring->tid);
+                write_json_string(file, ring->name);
+                fprintf(file, "}}");
+            }
+            first = false;
+
+            // copy the ring, then drop whatever the owner may have overwritten meanwhile,
+            // including the slot it may be in the middle of writing
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            const uint64_t begin = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+            events.clear();
+            for (uint64_t index = begin; index < head; ++index) {
+                events.push_back(ring->events[index & (TRACE_RING_SIZE - 1)]);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t headAfter = ring->head.load(std::memory_order_relaxed);
+            const uint64_t valid = headAfter >= TRACE_RING_SIZE ? headAfter - TRACE_RING_SIZE + 1 : 0;
+
+            for (uint64_t index = begin; index < head; ++index) {
+                const TraceEvent &event = events[index - begin];
+                if (index < valid || event.frame < firstFrame || event.frame > lastFrame) {
+                    continue;
+                }
+                fprintf(file, ",\n{\"name\":");
+                write_json_string(file, event.name);
+                fprintf(file, ",\"cat\":\"engine\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                              "\"pid\":1,\"tid\":%d,\"args\":{\"frame\":%llu}}",
+                        (double) event.startNs / 1000.0, (double) event.durationNs / 1000.0,
+                        ring->tid, (unsigned long long) event.frame);
+            }
+        }
+
+        fprintf(file, "\n]}\n");
+        return ferror(file) == 0;
+    }
+
+    bool WriteJsonFile(const char *path, uint64_t firstFrame, uint64_t lastFrame) {
+        FILE *file = fopen(path, "w");
+        if (file == NULL) {
+            ALOGE("Trace: could not open %s", path);
+            return false;
+        }
+        bool ok = WriteJson(file, firstFrame, lastFrame);
+        if (fclose(file) != 0) {
+            ok = false;
+        }
+        if (!ok) {
+            ALOGE("Trace: failed to write %s", path);
+        } else {
+            ALOGI("Trace: wrote frames %llu-%llu to %s", (unsigned long long) firstFrame,
+                  (unsigned long long) lastFrame, path);
+        }
+        return ok;
+    }
+}
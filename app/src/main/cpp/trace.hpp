@@ -0,0 +1,101 @@
+#ifndef agdktunnel_trace_hpp
+#define agdktunnel_trace_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+
+/*
+ * Scoped-timer tracing. TRACE_SCOPE("name") records how long the enclosing scope
+ * took into a lock-free ring owned by the calling thread, tagged with the frame
+ * that was current when the scope began. While tracing is stopped a scope costs a
+ * relaxed load and a branch; defining TRACE_DISABLE compiles the scopes out.
+ * The rings are exported in the Chrome trace-event JSON format, which Perfetto
+ * and chrome://tracing both open.
+ *
+ * Names must be string literals (or otherwise outlive the trace). A thread's
+ * ring is taken the first time it records while tracing is running, reusing
+ * the ring of a thread that has exited or allocating a new one. Realtime threads
+ * take one of the rings set aside by Start() instead, without locking.
+ */
+namespace Trace {
+
+    extern std::atomic<bool> sEnabled;
+    extern std::atomic<uint64_t> sFrame;
+
+    inline bool IsEnabled() {
+        return sEnabled.load(std::memory_order_relaxed);
+    }
+
+    inline int64_t NowNs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+    void Start();
+
+    void Stop();
+
+    // the frame that scopes beginning from now on belong to, set by the game thread
+    inline void SetFrame(uint64_t frame) {
+        sFrame.store(frame, std::memory_order_relaxed);
+    }
+
+    inline uint64_t GetFrame() {
+        return sFrame.load(std::memory_order_relaxed);
+    }
+
+    // name shown for the calling thread, copied
+    void SetThreadName(const char *name);
+
+    // The calling thread, e.g. an audio callback's, records without locking or
+    // allocating; cheap to call again. Its scopes are dropped while no ring set
+    // aside by Start() is free.
+    void SetThreadRealtime(const char *name);
+
+    void Record(const char *name, int64_t startNs, int64_t endNs, uint64_t frame);
+
+    // rings allocated so far, in use or not
+    int GetRingCount();
+
+    // Writes the scopes of frames [firstFrame, lastFrame] that are still in the
+    // rings. Safe to call while other threads keep recording.
+    bool WriteJson(FILE *file, uint64_t firstFrame, uint64_t lastFrame);
+
+    bool WriteJsonFile(const char *path, uint64_t firstFrame, uint64_t lastFrame);
+}
+
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) : mName(name) {
+        mStartNs = Trace::IsEnabled() ? Trace::NowNs() : -1;
+        mFrame = mStartNs >= 0 ? Trace::GetFrame() : 0;
+    }
+
+    ~TraceScope() {
+        if (mStartNs >= 0) {
+            Trace::Record(mName, mStartNs, Trace::NowNs(), mFrame);
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *mName;
+    int64_t mStartNs;
+    uint64_t mFrame;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef TRACE_DISABLE
+#define TRACE_SCOPE(name) ((void) 0)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(_traceScope, __LINE__)(name)
+#endif
+
+#endif
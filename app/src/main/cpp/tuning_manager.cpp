@@ -18,34 +18,31 @@
 #include <android/configuration.h>
 #include <android/log.h>
 #include <dlfcn.h>
+#include <cstdio>
 #include <cstdlib>
+#include <vector>
 #include "pb_common.h"
+#include "pb_decode.h"
 #include "pb_encode.h"
 #include "swappy/swappyGL.h"
 #include "swappy/swappyGL_extra.h"
 #include "tuningfork/tuningfork.h"
 #include "tuningfork/tuningfork_extra.h"
-//#include "game_consts.hpp"
+#include "game_consts.hpp"
+#include "resolution_controller.hpp"
+#include "startup_graph.hpp"
+#include "trace.hpp"
 #include "tuning_manager.hpp"
 
 #include "Log.h"
 #define LOG_TAG "GameActivityTutorial"
 
-// length of each tunnel section
-#define TUNNEL_SECTION_LENGTH 150.0f
+// size of each buffer of the annotation serialization arena
+#define SERIALIZATION_ARENA_SIZE 1024
 
-// number of tunnel sections to render ahead
-#define RENDER_TUNNEL_SECTION_COUNT 4
-
-/** @cond INTERNAL */
-
-/**
- * Internal to this file - do not use.
- */
-extern "C" void TuningFork_CProtobufSerialization_Dealloc(
-        TuningFork_CProtobufSerialization *c);
-
-/** @endcond */
+static_assert(com_google_tuningfork_ResolutionScale_SCALE_50 -
+              com_google_tuningfork_ResolutionScale_SCALE_100 + 1 == RESOLUTION_STEP_COUNT,
+              "one ResolutionScale annotation value per resolution step");
 
 namespace {
     constexpr TuningFork_InstrumentKey TFTICK_CHOREOGRAPHER = TFTICK_USERDEFINED_BASE;
@@ -59,6 +56,15 @@ namespace {
 
     func_AChoreographer_postFrameCallback64 pAChoreographer_postFrameCallback64 = nullptr;
 
+    // Tuning Fork's fidelity callback carries no user data
+    TuningManager *sTuningManager = nullptr;
+
+    void fidelity_params_callback(const TuningFork_CProtobufSerialization *params) {
+        if (sTuningManager != nullptr) {
+            sTuningManager->ReceiveFidelityParams(params, true);
+        }
+    }
+
     void choreographer_callback(long /*frameTimeNanos*/, void *data) {
         TuningManager *tuningManager = reinterpret_cast<TuningManager *>(data);
         tuningManager->HandleChoreographerFrame();
@@ -69,8 +75,11 @@ namespace {
         tuningManager->HandleChoreographerFrame();
     }
 
+    // The bytes come from the arena, so the serialization must not be freed; it
+    // stays valid until the arena's second EndFrame() after this call.
     bool serialize_annotation(TuningFork_CProtobufSerialization &cser,
-                              const _com_google_tuningfork_Annotation *annotation) {
+                              const _com_google_tuningfork_Annotation *annotation,
+                              FrameArena *arena) {
         bool success = false;
         cser.bytes = NULL;
         cser.size = 0;
@@ -78,9 +87,9 @@ namespace {
         size_t encodedSize = 0;
         if (pb_get_encoded_size(&encodedSize, com_google_tuningfork_Annotation_fields,
                                 annotation)) {
-            cser.bytes = (uint8_t *) ::malloc(encodedSize);
+            cser.bytes = arena->AllocateArray<uint8_t>(encodedSize);
             cser.size = encodedSize;
-            cser.dealloc = TuningFork_CProtobufSerialization_Dealloc;
+            cser.dealloc = NULL;
 
             pb_ostream_t pbStream = pb_ostream_from_buffer(cser.bytes, encodedSize);
             pb_encode(&pbStream, com_google_tuningfork_Annotation_fields, annotation);
@@ -90,8 +99,19 @@ namespace {
     }
 }
 
-TuningManager::TuningManager(JNIEnv *env, jobject activity, AConfiguration *config) {
+TuningManager::TuningManager(JNIEnv *env, jobject activity, bool warmStart)
+        : mSerializationArena(SERIALIZATION_ARENA_SIZE) {
     mTFInitialized = false;
+    mWarmStart = warmStart;
+    mLoadingStartNs = Trace::NowNs();
+    mStartupNs = 0;
+    mPendingFidelityParams.tunnelSectionCount = RENDER_TUNNEL_SECTION_COUNT;
+    mPendingFidelityParams.tunnelSectionLength = TUNNEL_SECTION_LENGTH;
+    mFidelityParamsChanged = false;
+    mAnnotation.loading = com_google_tuningfork_LoadingState_LOADING;
+    mAnnotation.level = com_google_tuningfork_Level_STARTUP;
+    mAnnotation.resolution_scale = com_google_tuningfork_ResolutionScale_SCALE_100;
+    sTuningManager = this;
 
     TuningFork_Settings settings{};
 
@@ -109,12 +129,12 @@ TuningManager::TuningManager(JNIEnv *env, jobject activity, AConfiguration *conf
     settings.endpoint_uri_override = "http://localhost:9000";
 #endif
 
+    // Parameters downloaded for this device replace the training ones at runtime
+    settings.fidelity_params_callback = fidelity_params_callback;
+
     /*
-     * AGDKTunnel doesn't have 'dynamic' settings, we are going to fake
-     * them by checking against what we consider  'low' and 'high' values
-     * for the RENDER_TUNNEL_SECTION_COUNT and TUNNEL_SECTION_LENGTH constants
-     * defined in game_consts.hpp and setting the corresponding fidelity level
-     * for our reporting
+     * Start from the training fidelity level matching the defaults in
+     * game_consts.hpp; the tunnel follows whatever parameters arrive later.
      */
     TuningFork_CProtobufSerialization fps = {};
     bool bHighDensity = (RENDER_TUNNEL_SECTION_COUNT == 8 && TUNNEL_SECTION_LENGTH == 75.0f);
@@ -125,6 +145,8 @@ TuningManager::TuningManager(JNIEnv *env, jobject activity, AConfiguration *conf
         // This overrides the value in default_fidelity_parameters_filename
         //  in tuningfork_settings, if it is there.
         settings.training_fidelity_params = &fps;
+        // the engine already starts at this level, or at the one a snapshot restored
+        ReceiveFidelityParams(&fps, false);
     } else {
         ALOGE("Couldn't load fidelity params from %s", filename);
     }
@@ -139,11 +161,10 @@ TuningManager::TuningManager(JNIEnv *env, jobject activity, AConfiguration *conf
 
     // Free any fidelity params we got from the APK
     TuningFork_CProtobufSerialization_free(&fps);
-
-    InitializeChoreographerCallback(config);
 }
 
 TuningManager::~TuningManager() {
+    sTuningManager = nullptr;
     if (mTFInitialized) {
         TuningFork_ErrorCode tfError = TuningFork_destroy();
         if (tfError != TUNINGFORK_ERROR_OK) {
@@ -201,42 +222,132 @@ void TuningManager::PostFrameTick(const TuningFork_InstrumentKey frameKey) {
 
 void TuningManager::SetCurrentAnnotation(const _com_google_tuningfork_Annotation *annotation) {
     TuningFork_CProtobufSerialization cser;
-    if (serialize_annotation(cser, annotation)) {
+    if (serialize_annotation(cser, annotation, &mSerializationArena)) {
         if (TuningFork_setCurrentAnnotation(&cser) != TUNINGFORK_ERROR_OK) {
             ALOGW("Bad annotation passed to TuningFork_setCurrentAnnotation");
         }
-        TuningFork_CProtobufSerialization_free(&cser);
+        mSerializationArena.EndFrame();
     } else {
         ALOGE("Failed to calculate annotation encode size");
     }
 }
 
 void TuningManager::StartLoading() {
+    mLoadingStartNs = Trace::NowNs();
+
     // Initial annotation of our state
-    _com_google_tuningfork_Annotation annotation;
-    annotation.loading = com_google_tuningfork_LoadingState_LOADING;
-    annotation.level = com_google_tuningfork_Level_STARTUP;
-    SetCurrentAnnotation(&annotation);
+    mAnnotation.loading = com_google_tuningfork_LoadingState_LOADING;
+    mAnnotation.level = com_google_tuningfork_Level_STARTUP;
+    SetCurrentAnnotation(&mAnnotation);
 
     // Setup loading start
     TuningFork_CProtobufSerialization cser;
-    if (serialize_annotation(cser, &annotation)) {
-        startupLoadingMetadata.state =
+    if (serialize_annotation(cser, &mAnnotation, &mSerializationArena)) {
+        // a warm start resumes from the snapshot the killed process saved
+        startupLoadingMetadata.state = mWarmStart ?
+                TuningFork_LoadingTimeMetadata::LoadingState::WARM_START :
                 TuningFork_LoadingTimeMetadata::LoadingState::COLD_START;
         startupLoadingMetadata.network_latency_ns = 1234567;
         TuningFork_startRecordingLoadingTime(&startupLoadingMetadata,
                                              sizeof(TuningFork_LoadingTimeMetadata),
                                              &cser,
                                              &startupLoadingHandle);
-        TuningFork_CProtobufSerialization_free(&cser);
+        mSerializationArena.EndFrame();
     }
 }
 
 void TuningManager::FinishLoading() {
     TuningFork_stopRecordingLoadingTime(startupLoadingHandle);
+    // what of the loading time went to starting up, and which tasks it waited on
+    ALOGI("TuningManager: %s start loaded in %.1f ms; startup took %.1f ms of it, "
+          "critical path %s", mWarmStart ? "warm" : "cold",
+          (double) (Trace::NowNs() - mLoadingStartNs) / 1e6, (double) mStartupNs / 1e6,
+          mStartupCriticalPath.c_str());
+
+    mAnnotation.loading = com_google_tuningfork_LoadingState_NOT_LOADING;
+    mAnnotation.level = com_google_tuningfork_Level_LEVEL_1;
+    SetCurrentAnnotation(&mAnnotation);
+}
 
-    _com_google_tuningfork_Annotation annotation;
-    annotation.loading = com_google_tuningfork_LoadingState_NOT_LOADING;
-    annotation.level = com_google_tuningfork_Level_LEVEL_1;
-    SetCurrentAnnotation(&annotation);
+void TuningManager::ReportStartup(const StartupGraph &graph) {
+    std::vector<int> path;
+    graph.GetCriticalPath(&path);
+    mStartupCriticalPath.clear();
+    for (int id : path) {
+        const StartupGraph::Task &task = graph.GetTask(id);
+        char step[64];
+        snprintf(step, sizeof(step), "%s%s %.1f ms", mStartupCriticalPath.empty() ? "" : " -> ",
+                 task.name, (double) (task.endNs - task.startNs) / 1e6);
+        mStartupCriticalPath += step;
+    }
+    mStartupNs = graph.GetElapsedNs();
+}
+
+void TuningManager::ReportResolutionStep(int step) {
+    // frame times are then histogrammed per resolution
+    mAnnotation.resolution_scale = (com_google_tuningfork_ResolutionScale)
+            (com_google_tuningfork_ResolutionScale_SCALE_100 + step);
+    if (mTFInitialized) {
+        SetCurrentAnnotation(&mAnnotation);
+    }
+}
+
+void TuningManager::ReceiveFidelityParams(const TuningFork_CProtobufSerialization *params,
+                                          bool changed) {
+    com_google_tuningfork_FidelityParams decoded = {};
+    pb_istream_t pbStream = pb_istream_from_buffer(params->bytes, params->size);
+    if (!pb_decode(&pbStream, com_google_tuningfork_FidelityParams_fields, &decoded)) {
+        ALOGE("TuningManager: couldn't decode fidelity params");
+        return;
+    }
+    if (decoded.tunnel_section_count < 1 || !(decoded.tunnel_section_length > 0.0f)) {
+        ALOGW("TuningManager: ignoring fidelity params with %d sections of length %.1f",
+              (int) decoded.tunnel_section_count, (double) decoded.tunnel_section_length);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mFidelityLock);
+    mPendingFidelityParams.tunnelSectionCount =
+            decoded.tunnel_section_count < MAX_TUNNEL_SECTION_COUNT ?
+            (int) decoded.tunnel_section_count : MAX_TUNNEL_SECTION_COUNT;
+    mPendingFidelityParams.tunnelSectionLength = decoded.tunnel_section_length;
+    mFidelityParamsChanged = mFidelityParamsChanged || changed;
+}
+
+bool TuningManager::PollFidelityParams(FidelityParams *params) {
+    std::lock_guard<std::mutex> lock(mFidelityLock);
+    if (!mFidelityParamsChanged) {
+        return false;
+    }
+    *params = mPendingFidelityParams;
+    mFidelityParamsChanged = false;
+    return true;
+}
+
+void TuningManager::ReportFidelityParams(const FidelityParams &params) {
+    if (!mTFInitialized) {
+        return;
+    }
+    com_google_tuningfork_FidelityParams encoded = {};
+    encoded.tunnel_section_count = params.tunnelSectionCount;
+    encoded.tunnel_section_length = params.tunnelSectionLength;
+
+    size_t encodedSize = 0;
+    if (!pb_get_encoded_size(&encodedSize, com_google_tuningfork_FidelityParams_fields,
+                             &encoded)) {
+        ALOGE("TuningManager: failed to calculate fidelity params encode size");
+        return;
+    }
+    TuningFork_CProtobufSerialization cser;
+    cser.bytes = mSerializationArena.AllocateArray<uint8_t>(encodedSize);
+    cser.size = encodedSize;
+    cser.dealloc = NULL;
+    pb_ostream_t pbStream = pb_ostream_from_buffer(cser.bytes, encodedSize);
+    pb_encode(&pbStream, com_google_tuningfork_FidelityParams_fields, &encoded);
+
+    // Tuning Fork keeps separate histograms per fidelity level from here on
+    if (TuningFork_setFidelityParameters(&cser) != TUNINGFORK_ERROR_OK) {
+        ALOGW("TuningManager: TuningFork_setFidelityParameters failed");
+    }
+    mSerializationArena.EndFrame();
 }
@@ -18,21 +18,46 @@
 #define agdktunnel_tuning_manager_hpp
 
 //#include "common.hpp"
+#include <mutex>
+#include <string>
+#include "frame_arena.hpp"
 #include "nano/dev_tuningfork.pb.h"
 #include "nano/tuningfork.pb.h"
+#include "performance_reporter.hpp"
+#include "tuningfork/tuningfork.h"
 
 struct AConfiguration;
 
-class TuningManager {
+class TuningManager : public PerformanceReporter {
 private:
     bool mTFInitialized;
+    // loading is recorded as a warm start, the game resumes from a snapshot
+    bool mWarmStart;
+    int64_t mLoadingStartNs;
 
-    void InitializeChoreographerCallback(AConfiguration *config);
+    // reported with the loading time
+    int64_t mStartupNs;
+    std::string mStartupCriticalPath;
+
+    // serialized annotations only live until Tuning Fork has copied them
+    FrameArena mSerializationArena;
+
+    // Fidelity parameters waiting for the game thread. Tuning Fork delivers
+    // downloaded parameters on its own thread, hence the lock.
+    std::mutex mFidelityLock;
+    FidelityParams mPendingFidelityParams;
+    bool mFidelityParamsChanged;
+
+    // the annotation frames are currently recorded under
+    _com_google_tuningfork_Annotation mAnnotation;
 
 public:
-    TuningManager(JNIEnv *env, jobject context, AConfiguration *config);
+    TuningManager(JNIEnv *env, jobject context, bool warmStart);
+
+    ~TuningManager() override;
 
-    ~TuningManager();
+    // must be called on a thread with a looper, the choreographer calls back on it
+    void InitializeChoreographerCallback(AConfiguration *config);
 
     void HandleChoreographerFrame();
 
@@ -40,9 +65,21 @@ public:
 
     void SetCurrentAnnotation(const _com_google_tuningfork_Annotation *annotation);
 
-    void StartLoading();
+    void StartLoading() override;
+
+    void FinishLoading() override;
+
+    bool PollFidelityParams(FidelityParams *params) override;
+
+    void ReportFidelityParams(const FidelityParams &params) override;
+
+    void ReportResolutionStep(int step) override;
+
+    void ReportStartup(const StartupGraph &graph) override;
 
-    void FinishLoading();
+    // Decodes serialized FidelityParams for the game thread; only changed ones
+    // are handed to it by PollFidelityParams().
+    void ReceiveFidelityParams(const TuningFork_CProtobufSerialization *params, bool changed);
 };
 
 #endif
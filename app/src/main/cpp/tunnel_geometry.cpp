@@ -0,0 +1,201 @@
+#include "tunnel_geometry.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include "Log.h"
+#include "simd.hpp"
+
+#define LOG_TAG "GameActivityTutorial"
+
+// how far and how quickly the tunnel's centre line winds
+#define TUNNEL_BEND_X 30.0f
+#define TUNNEL_BEND_Y 18.0f
+#define TUNNEL_BEND_FREQUENCY_X 0.0041f
+#define TUNNEL_BEND_FREQUENCY_Y 0.0027f
+
+// texture repeats along each section
+#define TUNNEL_TEXTURE_REPEAT_V 4.0f
+
+static_assert(TUNNEL_RING_SEGMENTS % 4 == 0, "TUNNEL_RING_SEGMENTS must be a multiple of 4");
+static_assert(TUNNEL_SECTION_VERTEX_SLOTS <= 65536, "tunnel section indices must fit 16 bits");
+
+float TunnelGeometry::sRingCos[TUNNEL_RING_STRIDE];
+float TunnelGeometry::sRingSin[TUNNEL_RING_STRIDE];
+float TunnelGeometry::sRingU[TUNNEL_RING_STRIDE];
+uint16_t TunnelGeometry::sIndices[TUNNEL_SECTION_INDEX_COUNT];
+
+namespace {
+    std::once_flag sTablesOnce;
+
+    int64_t floor_div(float z, float length) {
+        return (int64_t) floorf(z / length);
+    }
+}
+
+void TunnelGeometry::InitTables() {
+    for (int i = 0; i < TUNNEL_RING_STRIDE; ++i) {
+        // the seam vertex repeats the first one with u = 1, padding repeats the seam
+        const int segment = i <= TUNNEL_RING_SEGMENTS ? i : TUNNEL_RING_SEGMENTS;
+        const float angle = 2.0f * (float) M_PI * (float) segment / TUNNEL_RING_SEGMENTS;
+        sRingCos[i] = cosf(angle);
+        sRingSin[i] = sinf(angle);
+        sRingU[i] = (float) segment / TUNNEL_RING_SEGMENTS;
+    }
+
+    int n = 0;
+    for (int ring = 0; ring < TUNNEL_RINGS_PER_SECTION; ++ring) {
+        for (int segment = 0; segment < TUNNEL_RING_SEGMENTS; ++segment) {
+            const uint16_t a = (uint16_t) (ring * TUNNEL_RING_STRIDE + segment);
+            const uint16_t b = (uint16_t) (a + 1);
+            const uint16_t c = (uint16_t) (a + TUNNEL_RING_STRIDE);
+            const uint16_t d = (uint16_t) (c + 1);
+            // wound to face the inside of the tunnel
+            sIndices[n++] = a;
+            sIndices[n++] = c;
+            sIndices[n++] = b;
+            sIndices[n++] = b;
+            sIndices[n++] = c;
+            sIndices[n++] = d;
+        }
+    }
+}
+
+TunnelGeometry::TunnelGeometry() {
+    std::call_once(sTablesOnce, InitTables);
+
+    // five streams per pool, one allocation for all of them
+    const size_t floatsPerPool = 5 * TUNNEL_SECTION_VERTEX_SLOTS;
+    mVertexData = new float[floatsPerPool * MAX_TUNNEL_SECTION_COUNT];
+    for (int i = 0; i < MAX_TUNNEL_SECTION_COUNT; ++i) {
+        Section &pool = mPools[i];
+        float *data = mVertexData + floatsPerPool * i;
+        pool.index = -1;
+        pool.startZ = 0.0f;
+        pool.length = 0.0f;
+        pool.version = 0;
+        pool.x = data;
+        pool.y = data + TUNNEL_SECTION_VERTEX_SLOTS;
+        pool.z = data + 2 * TUNNEL_SECTION_VERTEX_SLOTS;
+        pool.u = data + 3 * TUNNEL_SECTION_VERTEX_SLOTS;
+        pool.v = data + 4 * TUNNEL_SECTION_VERTEX_SLOTS;
+    }
+
+    mFirstSection = 0;
+    mSectionCount = 0;
+    mSectionLength = 0.0f;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+TunnelGeometry::~TunnelGeometry() {
+    delete[] mVertexData;
+}
+
+void TunnelGeometry::GetCenter(float z, float *x, float *y) {
+    *x = TUNNEL_BEND_X * sinf(z * TUNNEL_BEND_FREQUENCY_X);
+    *y = TUNNEL_BEND_Y * cosf(z * TUNNEL_BEND_FREQUENCY_Y);
+}
+
+void TunnelGeometry::BuildSection(Section *section, int64_t index, float length) {
+    // also called without an instance, by tools
+    std::call_once(sTablesOnce, InitTables);
+
+    section->index = index;
+    section->startZ = (float) index * length;
+    section->length = length;
+    ++section->version;
+
+    const Float4 radius = Float4Set1(TUNNEL_RADIUS);
+    Float4 minX = Float4Set1(INFINITY), maxX = Float4Set1(-INFINITY);
+    Float4 minY = minX, maxY = maxX;
+    const float ringSpacing = length / TUNNEL_RINGS_PER_SECTION;
+    for (int ring = 0; ring <= TUNNEL_RINGS_PER_SECTION; ++ring) {
+        const float z = section->startZ + ringSpacing * (float) ring;
+        float centerX, centerY;
+        GetCenter(z, &centerX, &centerY);
+
+        const Float4 cx = Float4Set1(centerX);
+        const Float4 cy = Float4Set1(centerY);
+        const Float4 cz = Float4Set1(z);
+        const Float4 cv = Float4Set1(TUNNEL_TEXTURE_REPEAT_V * (float) ring /
+                                     TUNNEL_RINGS_PER_SECTION);
+        const int base = ring * TUNNEL_RING_STRIDE;
+        for (int i = 0; i < TUNNEL_RING_STRIDE; i += 4) {
+            const Float4 x = Float4MulAdd(Float4Load(&sRingCos[i]), radius, cx);
+            const Float4 y = Float4MulAdd(Float4Load(&sRingSin[i]), radius, cy);
+            Float4Store(&section->x[base + i], x);
+            Float4Store(&section->y[base + i], y);
+            Float4Store(&section->z[base + i], cz);
+            Float4Store(&section->u[base + i], Float4Load(&sRingU[i]));
+            Float4Store(&section->v[base + i], cv);
+            minX = Float4Min(minX, x);
+            maxX = Float4Max(maxX, x);
+            minY = Float4Min(minY, y);
+            maxY = Float4Max(maxY, y);
+        }
+    }
+
+    // the sphere around the section's box; padding lanes repeat real vertices
+    float lanes[4][4];
+    Float4Store(lanes[0], minX);
+    Float4Store(lanes[1], maxX);
+    Float4Store(lanes[2], minY);
+    Float4Store(lanes[3], maxY);
+    const float x0 = fminf(fminf(lanes[0][0], lanes[0][1]), fminf(lanes[0][2], lanes[0][3]));
+    const float x1 = fmaxf(fmaxf(lanes[1][0], lanes[1][1]), fmaxf(lanes[1][2], lanes[1][3]));
+    const float y0 = fminf(fminf(lanes[2][0], lanes[2][1]), fminf(lanes[2][2], lanes[2][3]));
+    const float y1 = fmaxf(fmaxf(lanes[3][0], lanes[3][1]), fmaxf(lanes[3][2], lanes[3][3]));
+    const float halfX = (x1 - x0) * 0.5f, halfY = (y1 - y0) * 0.5f, halfZ = length * 0.5f;
+    section->center[0] = x0 + halfX;
+    section->center[1] = y0 + halfY;
+    section->center[2] = section->startZ + halfZ;
+    section->radius = sqrtf(halfX * halfX + halfY * halfY + halfZ * halfZ);
+}
+
+int TunnelGeometry::Update(float cameraZ, int sectionCount, float sectionLength, int maxBuilds) {
+    if (sectionCount > MAX_TUNNEL_SECTION_COUNT) {
+        sectionCount = MAX_TUNNEL_SECTION_COUNT;
+    }
+    if (sectionCount < 1 || !(sectionLength > 0.0f)) {
+        return 0;
+    }
+
+    if (sectionLength != mSectionLength) {
+        // every section boundary moves, nothing built so far can be reused
+        for (int i = 0; i < MAX_TUNNEL_SECTION_COUNT; ++i) {
+            mPools[i].index = -1;
+        }
+        if (mSectionLength != 0.0f) {
+            ++mStats.resets;
+        }
+        mSectionLength = sectionLength;
+    }
+    mSectionCount = sectionCount;
+    mFirstSection = floor_div(cameraZ, sectionLength);
+
+    int built = 0;
+    for (int i = 0; i < sectionCount && built < maxBuilds; ++i) {
+        const int64_t index = mFirstSection + i;
+        Section &pool = mPools[((index % MAX_TUNNEL_SECTION_COUNT) + MAX_TUNNEL_SECTION_COUNT) %
+                               MAX_TUNNEL_SECTION_COUNT];
+        if (pool.index != index) {
+            BuildSection(&pool, index, sectionLength);
+            ++built;
+        }
+    }
+    mStats.sectionsBuilt += built;
+    return built;
+}
+
+int TunnelGeometry::GetWindowSections(const Section **sections, int maxSections) const {
+    int count = 0;
+    for (int i = 0; i < mSectionCount && count < maxSections; ++i) {
+        const int64_t index = mFirstSection + i;
+        const Section &pool = mPools[((index % MAX_TUNNEL_SECTION_COUNT) +
+                                      MAX_TUNNEL_SECTION_COUNT) % MAX_TUNNEL_SECTION_COUNT];
+        if (pool.index == index) {
+            sections[count++] = &pool;
+        }
+    }
+    return count;
+}
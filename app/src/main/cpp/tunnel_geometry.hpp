@@ -0,0 +1,100 @@
+#ifndef agdktunnel_tunnel_geometry_hpp
+#define agdktunnel_tunnel_geometry_hpp
+
+#include <cstdint>
+#include "game_consts.hpp"
+
+// vertices per ring including the seam vertex, padded to whole SIMD vectors
+#define TUNNEL_RING_STRIDE ((TUNNEL_RING_SEGMENTS + 1 + 3) & ~3)
+
+// vertex slots per section, padding included
+#define TUNNEL_SECTION_VERTEX_SLOTS ((TUNNEL_RINGS_PER_SECTION + 1) * TUNNEL_RING_STRIDE)
+
+// indices of one section, two triangles per quad
+#define TUNNEL_SECTION_INDEX_COUNT (TUNNEL_RINGS_PER_SECTION * TUNNEL_RING_SEGMENTS * 6)
+
+/*
+ * Streams procedural tunnel sections ahead of the camera. Section i covers
+ * z in [i * length, (i + 1) * length) and lives in vertex pool i modulo
+ * MAX_TUNNEL_SECTION_COUNT, so the pools form a ring that sections behind the
+ * camera are recycled from; all memory is allocated once, up front.
+ *
+ * Vertices are stored as separate streams (x, y, z, u, v), each with
+ * TUNNEL_RING_STRIDE slots per ring, and are generated four at a time. Every
+ * section shares the same index list.
+ */
+class TunnelGeometry {
+public:
+    struct Section {
+        // section number, -1 while the pool holds nothing
+        int64_t index;
+        float startZ;
+        float length;
+
+        // incremented whenever the pool is rebuilt, so uploads know when to refresh
+        uint32_t version;
+
+        // bounding sphere, for culling
+        float center[3];
+        float radius;
+
+        float *x, *y, *z;
+        float *u, *v;
+    };
+
+    struct Stats {
+        uint64_t sectionsBuilt;
+        // times a change of section length threw every section away
+        uint64_t resets;
+    };
+
+    TunnelGeometry();
+
+    ~TunnelGeometry();
+
+    TunnelGeometry(const TunnelGeometry &) = delete;
+    TunnelGeometry &operator=(const TunnelGeometry &) = delete;
+
+    // Makes sure the sectionCount sections from the one containing cameraZ are
+    // built, nearest first, building at most maxBuilds of them. Returns how many
+    // were built.
+    int Update(float cameraZ, int sectionCount, float sectionLength, int maxBuilds);
+
+    // Fills sections with the built sections of the current window, nearest first.
+    // Returns their number.
+    int GetWindowSections(const Section **sections, int maxSections) const;
+
+    static const uint16_t *GetIndices() {
+        return sIndices;
+    }
+
+    const Stats &GetStats() const {
+        return mStats;
+    }
+
+    // generates the vertices of section index into section's streams
+    static void BuildSection(Section *section, int64_t index, float length);
+
+    // x and y of the tunnel's centre line at depth z
+    static void GetCenter(float z, float *x, float *y);
+
+private:
+    static void InitTables();
+
+    Section mPools[MAX_TUNNEL_SECTION_COUNT];
+    float *mVertexData;
+
+    int64_t mFirstSection;
+    int mSectionCount;
+    float mSectionLength;
+
+    Stats mStats;
+
+    // cos and sin of each vertex angle, and its u, for every slot of a ring
+    static float sRingCos[TUNNEL_RING_STRIDE];
+    static float sRingSin[TUNNEL_RING_STRIDE];
+    static float sRingU[TUNNEL_RING_STRIDE];
+    static uint16_t sIndices[TUNNEL_SECTION_INDEX_COUNT];
+};
+
+#endif